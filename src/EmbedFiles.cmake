@@ -0,0 +1,22 @@
+# Writes files into a C++ header as null-terminated char arrays, plus a table that maps each file
+# name to its contents. Used for the GLSL shaders of the OpenGL backend and the headers they
+# include, which are compiled by the driver at runtime. The including code declares the table type:
+#   struct EmbeddedFile { const char *name; const char *contents; };
+#
+# Usage: cmake -DOUTPUT=<header> -DTABLE=<table name> -DFILES=<file|file|...> -P EmbedFiles.cmake
+
+string(REPLACE "|" ";" FILES "${FILES}")
+set(CONTENT "// generated by EmbedFiles.cmake, do not edit\n#pragma once\n\n")
+set(TABLE_ENTRIES "")
+set(INDEX 0)
+foreach(FILE ${FILES})
+	get_filename_component(NAME ${FILE} NAME)
+	file(READ ${FILE} HEX_CONTENTS HEX)
+	string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," HEX_CONTENTS "${HEX_CONTENTS}")
+	string(REGEX REPLACE "(0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,)" "\\1\n" HEX_CONTENTS "${HEX_CONTENTS}")
+	set(CONTENT "${CONTENT}static const unsigned char ${TABLE}_${INDEX}[] = {\n${HEX_CONTENTS}0x00\n};\n\n")
+	set(TABLE_ENTRIES "${TABLE_ENTRIES}\t{ \"${NAME}\", (const char*)${TABLE}_${INDEX} },\n")
+	math(EXPR INDEX "${INDEX} + 1")
+endforeach()
+set(CONTENT "${CONTENT}static const EmbeddedFile ${TABLE}[] = {\n${TABLE_ENTRIES}};\n")
+file(WRITE ${OUTPUT} "${CONTENT}")
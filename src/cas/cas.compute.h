@@ -20,6 +20,12 @@ void CasInput(inout AF1 r, inout AF1 g, inout AF1 b) {}
 
 #include "ffx_cas.h"
 
+#if OUTPUT_DITHER
+#include "../fsr/fsr_dither.h"
+#else
+float3 DitherOutput(float3 c, uint2 p) { return c; }
+#endif
+
 [numthreads(64, 1, 1)]
 void main(uint3 LocalThreadId : SV_GroupThreadID, uint3 WorkGroupId : SV_GroupID) {
 	AU2 gxy = ARmp8x8( LocalThreadId.x ) + AU2(WorkGroupId.x << 4u, WorkGroupId.y << 4u);
@@ -32,17 +38,17 @@ void main(uint3 LocalThreadId : SV_GroupThreadID, uint3 WorkGroupId : SV_GroupID
 	AF3 c;
 
 	CasFilter(c.r, c.g, c.b, gxy, const0, const1, sharpenOnly);
-	OutputTexture[ASU2(gxy)] = AF4(c, 1);
+	OutputTexture[ASU2(gxy)] = AF4(DitherOutput(c, gxy), 1);
 	gxy.x += 8u;
 
 	CasFilter(c.r, c.g, c.b, gxy, const0, const1, sharpenOnly);
-	OutputTexture[ASU2(gxy)] = AF4(c, 1);
+	OutputTexture[ASU2(gxy)] = AF4(DitherOutput(c, gxy), 1);
 	gxy.y += 8u;
 
 	CasFilter(c.r, c.g, c.b, gxy, const0, const1, sharpenOnly);
-	OutputTexture[ASU2(gxy)] = AF4(c, 1);
+	OutputTexture[ASU2(gxy)] = AF4(DitherOutput(c, gxy), 1);
 	gxy.x -= 8u;
 
 	CasFilter(c.r, c.g, c.b, gxy, const0, const1, sharpenOnly);
-	OutputTexture[ASU2(gxy)] = AF4(c, 1);
+	OutputTexture[ASU2(gxy)] = AF4(DitherOutput(c, gxy), 1);
 }
\ No newline at end of file
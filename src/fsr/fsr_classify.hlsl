@@ -0,0 +1,49 @@
+// Tile classification prepass: finds the output tiles whose part of the input is so flat that EASU
+// and RCAS can't do better there than bilinear filtering and a copy. One workgroup per 16x16 pixel
+// tile, the footprint of the EASU and RCAS workgroups, which read its result to skip those tiles.
+
+cbuffer cb : register(b0) {
+	uint2 InputSize;
+	// input pixels per output pixel
+	float2 Scale;
+	// luma range below which a tile counts as flat
+	float Threshold;
+};
+
+Texture2D<float4> InputTexture : register(t0);
+// 1 for flat tiles, one texel per tile
+RWTexture2D<uint> FlatTiles : register(u0);
+
+// luma range of the tile's input, as the bits of non-negative floats, which order like the floats
+groupshared uint TileMin;
+groupshared uint TileMax;
+
+[numthreads(8, 8, 1)]
+void main(uint3 LocalThreadId : SV_GroupThreadID, uint3 WorkGroupId : SV_GroupID) {
+	if (LocalThreadId.x == 0 && LocalThreadId.y == 0) {
+		TileMin = 0x7f7fffff;
+		TileMax = 0;
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	// the input texels EASU reads for the tile's pixels, and those of the neighbours RCAS reads
+	// around the tile's edge
+	int2 begin = max(int2(floor(float2(WorkGroupId.xy * 16) * Scale)) - 3, int2(0, 0));
+	int2 end = min(int2(ceil(float2((WorkGroupId.xy + 1) * 16) * Scale)) + 3, int2(InputSize));
+	uint lo = 0x7f7fffff;
+	uint hi = 0;
+	for (int y = begin.y + LocalThreadId.y; y < end.y; y += 8) {
+		for (int x = begin.x + LocalThreadId.x; x < end.x; x += 8) {
+			float luma = max(dot(InputTexture.Load(int3(x, y, 0)).rgb, float3(0.2126, 0.7152, 0.0722)), 0);
+			lo = min(lo, asuint(luma));
+			hi = max(hi, asuint(luma));
+		}
+	}
+	InterlockedMin(TileMin, lo);
+	InterlockedMax(TileMax, hi);
+	GroupMemoryBarrierWithGroupSync();
+
+	if (LocalThreadId.x == 0 && LocalThreadId.y == 0) {
+		FlatTiles[WorkGroupId.xy] = asfloat(TileMax) - asfloat(TileMin) < Threshold ? 1 : 0;
+	}
+}
@@ -0,0 +1,22 @@
+// Ordered dithering of the values a pass writes, included by the D3D11 builds of the shaders
+// (OUTPUT_DITHER). Rounding to one of the two nearest representable values with a position dependent
+// threshold keeps the average over an area equal to the undithered value, which hides the banding
+// compact UNORM formats would otherwise show. The CPU reference is cpu::QuantizeImage.
+
+cbuffer DitherConstants : register(b2) {
+	// 2^bits - 1 per channel of the output texture, or 0 to write values unchanged
+	float4 DitherLevels;
+};
+
+// the pattern of FsrTepdDitF, without the frame offset so that it doesn't flicker
+float DitherThreshold(uint2 p) {
+	float x = float(p.x) * 1.61803398875 + float(p.y) * (1.0 / 3.69);
+	return frac(x);
+}
+
+float3 DitherOutput(float3 c, uint2 p) {
+	if (DitherLevels.x == 0) {
+		return c;
+	}
+	return floor(saturate(c) * DitherLevels.rgb + DitherThreshold(p)) / DitherLevels.rgb;
+}
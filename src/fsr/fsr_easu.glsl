@@ -0,0 +1,66 @@
+// GLSL version of fsr_easu.hlsl for the OpenGL backend. The #version line and OUTPUT_FORMAT, the
+// image format of the output texture, are prepended when the shader is compiled.
+#define A_GPU 1
+#define A_GLSL 1
+//#define A_HALF
+#define FSR_EASU_F 1
+
+#include "ffx_a.h"
+
+layout(std140, binding = 0) uniform cb {
+	uvec4 Const0;
+	uvec4 Const1;
+	uvec4 Const2;
+	uvec4 Const3;
+	uvec4 Centre;
+	uvec4 Radius;
+};
+
+layout(binding = 0) uniform sampler2D InputTexture;
+layout(OUTPUT_FORMAT, binding = 0) uniform writeonly image2D OutputTexture;
+
+AF4 FsrEasuRF(AF2 p) { AF4 res = textureGather(InputTexture, p, 0); return res; }
+AF4 FsrEasuGF(AF2 p) { AF4 res = textureGather(InputTexture, p, 1); return res; }
+AF4 FsrEasuBF(AF2 p) { AF4 res = textureGather(InputTexture, p, 2); return res; }
+
+#include "ffx_fsr1.h"
+
+void Upscale(AU2 pos) {
+	AF3 c;
+	FsrEasuF(c, pos, Const0, Const1, Const2, Const3);
+	imageStore(OutputTexture, ivec2(pos), AF4(c, 1));
+}
+
+void Bilinear(AU2 pos) {
+	AF3 c = textureLod(InputTexture, (AF2(pos) + 0.5) / AF2(Radius.zw), 0).rgb;
+	imageStore(OutputTexture, ivec2(pos), AF4(c, 1));
+}
+
+layout(local_size_x = 64) in;
+void main() {
+	// Do remapping of local xy in workgroup for a more PS-like swizzle pattern.
+	AU2 gxy = ARmp8x8(gl_LocalInvocationID.x) + AU2(gl_WorkGroupID.x << 4u, gl_WorkGroupID.y << 4u);
+	AU2 groupCentre = AU2((gl_WorkGroupID.x << 4u) + 8u, (gl_WorkGroupID.y << 4u) + 8u);
+	AU2 dc1 = Centre.xy - groupCentre;
+	AU2 dc2 = Centre.zw - groupCentre;
+	// GLSL has no integer dot(); this wraps around exactly like the HLSL version
+	if (dc1.x * dc1.x + dc1.y * dc1.y <= Radius.y || dc2.x * dc2.x + dc2.y * dc2.y <= Radius.y) {
+		// only do the expensive EASU for workgroups inside the given radius
+		Upscale(gxy);
+		gxy.x += 8u;
+		Upscale(gxy);
+		gxy.y += 8u;
+		Upscale(gxy);
+		gxy.x -= 8u;
+		Upscale(gxy);
+	} else {
+		// resort to cheaper bilinear sampling
+		Bilinear(gxy);
+		gxy.x += 8u;
+		Bilinear(gxy);
+		gxy.y += 8u;
+		Bilinear(gxy);
+		gxy.x -= 8u;
+		Bilinear(gxy);
+	}
+}
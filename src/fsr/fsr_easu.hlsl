@@ -23,15 +23,262 @@ AF4 FsrEasuGF(AF2 p) { AF4 res = InputTexture.GatherGreen(samLinearClamp, p, int
 AF4 FsrEasuBF(AF2 p) { AF4 res = InputTexture.GatherBlue(samLinearClamp, p, int2(0, 0)); return res; }	
 
 #include "ffx_fsr1.h"
+#if APPLY_GRAIN
+#include "fsr_grain.h"
+#endif
+#if OUTPUT_DITHER
+#include "fsr_dither.h"
+#endif
+
+#if LENS_DISTORTION
+// where each channel of an output pixel is sampled from, one slice per channel, see LensDistortion.h
+Texture2DArray<AF2> DistortionMap : register(t1);
+cbuffer distortion : register(b3) {
+	// the eye's viewport in the input texture
+	AF4 Bounds;
+	// from output texture coordinates to the map's
+	AF4 MapTransform;
+};
+
+// the input texture coordinates the given channel of an output pixel is sampled from; false if they
+// fall outside the eye's viewport, where the panel sees past the rendered image
+bool DistortedUv(int2 pos, int channel, out AF2 uv) {
+	AF2 mapUv = (AF2(pos) + 0.5) / AF2(Radius.zw) * MapTransform.xy + MapTransform.zw;
+	AF2 viewportUv = DistortionMap.SampleLevel(samLinearClamp, AF3(mapUv, channel), 0);
+	uv = lerp(Bounds.xy, Bounds.zw, viewportUv);
+	return all(viewportUv >= 0) && all(viewportUv <= 1);
+}
+#endif
+
+#if TILE_CLASSIFICATION
+// 1 for the tiles fsr_classify.hlsl found flat, one texel per workgroup; reads 0 everywhere when
+// nothing is bound, as without classification
+Texture2D<uint> FlatTiles : register(t3);
+#endif
+
+#if LUMA_GUIDED || LENS_DISTORTION
+// FsrEasuTapF for a single channel
+void EasuChannelTap(inout AF1 aC, inout AF1 aW, AF2 off, AF2 dir, AF2 len, AF1 lob, AF1 clp, AF1 c) {
+	AF2 v;
+	v.x = (off.x * ( dir.x)) + (off.y * dir.y);
+	v.y = (off.x * (-dir.y)) + (off.y * dir.x);
+	v *= len;
+	AF1 d2 = v.x * v.x + v.y * v.y;
+	d2 = min(d2, clp);
+	AF1 wB = AF1_(2.0 / 5.0) * d2 + AF1_(-1.0);
+	AF1 wA = lob * d2 + AF1_(-1.0);
+	wB *= wB;
+	wA *= wA;
+	wB = AF1_(25.0 / 16.0) * wB + AF1_(-(25.0 / 16.0 - 1.0));
+	AF1 w = wB * wA;
+	aC += c * w;
+	aW += w;
+}
+
+// the kernel FsrEasuF fits to the luma of its 12 taps: direction, anisotropy and lobe
+struct EasuKernel {
+	AF2 dir;
+	AF2 len2;
+	AF1 lob;
+	AF1 clp;
+};
+
+// the positions FsrEasuF gathers the 12 texels around pp from, in input pixels relative to the texel
+// centres; returns the fraction of pp the taps are weighted by
+AF2 EasuGatherPositions(AF2 pp, out AF2 p0, out AF2 p1, out AF2 p2, out AF2 p3) {
+	AF2 fp = floor(pp);
+	p0 = fp * AF2_AU2(Const1.xy) + AF2_AU2(Const1.zw);
+	p1 = p0 + AF2_AU2(Const2.xy);
+	p2 = p0 + AF2_AU2(Const2.zw);
+	p3 = p0 + AF2_AU2(Const3.xy);
+	return pp - fp;
+}
+
+// the luma of the 12 taps in the order of the gathers, see FsrEasuF
+EasuKernel FitEasuKernel(AF2 pp, AF4 bczzL, AF4 ijfeL, AF4 klhgL, AF4 zzonL) {
+	AF1 bL = bczzL.x;
+	AF1 cL = bczzL.y;
+	AF1 iL = ijfeL.x;
+	AF1 jL = ijfeL.y;
+	AF1 fL = ijfeL.z;
+	AF1 eL = ijfeL.w;
+	AF1 kL = klhgL.x;
+	AF1 lL = klhgL.y;
+	AF1 hL = klhgL.z;
+	AF1 gL = klhgL.w;
+	AF1 oL = zzonL.z;
+	AF1 nL = zzonL.w;
+	AF2 dir = AF2_(0.0);
+	AF1 len = AF1_(0.0);
+	FsrEasuSetF(dir, len, pp, true, false, false, false, bL, eL, fL, gL, jL);
+	FsrEasuSetF(dir, len, pp, false, true, false, false, cL, fL, gL, hL, kL);
+	FsrEasuSetF(dir, len, pp, false, false, true, false, fL, iL, jL, kL, nL);
+	FsrEasuSetF(dir, len, pp, false, false, false, true, gL, jL, kL, lL, oL);
+	AF2 dir2 = dir * dir;
+	AF1 dirR = dir2.x + dir2.y;
+	AP1 zro = dirR < AF1_(1.0 / 32768.0);
+	dirR = APrxLoRsqF1(dirR);
+	dirR = zro ? AF1_(1.0) : dirR;
+	dir.x = zro ? AF1_(1.0) : dir.x;
+	dir *= AF2_(dirR);
+	len = len * AF1_(0.5);
+	len *= len;
+	AF1 stretch = (dir.x * dir.x + dir.y * dir.y) * APrxLoRcpF1(max(abs(dir.x), abs(dir.y)));
+	EasuKernel kernel;
+	kernel.dir = dir;
+	kernel.len2 = AF2(AF1_(1.0) + (stretch - AF1_(1.0)) * len, AF1_(1.0) + AF1_(-0.5) * len);
+	kernel.lob = AF1_(0.5) + AF1_((1.0 / 4.0 - 0.04) - 0.5) * len;
+	kernel.clp = APrxLoRcpF1(kernel.lob);
+	return kernel;
+}
+
+// FsrEasuF's filter and deringing clamp for one channel, from the four gathers of it around pp
+AF1 EasuChannel(EasuKernel k, AF2 pp, AF4 bczz, AF4 ijfe, AF4 klhg, AF4 zzon) {
+	AF1 aC = AF1_(0.0);
+	AF1 aW = AF1_(0.0);
+	EasuChannelTap(aC, aW, AF2( 0.0, -1.0) - pp, k.dir, k.len2, k.lob, k.clp, bczz.x);
+	EasuChannelTap(aC, aW, AF2( 1.0, -1.0) - pp, k.dir, k.len2, k.lob, k.clp, bczz.y);
+	EasuChannelTap(aC, aW, AF2(-1.0, 1.0) - pp, k.dir, k.len2, k.lob, k.clp, ijfe.x);
+	EasuChannelTap(aC, aW, AF2( 0.0, 1.0) - pp, k.dir, k.len2, k.lob, k.clp, ijfe.y);
+	EasuChannelTap(aC, aW, AF2( 0.0, 0.0) - pp, k.dir, k.len2, k.lob, k.clp, ijfe.z);
+	EasuChannelTap(aC, aW, AF2(-1.0, 0.0) - pp, k.dir, k.len2, k.lob, k.clp, ijfe.w);
+	EasuChannelTap(aC, aW, AF2( 1.0, 1.0) - pp, k.dir, k.len2, k.lob, k.clp, klhg.x);
+	EasuChannelTap(aC, aW, AF2( 2.0, 1.0) - pp, k.dir, k.len2, k.lob, k.clp, klhg.y);
+	EasuChannelTap(aC, aW, AF2( 2.0, 0.0) - pp, k.dir, k.len2, k.lob, k.clp, klhg.z);
+	EasuChannelTap(aC, aW, AF2( 1.0, 0.0) - pp, k.dir, k.len2, k.lob, k.clp, klhg.w);
+	EasuChannelTap(aC, aW, AF2( 1.0, 2.0) - pp, k.dir, k.len2, k.lob, k.clp, zzon.z);
+	EasuChannelTap(aC, aW, AF2( 0.0, 2.0) - pp, k.dir, k.len2, k.lob, k.clp, zzon.w);
+	// f, g, j and k
+	AF1 min4 = min(AMin3F1(ijfe.z, klhg.w, ijfe.y), klhg.x);
+	AF1 max4 = max(AMax3F1(ijfe.z, klhg.w, ijfe.y), klhg.x);
+	return min(max4, max(min4, aC * ARcpF1(aW)));
+}
+#endif
+
+#if LUMA_GUIDED
+// FSR's luma of the input, written by fsr_luma.hlsl
+Texture2D<AF1> LumaTexture : register(t2);
+
+// FsrEasuF on the luma alone: 4 gathers of the luma texture instead of 12 of the input, and one
+// channel to filter instead of three. The color comes from a bilinear sample, moved to the filtered
+// luma; the eye resolves much less detail in chroma than in luma.
+void EasuLuma(out AF3 pix, AU2 ip, AU4 con0) {
+	AF2 pp = AF2(ip) * AF2_AU2(con0.xy) + AF2_AU2(con0.zw);
+	AF2 uv = (pp + AF2_(0.5)) * AF2_AU2(Const1.xy);
+	AF2 p0, p1, p2, p3;
+	pp = EasuGatherPositions(pp, p0, p1, p2, p3);
+	AF4 bczzL = LumaTexture.GatherRed(samLinearClamp, p0, int2(0, 0));
+	AF4 ijfeL = LumaTexture.GatherRed(samLinearClamp, p1, int2(0, 0));
+	AF4 klhgL = LumaTexture.GatherRed(samLinearClamp, p2, int2(0, 0));
+	AF4 zzonL = LumaTexture.GatherRed(samLinearClamp, p3, int2(0, 0));
+	EasuKernel kernel = FitEasuKernel(pp, bczzL, ijfeL, klhgL, zzonL);
+	AF1 luma = EasuChannel(kernel, pp, bczzL, ijfeL, klhgL, zzonL);
+
+	AF3 c = InputTexture.SampleLevel(samLinearClamp, uv, 0).rgb;
+	// FSR's luma weighs red and blue by half, so moving all channels by d moves it by 2d
+	pix = max(c + AF3_((luma - (c.b * 0.5 + (c.r * 0.5 + c.g))) * 0.5), AF3_(0.0));
+}
+#endif
+
+#if SUPERSAMPLE
+// virtual pixels per output pixel; FsrEasuCon stored input / virtual size and 1 / input size
+AF2 SupersampleScale() {
+	return AF2(1, 1) / (AF2_AU2(Const0.xy) * AF2_AU2(Const1.xy) * AF2(Radius.zw));
+}
+#endif
 
 void Upscale(int2 pos) {
 	AF3 c;
+#if SUPERSAMPLE
+	// EASU for every virtual pixel the output pixel covers, weighted by the area it covers
+	AF2 scale = SupersampleScale();
+	AF2 begin = AF2(pos) * scale;
+	AF2 end = begin + scale;
+	AF3 sum = AF3(0, 0, 0);
+	AF1 weightSum = 0;
+	[loop] for (AF1 vy = floor(begin.y + 1.0 / 64); vy < end.y - 1.0 / 64; ++vy) {
+		AF1 weightY = min(vy + 1, end.y) - max(vy, begin.y);
+		[loop] for (AF1 vx = floor(begin.x + 1.0 / 64); vx < end.x - 1.0 / 64; ++vx) {
+			AF1 weight = weightY * (min(vx + 1, end.x) - max(vx, begin.x));
+			AF3 s;
+			FsrEasuF(s, AU2(vx, vy), Const0, Const1, Const2, Const3);
+			sum += s * weight;
+			weightSum += weight;
+		}
+	}
+	c = sum / weightSum;
+#elif LENS_DISTORTION
+	// The kernel is fitted once, to the luma around green's position, and each channel is filtered
+	// with it from its own 12 texels: 20 gathers and one fit per pixel, instead of the 36 gathers and
+	// three fits of an FsrEasuF per channel. The chromatic aberration moves red and blue by a few
+	// texels at most, across which the direction of an edge barely changes.
+	AF2 inputSize = AF2(1, 1) / AF2(AF1_AU1(Const1.x), AF1_AU1(Const1.y));
+	AF2 uvR, uvG, uvB;
+	bool insideR = DistortedUv(pos, 0, uvR);
+	bool insideG = DistortedUv(pos, 1, uvG);
+	bool insideB = DistortedUv(pos, 2, uvB);
+	AF2 p0, p1, p2, p3;
+	AF2 pp = EasuGatherPositions(uvG * inputSize - 0.5, p0, p1, p2, p3);
+	AF4 bczzR = FsrEasuRF(p0);
+	AF4 bczzG = FsrEasuGF(p0);
+	AF4 bczzB = FsrEasuBF(p0);
+	AF4 ijfeR = FsrEasuRF(p1);
+	AF4 ijfeG = FsrEasuGF(p1);
+	AF4 ijfeB = FsrEasuBF(p1);
+	AF4 klhgR = FsrEasuRF(p2);
+	AF4 klhgG = FsrEasuGF(p2);
+	AF4 klhgB = FsrEasuBF(p2);
+	AF4 zzonR = FsrEasuRF(p3);
+	AF4 zzonG = FsrEasuGF(p3);
+	AF4 zzonB = FsrEasuBF(p3);
+	EasuKernel kernel = FitEasuKernel(pp,
+		bczzB * AF4_(0.5) + (bczzR * AF4_(0.5) + bczzG),
+		ijfeB * AF4_(0.5) + (ijfeR * AF4_(0.5) + ijfeG),
+		klhgB * AF4_(0.5) + (klhgR * AF4_(0.5) + klhgG),
+		zzonB * AF4_(0.5) + (zzonR * AF4_(0.5) + zzonG));
+	c = AF3_(0.0);
+	if (insideG) {
+		c.g = EasuChannel(kernel, pp, bczzG, ijfeG, klhgG, zzonG);
+	}
+	if (insideR) {
+		pp = EasuGatherPositions(uvR * inputSize - 0.5, p0, p1, p2, p3);
+		c.r = EasuChannel(kernel, pp, FsrEasuRF(p0), FsrEasuRF(p1), FsrEasuRF(p2), FsrEasuRF(p3));
+	}
+	if (insideB) {
+		pp = EasuGatherPositions(uvB * inputSize - 0.5, p0, p1, p2, p3);
+		c.b = EasuChannel(kernel, pp, FsrEasuBF(p0), FsrEasuBF(p1), FsrEasuBF(p2), FsrEasuBF(p3));
+	}
+#elif LUMA_GUIDED
+	EasuLuma(c, pos, Const0);
+#else
 	FsrEasuF(c, pos, Const0, Const1, Const2, Const3);
+#endif
+#if APPLY_GRAIN
+	ApplyGrain(c, pos);
+#endif
+#if OUTPUT_DITHER
+	c = DitherOutput(c, pos);
+#endif
 	OutputTexture[pos] = AF4(c, 1);
 }
 
 void Bilinear(int2 pos) {
-	AF3 c = InputTexture.SampleLevel(samLinearClamp, float2(pos) / Radius.zw, 0).rgb;
+#if LENS_DISTORTION
+	AF3 c;
+	[unroll] for (int ch = 0; ch < 3; ++ch) {
+		AF2 uv;
+		c[ch] = DistortedUv(pos, ch, uv) ? InputTexture.SampleLevel(samLinearClamp, uv, 0)[ch] : 0;
+	}
+#else
+	// at the pixel centre, where EASU samples too
+	AF3 c = InputTexture.SampleLevel(samLinearClamp, (AF2(pos) + 0.5) / AF2(Radius.zw), 0).rgb;
+#endif
+#if APPLY_GRAIN
+	ApplyGrain(c, pos);
+#endif
+#if OUTPUT_DITHER
+	c = DitherOutput(c, pos);
+#endif
 	OutputTexture[pos] = AF4(c, 1);
 }
 
@@ -42,7 +289,12 @@ void main(uint3 LocalThreadId : SV_GroupThreadID, uint3 WorkGroupId : SV_GroupID
 	AU2 groupCentre = AU2((WorkGroupId.x << 4u) + 8u, (WorkGroupId.y << 4u) + 8u);
 	AU2 dc1 = Centre.xy - groupCentre;
 	AU2 dc2 = Centre.zw - groupCentre;
-	if (dot(dc1, dc1) <= Radius.y || dot(dc2, dc2) <= Radius.y) {
+	bool inside = dot(dc1, dc1) <= Radius.y || dot(dc2, dc2) <= Radius.y;
+#if TILE_CLASSIFICATION
+	// where the input is flat, bilinear sampling looks the same
+	inside = inside && FlatTiles.Load(int3(WorkGroupId.xy, 0)) == 0;
+#endif
+	if (inside) {
 		// only do the expensive EASU for workgroups inside the given radius
 		Upscale(gxy);
 		gxy.x += 8u;
@@ -0,0 +1,2 @@
+#define LENS_DISTORTION 1
+#include "fsr_easu.hlsl"
@@ -0,0 +1,3 @@
+#define LENS_DISTORTION 1
+#define APPLY_GRAIN 1
+#include "fsr_easu.hlsl"
@@ -0,0 +1,2 @@
+#define LUMA_GUIDED 1
+#include "fsr_easu.hlsl"
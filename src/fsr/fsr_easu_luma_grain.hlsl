@@ -0,0 +1,3 @@
+#define LUMA_GUIDED 1
+#define APPLY_GRAIN 1
+#include "fsr_easu.hlsl"
@@ -0,0 +1,2 @@
+#define SUPERSAMPLE 1
+#include "fsr_easu.hlsl"
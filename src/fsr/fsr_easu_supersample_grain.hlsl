@@ -0,0 +1,3 @@
+#define SUPERSAMPLE 1
+#define APPLY_GRAIN 1
+#include "fsr_easu.hlsl"
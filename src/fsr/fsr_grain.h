@@ -0,0 +1,23 @@
+// Film grain through FsrLfgaF, included by the shaders that apply it after ffx_fsr1.h.
+// The grain is white noise hashed from the pixel position and a per-frame seed, so it needs no
+// grain texture and the CPU reference (cpu::Grain) produces the same pattern.
+
+cbuffer GrainConstants : register(b1) {
+	AF1 GrainAmount;
+	AU1 GrainSeed;
+	AU2 GrainPadding;
+};
+
+AU1 GrainHash(AU1 x) {
+	x ^= x >> 16u;
+	x *= 0x7feb352du;
+	x ^= x >> 15u;
+	x *= 0x846ca68bu;
+	x ^= x >> 16u;
+	return x;
+}
+
+void ApplyGrain(inout AF3 c, AU2 p) {
+	AF1 noise = AF1(GrainHash(p.x ^ GrainHash(p.y ^ GrainHash(GrainSeed))) & 0xffffu) / 65535.0 - 0.5;
+	FsrLfgaF(c, AF3_(noise), GrainAmount);
+}
@@ -0,0 +1,21 @@
+#define A_GPU 1
+#define A_HLSL 1
+//#define A_HALF
+
+#include "ffx_a.h"
+
+Texture2D<AF4> InputTexture : register(t0);
+RWTexture2D<AF4> OutputTexture: register(u0);
+
+#include "ffx_fsr1.h"
+#include "fsr_grain.h"
+#include "fsr_dither.h"
+
+// standalone film grain pass, for chains where no preceding FSR pass can apply it
+[numthreads(8, 8, 1)]
+void main(uint3 Dtid : SV_DispatchThreadID) {
+	AF3 c = InputTexture.Load(int3(Dtid.xy, 0)).rgb;
+	ApplyGrain(c, Dtid.xy);
+	c = DitherOutput(c, Dtid.xy);
+	OutputTexture[Dtid.xy] = AF4(c, 1);
+}
@@ -0,0 +1,12 @@
+// Luma prepass of fsr_easu_luma.hlsl: FSR's luma of every input texel, so that the luma guided EASU
+// gathers one channel per tap instead of three.
+
+Texture2D<float4> InputTexture : register(t0);
+RWTexture2D<float> LumaTexture : register(u0);
+
+[numthreads(8, 8, 1)]
+void main(uint3 Dtid : SV_DispatchThreadID) {
+	float3 c = InputTexture.Load(int3(Dtid.xy, 0)).rgb;
+	// the approximation FsrEasuF uses, luma times 2
+	LumaTexture[Dtid.xy] = c.b * 0.5 + (c.r * 0.5 + c.g);
+}
@@ -0,0 +1,61 @@
+// GLSL version of fsr_rcas.hlsl for the OpenGL backend. The #version line and OUTPUT_FORMAT, the
+// image format of the output texture, are prepended when the shader is compiled.
+#define A_GPU 1
+#define A_GLSL 1
+//#define A_HALF
+#define FSR_RCAS_F
+
+#include "ffx_a.h"
+
+layout(std140, binding = 0) uniform cb {
+	uvec4 Const0;
+	uvec4 Centre;
+	uvec4 Radius;
+};
+
+layout(binding = 0) uniform sampler2D InputTexture;
+layout(OUTPUT_FORMAT, binding = 0) uniform writeonly image2D OutputTexture;
+
+AF4 FsrRcasLoadF(ASU2 p) { return texelFetch(InputTexture, ASU2(p), 0); }
+void FsrRcasInputF(inout AF1 r, inout AF1 g, inout AF1 b) {}
+
+#include "ffx_fsr1.h"
+
+void Sharpen(AU2 pos) {
+	AF3 c;
+	FsrRcasF(c.r, c.g, c.b, pos, Const0);
+	imageStore(OutputTexture, ivec2(pos), AF4(c, 1));
+}
+
+void Copy(AU2 pos, AF4 mul) {
+	imageStore(OutputTexture, ivec2(pos), mul * texelFetch(InputTexture, ivec2(pos), 0));
+}
+
+layout(local_size_x = 64) in;
+void main() {
+	// Do remapping of local xy in workgroup for a more PS-like swizzle pattern.
+	AU2 gxy = ARmp8x8(gl_LocalInvocationID.x) + AU2(gl_WorkGroupID.x << 4u, gl_WorkGroupID.y << 4u);
+	AU2 groupCentre = AU2((gl_WorkGroupID.x << 4u) + 8u, (gl_WorkGroupID.y << 4u) + 8u);
+	AU2 dc1 = Centre.xy - groupCentre;
+	AU2 dc2 = Centre.zw - groupCentre;
+	// GLSL has no integer dot(); this wraps around exactly like the HLSL version
+	if (dc1.x * dc1.x + dc1.y * dc1.y <= Radius.y || dc2.x * dc2.x + dc2.y * dc2.y <= Radius.y) {
+		// only do RCAS for workgroups inside the given radius
+		Sharpen(gxy);
+		gxy.x += 8u;
+		Sharpen(gxy);
+		gxy.y += 8u;
+		Sharpen(gxy);
+		gxy.x -= 8u;
+		Sharpen(gxy);
+	} else {
+		AF4 mul = AF4(1, 1, 1, 1) - AF1(Const0[3]) * AF4(0, 0.3, 0.3, 0);
+		Copy(gxy, mul);
+		gxy.x += 8u;
+		Copy(gxy, mul);
+		gxy.y += 8u;
+		Copy(gxy, mul);
+		gxy.x -= 8u;
+		Copy(gxy, mul);
+	}
+}
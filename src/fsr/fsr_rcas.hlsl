@@ -18,14 +18,43 @@ RWTexture2D<AF4> OutputTexture: register(u0);
 AF4 FsrRcasLoadF(ASU2 p) { return InputTexture.Load(int3(ASU2(p), 0)); }
 void FsrRcasInputF(inout AF1 r, inout AF1 g, inout AF1 b) {}
 
+#if TILE_CLASSIFICATION
+// 1 for the tiles fsr_classify.hlsl found flat, one texel per workgroup; reads 0 everywhere when
+// nothing is bound, as without classification
+Texture2D<uint> FlatTiles : register(t3);
+#endif
+
 #include "ffx_fsr1.h"
+#if APPLY_GRAIN
+#include "fsr_grain.h"
+#endif
+#if OUTPUT_DITHER
+#include "fsr_dither.h"
+#endif
 
 void Sharpen(int2 pos) {
 	AF3 c;
 	FsrRcasF(c.r, c.g, c.b, pos, Const0);
+#if APPLY_GRAIN
+	ApplyGrain(c, pos);
+#endif
+#if OUTPUT_DITHER
+	c = DitherOutput(c, pos);
+#endif
 	OutputTexture[pos] = AF4(c, 1);
 }
 
+void Copy(AU2 pos, AF4 mul) {
+	AF4 c = mul * InputTexture[pos];
+#if APPLY_GRAIN
+	ApplyGrain(c.rgb, pos);
+#endif
+#if OUTPUT_DITHER
+	c.rgb = DitherOutput(c.rgb, pos);
+#endif
+	OutputTexture[pos] = c;
+}
+
 [numthreads(64, 1, 1)]
 void main(uint3 LocalThreadId : SV_GroupThreadID, uint3 WorkGroupId : SV_GroupID, uint3 Dtid : SV_DispatchThreadID) {
 	// Do remapping of local xy in workgroup for a more PS-like swizzle pattern.
@@ -33,7 +62,12 @@ void main(uint3 LocalThreadId : SV_GroupThreadID, uint3 WorkGroupId : SV_GroupID
 	AU2 groupCentre = AU2((WorkGroupId.x << 4u) + 8u, (WorkGroupId.y << 4u) + 8u);
 	AU2 dc1 = Centre.xy - groupCentre;
 	AU2 dc2 = Centre.zw - groupCentre;
-	if (dot(dc1, dc1) <= Radius.y || dot(dc2, dc2) <= Radius.y) {
+	bool inside = dot(dc1, dc1) <= Radius.y || dot(dc2, dc2) <= Radius.y;
+#if TILE_CLASSIFICATION
+	// there is nothing to sharpen in flat tiles
+	inside = inside && FlatTiles.Load(int3(WorkGroupId.xy, 0)) == 0;
+#endif
+	if (inside) {
 		// only do RCAS for workgroups inside the given radius
 		Sharpen(gxy);
 		gxy.x += 8u;
@@ -44,12 +78,12 @@ void main(uint3 LocalThreadId : SV_GroupThreadID, uint3 WorkGroupId : SV_GroupID
 		Sharpen(gxy);
 	} else {
 		AF4 mul = AF4(1, 1, 1, 1) - Const0[3] * AF4(0, 0.3, 0.3, 0);
-		OutputTexture[gxy] = mul * InputTexture[gxy];
+		Copy(gxy, mul);
 		gxy.x += 8u;
-		OutputTexture[gxy] = mul * InputTexture[gxy];
+		Copy(gxy, mul);
 		gxy.y += 8u;
-		OutputTexture[gxy] = mul * InputTexture[gxy];
+		Copy(gxy, mul);
 		gxy.x -= 8u;
-		OutputTexture[gxy] = mul * InputTexture[gxy];
+		Copy(gxy, mul);
 	}
 }
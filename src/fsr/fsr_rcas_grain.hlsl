@@ -0,0 +1,2 @@
+#define APPLY_GRAIN 1
+#include "fsr_rcas.hlsl"
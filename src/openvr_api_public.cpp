@@ -94,6 +94,13 @@ uint32_t VR_InitInternal2( EVRInitError *peError, vr::EVRApplicationType eApplic
 		return 0;
 	}
 
+	// queried from the client core directly, so that no hooks are installed for these interface versions
+	IVRSystem *system = (IVRSystem*)g_pHmdSystem->GetGenericInterface( vr::IVRSystem_Version, nullptr );
+	ResolveConfigProfile( system );
+	IVRCompositor *compositor = (IVRCompositor*)g_pHmdSystem->GetGenericInterface( vr::IVRCompositor_Version, nullptr );
+	InitFramePacing( system, compositor );
+	InitHud( system, (IVROverlay*)g_pHmdSystem->GetGenericInterface( vr::IVROverlay_Version, nullptr ), compositor );
+
 	return ++g_nVRToken;
 }
 
@@ -0,0 +1,239 @@
+#include "AsyncCapture.h"
+#include "Logging.h"
+#include "ScreenGrab11.h"
+
+#include <wincodec.h>
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace vr {
+	AsyncCapture::~AsyncCapture() {
+		StopWorker();
+	}
+
+	void AsyncCapture::Request(int frameCount, const std::wstring &filename, CaptureFormat captureFormat) {
+		if (framesRemaining > 0) {
+			Log(LogLevel::Warning) << "Capture already in progress, ignoring request";
+			return;
+		}
+		framesRemaining = (std::min)((std::max)(frameCount, 1), MAX_BURST_FRAMES);
+		burstSize = framesRemaining;
+		burstIndex = 0;
+		baseFilename = filename;
+		format = captureFormat;
+		Log() << "Capturing " << framesRemaining << " frame(s)";
+	}
+
+	void AsyncCapture::CaptureFrame(ID3D11DeviceContext *context, ID3D11Texture2D *texture) {
+		if (framesRemaining <= 0) {
+			return;
+		}
+
+		--framesRemaining;
+		int frameIndex = burstIndex++;
+		std::wostringstream filenameStream;
+		filenameStream << baseFilename;
+		if (burstSize > 1) {
+			filenameStream << L"_f" << std::setw(3) << std::setfill(L'0') << frameIndex;
+		}
+		filenameStream << (format == CaptureFormat::PNG ? L".png" : L".dds");
+		std::wstring filename = filenameStream.str();
+		CaptureFormat fileFormat = format;
+
+		static_assert(MAX_BURST_FRAMES + (int)READBACK_DELAY + 1 <= MAX_RING_SIZE, "a full burst must fit the readback ring");
+		int requiredRingSize = burstSize + (int)READBACK_DELAY + 1;
+		bool queued = Readback(context, texture, 0, requiredRingSize, [filename, fileFormat](const D3D11_TEXTURE2D_DESC &desc, const void *pixels, size_t rowPitch) {
+			HRESULT result;
+			if (fileFormat == CaptureFormat::PNG) {
+				result = DirectX::SaveWICTextureToFile(desc, pixels, rowPitch, GUID_ContainerFormatPng, filename.c_str());
+			} else {
+				result = DirectX::SaveDDSTextureToFile(desc, pixels, rowPitch, filename.c_str());
+			}
+			if (FAILED(result)) {
+				Log(LogLevel::Error) << "Error writing screen capture: " << std::hex << result << std::dec;
+			}
+		});
+		if (!queued) {
+			static LogRateLimit droppedLimit (1000);
+			Log(LogLevel::Warning, droppedLimit) << "Dropping frame " << frameIndex << " of the capture";
+		}
+	}
+
+	bool AsyncCapture::Readback(ID3D11DeviceContext *context, ID3D11Texture2D *texture, UINT subresource, int requiredRingSize, ReadbackHandler handler) {
+		D3D11_TEXTURE2D_DESC td;
+		texture->GetDesc(&td);
+		if (td.SampleDesc.Count > 1) {
+			Log(LogLevel::Error) << "Can't read back multisampled texture";
+			return false;
+		}
+		requiredRingSize = (std::min)((std::max)(requiredRingSize, (int)MIN_RING_SIZE), (int)MAX_RING_SIZE);
+		if (!PrepareStagingTextures(context, td, requiredRingSize)) {
+			return false;
+		}
+
+		Slot &slot = *slots[nextSlot];
+		if (slot.state != SlotState::Free) {
+			return false;
+		}
+
+		context->CopySubresourceRegion(slot.staging.Get(), 0, 0, 0, 0, texture, subresource, nullptr);
+		slot.copiedFrame = frameCounter;
+		slot.handler = std::move(handler);
+		slot.state = SlotState::Copied;
+		nextSlot = (nextSlot + 1) % ringSize;
+		return true;
+	}
+
+	void AsyncCapture::Poll(ID3D11DeviceContext *context) {
+		++frameCounter;
+		PollRetiredSlots(context);
+		// nextSlot is the oldest slot, so walking the ring from there visits readbacks in the order they
+		// were issued; stop at the first one that isn't ready to keep them in order
+		bool blocked = false;
+		for (int n = 0; n < ringSize; ++n) {
+			int i = (nextSlot + n) % ringSize;
+			Slot &slot = *slots[i];
+			SlotState state = slot.state;
+			if (state == SlotState::Copied && !blocked) {
+				if (frameCounter - slot.copiedFrame < READBACK_DELAY) {
+					blocked = true;
+					continue;
+				}
+				HRESULT result = context->Map(slot.staging.Get(), 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &slot.mapped);
+				if (result == DXGI_ERROR_WAS_STILL_DRAWING) {
+					blocked = true;
+					continue;
+				}
+				if (FAILED(result)) {
+					Log(LogLevel::Error) << "Failed to map readback staging texture: " << std::hex << result << std::dec;
+					slot.handler = nullptr;
+					slot.state = SlotState::Free;
+					continue;
+				}
+				slot.state = SlotState::Processing;
+				StartWorker();
+				std::lock_guard<std::mutex> lock (jobMutex);
+				jobs.push_back(slots[i]);
+				jobAvailable.notify_one();
+			} else if (state == SlotState::Processed) {
+				context->Unmap(slot.staging.Get(), 0);
+				slot.state = SlotState::Free;
+			}
+		}
+	}
+
+	void AsyncCapture::Reset(ID3D11DeviceContext *context) {
+		framesRemaining = 0;
+		PollRetiredSlots(context);
+		for (int i = 0; i < ringSize; ++i) {
+			Slot &slot = *slots[i];
+			if (slot.state == SlotState::Processing) {
+				// the worker still encodes or writes it; it stays mapped until it's done
+				retiredSlots.push_back(std::move(slots[i]));
+				continue;
+			}
+			if (slot.state == SlotState::Processed && context != nullptr) {
+				context->Unmap(slot.staging.Get(), 0);
+			} else if (slot.state == SlotState::Copied) {
+				Log(LogLevel::Warning) << "Discarding pending readback";
+			}
+			slots[i].reset();
+		}
+		nextSlot = 0;
+		ringSize = 0;
+	}
+
+	void AsyncCapture::PollRetiredSlots(ID3D11DeviceContext *context) {
+		for (size_t i = 0; i < retiredSlots.size();) {
+			Slot &slot = *retiredSlots[i];
+			if (slot.state != SlotState::Processed) {
+				++i;
+				continue;
+			}
+			if (context != nullptr) {
+				context->Unmap(slot.staging.Get(), 0);
+			}
+			retiredSlots.erase(retiredSlots.begin() + i);
+		}
+	}
+
+	bool AsyncCapture::PrepareStagingTextures(ID3D11DeviceContext *context, const D3D11_TEXTURE2D_DESC &desc, int requiredRingSize) {
+		if (ringSize >= requiredRingSize && stagingDesc.Width == desc.Width && stagingDesc.Height == desc.Height && stagingDesc.Format == desc.Format) {
+			return true;
+		}
+
+		int remaining = framesRemaining;
+		Reset(context);
+		framesRemaining = remaining;
+
+		ComPtr<ID3D11Device> device;
+		context->GetDevice(device.GetAddressOf());
+		Log() << "Creating " << requiredRingSize << " readback staging textures of size " << desc.Width << "x" << desc.Height;
+		stagingDesc = desc;
+		stagingDesc.MipLevels = 1;
+		stagingDesc.ArraySize = 1;
+		stagingDesc.BindFlags = 0;
+		stagingDesc.MiscFlags = 0;
+		stagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+		stagingDesc.Usage = D3D11_USAGE_STAGING;
+		for (int i = 0; i < requiredRingSize; ++i) {
+			slots[i] = std::make_shared<Slot>();
+			slots[i]->desc = stagingDesc;
+			HRESULT result = device->CreateTexture2D(&stagingDesc, nullptr, slots[i]->staging.GetAddressOf());
+			if (FAILED(result)) {
+				Log(LogLevel::Error) << "Failed to create readback staging texture: " << std::hex << result << std::dec;
+				for (int j = 0; j <= i; ++j) {
+					slots[j].reset();
+				}
+				return false;
+			}
+		}
+		ringSize = requiredRingSize;
+		return true;
+	}
+
+	void AsyncCapture::StartWorker() {
+		if (worker.joinable()) {
+			return;
+		}
+		stopWorker = false;
+		worker = std::thread([this]() { WorkerLoop(); });
+	}
+
+	void AsyncCapture::StopWorker() {
+		if (!worker.joinable()) {
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock (jobMutex);
+			stopWorker = true;
+			jobAvailable.notify_one();
+		}
+		worker.join();
+	}
+
+	void AsyncCapture::WorkerLoop() {
+		// the WIC encoders used for captures are COM objects
+		HRESULT comResult = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+		for (;;) {
+			std::shared_ptr<Slot> slot;
+			{
+				std::unique_lock<std::mutex> lock (jobMutex);
+				jobAvailable.wait(lock, [this]() { return stopWorker || !jobs.empty(); });
+				if (jobs.empty()) {
+					break;
+				}
+				slot = std::move(jobs.front());
+				jobs.pop_front();
+			}
+			slot->handler(slot->desc, slot->mapped.pData, slot->mapped.RowPitch);
+			// release whatever the handler holds on to here rather than on the render thread
+			slot->handler = nullptr;
+			slot->state = SlotState::Processed;
+		}
+		if (SUCCEEDED(comResult)) {
+			CoUninitialize();
+		}
+	}
+}
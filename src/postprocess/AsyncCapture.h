@@ -0,0 +1,100 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace vr {
+	using Microsoft::WRL::ComPtr;
+
+	enum class CaptureFormat {
+		DDS,
+		PNG,
+	};
+
+	// Reads textures back to the CPU without stalling the render thread. A texture is copied into one of
+	// a ring of staging textures; a few frames later the staging texture is mapped with DO_NOT_WAIT and
+	// handed to a worker thread, which processes it straight from the mapped memory. The render thread
+	// unmaps the texture again once the worker is done with it. Readbacks are processed in the order
+	// they were issued. Resetting never waits for the worker: readbacks it is still processing are
+	// finished in the background and unmapped by a later Poll or Reset.
+	class AsyncCapture {
+	public:
+		// invoked on the worker thread with the mapped contents of a staging texture
+		typedef std::function<void(const D3D11_TEXTURE2D_DESC &desc, const void *pixels, size_t rowPitch)> ReadbackHandler;
+
+		~AsyncCapture();
+
+		// captures the next frameCount frames passed to CaptureFrame to image files
+		void Request(int frameCount, const std::wstring &baseFilename, CaptureFormat format);
+		bool IsCapturing() const { return framesRemaining > 0; }
+		void CaptureFrame(ID3D11DeviceContext *context, ID3D11Texture2D *texture);
+		// queues a readback of a single subresource; returns false if the texture can't be read back or
+		// all staging textures are still in use
+		bool Readback(ID3D11DeviceContext *context, ID3D11Texture2D *texture, UINT subresource, int requiredRingSize, ReadbackHandler handler);
+		// advances pending readbacks, must be called once per frame on the render thread
+		void Poll(ID3D11DeviceContext *context);
+		// releases the staging textures, discarding readbacks that haven't been mapped yet; those the
+		// worker is processing are retired rather than waited for
+		void Reset(ID3D11DeviceContext *context);
+
+		static const int MIN_RING_SIZE = 4;
+		static const int MAX_RING_SIZE = 32;
+		// longest burst that fits the ring: one slot per frame, plus the frames still waiting out the
+		// readback delay and the one being copied
+		static const int MAX_BURST_FRAMES = MAX_RING_SIZE - 3;
+
+	private:
+		// frames to wait after the copy before the first attempt to map a staging texture
+		static const uint64_t READBACK_DELAY = 2;
+
+		enum class SlotState {
+			Free,
+			Copied,
+			Processing,
+			Processed,
+		};
+
+		// shared with the worker while it processes the slot, so that Reset can hand it over
+		struct Slot {
+			ComPtr<ID3D11Texture2D> staging;
+			D3D11_TEXTURE2D_DESC desc;
+			std::atomic<SlotState> state { SlotState::Free };
+			uint64_t copiedFrame = 0;
+			ReadbackHandler handler;
+			D3D11_MAPPED_SUBRESOURCE mapped;
+		};
+
+		std::shared_ptr<Slot> slots[MAX_RING_SIZE];
+		// slots Reset took out of the ring while the worker was processing them, to unmap once it's done
+		std::vector<std::shared_ptr<Slot>> retiredSlots;
+		int ringSize = 0;
+		D3D11_TEXTURE2D_DESC stagingDesc;
+		int nextSlot = 0;
+		uint64_t frameCounter = 0;
+		int framesRemaining = 0;
+		int burstSize = 0;
+		int burstIndex = 0;
+		std::wstring baseFilename;
+		CaptureFormat format = CaptureFormat::DDS;
+
+		std::thread worker;
+		std::mutex jobMutex;
+		std::condition_variable jobAvailable;
+		std::deque<std::shared_ptr<Slot>> jobs;
+		bool stopWorker = false;
+
+		bool PrepareStagingTextures(ID3D11DeviceContext *context, const D3D11_TEXTURE2D_DESC &desc, int requiredRingSize);
+		void StartWorker();
+		void StopWorker();
+		void WorkerLoop();
+		void PollRetiredSlots(ID3D11DeviceContext *context);
+	};
+}
@@ -0,0 +1,191 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include "Config.h"
+#include "HotkeyListener.h"
+#include "Logging.h"
+
+namespace vr {
+	namespace {
+		float Percentile(std::vector<float> &sorted, double percentile) {
+			if (sorted.empty()) {
+				return 0;
+			}
+			size_t rank = (size_t)(percentile / 100.0 * (sorted.size() - 1) + 0.5);
+			return sorted[(std::min)(rank, sorted.size() - 1)];
+		}
+
+		// mean, p50, p90, p99 and max as CSV columns
+		std::string Distribution(std::vector<float> samples) {
+			if (samples.empty()) {
+				return ",,,,";
+			}
+			std::sort(samples.begin(), samples.end());
+			double sum = 0;
+			for (float sample : samples) {
+				sum += sample;
+			}
+			char buf[128];
+			snprintf(buf, sizeof(buf), "%.3f,%.3f,%.3f,%.3f,%.3f", sum / samples.size(), Percentile(samples, 50),
+				Percentile(samples, 90), Percentile(samples, 99), samples.back());
+			return buf;
+		}
+
+		float Mean(const std::vector<float> &samples) {
+			double sum = 0;
+			for (float sample : samples) {
+				sum += sample;
+			}
+			return samples.empty() ? 0.f : float(sum / samples.size());
+		}
+	}
+
+	void Benchmark::Update(EVREye eEye) {
+		const Json::Value &section = Config::Instance().benchmark;
+		bool enabled = section.get("enabled", false).asBool();
+		if (running && (!enabled || !(section == startedSection))) {
+			Log() << "Benchmark settings changed, stopping the benchmark";
+			Finish(false);
+		}
+		if (!enabled) {
+			// enabling the same section again runs it again
+			startedSection = Json::Value();
+		} else if (!running && !(section == startedSection)) {
+			Start(section);
+		}
+		if (!running) {
+			return;
+		}
+
+		Clock::time_point now = Clock::now();
+		if (eEye == Eye_Left) {
+			if (hasLastFrame && !IsSettling(now)) {
+				results.back().frameMs.push_back(std::chrono::duration<float, std::milli>(now - lastFrame).count());
+			}
+			lastFrame = now;
+			hasLastFrame = true;
+		}
+
+		if (now - settingStart >= timePerSetting) {
+			size_t next = results.back().setting + 1;
+			if (next < settings.size()) {
+				results.push_back(Result { results.back().cycle, next });
+				BeginSetting(next);
+			} else if (results.back().cycle + 1 < cycles) {
+				results.push_back(Result { results.back().cycle + 1, 0 });
+				BeginSetting(0);
+			} else {
+				Finish(true);
+			}
+		}
+	}
+
+	void Benchmark::AddGpuTime(float ms) {
+		if (running && !IsSettling(Clock::now())) {
+			results.back().gpuMs.push_back(ms);
+		}
+	}
+
+	void Benchmark::Start(const Json::Value &section) {
+		startedSection = section;
+		Config &config = Config::Instance();
+		original = Setting { "", config.fsrEnabled, config.useNis, config.sharpness, config.radius };
+
+		settings.clear();
+		try {
+			for (const Json::Value &entry : section.get("configs", Json::Value(Json::arrayValue))) {
+				// unset values are taken from the settings the benchmark started with
+				Setting setting = original;
+				setting.name = entry.get("name", "config " + std::to_string(settings.size() + 1)).asString();
+				setting.fsrEnabled = entry.get("enabled", original.fsrEnabled).asBool();
+				setting.useNis = entry.get("useNIS", original.useNis).asBool();
+				setting.sharpness = (std::max)(0.f, entry.get("sharpness", original.sharpness).asFloat());
+				setting.radius = entry.get("radius", original.radius).asFloat();
+				if (entry.isMember("renderScale")) {
+					Log(LogLevel::Warning) << "Benchmark config " << setting.name << ": renderScale can't change while the game is running, ignoring it";
+				}
+				settings.push_back(setting);
+			}
+			cycles = (std::max)(1, section.get("cycles", 1).asInt());
+			float secondsPerConfig = (std::max)(1.f, section.get("secondsPerConfig", 30.0).asFloat());
+			float settleSeconds = (std::min)(secondsPerConfig / 2, (std::max)(0.f, section.get("settleSeconds", 2.0).asFloat()));
+			timePerSetting = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(secondsPerConfig));
+			settleTime = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(settleSeconds));
+		} catch (...) {
+			Log(LogLevel::Error) << "Could not read the benchmark settings.";
+			settings.clear();
+		}
+		if (settings.empty()) {
+			Log(LogLevel::Warning) << "The benchmark has no configs to run";
+			return;
+		}
+
+		Log() << "Starting benchmark of " << (unsigned)settings.size() << " configs, " << cycles << " cycle(s)";
+		running = true;
+		results.clear();
+		results.push_back(Result { 0, 0 });
+		BeginSetting(0);
+	}
+
+	void Benchmark::BeginSetting(size_t index) {
+		const Setting &setting = settings[index];
+		Log() << "Benchmark: running " << setting.name;
+		Config &config = Config::Instance();
+		config.fsrEnabled = setting.fsrEnabled;
+		config.useNis = setting.useNis;
+		config.sharpness = setting.sharpness;
+		config.radius = setting.radius;
+		// the hotkeys only work while the mod is enabled
+		HotkeyListener::Instance().UpdateBindings();
+		settingStart = Clock::now();
+		hasLastFrame = false;
+	}
+
+	void Benchmark::Finish(bool completed) {
+		running = false;
+		Config &config = Config::Instance();
+		config.fsrEnabled = original.fsrEnabled;
+		config.useNis = original.useNis;
+		config.sharpness = original.sharpness;
+		config.radius = original.radius;
+		HotkeyListener::Instance().UpdateBindings();
+
+		for (const Result &result : results) {
+			Log() << "Benchmark " << settings[result.setting].name << " (cycle " << result.cycle + 1 << "): "
+				<< (unsigned)result.frameMs.size() << " frames, " << Mean(result.frameMs) << " ms per frame, "
+				<< Mean(result.gpuMs) << " ms GPU per post-processing run";
+		}
+		WriteReport();
+		Log() << "Benchmark " << (completed ? "finished" : "stopped") << ", restored the previous settings";
+	}
+
+	void Benchmark::WriteReport() {
+		static char timeBuf[16];
+		std::time_t now = std::time(nullptr);
+		std::strftime(timeBuf, sizeof(timeBuf), "%Y%m%d_%H%M%S", std::localtime(&now));
+		std::wstring filename = GetDllPath() + L"\\benchmark_" + std::wstring(timeBuf, timeBuf + strlen(timeBuf)) + L".csv";
+
+		std::ofstream csv (filename);
+		if (!csv.is_open()) {
+			Log(LogLevel::Error) << "Could not write the benchmark report";
+			return;
+		}
+		csv << "cycle,config,enabled,use_nis,sharpness,radius,render_scale,frames,frame_ms_mean,frame_ms_p50,frame_ms_p90,frame_ms_p99,frame_ms_max,"
+			"gpu_runs,gpu_ms_mean,gpu_ms_p50,gpu_ms_p90,gpu_ms_p99,gpu_ms_max\n";
+		for (const Result &result : results) {
+			const Setting &setting = settings[result.setting];
+			char buf[128];
+			snprintf(buf, sizeof(buf), "%d,%d,%.3f,%.3f,%.3f,", setting.fsrEnabled ? 1 : 0, setting.useNis ? 1 : 0,
+				setting.sharpness, setting.radius, Config::Instance().renderScale);
+			// names are quoted, as they may contain commas
+			std::string name = setting.name;
+			std::replace(name.begin(), name.end(), '"', '\'');
+			csv << result.cycle + 1 << ",\"" << name << "\"," << buf << result.frameMs.size() << "," << Distribution(result.frameMs) << ","
+				<< result.gpuMs.size() << "," << Distribution(result.gpuMs) << "\n";
+		}
+		Log() << "Wrote the benchmark report to benchmark_" << timeBuf << ".csv";
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <chrono>
+#include <string>
+#include <vector>
+#include "json/json.h"
+#include "openvr.h"
+
+namespace vr {
+	// Cycles through the configurations listed in the config file's benchmark section while the game
+	// runs, spending a fixed time on each, and writes the distribution of frame times and post-processing
+	// GPU times per configuration to a CSV file next to the DLL. Configurations are switched the same
+	// way the hotkeys and config reloads switch them, so parameter changes only update constants and
+	// algorithm changes reuse the pooled textures and cached shaders. The first seconds after a switch
+	// are not measured, so that the switch itself and GPU timings of the previous configuration, which
+	// arrive a few frames late, don't count.
+	//
+	// A run starts when the section is enabled, at launch or by a config reload, and restores the
+	// settings it started with when it is done. Changing the section while a run is going starts over.
+	class Benchmark {
+	public:
+		// must be called at every Submit, before the settings are used
+		void Update(EVREye eEye);
+		// GPU time of one post-processing run, in milliseconds
+		void AddGpuTime(float ms);
+		bool IsRunning() const { return running; }
+
+	private:
+		typedef std::chrono::steady_clock Clock;
+
+		struct Setting {
+			std::string name;
+			bool fsrEnabled;
+			bool useNis;
+			float sharpness;
+			float radius;
+		};
+
+		struct Result {
+			int cycle;
+			size_t setting;
+			std::vector<float> frameMs;
+			std::vector<float> gpuMs;
+		};
+
+		bool running = false;
+		// the section the last run was started from, so that a finished run isn't repeated
+		Json::Value startedSection;
+		std::vector<Setting> settings;
+		Setting original;
+		int cycles = 1;
+		Clock::duration timePerSetting;
+		Clock::duration settleTime;
+
+		std::vector<Result> results;
+		Clock::time_point settingStart;
+		Clock::time_point lastFrame;
+		bool hasLastFrame = false;
+
+		void Start(const Json::Value &section);
+		void Finish(bool completed);
+		void BeginSetting(size_t index);
+		bool IsSettling(Clock::time_point now) const { return now - settingStart < settleTime; }
+		void WriteReport();
+	};
+}
@@ -1,9 +1,125 @@
 #include "Config.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <iomanip>
 #include <iostream>
+#include <memory>
+#include <sstream>
+#include <thread>
 #include <windows.h>
+#include "pathtools_public.h"
 
 namespace {
 	void helper() {}
+
+	std::string ToLower(std::string s) {
+		std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+		return s;
+	}
+
+	// FNV-1a over the file contents, as hex; identifies a particular build of a game
+	std::string HashFile(const std::string &path) {
+		std::ifstream file (path, std::ios::binary);
+		if (!file.is_open()) {
+			return "";
+		}
+		uint64_t hash = 14695981039346656037ull;
+		char buffer[65536];
+		while (file) {
+			file.read(buffer, sizeof(buffer));
+			for (std::streamsize i = 0; i < file.gcount(); ++i) {
+				hash = (hash ^ (uint8_t)buffer[i]) * 1099511628211ull;
+			}
+		}
+		std::ostringstream hex;
+		hex << std::hex << std::setw(16) << std::setfill('0') << hash;
+		return hex.str();
+	}
+
+	// the running executable's name and, once needed, its hash, kept for reloads of the config
+	std::string executablePath;
+	std::string executableName;
+	std::string executableHash;
+
+	// the last config the watcher read, until the render thread takes it; only accessed through
+	// std::atomic_load and friends
+	std::shared_ptr<const Config> pendingReload;
+	// the settings of the config file as last applied, with the profiles resolved once they are;
+	// reloads are compared against these rather than the live settings, which hotkeys and the
+	// benchmark change. Only accessed by StartWatching and on the render thread.
+	std::shared_ptr<const Config> appliedFile;
+	// like the log writer, left running if the game exits without shutting down OpenVR, so that
+	// nothing waits for it during DLL unload
+	std::thread *watcherThread = nullptr;
+	HANDLE watcherStopEvent = nullptr;
+
+	void WatchConfigFile(HANDLE stopEvent) {
+		HANDLE directory = CreateFileW(GetDllPath().c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+		if (directory == INVALID_HANDLE_VALUE) {
+			Log(LogLevel::Error) << "Could not watch the config file for changes";
+			return;
+		}
+		OVERLAPPED overlapped = {};
+		overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+		// FILE_NOTIFY_INFORMATION must be DWORD aligned
+		DWORD buffer[4096];
+		while (true) {
+			ResetEvent(overlapped.hEvent);
+			if (!ReadDirectoryChangesW(directory, buffer, sizeof(buffer), FALSE,
+					FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE, nullptr, &overlapped, nullptr)) {
+				Log(LogLevel::Error) << "Could not watch the config file for changes";
+				break;
+			}
+			HANDLE events[2] = { stopEvent, overlapped.hEvent };
+			DWORD bytes = 0;
+			if (WaitForMultipleObjects(2, events, FALSE, INFINITE) != WAIT_OBJECT_0 + 1) {
+				CancelIo(directory);
+				GetOverlappedResult(directory, &overlapped, &bytes, TRUE);
+				break;
+			}
+			if (!GetOverlappedResult(directory, &overlapped, &bytes, FALSE)) {
+				break;
+			}
+
+			// no bytes means the buffer overflowed, in which case the config may be among the changes
+			bool configChanged = bytes == 0;
+			for (const FILE_NOTIFY_INFORMATION *info = (const FILE_NOTIFY_INFORMATION*)buffer; bytes > 0; ) {
+				std::wstring name (info->FileName, info->FileNameLength / sizeof(wchar_t));
+				configChanged |= _wcsicmp(name.c_str(), L"openvr_mod.cfg") == 0;
+				if (info->NextEntryOffset == 0) {
+					break;
+				}
+				info = (const FILE_NOTIFY_INFORMATION*)((const char*)info + info->NextEntryOffset);
+			}
+			if (!configChanged) {
+				continue;
+			}
+
+			// editors tend to save in several steps, so wait for them to finish before reading
+			if (WaitForSingleObject(stopEvent, 100) == WAIT_OBJECT_0) {
+				break;
+			}
+			std::shared_ptr<Config> config = std::make_shared<Config>();
+			if (Config::LoadFile(*config)) {
+				std::atomic_store(&pendingReload, std::shared_ptr<const Config>(config));
+			} else {
+				Log(LogLevel::Warning) << "Could not reload the config file, keeping the current settings";
+			}
+		}
+		CloseHandle(overlapped.hEvent);
+		CloseHandle(directory);
+	}
+
+	bool UsesExecutableHash(const Json::Value &profiles) {
+		for (const Json::Value &profile : profiles) {
+			if (profile.isMember("executableHash")) {
+				return true;
+			}
+		}
+		return false;
+	}
 }
 
 std::wstring GetDllPath() {
@@ -22,11 +138,152 @@ std::wstring GetDllPath() {
 	return p.substr(0, p.find_last_of('\\'));
 }
 
-std::ostream& Log() {
+void Config::ResolveProfile(const std::string &hmdModel) {
+	if (profileResolved) {
+		return;
+	}
+	profileResolved = true;
+
+	this->hmdModel = hmdModel;
+
+	if (executablePath.empty()) {
+		executablePath = Path_GetExecutablePath();
+		executableName = ToLower(Path_StripDirectory(executablePath));
+	}
+	// reading the executable can take a moment, so it's only hashed if a profile needs it or to look the hash up
+	if (executableHash.empty() && (debugMode || UsesExecutableHash(profiles))) {
+		executableHash = HashFile(executablePath);
+	}
+	const std::string &executable = executableName;
+	Log() << "Running " << executable << (executableHash.empty() ? "" : " (hash " + executableHash + ")") << " on HMD " << hmdModel;
+
 	try {
-		static std::ofstream logFile (GetDllPath() + L"\\openvr_mod.log");
-		return logFile;
+		for (const Json::Value &profile : profiles) {
+			// every given condition must hold; the HMD model only needs to contain the configured name
+			bool matches = true;
+			if (profile.isMember("executable")) {
+				matches &= ToLower(profile["executable"].asString()) == executable;
+			}
+			if (profile.isMember("executableHash")) {
+				matches &= !executableHash.empty() && ToLower(profile["executableHash"].asString()) == executableHash;
+			}
+			if (profile.isMember("hmd")) {
+				matches &= ToLower(hmdModel).find(ToLower(profile["hmd"].asString())) != std::string::npos;
+			}
+			if (!matches) {
+				continue;
+			}
+
+			Log() << "Applying profile " << profile.get("name", "(unnamed)").asString();
+			if (profile.isMember("renderScale")) {
+				renderScale = profile["renderScale"].asFloat();
+			}
+			if (profile.isMember("useNIS")) {
+				useNis = profile["useNIS"].asBool();
+			}
+			if (profile.isMember("radius")) {
+				radius = profile["radius"].asFloat();
+			}
+			if (profile.isMember("sharpness")) {
+				sharpness = profile["sharpness"].asFloat();
+				if (sharpness < 0) sharpness = 0;
+			}
+		}
 	} catch (...) {
-		return std::cout;
+		Log(LogLevel::Error) << "Could not apply the config profiles.";
+	}
+}
+
+void Config::StartWatching() {
+	if (watcherThread != nullptr) {
+		return;
+	}
+	appliedFile = std::make_shared<const Config>(Instance());
+	watcherStopEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+	watcherThread = new std::thread(WatchConfigFile, watcherStopEvent);
+}
+
+void Config::StopWatching() {
+	if (watcherThread == nullptr) {
+		return;
 	}
+	SetEvent(watcherStopEvent);
+	watcherThread->join();
+	delete watcherThread;
+	watcherThread = nullptr;
+	CloseHandle(watcherStopEvent);
+	watcherStopEvent = nullptr;
+	std::atomic_store(&pendingReload, std::shared_ptr<const Config>());
+}
+
+bool Config::ApplyPendingReload() {
+	std::shared_ptr<const Config> reload = std::atomic_exchange(&pendingReload, std::shared_ptr<const Config>());
+	if (!reload) {
+		return false;
+	}
+	Config next = *reload;
+	Config previous = appliedFile ? *appliedFile : *this;
+	if (profileResolved) {
+		next.ResolveProfile(hmdModel);
+		previous.ResolveProfile(hmdModel);
+	}
+	appliedFile = std::make_shared<const Config>(next);
+	// the game has already sized its render targets by the render scale
+	if (previous.renderScale != next.renderScale) {
+		Log(LogLevel::Warning) << "renderScale changes take effect after restarting the game";
+	}
+
+	LogLine log = Log();
+	log << "Config file reloaded, changed:";
+	bool changed = false;
+	// only what the edit changed, so that saving the file keeps the settings changed with hotkeys
+#define APPLY_IF_CHANGED(field) if (!(previous.field == next.field)) { field = next.field; log << " " #field; changed = true; }
+	APPLY_IF_CHANGED(fsrEnabled)
+	APPLY_IF_CHANGED(applyMIPBias)
+	APPLY_IF_CHANGED(sharpness)
+	APPLY_IF_CHANGED(radius)
+	APPLY_IF_CHANGED(debugMode)
+	APPLY_IF_CHANGED(useNis)
+	APPLY_IF_CHANGED(chain)
+	APPLY_IF_CHANGED(grainAmount)
+	APPLY_IF_CHANGED(outputRingSize)
+	APPLY_IF_CHANGED(intermediateFormat)
+	APPLY_IF_CHANGED(dither)
+	APPLY_IF_CHANGED(lensDistortion)
+	APPLY_IF_CHANGED(supersample)
+	APPLY_IF_CHANGED(tileClassification)
+	APPLY_IF_CHANGED(flatTileThreshold)
+	APPLY_IF_CHANGED(lumaUpscale)
+	APPLY_IF_CHANGED(telemetry)
+	APPLY_IF_CHANGED(trace)
+	APPLY_IF_CHANGED(framePacing)
+	APPLY_IF_CHANGED(hud)
+	APPLY_IF_CHANGED(gpuBudgetEnabled)
+	APPLY_IF_CHANGED(gpuBudgetMs)
+	APPLY_IF_CHANGED(gpuBudgetMinRadius)
+	APPLY_IF_CHANGED(hotkeysEnabled)
+	APPLY_IF_CHANGED(hotkeysRequireCtrl)
+	APPLY_IF_CHANGED(hotkeysRequireAlt)
+	APPLY_IF_CHANGED(hotkeysRequireShift)
+	APPLY_IF_CHANGED(hotkeyToggleUseNis)
+	APPLY_IF_CHANGED(hotkeyToggleDebugMode)
+	APPLY_IF_CHANGED(hotkeyDecreaseSharpness)
+	APPLY_IF_CHANGED(hotkeyIncreaseSharpness)
+	APPLY_IF_CHANGED(hotkeyDecreaseRadius)
+	APPLY_IF_CHANGED(hotkeyIncreaseRadius)
+	APPLY_IF_CHANGED(hotkeyCaptureOutput)
+	APPLY_IF_CHANGED(hotkeyRecordFrameDump)
+	APPLY_IF_CHANGED(hotkeyWriteTrace)
+	APPLY_IF_CHANGED(captureFormat)
+	APPLY_IF_CHANGED(captureBurstFrames)
+	APPLY_IF_CHANGED(frameDumpFrames)
+	APPLY_IF_CHANGED(benchmark)
+	APPLY_IF_CHANGED(profiles)
+#undef APPLY_IF_CHANGED
+	if (!changed) {
+		log << " nothing";
+	}
+
+	SetLogLevel(debugMode ? LogLevel::Debug : LogLevel::Info);
+	return changed;
 }
@@ -1,10 +1,12 @@
 #pragma once
 #include <fstream>
+#include <string>
+#include <vector>
 
+#include "Logging.h"
 #include "PostProcessor.h"
 #include "json/json.h"
 
-std::ostream& Log();
 std::wstring GetDllPath();
 
 struct Config {
@@ -15,6 +17,33 @@ struct Config {
 	float radius = 0.5f;
 	bool debugMode = false;
 	bool useNis = false;
+	// post-processing stages in order; empty to let the upscaler decide
+	std::vector<vr::PipelineStage> chain;
+	float grainAmount = 0.3f;
+	int outputRingSize = 2;
+	// framedump::Format of the intermediate textures, 0 for the output format
+	uint32_t intermediateFormat = 0;
+	bool dither = false;
+	// upscale straight to the lens distorted image, see LensDistortion.h
+	bool lensDistortion = false;
+	// with renderScale > 1, filter the upscaled image back down to the game's resolution
+	bool supersample = false;
+	// let FSR skip tiles whose luma range is below flatTileThreshold, see PipelineSettings
+	bool tileClassification = false;
+	float flatTileThreshold = 0.01f;
+	// run EASU on the luma only, see PipelineSettings
+	bool lumaUpscale = false;
+	// publish live statistics in shared memory, see Telemetry.h
+	bool telemetry = false;
+	bool trace = false;
+	bool framePacing = false;
+	// show live statistics on an overlay in the headset, see PerformanceHud.h
+	bool hud = false;
+	// shrink the radius below the configured one while the post-processing takes longer than
+	// gpuBudgetMs per frame, summed over both eyes, see RadiusGovernor.h
+	bool gpuBudgetEnabled = false;
+	float gpuBudgetMs = 2.f;
+	float gpuBudgetMinRadius = 0.2f;
 	bool hotkeysEnabled = true;
 	bool hotkeysRequireCtrl = false;
 	bool hotkeysRequireAlt = false;
@@ -26,39 +55,120 @@ struct Config {
 	int hotkeyDecreaseRadius = VK_F5;
 	int hotkeyIncreaseRadius = VK_F6;
 	int hotkeyCaptureOutput = VK_F7;
+	int hotkeyRecordFrameDump = VK_F8;
+	int hotkeyWriteTrace = VK_F9;
+	vr::CaptureFormat captureFormat = vr::CaptureFormat::DDS;
+	int captureBurstFrames = 1;
+	int frameDumpFrames = 90;
+	// the benchmark section, read by vr::Benchmark when a run starts
+	Json::Value benchmark;
+	// per-title overrides from the profiles section, applied by ResolveProfile
+	Json::Value profiles;
+	bool profileResolved = false;
+	std::string hmdModel;
 
-	static Config Load() {
-		Config config;
+	// Applies every profile matching the running executable and the given HMD model on top of the
+	// global settings, later profiles overriding earlier ones. Only the first call has an effect.
+	void ResolveProfile(const std::string &hmdModel);
+
+	// Watches openvr_mod.cfg on a background thread, which parses it again whenever it is saved.
+	static void StartWatching();
+	static void StopWatching();
+	// Takes the settings of the config file's last reload, if there was one since the previous call,
+	// that differ from the file as it was applied before. Settings the edit left alone keep their
+	// current values, including those changed with hotkeys, and parameter changes don't recreate
+	// resources. Called on the render thread; returns whether any setting changed.
+	bool ApplyPendingReload();
+
+	// reads openvr_mod.cfg into config; returns false if it is missing or can't be parsed, in which
+	// case config may hold only some of its settings
+	static bool LoadFile(Config &config) {
 		try {
 			std::ifstream configFile (GetDllPath() + L"\\openvr_mod.cfg");
-			if (configFile.is_open()) {
-				Json::Value root;
-				configFile >> root;
-				Json::Value fsr = root.get("fsr", Json::Value());
-				config.fsrEnabled = fsr.get("enabled", false).asBool();
-				config.sharpness = fsr.get("sharpness", 1.0).asFloat();
-				if (config.sharpness < 0) config.sharpness = 0;
-				config.renderScale = fsr.get("renderScale", 1.0).asFloat();
-				config.applyMIPBias = fsr.get("applyMIPBias", true).asBool();
-				config.radius = fsr.get("radius", 0.5).asFloat();
-				config.debugMode = fsr.get("debugMode", false).asBool();
-				config.useNis = fsr.get("useNIS", false).asBool();
-				Json::Value hotkeys = fsr.get("hotkeys", Json::Value());
-				config.hotkeysEnabled = hotkeys.get("enabled", true).asBool();
-				config.hotkeysRequireCtrl = hotkeys.get("requireCtrl", false).asBool();
-				config.hotkeysRequireAlt = hotkeys.get("requireAlt", false).asBool();
-				config.hotkeysRequireShift = hotkeys.get("requireShift", false).asBool();
-				config.hotkeyToggleUseNis = hotkeys.get("toggleUseNIS", VK_F1).asInt();
-				config.hotkeyToggleDebugMode = hotkeys.get("toggleDebugMode", VK_F2).asInt();
-				config.hotkeyDecreaseSharpness = hotkeys.get("decreaseSharpness", VK_F3).asInt();
-				config.hotkeyIncreaseSharpness = hotkeys.get("increaseSharpness", VK_F4).asInt();
-				config.hotkeyDecreaseRadius = hotkeys.get("decreaseRadius", VK_F5).asInt();
-				config.hotkeyIncreaseRadius = hotkeys.get("increaseRadius", VK_F6).asInt();
-				config.hotkeyCaptureOutput = hotkeys.get("captureOutput", VK_F7).asInt();
+			if (!configFile.is_open()) {
+				return false;
+			}
+			Json::Value root;
+			configFile >> root;
+			Json::Value fsr = root.get("fsr", Json::Value());
+			config.fsrEnabled = fsr.get("enabled", false).asBool();
+			config.sharpness = fsr.get("sharpness", 1.0).asFloat();
+			if (config.sharpness < 0) config.sharpness = 0;
+			config.renderScale = fsr.get("renderScale", 1.0).asFloat();
+			config.applyMIPBias = fsr.get("applyMIPBias", true).asBool();
+			config.radius = fsr.get("radius", 0.5).asFloat();
+			config.debugMode = fsr.get("debugMode", false).asBool();
+			config.useNis = fsr.get("useNIS", false).asBool();
+			Json::Value chain = fsr.get("chain", Json::Value(Json::arrayValue));
+			for (const Json::Value &name : chain) {
+				vr::PipelineStage stage;
+				if (vr::ParsePipelineStage(name.asString(), stage)) {
+					config.chain.push_back(stage);
+				} else {
+					Log(LogLevel::Warning) << "Ignoring unknown post-processing stage " << name.asString();
+				}
+			}
+			config.grainAmount = fsr.get("grainAmount", 0.3).asFloat();
+			if (config.grainAmount < 0) config.grainAmount = 0;
+			config.outputRingSize = fsr.get("outputRingSize", 2).asInt();
+			std::string intermediateFormat = fsr.get("intermediateFormat", "output").asString();
+			if (!vr::ParseIntermediateFormat(intermediateFormat, config.intermediateFormat)) {
+				Log(LogLevel::Warning) << "Ignoring unknown intermediate format " << intermediateFormat;
 			}
+			config.dither = fsr.get("dither", false).asBool();
+			config.lensDistortion = fsr.get("lensDistortion", false).asBool();
+			config.supersample = fsr.get("supersample", false).asBool();
+			Json::Value tileClassification = fsr.get("tileClassification", Json::Value());
+			config.tileClassification = tileClassification.get("enabled", false).asBool();
+			config.flatTileThreshold = tileClassification.get("threshold", 0.01).asFloat();
+			if (config.flatTileThreshold < 0) config.flatTileThreshold = 0;
+			config.lumaUpscale = fsr.get("lumaUpscale", false).asBool();
+			config.telemetry = fsr.get("telemetry", false).asBool();
+			config.trace = fsr.get("trace", false).asBool();
+			config.framePacing = fsr.get("framePacing", false).asBool();
+			config.hud = fsr.get("hud", false).asBool();
+			Json::Value gpuBudget = fsr.get("gpuBudget", Json::Value());
+			config.gpuBudgetEnabled = gpuBudget.get("enabled", false).asBool();
+			config.gpuBudgetMs = gpuBudget.get("milliseconds", 2.0).asFloat();
+			config.gpuBudgetMinRadius = gpuBudget.get("minRadius", 0.2).asFloat();
+			if (config.gpuBudgetMinRadius < 0) config.gpuBudgetMinRadius = 0;
+			Json::Value capture = fsr.get("capture", Json::Value());
+			config.captureFormat = capture.get("format", "dds").asString() == "png" ? vr::CaptureFormat::PNG : vr::CaptureFormat::DDS;
+			config.captureBurstFrames = capture.get("burstFrames", 1).asInt();
+			if (config.captureBurstFrames < 1) config.captureBurstFrames = 1;
+			if (config.captureBurstFrames > vr::AsyncCapture::MAX_BURST_FRAMES) {
+				Log(LogLevel::Warning) << "capture.burstFrames is limited to " << vr::AsyncCapture::MAX_BURST_FRAMES << " frames";
+				config.captureBurstFrames = vr::AsyncCapture::MAX_BURST_FRAMES;
+			}
+			config.frameDumpFrames = capture.get("frameDumpFrames", 90).asInt();
+			if (config.frameDumpFrames < 1) config.frameDumpFrames = 1;
+			config.benchmark = fsr.get("benchmark", Json::Value());
+			Json::Value hotkeys = fsr.get("hotkeys", Json::Value());
+			config.hotkeysEnabled = hotkeys.get("enabled", true).asBool();
+			config.hotkeysRequireCtrl = hotkeys.get("requireCtrl", false).asBool();
+			config.hotkeysRequireAlt = hotkeys.get("requireAlt", false).asBool();
+			config.hotkeysRequireShift = hotkeys.get("requireShift", false).asBool();
+			config.hotkeyToggleUseNis = hotkeys.get("toggleUseNIS", VK_F1).asInt();
+			config.hotkeyToggleDebugMode = hotkeys.get("toggleDebugMode", VK_F2).asInt();
+			config.hotkeyDecreaseSharpness = hotkeys.get("decreaseSharpness", VK_F3).asInt();
+			config.hotkeyIncreaseSharpness = hotkeys.get("increaseSharpness", VK_F4).asInt();
+			config.hotkeyDecreaseRadius = hotkeys.get("decreaseRadius", VK_F5).asInt();
+			config.hotkeyIncreaseRadius = hotkeys.get("increaseRadius", VK_F6).asInt();
+			config.hotkeyCaptureOutput = hotkeys.get("captureOutput", VK_F7).asInt();
+			config.hotkeyRecordFrameDump = hotkeys.get("recordFrameDump", VK_F8).asInt();
+			config.hotkeyWriteTrace = hotkeys.get("writeTrace", VK_F9).asInt();
+			config.profiles = root.get("profiles", Json::Value(Json::arrayValue));
+			return true;
 		} catch (...) {
-			Log() << "Could not read config file.\n";
+			Log(LogLevel::Error) << "Could not read config file.";
+			return false;
 		}
+	}
+
+	static Config Load() {
+		Config config;
+		LoadFile(config);
+		SetLogLevel(config.debugMode ? LogLevel::Debug : LogLevel::Info);
 		return config;
 	}
 
@@ -0,0 +1,233 @@
+#include "CpuBackend.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
+#include "Logging.h"
+#include "Tracing.h"
+
+namespace vr {
+namespace cpu {
+	namespace {
+		// the format the post processor's shader resource views read a texture in, see MakeSrgbFormatsTypeless
+		uint32_t MakeSrgbFormatsTypeless(uint32_t format) {
+			switch (format) {
+			case framedump::FORMAT_B8G8R8A8_UNORM_SRGB:
+				return framedump::FORMAT_B8G8R8A8_TYPELESS;
+			case framedump::FORMAT_B8G8R8X8_UNORM_SRGB:
+				return framedump::FORMAT_B8G8R8X8_TYPELESS;
+			case framedump::FORMAT_R8G8B8A8_UNORM_SRGB:
+				return framedump::FORMAT_R8G8B8A8_TYPELESS;
+			default:
+				return format;
+			}
+		}
+
+		uint32_t DetermineOutputFormat(uint32_t inputFormat) {
+			switch (inputFormat) {
+			case framedump::FORMAT_R10G10B10A2_UNORM:
+			case framedump::FORMAT_R10G10B10A2_TYPELESS:
+				return framedump::FORMAT_R10G10B10A2_UNORM;
+			default:
+				return framedump::FORMAT_R8G8B8A8_UNORM;
+			}
+		}
+
+		bool IsSrgbFormat(uint32_t format) {
+			switch (format) {
+			case framedump::FORMAT_B8G8R8A8_UNORM_SRGB:
+			case framedump::FORMAT_B8G8R8X8_UNORM_SRGB:
+			case framedump::FORMAT_R8G8B8A8_UNORM_SRGB:
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		bool IsConsideredSrgbByOpenVR(uint32_t format) {
+			switch (format) {
+			case framedump::FORMAT_R8G8B8A8_UNORM_SRGB:
+			case framedump::FORMAT_B8G8R8A8_UNORM_SRGB:
+			case framedump::FORMAT_B8G8R8X8_UNORM_SRGB:
+			case framedump::FORMAT_B8G8R8A8_TYPELESS:
+			case framedump::FORMAT_R8G8B8A8_TYPELESS:
+			case framedump::FORMAT_B8G8R8X8_TYPELESS:
+			case framedump::FORMAT_R10G10B10A2_TYPELESS:
+				return true;
+			default:
+				return false;
+			}
+		}
+	}
+
+	bool CpuBackend::DescribeInput(void *texture, InputTextureInfo &info) {
+		const HostTexture *host = (const HostTexture*)texture;
+		if (host->pixels == nullptr || framedump::BytesPerPixel(host->format) == 0) {
+			return false;
+		}
+		info.width = host->width;
+		info.height = host->height;
+		info.format = MakeSrgbFormatsTypeless(host->format);
+		info.outputFormat = DetermineOutputFormat(host->format);
+		info.sampleCount = 1;
+		info.shaderReadable = true;
+		info.srgbFormat = IsSrgbFormat(host->format);
+		info.consideredSrgb = IsConsideredSrgbByOpenVR(host->format);
+		return true;
+	}
+
+	void CpuBackend::PrepareResources(void *texture, const PipelinePlan &plan) {
+		if (plan.useNis) {
+			Log(LogLevel::Error) << "NIS is not available on the CPU backend";
+			throw std::exception();
+		}
+		for (const PipelinePass &pass : plan.graph.passes) {
+			if (pass.stage == PipelineStage::Cas) {
+				Log(LogLevel::Error) << "CAS is not available on the CPU backend";
+				throw std::exception();
+			}
+		}
+
+		textureContainsOnlyOneEye = plan.textureContainsOnlyOneEye;
+		supersample = plan.supersample;
+		lensDistortion = plan.lensDistortion;
+		for (int eye = 0; eye < 2; ++eye) {
+			distortionMap[eye] = plan.distortionMap[eye];
+		}
+		classifyTiles = plan.classifyTiles;
+		lumaUpscale = plan.lumaUpscale;
+		outputWidth = plan.outputWidth;
+		outputHeight = plan.outputHeight;
+		UpdateConstants(plan);
+
+		transientImages.resize(plan.graph.textures.size());
+		transientTextures.resize(plan.graph.textures.size());
+		transientFormats = plan.graph.textures;
+		for (size_t i = 0; i < plan.graph.textures.size(); ++i) {
+			transientImages[i].Resize(plan.graph.textures[i].width, plan.graph.textures[i].height);
+		}
+	}
+
+	void CpuBackend::ReleaseResources() {
+		input = Image();
+		transientImages.clear();
+		transientTextures.clear();
+		transientFormats.clear();
+		lensDistortion = false;
+		for (int eye = 0; eye < 2; ++eye) {
+			distortionMap[eye] = DistortionMap();
+		}
+		classifyTiles = false;
+		flatTiles = TileMask();
+		lumaUpscale = false;
+		luma = Image();
+	}
+
+	void CpuBackend::UpdateConstants(const PipelinePlan &plan) {
+		for (int eye = 0; eye < 2; ++eye) {
+			upscaleConstants[eye] = plan.constants.upscale[eye];
+			sharpenConstants[eye] = plan.constants.sharpen[eye];
+			distortion[eye] = plan.distortion[eye];
+		}
+		grainAmount = plan.grainAmount;
+		classify = plan.classify;
+	}
+
+	bool CpuBackend::BeginPostProcess(EVREye eEye, void *texture, uint32_t frameIndex) {
+		grainSeed = frameIndex;
+		const HostTexture *host = (const HostTexture*)texture;
+		if (!DecodeImage(host->pixels, host->width, host->height, host->rowPitch, host->format, input)) {
+			return false;
+		}
+		if (classifyTiles) {
+			TRACE_SCOPE("CpuBackend::ClassifyTiles");
+			ClassifyTiles(input, classify, outputWidth, outputHeight, flatTiles);
+		}
+		return true;
+	}
+
+	void CpuBackend::RunPass(const PipelinePass &pass, EVREye eEye) {
+		TRACE_SCOPE("CpuBackend::RunPass");
+		const Image &source = GetImage(pass.input);
+		Image &target = GetImage(pass.output);
+		const TileMask *mask = pass.skipFlatTiles ? &flatTiles : nullptr;
+		switch (pass.stage) {
+		case PipelineStage::Upscale: {
+			const UpscaleConstants &constants = upscaleConstants[eEye];
+			if (lensDistortion) {
+				const DistortionMap &map = distortionMap[eEye];
+				const DistortionConstants &eyeDistortion = distortion[eEye];
+				ParallelRows(target.height, [&](uint32_t begin, uint32_t end) { EasuDistorted(source, target, constants, map, eyeDistortion, begin, end); });
+			} else if (supersample) {
+				ParallelRows(target.height, [&](uint32_t begin, uint32_t end) { EasuSupersampled(source, target, constants, begin, end, mask); });
+			} else if (lumaUpscale) {
+				luma.Resize(source.width, source.height);
+				ParallelRows(source.height, [&](uint32_t begin, uint32_t end) { Luma(source, luma, begin, end); });
+				ParallelRows(target.height, [&](uint32_t begin, uint32_t end) { EasuLuma(source, luma, target, constants, begin, end, mask); });
+			} else {
+				ParallelRows(target.height, [&](uint32_t begin, uint32_t end) { Easu(source, target, constants, begin, end, mask); });
+			}
+			break;
+		}
+		case PipelineStage::Sharpen: {
+			const SharpenConstants &constants = sharpenConstants[eEye];
+			ParallelRows(target.height, [&](uint32_t begin, uint32_t end) { Rcas(source, target, constants, begin, end, mask); });
+			break;
+		}
+		case PipelineStage::Grain:
+			ParallelRows(target.height, [&](uint32_t begin, uint32_t end) { Grain(source, target, grainAmount, grainSeed, begin, end); });
+			break;
+		default:
+			break;
+		}
+		if (pass.fusedGrain) {
+			// the fused shaders add the grain before writing, so this sees the unquantized result as well
+			ParallelRows(target.height, [&](uint32_t begin, uint32_t end) { Grain(target, target, grainAmount, grainSeed, begin, end); });
+		}
+		// the next pass reads what a GPU pass would have written to its output texture
+		const TransientTexture &format = transientFormats[pass.output];
+		QuantizeImage(target, format.format, format.dither);
+	}
+
+	void * CpuBackend::GetSubmitTexture(PipelineSurface surface, void *texture) {
+		if (surface == INPUT_SURFACE) {
+			return texture;
+		}
+		HostTexture *output = &transientTextures[surface];
+		const Image &image = GetImage(surface);
+		output->width = image.width;
+		output->height = image.height;
+		output->format = framedump::FORMAT_R32G32B32A32_FLOAT;
+		output->rowPitch = (size_t)image.width * 4 * sizeof(float);
+		output->pixels = image.pixels.data();
+		return output;
+	}
+
+	Image & CpuBackend::GetImage(PipelineSurface surface) {
+		if (surface == INPUT_SURFACE) {
+			return input;
+		}
+		return transientImages[surface];
+	}
+
+	void CpuBackend::ParallelRows(uint32_t height, const std::function<void(uint32_t, uint32_t)> &fn) {
+		const uint32_t rowsPerJob = TILE_SIZE;
+		uint32_t jobs = (height + rowsPerJob - 1) / rowsPerJob;
+		std::atomic<uint32_t> nextJob (0);
+		auto work = [&]() {
+			for (uint32_t job = nextJob++; job < jobs; job = nextJob++) {
+				fn(job * rowsPerJob, (std::min)((job + 1) * rowsPerJob, height));
+			}
+		};
+		std::vector<std::thread> workers;
+		for (int i = 1; i < threads; ++i) {
+			workers.emplace_back(work);
+		}
+		work();
+		for (auto &worker : workers) {
+			worker.join();
+		}
+	}
+}
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "CpuKernels.h"
+#include "PostProcessPipeline.h"
+
+namespace vr {
+namespace cpu {
+	// an image in host memory, submitted to the CPU backend in place of a GPU texture
+	struct HostTexture {
+		uint32_t width = 0;
+		uint32_t height = 0;
+		// a framedump::Format
+		uint32_t format = 0;
+		size_t rowPitch = 0;
+		const void *pixels = nullptr;
+	};
+
+	// PostProcessPipeline backend that runs the stages with the CPU kernels, so the whole pipeline can
+	// be exercised and benchmarked on machines without a GPU. Submitted textures are HostTextures; the
+	// processed surfaces are handed back as HostTextures in FORMAT_R32G32B32A32_FLOAT, holding values
+	// quantized to the output format like the GPU textures would.
+	//
+	// NIS and CAS have no CPU port, so preparing resources for a plan using them fails.
+	class CpuBackend : public PostProcessBackend {
+	public:
+		explicit CpuBackend(int threads = 1) : threads(threads < 1 ? 1 : threads) {}
+
+		bool DescribeInput(void *texture, InputTextureInfo &info) override;
+		void PrepareResources(void *texture, const PipelinePlan &plan) override;
+		void ReleaseResources() override;
+		void UpdateConstants(const PipelinePlan &plan) override;
+		bool BeginPostProcess(EVREye eEye, void *texture, uint32_t frameIndex) override;
+		void RunPass(const PipelinePass &pass, EVREye eEye) override;
+		void EndPostProcess(EVREye eEye, PipelineSurface output) override {}
+		void * GetSubmitTexture(PipelineSurface surface, void *texture) override;
+
+	private:
+		int threads;
+		bool textureContainsOnlyOneEye = true;
+		UpscaleConstants upscaleConstants[2];
+		SharpenConstants sharpenConstants[2];
+		float grainAmount = 0.f;
+		uint32_t grainSeed = 0;
+		bool supersample = false;
+		bool lensDistortion = false;
+		DistortionMap distortionMap[2];
+		DistortionConstants distortion[2];
+		bool classifyTiles = false;
+		ClassifyConstants classify;
+		uint32_t outputWidth = 0;
+		uint32_t outputHeight = 0;
+		// the classification of the current input, for the passes that skip flat tiles
+		TileMask flatTiles;
+		bool lumaUpscale = false;
+		// what the luma prepass of the upscale pass wrote
+		Image luma;
+
+		Image input;
+		// the pipeline graph's intermediate textures, indexed by PipelineSurface
+		std::vector<Image> transientImages;
+		std::vector<HostTexture> transientTextures;
+		// the format and dithering of each of them, as planned
+		std::vector<TransientTexture> transientFormats;
+
+		Image & GetImage(PipelineSurface surface);
+		// runs fn over tile-aligned row ranges of the given height on all threads
+		void ParallelRows(uint32_t height, const std::function<void(uint32_t, uint32_t)> &fn);
+	};
+}
+}
@@ -0,0 +1,797 @@
+#include "CpuKernels.h"
+#include "FrameDump.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#define A_CPU
+#include "fsr/ffx_a.h"
+#include "fsr/ffx_fsr1.h"
+
+namespace vr {
+namespace cpu {
+	namespace {
+		inline float AsFloat(uint32_t u) {
+			float f;
+			memcpy(&f, &u, sizeof(f));
+			return f;
+		}
+
+		inline uint32_t AsUint(float f) {
+			uint32_t u;
+			memcpy(&u, &f, sizeof(u));
+			return u;
+		}
+
+		// the approximations from ffx_a.h the shaders use
+		inline float PrxLoRcp(float a) { return AsFloat(0x7ef07ebbu - AsUint(a)); }
+		inline float PrxMedRcp(float a) { float b = AsFloat(0x7ef19fffu - AsUint(a)); return b * (-b * a + 2.f); }
+		inline float PrxLoRsq(float a) { return AsFloat(0x5f347d74u - (AsUint(a) >> 1)); }
+		inline float Sat(float a) { return (std::min)(1.f, (std::max)(0.f, a)); }
+		inline float Min3(float a, float b, float c) { return (std::min)(a, (std::min)(b, c)); }
+		inline float Max3(float a, float b, float c) { return (std::max)(a, (std::max)(b, c)); }
+
+		float SmallFloatToFloat(uint32_t bits, uint32_t mantissaBits) {
+			uint32_t exponent = bits >> mantissaBits;
+			uint32_t mantissa = bits & ((1u << mantissaBits) - 1);
+			if (exponent == 0) {
+				return std::ldexp((float)mantissa, -14 - (int)mantissaBits);
+			}
+			if (exponent == 31) {
+				return mantissa == 0 ? INFINITY : NAN;
+			}
+			return std::ldexp(1.f + mantissa / float(1u << mantissaBits), (int)exponent - 15);
+		}
+
+		// rounds a non-negative value to the nearest value of an unsigned float format with the given
+		// number of mantissa bits and a 5 bit exponent, as R11G11B10_FLOAT stores it
+		float RoundToSmallFloat(float value, int mantissaBits) {
+			if (!(value > 0.f)) {
+				return 0.f;
+			}
+			// largest finite value
+			float maxValue = std::ldexp(2.f - std::ldexp(1.f, -mantissaBits), 15);
+			if (value >= maxValue) {
+				return maxValue;
+			}
+			int exponent;
+			std::frexp(value, &exponent);
+			// values below 2^-14 are denormals with a fixed step
+			int step = (std::max)(exponent - 1, -14) - mantissaBits;
+			return std::ldexp(std::floor(std::ldexp(value, -step) + 0.5f), step);
+		}
+
+		float HalfToFloat(uint16_t half) {
+			float value = SmallFloatToFloat(half & 0x7fff, 10);
+			return (half & 0x8000) ? -value : value;
+		}
+
+		// texture fetch with clamp addressing, as used by the gathers and the bilinear sampler
+		inline const float * ClampedTexel(const Image &image, int x, int y) {
+			x = (std::min)((std::max)(x, 0), (int)image.width - 1);
+			y = (std::min)((std::max)(y, 0), (int)image.height - 1);
+			return image.Pixel(x, y);
+		}
+
+		// Texture.Load, which returns zero outside the texture
+		inline const float * LoadedTexel(const Image &image, int x, int y) {
+			static const float zero[4] = { 0, 0, 0, 0 };
+			if (x < 0 || y < 0 || x >= (int)image.width || y >= (int)image.height) {
+				return zero;
+			}
+			return image.Pixel(x, y);
+		}
+
+		inline float Luma2(const float *c) {
+			return c[2] * 0.5f + (c[0] * 0.5f + c[1]);
+		}
+
+		void SampleBilinear(const Image &input, float u, float v, float *out) {
+			float tx = u * input.width - 0.5f;
+			float ty = v * input.height - 0.5f;
+			float fx = std::floor(tx);
+			float fy = std::floor(ty);
+			float wx = tx - fx;
+			float wy = ty - fy;
+			int x0 = (int)fx;
+			int y0 = (int)fy;
+			const float *a = ClampedTexel(input, x0, y0);
+			const float *b = ClampedTexel(input, x0 + 1, y0);
+			const float *c = ClampedTexel(input, x0, y0 + 1);
+			const float *d = ClampedTexel(input, x0 + 1, y0 + 1);
+			for (int i = 0; i < 3; ++i) {
+				float top = a[i] + (b[i] - a[i]) * wx;
+				float bottom = c[i] + (d[i] - c[i]) * wx;
+				out[i] = top + (bottom - top) * wy;
+			}
+			out[3] = 1.f;
+		}
+
+		void BilinearPixel(const Image &input, Image &output, uint32_t x, uint32_t y) {
+			SampleBilinear(input, (x + .5f) / output.width, (y + .5f) / output.height, output.Pixel(x, y));
+		}
+
+		void EasuSet(float &dirX, float &dirY, float &len, float w, float lA, float lB, float lC, float lD, float lE) {
+			float dc = lD - lC;
+			float cb = lC - lB;
+			float lenX = (std::max)(std::abs(dc), std::abs(cb));
+			lenX = PrxLoRcp(lenX);
+			float dX = lD - lB;
+			dirX += dX * w;
+			lenX = Sat(std::abs(dX) * lenX);
+			lenX *= lenX;
+			len += lenX * w;
+
+			float ec = lE - lC;
+			float ca = lC - lA;
+			float lenY = (std::max)(std::abs(ec), std::abs(ca));
+			lenY = PrxLoRcp(lenY);
+			float dY = lE - lA;
+			dirY += dY * w;
+			lenY = Sat(std::abs(dY) * lenY);
+			lenY *= lenY;
+			len += lenY * w;
+		}
+
+		// the kernel FsrEasuF fits to FSR's luma around 'f': its direction, anisotropy and lobe
+		struct EasuKernel {
+			float dirX, dirY;
+			float len2X, len2Y;
+			float lob, clp;
+		};
+
+		// the luma of the 12 taps, laid out as
+		//    b c
+		//  e f g h
+		//  i j k l
+		//    n o
+		EasuKernel FitEasuKernel(float ppX, float ppY, float bL, float cL, float eL, float fL, float gL, float hL,
+				float iL, float jL, float kL, float lL, float nL, float oL) {
+			float dirX = 0, dirY = 0, len = 0;
+			EasuSet(dirX, dirY, len, (1.f - ppX) * (1.f - ppY), bL, eL, fL, gL, jL);
+			EasuSet(dirX, dirY, len, ppX * (1.f - ppY), cL, fL, gL, hL, kL);
+			EasuSet(dirX, dirY, len, (1.f - ppX) * ppY, fL, iL, jL, kL, nL);
+			EasuSet(dirX, dirY, len, ppX * ppY, gL, jL, kL, lL, oL);
+
+			float dirR = dirX * dirX + dirY * dirY;
+			bool zro = dirR < 1.f / 32768.f;
+			dirR = PrxLoRsq(dirR);
+			dirR = zro ? 1.f : dirR;
+			dirX = zro ? 1.f : dirX;
+			dirX *= dirR;
+			dirY *= dirR;
+			len = len * 0.5f;
+			len *= len;
+			float stretch = (dirX * dirX + dirY * dirY) * PrxLoRcp((std::max)(std::abs(dirX), std::abs(dirY)));
+			EasuKernel kernel;
+			kernel.dirX = dirX;
+			kernel.dirY = dirY;
+			kernel.len2X = 1.f + (stretch - 1.f) * len;
+			kernel.len2Y = 1.f - 0.5f * len;
+			kernel.lob = 0.5f + ((1.f / 4.f - 0.04f) - 0.5f) * len;
+			kernel.clp = PrxLoRcp(kernel.lob);
+			return kernel;
+		}
+
+		// FsrEasuTapF's weight for a tap at the given offset from the resolve position
+		inline float EasuWeight(const EasuKernel &kernel, float offX, float offY) {
+			float vX = offX * kernel.dirX + offY * kernel.dirY;
+			float vY = offX * -kernel.dirY + offY * kernel.dirX;
+			vX *= kernel.len2X;
+			vY *= kernel.len2Y;
+			float d2 = vX * vX + vY * vY;
+			d2 = (std::min)(d2, kernel.clp);
+			float wB = (2.f / 5.f) * d2 - 1.f;
+			float wA = kernel.lob * d2 - 1.f;
+			wB *= wB;
+			wA *= wA;
+			wB = (25.f / 16.f) * wB - (25.f / 16.f - 1.f);
+			return wB * wA;
+		}
+
+		inline void EasuTap(float *aC, float &aW, const EasuKernel &kernel, float offX, float offY, const float *c) {
+			float w = EasuWeight(kernel, offX, offY);
+			aC[0] += c[0] * w;
+			aC[1] += c[1] * w;
+			aC[2] += c[2] * w;
+			aW += w;
+		}
+
+		// the 12 texels FsrEasuF reads around the given input position for one channel, in the order
+		// FitEasuKernel takes them
+		void EasuTexels(const Image &input, int channel, float ppX, float ppY, float texels[12]) {
+			int ix = (int)std::floor(ppX);
+			int iy = (int)std::floor(ppY);
+			const int offsets[12][2] = { { 0, -1 }, { 1, -1 }, { -1, 0 }, { 0, 0 }, { 1, 0 }, { 2, 0 }, { -1, 1 }, { 0, 1 }, { 1, 1 }, { 2, 1 }, { 0, 2 }, { 1, 2 } };
+			for (int t = 0; t < 12; ++t) {
+				texels[t] = ClampedTexel(input, ix + offsets[t][0], iy + offsets[t][1])[channel];
+			}
+		}
+
+		EasuKernel FitEasuKernel(float ppX, float ppY, const float l[12]) {
+			return FitEasuKernel(ppX, ppY, l[0], l[1], l[2], l[3], l[4], l[5], l[6], l[7], l[8], l[9], l[10], l[11]);
+		}
+
+		// the filter and deringing clamp of FsrEasuF for one channel of the texels EasuTexels read
+		float EasuChannel(const EasuKernel &kernel, float ppX, float ppY, const float t[12]) {
+			enum { B, C, E, F, G, H, I, J, K, L, N, O };
+			// in the order FsrEasuF sums the taps
+			const int order[12] = { B, C, I, J, F, E, K, L, H, G, O, N };
+			const float offsets[12][2] = { { 0, -1 }, { 1, -1 }, { -1, 0 }, { 0, 0 }, { 1, 0 }, { 2, 0 }, { -1, 1 }, { 0, 1 }, { 1, 1 }, { 2, 1 }, { 0, 2 }, { 1, 2 } };
+			float aC = 0;
+			float aW = 0;
+			for (int tap : order) {
+				float w = EasuWeight(kernel, offsets[tap][0] - ppX, offsets[tap][1] - ppY);
+				aC += t[tap] * w;
+				aW += w;
+			}
+			float min4 = (std::min)(Min3(t[F], t[G], t[J]), t[K]);
+			float max4 = (std::max)(Max3(t[F], t[G], t[J]), t[K]);
+			return (std::min)(max4, (std::max)(min4, aC * (1.f / aW)));
+		}
+
+		// FsrEasuF at the given input position, in pixels relative to the texel centres
+		void EasuSample(const Image &input, float ppX, float ppY, float *out) {
+			float fpX = std::floor(ppX);
+			float fpY = std::floor(ppY);
+			ppX -= fpX;
+			ppY -= fpY;
+
+			// the four gathers of the shader resolve to these 12 texels around 'f', see FitEasuKernel
+			int ix = (int)fpX;
+			int iy = (int)fpY;
+			const float *b = ClampedTexel(input, ix, iy - 1);
+			const float *c = ClampedTexel(input, ix + 1, iy - 1);
+			const float *e = ClampedTexel(input, ix - 1, iy);
+			const float *f = ClampedTexel(input, ix, iy);
+			const float *g = ClampedTexel(input, ix + 1, iy);
+			const float *h = ClampedTexel(input, ix + 2, iy);
+			const float *i = ClampedTexel(input, ix - 1, iy + 1);
+			const float *j = ClampedTexel(input, ix, iy + 1);
+			const float *k = ClampedTexel(input, ix + 1, iy + 1);
+			const float *l = ClampedTexel(input, ix + 2, iy + 1);
+			const float *n = ClampedTexel(input, ix, iy + 2);
+			const float *o = ClampedTexel(input, ix + 1, iy + 2);
+
+			EasuKernel kernel = FitEasuKernel(ppX, ppY, Luma2(b), Luma2(c), Luma2(e), Luma2(f), Luma2(g), Luma2(h),
+				Luma2(i), Luma2(j), Luma2(k), Luma2(l), Luma2(n), Luma2(o));
+
+			float aC[3] = { 0, 0, 0 };
+			float aW = 0;
+			EasuTap(aC, aW, kernel, 0.f - ppX, -1.f - ppY, b);
+			EasuTap(aC, aW, kernel, 1.f - ppX, -1.f - ppY, c);
+			EasuTap(aC, aW, kernel, -1.f - ppX, 1.f - ppY, i);
+			EasuTap(aC, aW, kernel, 0.f - ppX, 1.f - ppY, j);
+			EasuTap(aC, aW, kernel, 0.f - ppX, 0.f - ppY, f);
+			EasuTap(aC, aW, kernel, -1.f - ppX, 0.f - ppY, e);
+			EasuTap(aC, aW, kernel, 1.f - ppX, 1.f - ppY, k);
+			EasuTap(aC, aW, kernel, 2.f - ppX, 1.f - ppY, l);
+			EasuTap(aC, aW, kernel, 2.f - ppX, 0.f - ppY, h);
+			EasuTap(aC, aW, kernel, 1.f - ppX, 0.f - ppY, g);
+			EasuTap(aC, aW, kernel, 1.f - ppX, 2.f - ppY, o);
+			EasuTap(aC, aW, kernel, 0.f - ppX, 2.f - ppY, n);
+
+			float rcpW = 1.f / aW;
+			for (int ch = 0; ch < 3; ++ch) {
+				float min4 = (std::min)(Min3(f[ch], g[ch], j[ch]), k[ch]);
+				float max4 = (std::max)(Max3(f[ch], g[ch], j[ch]), k[ch]);
+				out[ch] = (std::min)(max4, (std::max)(min4, aC[ch] * rcpW));
+			}
+			out[3] = 1.f;
+		}
+
+		// the LUMA_GUIDED path of fsr_easu.hlsl: FsrEasuF on the luma alone, and the color of a bilinear
+		// sample moved to the filtered luma
+		void EasuLumaSample(const Image &input, const Image &luma, float ppX, float ppY, float *out) {
+			float u = (ppX + 0.5f) / input.width;
+			float v = (ppY + 0.5f) / input.height;
+			float l[12];
+			EasuTexels(luma, 0, ppX, ppY, l);
+			ppX -= std::floor(ppX);
+			ppY -= std::floor(ppY);
+			EasuKernel kernel = FitEasuKernel(ppX, ppY, l);
+			float filtered = EasuChannel(kernel, ppX, ppY, l);
+
+			float c[4];
+			SampleBilinear(input, u, v, c);
+			// FSR's luma weighs red and blue by half, so moving all channels by d moves it by 2d
+			float shift = (filtered - Luma2(c)) * 0.5f;
+			for (int ch = 0; ch < 3; ++ch) {
+				out[ch] = (std::max)(c[ch] + shift, 0.f);
+			}
+			out[3] = 1.f;
+		}
+
+		void EasuPixel(const Image &input, Image &output, const UpscaleConstants &constants, uint32_t x, uint32_t y) {
+			float ppX = x * AsFloat(constants.const0[0]) + AsFloat(constants.const0[2]);
+			float ppY = y * AsFloat(constants.const0[1]) + AsFloat(constants.const0[3]);
+			EasuSample(input, ppX, ppY, output.Pixel(x, y));
+		}
+
+		void EasuLumaPixel(const Image &input, const Image &luma, Image &output, const UpscaleConstants &constants, uint32_t x, uint32_t y) {
+			float ppX = x * AsFloat(constants.const0[0]) + AsFloat(constants.const0[2]);
+			float ppY = y * AsFloat(constants.const0[1]) + AsFloat(constants.const0[3]);
+			EasuLumaSample(input, luma, ppX, ppY, output.Pixel(x, y));
+		}
+
+		// the SUPERSAMPLE path of fsr_easu.hlsl: the area weighted average of the EASU results of all
+		// virtual pixels the output pixel covers
+		void EasuSupersampledPixel(const Image &input, Image &output, const UpscaleConstants &constants, uint32_t x, uint32_t y) {
+			// virtual pixels per output pixel, from what FsrEasuCon stored
+			float scaleX = 1.f / (AsFloat(constants.const0[0]) * AsFloat(constants.const1[0]) * constants.radius[2]);
+			float scaleY = 1.f / (AsFloat(constants.const0[1]) * AsFloat(constants.const1[1]) * constants.radius[3]);
+			float beginX = x * scaleX, endX = beginX + scaleX;
+			float beginY = y * scaleY, endY = beginY + scaleY;
+			float sum[3] = { 0, 0, 0 };
+			float weightSum = 0;
+			for (float vy = std::floor(beginY + 1.f / 64); vy < endY - 1.f / 64; ++vy) {
+				float weightY = (std::min)(vy + 1, endY) - (std::max)(vy, beginY);
+				for (float vx = std::floor(beginX + 1.f / 64); vx < endX - 1.f / 64; ++vx) {
+					float weight = weightY * ((std::min)(vx + 1, endX) - (std::max)(vx, beginX));
+					float sample[4];
+					EasuSample(input, vx * AsFloat(constants.const0[0]) + AsFloat(constants.const0[2]),
+						vy * AsFloat(constants.const0[1]) + AsFloat(constants.const0[3]), sample);
+					for (int ch = 0; ch < 3; ++ch) {
+						sum[ch] += sample[ch] * weight;
+					}
+					weightSum += weight;
+				}
+			}
+			float *out = output.Pixel(x, y);
+			for (int ch = 0; ch < 3; ++ch) {
+				out[ch] = sum[ch] / weightSum;
+			}
+			out[3] = 1.f;
+		}
+
+		// the input texture coordinates each channel of an output pixel is sampled from, as DistortedUv
+		// in fsr_easu.hlsl computes them; false for the channels that fall outside the eye's viewport
+		void DistortedUv(const Image &output, const DistortionMap &map, const DistortionConstants &distortion,
+				uint32_t x, uint32_t y, float uv[6], bool inside[3]) {
+			SampleDistortionMap(map, (x + .5f) / output.width, (y + .5f) / output.height, uv);
+			for (int ch = 0; ch < 3; ++ch) {
+				float u = uv[ch * 2];
+				float v = uv[ch * 2 + 1];
+				inside[ch] = u >= 0.f && u <= 1.f && v >= 0.f && v <= 1.f;
+				uv[ch * 2] = distortion.bounds[0] + (distortion.bounds[2] - distortion.bounds[0]) * u;
+				uv[ch * 2 + 1] = distortion.bounds[1] + (distortion.bounds[3] - distortion.bounds[1]) * v;
+			}
+		}
+
+		// the LENS_DISTORTION path of fsr_easu.hlsl: the kernel is fitted once, to the luma around
+		// green's position, and filters each channel from its own texels
+		void EasuDistortedPixel(const Image &input, Image &output, const DistortionMap &map, const DistortionConstants &distortion,
+				uint32_t x, uint32_t y) {
+			float uv[6];
+			bool inside[3];
+			DistortedUv(output, map, distortion, x, y, uv, inside);
+			float ppX = uv[2] * input.width - .5f;
+			float ppY = uv[3] * input.height - .5f;
+			float texels[3][12];
+			for (int ch = 0; ch < 3; ++ch) {
+				EasuTexels(input, ch, ppX, ppY, texels[ch]);
+			}
+			float l[12];
+			for (int t = 0; t < 12; ++t) {
+				l[t] = texels[2][t] * 0.5f + (texels[0][t] * 0.5f + texels[1][t]);
+			}
+			ppX -= std::floor(ppX);
+			ppY -= std::floor(ppY);
+			EasuKernel kernel = FitEasuKernel(ppX, ppY, l);
+
+			float *out = output.Pixel(x, y);
+			out[0] = out[1] = out[2] = 0.f;
+			if (inside[1]) {
+				out[1] = EasuChannel(kernel, ppX, ppY, texels[1]);
+			}
+			// red and blue at their own positions
+			for (int ch = 0; ch < 3; ch += 2) {
+				if (inside[ch]) {
+					float chX = uv[ch * 2] * input.width - .5f;
+					float chY = uv[ch * 2 + 1] * input.height - .5f;
+					float t[12];
+					EasuTexels(input, ch, chX, chY, t);
+					out[ch] = EasuChannel(kernel, chX - std::floor(chX), chY - std::floor(chY), t);
+				}
+			}
+			out[3] = 1.f;
+		}
+
+		void BilinearDistortedPixel(const Image &input, Image &output, const DistortionMap &map, const DistortionConstants &distortion,
+				uint32_t x, uint32_t y) {
+			float uv[6];
+			bool inside[3];
+			DistortedUv(output, map, distortion, x, y, uv, inside);
+			float *out = output.Pixel(x, y);
+			for (int ch = 0; ch < 3; ++ch) {
+				float sample[4];
+				if (inside[ch]) {
+					SampleBilinear(input, uv[ch * 2], uv[ch * 2 + 1], sample);
+				}
+				out[ch] = inside[ch] ? sample[ch] : 0.f;
+			}
+			out[3] = 1.f;
+		}
+
+		void RcasPixel(const Image &input, Image &output, const SharpenConstants &constants, uint32_t x, uint32_t y) {
+			const float *b = LoadedTexel(input, x, (int)y - 1);
+			const float *d = LoadedTexel(input, (int)x - 1, y);
+			const float *e = LoadedTexel(input, x, y);
+			const float *f = LoadedTexel(input, x + 1, y);
+			const float *h = LoadedTexel(input, x, y + 1);
+
+			float mn4[3], mx4[3], lobes[3];
+			for (int ch = 0; ch < 3; ++ch) {
+				mn4[ch] = (std::min)(Min3(b[ch], d[ch], f[ch]), h[ch]);
+				mx4[ch] = (std::max)(Max3(b[ch], d[ch], f[ch]), h[ch]);
+				float hitMin = mn4[ch] * (1.f / (4.f * mx4[ch]));
+				float hitMax = (1.f - mx4[ch]) * (1.f / (4.f * mn4[ch] - 4.f));
+				lobes[ch] = (std::max)(-hitMin, hitMax);
+			}
+			float lobe = (std::max)(float(-FSR_RCAS_LIMIT), (std::min)(Max3(lobes[0], lobes[1], lobes[2]), 0.f)) * AsFloat(constants.const0[0]);
+			float rcpL = PrxMedRcp(4.f * lobe + 1.f);
+
+			float *out = output.Pixel(x, y);
+			for (int ch = 0; ch < 3; ++ch) {
+				out[ch] = (lobe * b[ch] + lobe * d[ch] + lobe * h[ch] + lobe * f[ch] + e[ch]) * rcpL;
+			}
+			out[3] = 1.f;
+		}
+
+		bool IsTileFlat(const TileMask *flatTiles, uint32_t tileX, uint32_t tileY) {
+			return flatTiles != nullptr && flatTiles->IsFlat(tileX, tileY);
+		}
+
+		// the integer hash of fsr_grain.h
+		uint32_t GrainHash(uint32_t x) {
+			x ^= x >> 16;
+			x *= 0x7feb352du;
+			x ^= x >> 15;
+			x *= 0x846ca68bu;
+			x ^= x >> 16;
+			return x;
+		}
+	}
+
+	bool DecodeImage(const void *pixels, uint32_t width, uint32_t height, size_t rowPitch, uint32_t format, Image &image) {
+		using namespace framedump;
+		image.Resize(width, height);
+		for (uint32_t y = 0; y < height; ++y) {
+			const uint8_t *row = (const uint8_t*)pixels + y * rowPitch;
+			float *out = image.Pixel(0, y);
+			for (uint32_t x = 0; x < width; ++x, out += 4) {
+				switch (format) {
+				case FORMAT_R8G8B8A8_TYPELESS:
+				case FORMAT_R8G8B8A8_UNORM:
+				case FORMAT_R8G8B8A8_UNORM_SRGB:
+					for (int ch = 0; ch < 4; ++ch) {
+						out[ch] = row[x * 4 + ch] / 255.f;
+					}
+					break;
+				case FORMAT_B8G8R8A8_UNORM:
+				case FORMAT_B8G8R8A8_TYPELESS:
+				case FORMAT_B8G8R8A8_UNORM_SRGB:
+				case FORMAT_B8G8R8X8_UNORM:
+				case FORMAT_B8G8R8X8_TYPELESS:
+				case FORMAT_B8G8R8X8_UNORM_SRGB:
+					out[0] = row[x * 4 + 2] / 255.f;
+					out[1] = row[x * 4 + 1] / 255.f;
+					out[2] = row[x * 4 + 0] / 255.f;
+					out[3] = row[x * 4 + 3] / 255.f;
+					break;
+				case FORMAT_R10G10B10A2_TYPELESS:
+				case FORMAT_R10G10B10A2_UNORM:
+				case FORMAT_R10G10B10A2_UINT: {
+					uint32_t v;
+					memcpy(&v, row + x * 4, 4);
+					out[0] = (v & 0x3ff) / 1023.f;
+					out[1] = ((v >> 10) & 0x3ff) / 1023.f;
+					out[2] = ((v >> 20) & 0x3ff) / 1023.f;
+					out[3] = (v >> 30) / 3.f;
+					break;
+				}
+				case FORMAT_R11G11B10_FLOAT: {
+					uint32_t v;
+					memcpy(&v, row + x * 4, 4);
+					out[0] = SmallFloatToFloat(v & 0x7ff, 6);
+					out[1] = SmallFloatToFloat((v >> 11) & 0x7ff, 6);
+					out[2] = SmallFloatToFloat(v >> 22, 5);
+					out[3] = 1.f;
+					break;
+				}
+				case FORMAT_B5G6R5_UNORM: {
+					uint16_t v;
+					memcpy(&v, row + x * 2, 2);
+					out[0] = (v >> 11) / 31.f;
+					out[1] = ((v >> 5) & 0x3f) / 63.f;
+					out[2] = (v & 0x1f) / 31.f;
+					out[3] = 1.f;
+					break;
+				}
+				case FORMAT_R16G16B16A16_TYPELESS:
+				case FORMAT_R16G16B16A16_FLOAT:
+					for (int ch = 0; ch < 4; ++ch) {
+						uint16_t v;
+						memcpy(&v, row + x * 8 + ch * 2, 2);
+						out[ch] = HalfToFloat(v);
+					}
+					break;
+				case FORMAT_R16G16B16A16_UNORM:
+					for (int ch = 0; ch < 4; ++ch) {
+						uint16_t v;
+						memcpy(&v, row + x * 8 + ch * 2, 2);
+						out[ch] = v / 65535.f;
+					}
+					break;
+				case FORMAT_R32G32B32A32_TYPELESS:
+				case FORMAT_R32G32B32A32_FLOAT:
+					memcpy(out, row + x * 16, 16);
+					break;
+				default:
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	float DitherThreshold(uint32_t x, uint32_t y) {
+		// FsrTepdDitF without the frame offset
+		float value = float(x) * 1.61803398875f + float(y) * (1.f / 3.69f);
+		return value - std::floor(value);
+	}
+
+	void QuantizeImage(Image &image, uint32_t format, bool dither) {
+		float levels[4];
+		switch (format) {
+		case framedump::FORMAT_R8G8B8A8_UNORM:
+			levels[0] = levels[1] = levels[2] = levels[3] = 255.f;
+			break;
+		case framedump::FORMAT_R10G10B10A2_UNORM:
+			levels[0] = levels[1] = levels[2] = levels[3] = 1023.f;
+			break;
+		case framedump::FORMAT_B5G6R5_UNORM:
+			levels[0] = levels[2] = 31.f;
+			levels[1] = 63.f;
+			levels[3] = 0.f;
+			break;
+		case framedump::FORMAT_R11G11B10_FLOAT:
+			for (size_t i = 0; i < image.pixels.size(); i += 4) {
+				image.pixels[i] = RoundToSmallFloat(image.pixels[i], 6);
+				image.pixels[i + 1] = RoundToSmallFloat(image.pixels[i + 1], 6);
+				image.pixels[i + 2] = RoundToSmallFloat(image.pixels[i + 2], 5);
+				image.pixels[i + 3] = 1.f;
+			}
+			return;
+		default:
+			return;
+		}
+		for (uint32_t y = 0; y < image.height; ++y) {
+			float *pixel = image.Pixel(0, y);
+			for (uint32_t x = 0; x < image.width; ++x, pixel += 4) {
+				// the shaders dither color only, alpha is rounded as usual
+				float threshold = dither ? DitherThreshold(x, y) : 0.5f;
+				for (int ch = 0; ch < 3; ++ch) {
+					pixel[ch] = std::floor(Sat(pixel[ch]) * levels[ch] + threshold) / levels[ch];
+				}
+				pixel[3] = levels[3] > 0.f ? std::floor(Sat(pixel[3]) * levels[3] + 0.5f) / levels[3] : 1.f;
+			}
+		}
+	}
+
+	void SetupEasuConstants(UpscaleConstants &constants, uint32_t inputWidth, uint32_t inputHeight, uint32_t outputWidth, uint32_t outputHeight) {
+		FsrEasuCon(constants.const0, constants.const1, constants.const2, constants.const3, inputWidth, inputHeight, inputWidth, inputHeight, outputWidth, outputHeight);
+	}
+
+	void SetupRcasConstants(SharpenConstants &constants, float sharpness, bool debugMode) {
+		sharpness = AClampF1(sharpness, 0, 1);
+		FsrRcasCon(constants.const0, 2.f - 2 * sharpness);
+		constants.const0[3] = debugMode;
+	}
+
+	void SetupFoveationRadius(uint32_t radiusConstants[4], float radius, uint32_t outputWidth, uint32_t outputHeight) {
+		radiusConstants[0] = 0.5f * radius * outputHeight;
+		radiusConstants[1] = radiusConstants[0] * radiusConstants[0];
+		radiusConstants[2] = outputWidth;
+		radiusConstants[3] = outputHeight;
+	}
+
+	void SetupClassifyConstants(ClassifyConstants &constants, uint32_t inputWidth, uint32_t inputHeight, uint32_t outputWidth, uint32_t outputHeight,
+			float threshold) {
+		memset(&constants, 0, sizeof(constants));
+		constants.inputSize[0] = inputWidth;
+		constants.inputSize[1] = inputHeight;
+		constants.scale[0] = inputWidth / float(outputWidth);
+		constants.scale[1] = inputHeight / float(outputHeight);
+		constants.threshold = threshold;
+	}
+
+	bool IsTileInsideRadius(const uint32_t imageCentre[4], const uint32_t radius[4], uint32_t tileX, uint32_t tileY) {
+		// unsigned arithmetic on purpose, this is what the shaders compute
+		uint32_t groupCentreX = tileX * TILE_SIZE + TILE_SIZE / 2;
+		uint32_t groupCentreY = tileY * TILE_SIZE + TILE_SIZE / 2;
+		uint32_t dx1 = imageCentre[0] - groupCentreX;
+		uint32_t dy1 = imageCentre[1] - groupCentreY;
+		uint32_t dx2 = imageCentre[2] - groupCentreX;
+		uint32_t dy2 = imageCentre[3] - groupCentreY;
+		return dx1 * dx1 + dy1 * dy1 <= radius[1] || dx2 * dx2 + dy2 * dy2 <= radius[1];
+	}
+
+	void ClassifyTiles(const Image &input, const ClassifyConstants &constants, uint32_t outputWidth, uint32_t outputHeight, TileMask &mask) {
+		mask.width = (outputWidth + TILE_SIZE - 1) / TILE_SIZE;
+		mask.height = (outputHeight + TILE_SIZE - 1) / TILE_SIZE;
+		mask.flat.assign((size_t)mask.width * mask.height, 0);
+		for (uint32_t tileY = 0; tileY < mask.height; ++tileY) {
+			for (uint32_t tileX = 0; tileX < mask.width; ++tileX) {
+				// the input texels EASU reads for the tile's pixels, and those of the neighbours RCAS reads
+				int beginX = (std::max)((int)std::floor(float(tileX * TILE_SIZE) * constants.scale[0]) - 3, 0);
+				int beginY = (std::max)((int)std::floor(float(tileY * TILE_SIZE) * constants.scale[1]) - 3, 0);
+				int endX = (std::min)((int)std::ceil(float((tileX + 1) * TILE_SIZE) * constants.scale[0]) + 3, (int)constants.inputSize[0]);
+				int endY = (std::min)((int)std::ceil(float((tileY + 1) * TILE_SIZE) * constants.scale[1]) + 3, (int)constants.inputSize[1]);
+				float lo = 3.402823466e38f;
+				float hi = 0;
+				for (int y = beginY; y < endY; ++y) {
+					for (int x = beginX; x < endX; ++x) {
+						const float *p = input.Pixel(x, y);
+						float luma = (std::max)(p[0] * 0.2126f + p[1] * 0.7152f + p[2] * 0.0722f, 0.f);
+						lo = (std::min)(lo, luma);
+						hi = (std::max)(hi, luma);
+					}
+				}
+				mask.flat[(size_t)tileY * mask.width + tileX] = hi - lo < constants.threshold ? 1 : 0;
+			}
+		}
+	}
+
+	void Easu(const Image &input, Image &output, const UpscaleConstants &constants, uint32_t rowBegin, uint32_t rowEnd,
+			const TileMask *flatTiles) {
+		rowEnd = (std::min)(rowEnd, output.height);
+		for (uint32_t y = rowBegin; y < rowEnd; ++y) {
+			for (uint32_t tileX = 0; tileX * TILE_SIZE < output.width; ++tileX) {
+				uint32_t xEnd = (std::min)((tileX + 1) * TILE_SIZE, output.width);
+				if (IsTileInsideRadius(constants.imageCentre, constants.radius, tileX, y / TILE_SIZE) && !IsTileFlat(flatTiles, tileX, y / TILE_SIZE)) {
+					for (uint32_t x = tileX * TILE_SIZE; x < xEnd; ++x) {
+						EasuPixel(input, output, constants, x, y);
+					}
+				} else {
+					for (uint32_t x = tileX * TILE_SIZE; x < xEnd; ++x) {
+						BilinearPixel(input, output, x, y);
+					}
+				}
+			}
+		}
+	}
+
+	void Luma(const Image &input, Image &luma, uint32_t rowBegin, uint32_t rowEnd) {
+		rowEnd = (std::min)(rowEnd, luma.height);
+		for (uint32_t y = rowBegin; y < rowEnd; ++y) {
+			for (uint32_t x = 0; x < luma.width; ++x) {
+				float value = Luma2(input.Pixel(x, y));
+				float *out = luma.Pixel(x, y);
+				// the R16_FLOAT texture the shader writes
+				out[0] = value < 0.f ? -RoundToSmallFloat(-value, 10) : RoundToSmallFloat(value, 10);
+				out[1] = out[2] = 0.f;
+				out[3] = 1.f;
+			}
+		}
+	}
+
+	void EasuLuma(const Image &input, const Image &luma, Image &output, const UpscaleConstants &constants, uint32_t rowBegin, uint32_t rowEnd,
+			const TileMask *flatTiles) {
+		rowEnd = (std::min)(rowEnd, output.height);
+		for (uint32_t y = rowBegin; y < rowEnd; ++y) {
+			for (uint32_t tileX = 0; tileX * TILE_SIZE < output.width; ++tileX) {
+				uint32_t xEnd = (std::min)((tileX + 1) * TILE_SIZE, output.width);
+				if (IsTileInsideRadius(constants.imageCentre, constants.radius, tileX, y / TILE_SIZE) && !IsTileFlat(flatTiles, tileX, y / TILE_SIZE)) {
+					for (uint32_t x = tileX * TILE_SIZE; x < xEnd; ++x) {
+						EasuLumaPixel(input, luma, output, constants, x, y);
+					}
+				} else {
+					for (uint32_t x = tileX * TILE_SIZE; x < xEnd; ++x) {
+						BilinearPixel(input, output, x, y);
+					}
+				}
+			}
+		}
+	}
+
+	void EasuDistorted(const Image &input, Image &output, const UpscaleConstants &constants, const DistortionMap &map,
+			const DistortionConstants &distortion, uint32_t rowBegin, uint32_t rowEnd) {
+		rowEnd = (std::min)(rowEnd, output.height);
+		for (uint32_t y = rowBegin; y < rowEnd; ++y) {
+			for (uint32_t tileX = 0; tileX * TILE_SIZE < output.width; ++tileX) {
+				uint32_t xEnd = (std::min)((tileX + 1) * TILE_SIZE, output.width);
+				bool inside = IsTileInsideRadius(constants.imageCentre, constants.radius, tileX, y / TILE_SIZE);
+				for (uint32_t x = tileX * TILE_SIZE; x < xEnd; ++x) {
+					if (inside) {
+						EasuDistortedPixel(input, output, map, distortion, x, y);
+					} else {
+						BilinearDistortedPixel(input, output, map, distortion, x, y);
+					}
+				}
+			}
+		}
+	}
+
+	void EasuSupersampled(const Image &input, Image &output, const UpscaleConstants &constants, uint32_t rowBegin, uint32_t rowEnd,
+			const TileMask *flatTiles) {
+		rowEnd = (std::min)(rowEnd, output.height);
+		for (uint32_t y = rowBegin; y < rowEnd; ++y) {
+			for (uint32_t tileX = 0; tileX * TILE_SIZE < output.width; ++tileX) {
+				uint32_t xEnd = (std::min)((tileX + 1) * TILE_SIZE, output.width);
+				if (IsTileInsideRadius(constants.imageCentre, constants.radius, tileX, y / TILE_SIZE) && !IsTileFlat(flatTiles, tileX, y / TILE_SIZE)) {
+					for (uint32_t x = tileX * TILE_SIZE; x < xEnd; ++x) {
+						EasuSupersampledPixel(input, output, constants, x, y);
+					}
+				} else {
+					for (uint32_t x = tileX * TILE_SIZE; x < xEnd; ++x) {
+						SampleBilinear(input, (x + .5f) / output.width, (y + .5f) / output.height, output.Pixel(x, y));
+					}
+				}
+			}
+		}
+	}
+
+	void Distort(const Image &input, Image &output, const DistortionMap &map, const DistortionConstants &distortion, uint32_t rowBegin, uint32_t rowEnd) {
+		rowEnd = (std::min)(rowEnd, output.height);
+		for (uint32_t y = rowBegin; y < rowEnd; ++y) {
+			for (uint32_t x = 0; x < output.width; ++x) {
+				BilinearDistortedPixel(input, output, map, distortion, x, y);
+			}
+		}
+	}
+
+	void Bilinear(const Image &input, Image &output, uint32_t rowBegin, uint32_t rowEnd) {
+		rowEnd = (std::min)(rowEnd, output.height);
+		for (uint32_t y = rowBegin; y < rowEnd; ++y) {
+			for (uint32_t x = 0; x < output.width; ++x) {
+				BilinearPixel(input, output, x, y);
+			}
+		}
+	}
+
+	void Grain(const Image &input, Image &output, float amount, uint32_t seed, uint32_t rowBegin, uint32_t rowEnd) {
+		rowEnd = (std::min)(rowEnd, output.height);
+		uint32_t seedHash = GrainHash(seed);
+		for (uint32_t y = rowBegin; y < rowEnd; ++y) {
+			uint32_t rowHash = GrainHash(y ^ seedHash);
+			for (uint32_t x = 0; x < output.width; ++x) {
+				float noise = float(GrainHash(x ^ rowHash) & 0xffff) / 65535.f - 0.5f;
+				const float *in = input.Pixel(x, y);
+				float *out = output.Pixel(x, y);
+				// FsrLfgaF
+				for (int ch = 0; ch < 3; ++ch) {
+					out[ch] = in[ch] + noise * amount * (std::min)(1.f - in[ch], in[ch]);
+				}
+				out[3] = in[3];
+			}
+		}
+	}
+
+	void Rcas(const Image &input, Image &output, const SharpenConstants &constants, uint32_t rowBegin, uint32_t rowEnd,
+			const TileMask *flatTiles) {
+		rowEnd = (std::min)(rowEnd, output.height);
+		float tint = constants.const0[3] ? 0.7f : 1.f;
+		for (uint32_t y = rowBegin; y < rowEnd; ++y) {
+			for (uint32_t tileX = 0; tileX * TILE_SIZE < output.width; ++tileX) {
+				uint32_t xEnd = (std::min)((tileX + 1) * TILE_SIZE, output.width);
+				if (IsTileInsideRadius(constants.imageCentre, constants.radius, tileX, y / TILE_SIZE) && !IsTileFlat(flatTiles, tileX, y / TILE_SIZE)) {
+					for (uint32_t x = tileX * TILE_SIZE; x < xEnd; ++x) {
+						RcasPixel(input, output, constants, x, y);
+					}
+				} else {
+					for (uint32_t x = tileX * TILE_SIZE; x < xEnd; ++x) {
+						const float *in = input.Pixel(x, y);
+						float *out = output.Pixel(x, y);
+						out[0] = in[0];
+						out[1] = in[1] * tint;
+						out[2] = in[2] * tint;
+						out[3] = in[3];
+					}
+				}
+			}
+		}
+	}
+}
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "LensDistortion.h"
+#include "ShaderConstants.h"
+
+// Scalar CPU ports of the post-processing compute shaders, used to replay frame dumps and as a
+// reference when changing the kernels. They follow the shaders operation for operation, including
+// the approximate reciprocals and the per-workgroup foveation test, so results should match the GPU
+// up to floating point and texture filtering precision. NIS and CAS have no CPU port yet.
+namespace vr {
+namespace cpu {
+	// RGBA image with one float per channel, holding what a shader sees when it samples the texture
+	struct Image {
+		uint32_t width = 0;
+		uint32_t height = 0;
+		std::vector<float> pixels;
+
+		void Resize(uint32_t w, uint32_t h) {
+			width = w;
+			height = h;
+			pixels.resize((size_t)w * h * 4);
+		}
+		float * Pixel(uint32_t x, uint32_t y) { return &pixels[((size_t)y * width + x) * 4]; }
+		const float * Pixel(uint32_t x, uint32_t y) const { return &pixels[((size_t)y * width + x) * 4]; }
+	};
+
+	// size of the square pixel tiles the foveation test is done for, i.e. the shaders' workgroup footprint
+	const uint32_t TILE_SIZE = 16;
+
+	// the mask fsr_classify.hlsl writes: whether each output tile is flat enough to skip EASU and RCAS
+	struct TileMask {
+		uint32_t width = 0;
+		uint32_t height = 0;
+		std::vector<uint8_t> flat;
+
+		bool IsFlat(uint32_t tileX, uint32_t tileY) const { return flat[(size_t)tileY * width + tileX] != 0; }
+	};
+
+	// converts pixels of a DXGI format (see framedump::Format) the way the post processor's shader
+	// resource views read them; returns false for unsupported formats
+	bool DecodeImage(const void *pixels, uint32_t width, uint32_t height, size_t rowPitch, uint32_t format, Image &image);
+	// rounds the image to the precision of the given output format, as writing to the UAV would; with
+	// dither, rounds like fsr/fsr_dither.h does for UNORM formats
+	void QuantizeImage(Image &image, uint32_t format, bool dither = false);
+	// the ordered dither threshold of fsr/fsr_dither.h for a pixel, in [0, 1)
+	float DitherThreshold(uint32_t x, uint32_t y);
+
+	// fills in the FSR constants like the post processor does, leaving the foveation fields untouched
+	void SetupEasuConstants(UpscaleConstants &constants, uint32_t inputWidth, uint32_t inputHeight, uint32_t outputWidth, uint32_t outputHeight);
+	void SetupRcasConstants(SharpenConstants &constants, float sharpness, bool debugMode);
+	// sets the radius fields of either constants struct; radius is relative to the output height
+	void SetupFoveationRadius(uint32_t radiusConstants[4], float radius, uint32_t outputWidth, uint32_t outputHeight);
+	void SetupClassifyConstants(ClassifyConstants &constants, uint32_t inputWidth, uint32_t inputHeight, uint32_t outputWidth, uint32_t outputHeight,
+			float threshold);
+
+	// true if the tile at the given tile coordinates falls within the foveation radius
+	bool IsTileInsideRadius(const uint32_t imageCentre[4], const uint32_t radius[4], uint32_t tileX, uint32_t tileY);
+
+	// fsr_classify.hlsl: marks the tiles of an output of the given size as flat where the luma range of
+	// the input texels EASU and RCAS read for them is below the threshold
+	void ClassifyTiles(const Image &input, const ClassifyConstants &constants, uint32_t outputWidth, uint32_t outputHeight, TileMask &mask);
+
+	// The kernels process the output rows [rowBegin, rowEnd), so callers can split an image across
+	// threads. Output images must already have their final size; split on TILE_SIZE boundaries to keep
+	// the work per tile together. Those taking a TileMask treat its flat tiles like tiles outside the
+	// radius, as the TILE_CLASSIFICATION builds of the shaders do; without one, no tile is flat.
+
+	// fsr_easu.hlsl: EASU inside the radius, bilinear outside
+	void Easu(const Image &input, Image &output, const UpscaleConstants &constants, uint32_t rowBegin, uint32_t rowEnd,
+			const TileMask *flatTiles = nullptr);
+	// fsr_luma.hlsl: FSR's luma of each texel in the first channel, at the precision of the 16 bit float
+	// texture the shader writes; luma must have the input's size
+	void Luma(const Image &input, Image &luma, uint32_t rowBegin, uint32_t rowEnd);
+	// the LUMA_GUIDED variant of fsr_easu.hlsl: inside the radius, EASU filters the luma Luma computed
+	// for the input alone and the color of a bilinear sample is moved to the result; outside, bilinear as Easu
+	void EasuLuma(const Image &input, const Image &luma, Image &output, const UpscaleConstants &constants, uint32_t rowBegin, uint32_t rowEnd,
+			const TileMask *flatTiles = nullptr);
+	// the SUPERSAMPLE variant of fsr_easu.hlsl: inside the radius, EASU at the resolution the constants
+	// were set up for, box filtered down to the output; outside, bilinear at the output pixel centres
+	void EasuSupersampled(const Image &input, Image &output, const UpscaleConstants &constants, uint32_t rowBegin, uint32_t rowEnd,
+			const TileMask *flatTiles = nullptr);
+	// the LENS_DISTORTION variant of fsr_easu.hlsl: as Easu, but writing the lens distorted image by
+	// sampling each channel at the position the distortion map gives for it, with the kernel EASU fits
+	// at green's position
+	void EasuDistorted(const Image &input, Image &output, const UpscaleConstants &constants, const DistortionMap &map,
+			const DistortionConstants &distortion, uint32_t rowBegin, uint32_t rowEnd);
+	// what the compositor does to a submitted image: a bilinear sample of each channel at the position
+	// the distortion map gives for it. Distort of Easu is the reference EasuDistorted is checked against.
+	void Distort(const Image &input, Image &output, const DistortionMap &map, const DistortionConstants &distortion, uint32_t rowBegin, uint32_t rowEnd);
+	// the bilinear fallback of fsr_easu.hlsl applied to every pixel
+	void Bilinear(const Image &input, Image &output, uint32_t rowBegin, uint32_t rowEnd);
+	// fsr_rcas.hlsl: RCAS inside the radius, copy (tinted in debug mode) outside
+	void Rcas(const Image &input, Image &output, const SharpenConstants &constants, uint32_t rowBegin, uint32_t rowEnd,
+			const TileMask *flatTiles = nullptr);
+	// fsr/fsr_grain.h: film grain through FsrLfgaF; input and output may be the same image
+	void Grain(const Image &input, Image &output, float amount, uint32_t seed, uint32_t rowBegin, uint32_t rowEnd);
+}
+}
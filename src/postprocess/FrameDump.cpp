@@ -0,0 +1,239 @@
+#include "FrameDump.h"
+
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace vr {
+namespace framedump {
+	uint32_t BytesPerPixel(uint32_t format) {
+		switch (format) {
+		case FORMAT_R32G32B32A32_TYPELESS:
+		case FORMAT_R32G32B32A32_FLOAT:
+			return 16;
+		case FORMAT_R16G16B16A16_TYPELESS:
+		case FORMAT_R16G16B16A16_FLOAT:
+		case FORMAT_R16G16B16A16_UNORM:
+			return 8;
+		case FORMAT_R10G10B10A2_TYPELESS:
+		case FORMAT_R10G10B10A2_UNORM:
+		case FORMAT_R10G10B10A2_UINT:
+		case FORMAT_R11G11B10_FLOAT:
+		case FORMAT_R8G8B8A8_TYPELESS:
+		case FORMAT_R8G8B8A8_UNORM:
+		case FORMAT_R8G8B8A8_UNORM_SRGB:
+		case FORMAT_B8G8R8A8_UNORM:
+		case FORMAT_B8G8R8X8_UNORM:
+		case FORMAT_B8G8R8A8_TYPELESS:
+		case FORMAT_B8G8R8A8_UNORM_SRGB:
+		case FORMAT_B8G8R8X8_TYPELESS:
+		case FORMAT_B8G8R8X8_UNORM_SRGB:
+			return 4;
+		case FORMAT_B5G6R5_UNORM:
+			return 2;
+		default:
+			return 0;
+		}
+	}
+
+	FrameDumpWriter::FrameDumpWriter(FILE *file) : file(file) {
+		// frames are several MB each, a large buffer keeps the number of write calls down
+		setvbuf(file, nullptr, _IOFBF, 4 * 1024 * 1024);
+		FileHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, FILE_MAGIC, sizeof(header.magic));
+		header.version = FILE_VERSION;
+		header.headerSize = sizeof(FileHeader);
+		Write(&header, sizeof(header));
+	}
+
+	FrameDumpWriter::~FrameDumpWriter() {
+		if (file != nullptr) {
+			fclose(file);
+		}
+	}
+
+	uint32_t FrameDumpWriter::WriteConstants(const Constants &constants) {
+		ChunkHeader chunk;
+		memset(&chunk, 0, sizeof(chunk));
+		chunk.id = CHUNK_CONSTANTS;
+		chunk.size = sizeof(Constants);
+		Write(&chunk, sizeof(chunk));
+		Write(&constants, sizeof(constants));
+		PadToAlignment();
+		return constantsCount++;
+	}
+
+	void FrameDumpWriter::WriteFrame(const FrameHeader &header, const void *pixels, size_t sourceRowPitch) {
+		FrameHeader frame = header;
+		frame.rowPitch = frame.width * BytesPerPixel(frame.format);
+		ChunkHeader chunk;
+		memset(&chunk, 0, sizeof(chunk));
+		chunk.id = CHUNK_FRAME;
+		chunk.size = sizeof(FrameHeader) + (uint64_t)frame.rowPitch * frame.height;
+		Write(&chunk, sizeof(chunk));
+		Write(&frame, sizeof(frame));
+		const uint8_t *row = (const uint8_t*)pixels;
+		for (uint32_t y = 0; y < frame.height; ++y) {
+			Write(row, frame.rowPitch);
+			row += sourceRowPitch;
+		}
+		PadToAlignment();
+		++framesWritten;
+	}
+
+	void FrameDumpWriter::Write(const void *data, size_t size) {
+		if (failed) {
+			return;
+		}
+		if (fwrite(data, 1, size, file) != size) {
+			failed = true;
+		}
+		offset += size;
+	}
+
+	void FrameDumpWriter::PadToAlignment() {
+		static const uint8_t zeros[CHUNK_ALIGNMENT] = {};
+		size_t padding = (CHUNK_ALIGNMENT - offset % CHUNK_ALIGNMENT) % CHUNK_ALIGNMENT;
+		Write(zeros, padding);
+	}
+
+	FrameDumpReader::~FrameDumpReader() {
+		Close();
+	}
+
+	bool FrameDumpReader::Open(const std::string &path) {
+		Close();
+		if (!Map(path)) {
+			return false;
+		}
+		if (size < sizeof(FileHeader)) {
+			return Fail("file is too small");
+		}
+		FileHeader header;
+		memcpy(&header, data, sizeof(header));
+		if (memcmp(header.magic, FILE_MAGIC, sizeof(header.magic)) != 0) {
+			return Fail("not a frame dump");
+		}
+		if (header.version != FILE_VERSION) {
+			return Fail("unsupported version " + std::to_string(header.version));
+		}
+		if (header.headerSize < sizeof(FileHeader) || header.headerSize > size) {
+			return Fail("corrupt file header");
+		}
+
+		uint64_t offset = header.headerSize;
+		while (offset + sizeof(ChunkHeader) <= size) {
+			ChunkHeader chunk;
+			memcpy(&chunk, data + offset, sizeof(chunk));
+			uint64_t payload = offset + sizeof(ChunkHeader);
+			if (chunk.size > size - payload) {
+				// a recording that was cut short, keep what we have
+				break;
+			}
+			if (chunk.id == CHUNK_CONSTANTS && chunk.size >= sizeof(Constants)) {
+				Constants c;
+				memcpy(&c, data + payload, sizeof(c));
+				constants.push_back(c);
+			} else if (chunk.id == CHUNK_FRAME && chunk.size >= sizeof(FrameHeader)) {
+				Frame frame;
+				memcpy(&frame.header, data + payload, sizeof(frame.header));
+				frame.pixels = data + payload + sizeof(FrameHeader);
+				uint64_t pixelBytes = (uint64_t)frame.header.rowPitch * frame.header.height;
+				if (frame.header.rowPitch < frame.header.width * BytesPerPixel(frame.header.format) || pixelBytes > chunk.size - sizeof(FrameHeader)) {
+					return Fail("corrupt frame chunk at offset " + std::to_string(offset));
+				}
+				if (frame.header.constantsIndex >= constants.size()) {
+					return Fail("frame at offset " + std::to_string(offset) + " references missing constants");
+				}
+				frames.push_back(frame);
+			}
+			offset = payload + chunk.size;
+			offset = (offset + CHUNK_ALIGNMENT - 1) / CHUNK_ALIGNMENT * CHUNK_ALIGNMENT;
+		}
+		return true;
+	}
+
+	void FrameDumpReader::Close() {
+		constants.clear();
+		frames.clear();
+#ifdef _WIN32
+		if (data != nullptr) {
+			UnmapViewOfFile(data);
+		}
+		if (mappingHandle != nullptr) {
+			CloseHandle(mappingHandle);
+			mappingHandle = nullptr;
+		}
+		if (fileHandle != nullptr) {
+			CloseHandle(fileHandle);
+			fileHandle = nullptr;
+		}
+#else
+		if (data != nullptr) {
+			munmap(const_cast<uint8_t*>(data), size);
+		}
+#endif
+		data = nullptr;
+		size = 0;
+	}
+
+	bool FrameDumpReader::Map(const std::string &path) {
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE) {
+			return Fail("could not open " + path);
+		}
+		fileHandle = file;
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+			return Fail("could not determine size of " + path);
+		}
+		mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mappingHandle == nullptr) {
+			return Fail("could not map " + path);
+		}
+		data = (const uint8_t*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+		if (data == nullptr) {
+			return Fail("could not map " + path);
+		}
+		size = fileSize.QuadPart;
+#else
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			return Fail("could not open " + path);
+		}
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size == 0) {
+			close(fd);
+			return Fail("could not determine size of " + path);
+		}
+		void *mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (mapping == MAP_FAILED) {
+			return Fail("could not map " + path);
+		}
+		madvise(mapping, st.st_size, MADV_SEQUENTIAL);
+		data = (const uint8_t*)mapping;
+		size = st.st_size;
+#endif
+		return true;
+	}
+
+	bool FrameDumpReader::Fail(const std::string &message) {
+		error = message;
+		Close();
+		return false;
+	}
+}
+}
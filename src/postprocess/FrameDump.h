@@ -0,0 +1,192 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "ShaderConstants.h"
+
+// Container format for recorded input frames. A dump is a file header followed by a sequence of
+// chunks. Every chunk starts with a ChunkHeader at a CHUNK_ALIGNMENT boundary and is padded to the
+// next boundary, so the file can be memory-mapped and frame pixels used in place. Readers must skip
+// chunks with unknown ids.
+//
+// CNST chunks hold a Constants record describing how the frames following it were processed; FRAM
+// chunks hold a FrameHeader followed by tightly packed pixel rows in the recorded texture format.
+//
+// This file deliberately has no Windows or D3D dependencies so that dumps can be read and replayed
+// on any platform.
+namespace vr {
+namespace framedump {
+	const char FILE_MAGIC[8] = { 'O', 'V', 'R', 'F', 'D', 'U', 'M', 'P' };
+	const uint32_t FILE_VERSION = 1;
+	const uint32_t CHUNK_ALIGNMENT = 64;
+
+	inline constexpr uint32_t MakeChunkId(char a, char b, char c, char d) {
+		return uint32_t(uint8_t(a)) | uint32_t(uint8_t(b)) << 8 | uint32_t(uint8_t(c)) << 16 | uint32_t(uint8_t(d)) << 24;
+	}
+	const uint32_t CHUNK_CONSTANTS = MakeChunkId('C', 'N', 'S', 'T');
+	const uint32_t CHUNK_FRAME = MakeChunkId('F', 'R', 'A', 'M');
+
+	// values of the DXGI_FORMATs a dump may contain, so that dumps can be interpreted without the Windows SDK
+	enum Format : uint32_t {
+		FORMAT_R32G32B32A32_TYPELESS = 1,
+		FORMAT_R32G32B32A32_FLOAT = 2,
+		FORMAT_R16G16B16A16_TYPELESS = 9,
+		FORMAT_R16G16B16A16_FLOAT = 10,
+		FORMAT_R16G16B16A16_UNORM = 11,
+		FORMAT_R10G10B10A2_TYPELESS = 23,
+		FORMAT_R10G10B10A2_UNORM = 24,
+		FORMAT_R10G10B10A2_UINT = 25,
+		FORMAT_R11G11B10_FLOAT = 26,
+		FORMAT_R8G8B8A8_TYPELESS = 27,
+		FORMAT_R8G8B8A8_UNORM = 28,
+		FORMAT_R8G8B8A8_UNORM_SRGB = 29,
+		FORMAT_B5G6R5_UNORM = 85,
+		FORMAT_B8G8R8A8_UNORM = 87,
+		FORMAT_B8G8R8X8_UNORM = 88,
+		FORMAT_B8G8R8A8_TYPELESS = 90,
+		FORMAT_B8G8R8A8_UNORM_SRGB = 91,
+		FORMAT_B8G8R8X8_TYPELESS = 92,
+		FORMAT_B8G8R8X8_UNORM_SRGB = 93,
+	};
+
+	// returns 0 for formats that can't be recorded
+	uint32_t BytesPerPixel(uint32_t format);
+
+	enum ConstantsFlags : uint32_t {
+		// each eye was submitted as its own texture (or array slice) rather than side by side
+		FLAG_ONE_EYE_PER_TEXTURE = 1 << 0,
+		FLAG_INPUT_SRGB = 1 << 1,
+		FLAG_UPSCALE = 1 << 2,
+		FLAG_SHARPEN = 1 << 3,
+		FLAG_USE_NIS = 1 << 4,
+		FLAG_DEBUG_MODE = 1 << 5,
+		// EASU ran at inputWidth * renderScale and was filtered down to the output, which has the input's size
+		FLAG_SUPERSAMPLE = 1 << 6,
+		// EASU filtered the luma only and took the chroma from a bilinear sample
+		FLAG_LUMA_UPSCALE = 1 << 7,
+	};
+
+	const uint32_t NIS_CONFIG_SIZE = 256;
+
+	struct FileHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t headerSize;
+		uint8_t reserved[48];
+	};
+
+	struct ChunkHeader {
+		uint32_t id;
+		uint32_t reserved;
+		// size of the payload following this header, excluding padding
+		uint64_t size;
+	};
+
+	struct Constants {
+		uint32_t inputWidth;
+		uint32_t inputHeight;
+		uint32_t outputWidth;
+		uint32_t outputHeight;
+		uint32_t inputFormat;
+		uint32_t outputFormat;
+		uint32_t flags;
+		float renderScale;
+		float sharpness;
+		float radius;
+		// normalized projection centre per eye
+		float projectionCentre[2][2];
+		// texture bounds as submitted per eye: uMin, vMin, uMax, vMax
+		float bounds[2][4];
+		// contents of the constant buffers bound for each eye
+		UpscaleConstants upscale[2];
+		SharpenConstants sharpen[2];
+		// raw NISConfig, see nis/NIS_Config.h
+		uint8_t nisUpscale[2][NIS_CONFIG_SIZE];
+		uint8_t nisSharpen[2][NIS_CONFIG_SIZE];
+	};
+
+	struct FrameHeader {
+		// index of the submitted frame since the recording started; gaps mean dropped frames
+		uint64_t frameIndex;
+		// index of the CNST chunk, in file order, that applies to this frame
+		uint32_t constantsIndex;
+		uint32_t eye;
+		uint32_t width;
+		uint32_t height;
+		uint32_t format;
+		// row pitch of the pixel data following this header, always width * BytesPerPixel(format)
+		uint32_t rowPitch;
+		uint8_t reserved[16];
+	};
+
+	static_assert(sizeof(FileHeader) % CHUNK_ALIGNMENT == 0, "file header must keep chunks aligned");
+	static_assert(sizeof(ChunkHeader) + sizeof(FrameHeader) == CHUNK_ALIGNMENT, "frame pixels must start aligned");
+
+	// Streams chunks to a file. Not thread-safe; meant to be driven by a single worker thread.
+	class FrameDumpWriter {
+	public:
+		// takes ownership of a file opened for binary writing and writes the file header
+		explicit FrameDumpWriter(FILE *file);
+		~FrameDumpWriter();
+
+		// returns the index frames must reference to use these constants
+		uint32_t WriteConstants(const Constants &constants);
+		void WriteFrame(const FrameHeader &header, const void *pixels, size_t sourceRowPitch);
+
+		bool Failed() const { return failed; }
+		uint64_t FramesWritten() const { return framesWritten; }
+		uint64_t BytesWritten() const { return offset; }
+
+	private:
+		FrameDumpWriter(const FrameDumpWriter&) = delete;
+		FrameDumpWriter& operator=(const FrameDumpWriter&) = delete;
+
+		void Write(const void *data, size_t size);
+		void PadToAlignment();
+
+		FILE *file;
+		uint64_t offset = 0;
+		uint32_t constantsCount = 0;
+		uint64_t framesWritten = 0;
+		bool failed = false;
+	};
+
+	// Memory-maps a dump and indexes its chunks. Frame pixels point directly into the mapping.
+	class FrameDumpReader {
+	public:
+		struct Frame {
+			FrameHeader header;
+			const uint8_t *pixels;
+		};
+
+		FrameDumpReader() = default;
+		~FrameDumpReader();
+
+		bool Open(const std::string &path);
+		void Close();
+
+		const std::vector<Constants> & GetConstants() const { return constants; }
+		const std::vector<Frame> & GetFrames() const { return frames; }
+		const std::string & GetError() const { return error; }
+
+	private:
+		FrameDumpReader(const FrameDumpReader&) = delete;
+		FrameDumpReader& operator=(const FrameDumpReader&) = delete;
+
+		bool Map(const std::string &path);
+		bool Fail(const std::string &message);
+
+		const uint8_t *data = nullptr;
+		uint64_t size = 0;
+#ifdef _WIN32
+		void *fileHandle = nullptr;
+		void *mappingHandle = nullptr;
+#endif
+		std::vector<Constants> constants;
+		std::vector<Frame> frames;
+		std::string error;
+	};
+}
+}
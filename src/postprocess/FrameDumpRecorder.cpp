@@ -0,0 +1,109 @@
+#include "FrameDumpRecorder.h"
+#include "Logging.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace vr {
+	void FrameDumpRecorder::Start(const std::wstring &filename, int frames) {
+		if (writer != nullptr) {
+			Log(LogLevel::Warning) << "Frame dump already in progress, ignoring request";
+			return;
+		}
+		FILE *file = _wfopen(filename.c_str(), L"wb");
+		if (file == nullptr) {
+			Log(LogLevel::Error) << "Could not create frame dump file";
+			return;
+		}
+		writer = std::make_shared<framedump::FrameDumpWriter>(file);
+		constants.reset();
+		writtenConstants = std::make_shared<WrittenConstants>();
+		frameCount = frames > 0 ? frames : 1;
+		nextFrameIndex = 0;
+		droppedFrames = 0;
+		Log() << "Recording frame dump of " << frameCount << " frame(s)";
+	}
+
+	void FrameDumpRecorder::SetConstants(const framedump::Constants &newConstants) {
+		if (constants != nullptr && memcmp(constants.get(), &newConstants, sizeof(newConstants)) == 0) {
+			return;
+		}
+		// frames already queued may still reference the previous constants
+		constants = std::make_shared<framedump::Constants>(newConstants);
+	}
+
+	void FrameDumpRecorder::RecordFrame(ID3D11DeviceContext *context, ID3D11Texture2D *texture, UINT subresource, int eye) {
+		if (writer == nullptr || constants == nullptr) {
+			return;
+		}
+		if (eye == 0) {
+			if (nextFrameIndex >= (uint64_t)frameCount) {
+				Finish();
+				return;
+			}
+			currentFrameIndex = nextFrameIndex++;
+		}
+
+		D3D11_TEXTURE2D_DESC td;
+		texture->GetDesc(&td);
+		if (framedump::BytesPerPixel(td.Format) == 0) {
+			Log(LogLevel::Error) << "Can't record frames of format " << td.Format << ", aborting frame dump";
+			Finish();
+			return;
+		}
+
+		framedump::FrameHeader header;
+		memset(&header, 0, sizeof(header));
+		header.frameIndex = currentFrameIndex;
+		header.eye = eye;
+		header.width = td.Width;
+		header.height = td.Height;
+		header.format = td.Format;
+
+		std::shared_ptr<framedump::FrameDumpWriter> dumpWriter = writer;
+		std::shared_ptr<WrittenConstants> written = writtenConstants;
+		std::shared_ptr<framedump::Constants> frameConstants = constants;
+		bool queued = readback.Readback(context, texture, subresource, RING_SIZE,
+				[dumpWriter, written, frameConstants, header](const D3D11_TEXTURE2D_DESC &desc, const void *pixels, size_t rowPitch) {
+			if (written->constants != frameConstants) {
+				written->index = dumpWriter->WriteConstants(*frameConstants);
+				written->constants = frameConstants;
+			}
+			framedump::FrameHeader frame = header;
+			frame.constantsIndex = written->index;
+			dumpWriter->WriteFrame(frame, pixels, rowPitch);
+			if (dumpWriter->Failed()) {
+				static LogRateLimit writeErrorLimit (5000);
+				Log(LogLevel::Error, writeErrorLimit) << "Error writing frame dump, disk full?";
+			}
+		});
+
+		if (!queued) {
+			++droppedFrames;
+			static LogRateLimit droppedLimit (1000);
+			Log(LogLevel::Warning, droppedLimit) << "Frame dump can't keep up, dropped frame " << currentFrameIndex << " eye " << eye;
+		}
+	}
+
+	void FrameDumpRecorder::Poll(ID3D11DeviceContext *context) {
+		readback.Poll(context);
+	}
+
+	void FrameDumpRecorder::Reset(ID3D11DeviceContext *context) {
+		if (writer != nullptr) {
+			Log(LogLevel::Warning) << "Frame dump interrupted by a reset";
+		}
+		readback.Reset(context);
+		if (writer != nullptr) {
+			Finish();
+		}
+	}
+
+	void FrameDumpRecorder::Finish() {
+		Log() << "Frame dump finished after " << nextFrameIndex << " frame(s), " << droppedFrames << " eye image(s) dropped";
+		// the worker closes the file once the last queued frame has been written
+		writer.reset();
+		writtenConstants.reset();
+		constants.reset();
+	}
+}
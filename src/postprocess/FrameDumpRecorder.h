@@ -0,0 +1,49 @@
+#pragma once
+#include <d3d11.h>
+#include <memory>
+#include <string>
+#include "AsyncCapture.h"
+#include "FrameDump.h"
+
+namespace vr {
+	// Records the input frames of the post-processing chain, together with the constants they were
+	// processed with, into a frame dump (see FrameDump.h). Frames are read back through an AsyncCapture
+	// ring and written by its worker thread, so recording never waits on the GPU or the disk. If the
+	// disk can't keep up, frames are dropped rather than stalling the game; the dump records the index
+	// of every frame so that gaps are visible.
+	class FrameDumpRecorder {
+	public:
+		void Start(const std::wstring &filename, int frameCount);
+		bool IsRecording() const { return writer != nullptr; }
+		// constants for the frames recorded from now on; only written to the dump when they change
+		void SetConstants(const framedump::Constants &constants);
+		// records the given subresource as the input for the given eye; a left eye starts a new frame
+		void RecordFrame(ID3D11DeviceContext *context, ID3D11Texture2D *texture, UINT subresource, int eye);
+		void Poll(ID3D11DeviceContext *context);
+		// stops a running recording; frames already read back are still written by the worker
+		void Reset(ID3D11DeviceContext *context);
+
+	private:
+		// enough for a few frames of both eyes in flight
+		static const int RING_SIZE = 12;
+
+		AsyncCapture readback;
+		// shared with the readback handlers, the file is closed once the last pending frame is written
+		std::shared_ptr<framedump::FrameDumpWriter> writer;
+		std::shared_ptr<framedump::Constants> constants;
+		// the constants last written to the dump and their index, only used by the readback worker.
+		// Indices are assigned as the constants are written, so frames that are dropped or fail to
+		// map can't leave later frames referencing constants that never made it into the file.
+		struct WrittenConstants {
+			std::shared_ptr<framedump::Constants> constants;
+			uint32_t index = 0;
+		};
+		std::shared_ptr<WrittenConstants> writtenConstants;
+		int frameCount = 0;
+		uint64_t nextFrameIndex = 0;
+		uint64_t currentFrameIndex = 0;
+		uint64_t droppedFrames = 0;
+
+		void Finish();
+	};
+}
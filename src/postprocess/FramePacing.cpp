@@ -0,0 +1,145 @@
+#include "FramePacing.h"
+#include <algorithm>
+#include "Logging.h"
+
+namespace vr {
+	namespace {
+		double Percent(double part, double total) {
+			return total > 0 ? int(1000.0 * part / total + 0.5) / 10.0 : 0.0;
+		}
+
+		double RoundMs(double ms) {
+			return int(ms * 100 + (ms < 0 ? -0.5 : 0.5)) / 100.0;
+		}
+	}
+
+	void FramePacingAnalyzer::SetCompositor(IVRCompositor *compositor, float displayFrequency) {
+		this->compositor = compositor;
+		frameBudgetMs = displayFrequency > 0 ? 1000.f / displayFrequency : 0;
+		if (compositor != nullptr) {
+			Log() << "Frame budget is " << frameBudgetMs << " ms at " << displayFrequency << " Hz";
+		}
+		Reset();
+	}
+
+	void FramePacingAnalyzer::Reset() {
+		currentFrame = 0;
+		lastEvaluatedFrame = 0;
+		for (FrameCost &cost : costs) {
+			cost = FrameCost();
+		}
+		summary = Summary();
+		summaryStartSeconds = 0;
+	}
+
+	void FramePacingAnalyzer::BeginFrame() {
+		if (compositor == nullptr || frameBudgetMs <= 0) {
+			return;
+		}
+
+		Compositor_FrameTiming timings[MAX_TIMINGS];
+		timings[0].m_nSize = sizeof(Compositor_FrameTiming);
+		uint32_t count = compositor->GetFrameTimings(timings, MAX_TIMINGS);
+		if (count == 0) {
+			return;
+		}
+
+		currentFrame = timings[count - 1].m_nFrameIndex;
+		FrameCost &cost = costs[currentFrame % HISTORY];
+		if (cost.frame != currentFrame) {
+			cost = FrameCost();
+			cost.frame = currentFrame;
+		}
+
+		// timings come oldest first
+		for (uint32_t i = 0; i < count; ++i) {
+			uint32_t frame = timings[i].m_nFrameIndex;
+			if (frame + EVALUATION_DELAY > currentFrame || frame <= lastEvaluatedFrame) {
+				continue;
+			}
+			Evaluate(timings[i]);
+			lastEvaluatedFrame = frame;
+		}
+	}
+
+	void FramePacingAnalyzer::AddCpuTime(float ms) {
+		FrameCost &cost = costs[currentFrame % HISTORY];
+		if (cost.frame == currentFrame) {
+			cost.cpuMs += ms;
+		}
+	}
+
+	void FramePacingAnalyzer::AddGpuTime(uint32_t frame, float ms) {
+		FrameCost &cost = costs[frame % HISTORY];
+		if (cost.frame == frame) {
+			cost.gpuMs += ms;
+			cost.hasGpuTime = true;
+		}
+	}
+
+	void FramePacingAnalyzer::Evaluate(const Compositor_FrameTiming &timing) {
+		if (summary.frames == 0) {
+			summaryStartSeconds = timing.m_flSystemTimeInSeconds;
+			summary.minHeadroomMs = frameBudgetMs;
+		}
+
+		++summary.frames;
+		if (timing.m_nReprojectionFlags & (VRCompositor_ReprojectionReason_Cpu | VRCompositor_ReprojectionReason_Gpu)) {
+			++summary.reprojected;
+		}
+		if (timing.m_nReprojectionFlags & VRCompositor_ReprojectionReason_Gpu) {
+			++summary.reprojectedForGpu;
+		}
+		if (timing.m_nNumMisPresented > 0) {
+			++summary.mispresented;
+		}
+		summary.dropped += timing.m_nNumDroppedFrames;
+
+		float gpuFrameMs = timing.m_flTotalRenderGpuMs;
+		summary.gpuFrameMs += gpuFrameMs;
+		summary.minHeadroomMs = (std::min)(summary.minHeadroomMs, frameBudgetMs - gpuFrameMs);
+
+		// the game only submits frames it renders, so reprojected frames have no costs of their own
+		const FrameCost &cost = costs[timing.m_nFrameIndex % HISTORY];
+		bool hasCost = cost.frame == timing.m_nFrameIndex && cost.hasGpuTime;
+		if (hasCost) {
+			++summary.framesWithCost;
+			summary.modGpuMs += cost.gpuMs;
+			summary.modCpuMs += cost.cpuMs;
+		}
+		float overrunMs = gpuFrameMs - frameBudgetMs;
+		if (overrunMs > 0) {
+			++summary.overBudget;
+			summary.overrunMs += overrunMs;
+			if (hasCost) {
+				summary.overrunFromModMs += (std::min)(overrunMs, cost.gpuMs);
+				if (overrunMs <= cost.gpuMs) {
+					++summary.overBudgetByMod;
+				}
+			}
+		}
+
+		if (timing.m_flSystemTimeInSeconds - summaryStartSeconds >= SUMMARY_INTERVAL_SECONDS) {
+			LogSummary();
+			summary = Summary();
+		}
+	}
+
+	void FramePacingAnalyzer::LogSummary() {
+		const Summary &s = summary;
+		Log() << "Frame pacing over " << s.frames << " frames: " << Percent(s.reprojected, s.frames) << "% reprojected ("
+			<< Percent(s.reprojectedForGpu, s.frames) << "% for GPU), " << Percent(s.mispresented, s.frames) << "% mispresented, "
+			<< s.dropped << " dropped";
+		Log() << "GPU frame time " << RoundMs(s.gpuFrameMs / s.frames) << " ms of " << RoundMs(frameBudgetMs) << " ms budget, headroom "
+			<< RoundMs(frameBudgetMs - s.gpuFrameMs / s.frames) << " ms on average, " << RoundMs(s.minHeadroomMs) << " ms at worst";
+		if (s.framesWithCost > 0) {
+			Log() << "Post-processing took " << RoundMs(s.modGpuMs / s.framesWithCost) << " ms GPU and "
+				<< RoundMs(s.modCpuMs / s.framesWithCost) << " ms CPU per frame, measured on " << s.framesWithCost << " frames";
+		}
+		if (s.overBudget > 0) {
+			Log() << s.overBudget << " frames over budget by " << RoundMs(s.overrunMs / s.overBudget) << " ms on average, "
+				<< Percent(s.overrunFromModMs, s.overrunMs) << "% of it post-processing; "
+				<< s.overBudgetByMod << " would have been in budget without it";
+		}
+	}
+}
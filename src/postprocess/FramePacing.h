@@ -0,0 +1,72 @@
+#pragma once
+#include <cstdint>
+#include "openvr.h"
+
+namespace vr {
+	// Correlates the compositor's frame timing with what the mod itself costs, to tell whether the
+	// post-processing is what makes a game miss frames. The mod's costs are booked under the compositor
+	// frame that is current when the game submits; once the compositor has finished a frame (and the GPU
+	// timings of the mod have come in, a few frames later) it is evaluated against the frame budget.
+	// A summary is logged periodically: how often frames were missed or reprojected, the GPU frame time
+	// and headroom, and how much of the time over budget was spent post-processing.
+	class FramePacingAnalyzer {
+	public:
+		// compositor of the current interface version, queried directly from the runtime; nullptr disables
+		void SetCompositor(IVRCompositor *compositor, float displayFrequency);
+
+		// must be called at the first Submit of every frame, before the mod's costs are added
+		void BeginFrame();
+		// the frame the mod's costs are currently booked under, for tagging GPU queries
+		uint32_t CurrentFrame() const { return currentFrame; }
+		void AddCpuTime(float ms);
+		void AddGpuTime(uint32_t frame, float ms);
+		// forgets the frames seen so far, e.g. after the post-processing resources changed
+		void Reset();
+
+	private:
+		// frames whose costs are kept until they are evaluated
+		static const uint32_t HISTORY = 64;
+		// frames to wait before evaluating one, so that the GPU timing of the mod is available
+		static const uint32_t EVALUATION_DELAY = 8;
+		static const uint32_t MAX_TIMINGS = 16;
+		static const uint32_t SUMMARY_INTERVAL_SECONDS = 10;
+
+		struct FrameCost {
+			uint32_t frame = 0;
+			float cpuMs = 0;
+			float gpuMs = 0;
+			bool hasGpuTime = false;
+		};
+
+		struct Summary {
+			uint32_t frames = 0;
+			uint32_t reprojected = 0;
+			uint32_t reprojectedForGpu = 0;
+			uint32_t mispresented = 0;
+			uint32_t dropped = 0;
+			double gpuFrameMs = 0;
+			float minHeadroomMs = 0;
+			// frames with a GPU time for the mod, and the sums over them
+			uint32_t framesWithCost = 0;
+			double modGpuMs = 0;
+			double modCpuMs = 0;
+			// frames over budget, the sum of their overruns and how much of it was post-processing
+			uint32_t overBudget = 0;
+			double overrunMs = 0;
+			double overrunFromModMs = 0;
+			// frames over budget by no more than the post-processing took
+			uint32_t overBudgetByMod = 0;
+		};
+
+		IVRCompositor *compositor = nullptr;
+		float frameBudgetMs = 0;
+		uint32_t currentFrame = 0;
+		uint32_t lastEvaluatedFrame = 0;
+		FrameCost costs[HISTORY];
+		Summary summary;
+		double summaryStartSeconds = 0;
+
+		void Evaluate(const Compositor_FrameTiming &timing);
+		void LogSummary();
+	};
+}
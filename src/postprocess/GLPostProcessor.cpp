@@ -0,0 +1,505 @@
+#include <cmath>
+#include <cstring>
+#include <string>
+#include "GLPostProcessor.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+#include "Config.h"
+#include "PostProcessConstants.h"
+
+namespace {
+	struct EmbeddedFile { const char *name; const char *contents; };
+}
+#include "shader_gl_sources.h"
+
+namespace vr {
+	// the few GL enums we need; the mod doesn't depend on any GL headers
+	const GLenum GL_NO_ERROR = 0;
+	const GLenum GL_TEXTURE_2D = 0x0DE1;
+	const GLenum GL_TEXTURE_WIDTH = 0x1000;
+	const GLenum GL_TEXTURE_HEIGHT = 0x1001;
+	const GLenum GL_TEXTURE_INTERNAL_FORMAT = 0x1003;
+	const GLenum GL_LINEAR = 0x2601;
+	const GLenum GL_TEXTURE_MAG_FILTER = 0x2800;
+	const GLenum GL_TEXTURE_MIN_FILTER = 0x2801;
+	const GLenum GL_TEXTURE_WRAP_S = 0x2802;
+	const GLenum GL_TEXTURE_WRAP_T = 0x2803;
+	const GLenum GL_CLAMP_TO_EDGE = 0x812F;
+	const GLenum GL_RGB8 = 0x8051;
+	const GLenum GL_RGBA8 = 0x8058;
+	const GLenum GL_RGB10_A2 = 0x8059;
+	const GLenum GL_SRGB8 = 0x8C41;
+	const GLenum GL_SRGB8_ALPHA8 = 0x8C43;
+	const GLenum GL_TEXTURE0 = 0x84C0;
+	const GLenum GL_ACTIVE_TEXTURE = 0x84E0;
+	const GLenum GL_TEXTURE_BINDING_2D = 0x8069;
+	const GLenum GL_SAMPLER_BINDING = 0x8919;
+	const GLenum GL_CURRENT_PROGRAM = 0x8B8D;
+	const GLenum GL_DYNAMIC_DRAW = 0x88E8;
+	const GLenum GL_UNIFORM_BUFFER = 0x8A11;
+	const GLenum GL_UNIFORM_BUFFER_BINDING = 0x8A28;
+	const GLenum GL_UNIFORM_BUFFER_START = 0x8A29;
+	const GLenum GL_UNIFORM_BUFFER_SIZE = 0x8A2A;
+	const GLenum GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT = 0x8A34;
+	const GLenum GL_COMPUTE_SHADER = 0x91B9;
+	const GLenum GL_COMPILE_STATUS = 0x8B81;
+	const GLenum GL_LINK_STATUS = 0x8B82;
+	const GLenum GL_INFO_LOG_LENGTH = 0x8B84;
+	const GLenum GL_WRITE_ONLY = 0x88B9;
+	const GLenum GL_IMAGE_BINDING_NAME = 0x8F3A;
+	const GLenum GL_IMAGE_BINDING_LEVEL = 0x8F3B;
+	const GLenum GL_IMAGE_BINDING_LAYERED = 0x8F3C;
+	const GLenum GL_IMAGE_BINDING_LAYER = 0x8F3D;
+	const GLenum GL_IMAGE_BINDING_ACCESS = 0x8F3E;
+	const GLenum GL_IMAGE_BINDING_FORMAT = 0x906E;
+	const GLbitfield GL_TEXTURE_FETCH_BARRIER_BIT = 0x00000008;
+	const GLbitfield GL_ALL_BARRIER_BITS = 0xFFFFFFFF;
+
+	// constant blocks are at least this far apart, the size of the largest D3D constants block
+	const GLint MIN_CONSTANTS_BLOCK_SIZE = 256;
+
+	typedef void *(VR_GL_APIENTRY *PFN_GetProcAddress)(const char *name);
+	typedef void *(VR_GL_APIENTRY *PFN_GetCurrentContext)();
+
+	void *GetGLFunction(const char *name) {
+#ifdef _WIN32
+		HMODULE opengl = GetModuleHandleA("opengl32.dll");
+		if (opengl == nullptr) {
+			return nullptr;
+		}
+		PFN_GetProcAddress wglGetProcAddress = (PFN_GetProcAddress)GetProcAddress(opengl, "wglGetProcAddress");
+		void *function = wglGetProcAddress != nullptr ? wglGetProcAddress(name) : nullptr;
+		// wglGetProcAddress only knows about extensions and functions beyond GL 1.1, and some drivers
+		// return small integers instead of null for unknown functions
+		if ((uintptr_t)function <= 3 || (intptr_t)function == -1) {
+			function = (void*)GetProcAddress(opengl, name);
+		}
+		return function;
+#else
+		static PFN_GetProcAddress getProcAddress = nullptr;
+		if (getProcAddress == nullptr) {
+			getProcAddress = (PFN_GetProcAddress)dlsym(RTLD_DEFAULT, "eglGetProcAddress");
+		}
+		if (getProcAddress == nullptr) {
+			getProcAddress = (PFN_GetProcAddress)dlsym(RTLD_DEFAULT, "glXGetProcAddressARB");
+		}
+		return getProcAddress != nullptr ? getProcAddress(name) : nullptr;
+#endif
+	}
+
+	void *GetCurrentGLContext() {
+#ifdef _WIN32
+		HMODULE opengl = GetModuleHandleA("opengl32.dll");
+		PFN_GetCurrentContext getCurrentContext = opengl != nullptr ? (PFN_GetCurrentContext)GetProcAddress(opengl, "wglGetCurrentContext") : nullptr;
+		return getCurrentContext != nullptr ? getCurrentContext() : nullptr;
+#else
+		void *context = nullptr;
+		PFN_GetCurrentContext getCurrentContext = (PFN_GetCurrentContext)dlsym(RTLD_DEFAULT, "eglGetCurrentContext");
+		if (getCurrentContext != nullptr) {
+			context = getCurrentContext();
+		}
+		getCurrentContext = (PFN_GetCurrentContext)dlsym(RTLD_DEFAULT, "glXGetCurrentContext");
+		if (context == nullptr && getCurrentContext != nullptr) {
+			context = getCurrentContext();
+		}
+		return context;
+#endif
+	}
+
+	GLenum MakeSrgbFormatsUnorm(GLenum format) {
+		switch (format) {
+		case GL_SRGB8_ALPHA8:
+			return GL_RGBA8;
+		case GL_SRGB8:
+			return GL_RGB8;
+		default:
+			return format;
+		}
+	}
+
+	bool IsSrgbFormat(GLenum format) {
+		return MakeSrgbFormatsUnorm(format) != format;
+	}
+
+	GLenum DetermineOutputFormat(GLenum inputFormat) {
+		// same reasoning as for the D3D11 path: SteamVR applies a different color conversion to 10 bit
+		// textures that we can't match with an 8 bit output
+		return inputFormat == GL_RGB10_A2 ? GL_RGB10_A2 : GL_RGBA8;
+	}
+
+	// resolves the #include lines of an embedded shader source, which GLSL compilers don't support
+	bool ResolveIncludes(std::string &source, const char *fileName) {
+		for (const EmbeddedFile &file : g_GLShaderFiles) {
+			if (strcmp(file.name, fileName) != 0) {
+				continue;
+			}
+			const char *line = file.contents;
+			while (*line != '\0') {
+				const char *end = strchr(line, '\n');
+				size_t length = end != nullptr ? end - line + 1 : strlen(line);
+				const char *directive = line;
+				while (*directive == ' ' || *directive == '\t') {
+					++directive;
+				}
+				if (strncmp(directive, "#include \"", 10) == 0) {
+					std::string include (directive + 10, strcspn(directive + 10, "\"\n"));
+					if (!ResolveIncludes(source, include.c_str())) {
+						return false;
+					}
+				} else {
+					source.append(line, length);
+				}
+				line += length;
+			}
+			return true;
+		}
+		Log(LogLevel::Error) << "Missing embedded shader file " << fileName;
+		return false;
+	}
+
+	void GLPostProcessor::Apply(EVREye eEye, const Texture_t *pTexture, const VRTextureBounds_t* pBounds, EVRSubmitFlags nSubmitFlags) {
+		if (!enabled || pTexture == nullptr || pTexture->eType != TextureType_OpenGL || pTexture->handle == nullptr) {
+			return;
+		}
+
+		if (nSubmitFlags & (Submit_GlRenderBuffer | Submit_GlArrayTexture)) {
+			// we replace the submitted texture, but can't change the submit flags that describe it
+			static bool logged = false;
+			if (!logged) {
+				Log() << "OpenGL render buffers and array textures are not supported, skipping post-processing";
+				logged = true;
+			}
+			return;
+		}
+
+		static VRTextureBounds_t defaultBounds { 0, 0, 1, 1 };
+		if (pBounds == nullptr) {
+			pBounds = &defaultBounds;
+		}
+
+		GLuint texture = (GLuint)(uintptr_t)pTexture->handle;
+
+		if ( Config::Instance().fsrEnabled ) {
+			if (initialized && GetCurrentGLContext() != context) {
+				Log() << "OpenGL context changed, recreating resources...";
+				Reset();
+			}
+			PipelineSettings settings = CurrentPipelineSettings();
+			if (initialized && RequiresNewResources(plannedSettings, settings)) {
+				Log() << "Settings changed, recreating resources...";
+				Reset();
+			}
+			if (!initialized) {
+				try {
+					context = GetCurrentGLContext();
+					if (context == nullptr) {
+						Log(LogLevel::Error) << "No OpenGL context is current";
+						throw std::exception();
+					}
+					if (!LoadFunctions()) {
+						throw std::exception();
+					}
+					textureContainsOnlyOneEye = std::abs(pBounds->uMax - pBounds->uMin) > .5f;
+					SavedState state;
+					SaveState(state);
+					try {
+						PrepareResources(texture, pTexture->eColorSpace);
+					} catch (...) {
+						RestoreState(state);
+						throw;
+					}
+					RestoreState(state);
+				} catch (...) {
+					Log(LogLevel::Error) << "OpenGL resource creation failed, disabling";
+					Reset();
+					enabled = false;
+					return;
+				}
+			}
+
+			SavedState state;
+			SaveState(state);
+			if (ParametersDiffer(plannedSettings, settings)) {
+				UpdateConstants(settings);
+			}
+			// if a single shared texture is used for both eyes, only apply effects on the first Submit
+			if (eyeCount == 0 || textureContainsOnlyOneEye || texture != lastSubmittedTexture) {
+				ApplyPostProcess(textureContainsOnlyOneEye ? eEye : Eye_Left, texture);
+			}
+			RestoreState(state);
+			if (!initialized) {
+				// the texture size changed, resources are recreated on the next Submit
+				return;
+			}
+			lastSubmittedTexture = texture;
+			eyeCount = (eyeCount + 1) % 2;
+			const_cast<Texture_t*>(pTexture)->handle = (void*)(uintptr_t)outputTexture;
+			const_cast<Texture_t*>(pTexture)->eColorSpace = inputIsSrgb ? ColorSpace_Gamma : ColorSpace_Auto;
+		}
+	}
+
+	void GLPostProcessor::Reset() {
+		// GL objects can only be deleted with their context current; otherwise they are gone with it
+		if (initialized && context != nullptr && GetCurrentGLContext() == context) {
+			GLuint textures[] = { copiedTexture, upscaledTexture, sharpenedTexture };
+			glDeleteTextures(3, textures);
+			glDeleteSamplers(1, &sampler);
+			glDeleteBuffers(1, &constantsBuffer);
+			glDeleteProgram(upscaleProgram);
+			glDeleteProgram(sharpenProgram);
+		}
+
+		enabled = true;
+		initialized = false;
+		context = nullptr;
+		sampler = 0;
+		constantsBuffer = 0;
+		copiedTexture = 0;
+		upscaleProgram = 0;
+		upscaledTexture = 0;
+		sharpenProgram = 0;
+		sharpenedTexture = 0;
+		outputTexture = 0;
+		lastSubmittedTexture = 0;
+		eyeCount = 0;
+	}
+
+	bool GLPostProcessor::LoadFunctions() {
+		bool success = true;
+#define VR_LOAD_GL_FUNCTION(name, ret, args) \
+		name = (PFN_##name)GetGLFunction(#name); \
+		if (name == nullptr) { Log(LogLevel::Error) << "Could not load " #name; success = false; }
+		VR_GL_FUNCTIONS(VR_LOAD_GL_FUNCTION)
+#undef VR_LOAD_GL_FUNCTION
+		return success;
+	}
+
+	GLuint GLPostProcessor::CreateTexture(GLenum format, uint32_t width, uint32_t height, const char *name) {
+		Log() << "Creating " << name << " of size " << width << "x" << height << " in format " << std::hex << format << std::dec;
+		GLuint texture = 0;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexStorage2D(GL_TEXTURE_2D, 1, format, width, height);
+		GLenum error = glGetError();
+		if (error != GL_NO_ERROR) {
+			glDeleteTextures(1, &texture);
+			Log(LogLevel::Error) << "Failed (" << std::hex << error << std::dec << "): Creating " << name;
+			throw std::exception();
+		}
+		return texture;
+	}
+
+	GLuint GLPostProcessor::CreateProgram(const char *mainFile, const char *name) {
+		std::string source = "#version 430\n#define OUTPUT_FORMAT ";
+		source += outputFormat == GL_RGB10_A2 ? "rgb10_a2\n" : "rgba8\n";
+		if (!ResolveIncludes(source, mainFile)) {
+			throw std::exception();
+		}
+
+		GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
+		const GLchar *sources[] = { source.c_str() };
+		glShaderSource(shader, 1, sources, nullptr);
+		glCompileShader(shader);
+		GLint status = 0;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+		if (!status) {
+			GLint length = 0;
+			glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+			std::string infoLog (length > 0 ? length : 1, '\0');
+			glGetShaderInfoLog(shader, (GLsizei)infoLog.size(), nullptr, &infoLog[0]);
+			glDeleteShader(shader);
+			Log(LogLevel::Error) << "Failed compiling " << name << ": " << infoLog.c_str();
+			throw std::exception();
+		}
+
+		GLuint program = glCreateProgram();
+		glAttachShader(program, shader);
+		glLinkProgram(program);
+		glDeleteShader(shader);
+		glGetProgramiv(program, GL_LINK_STATUS, &status);
+		if (!status) {
+			GLint length = 0;
+			glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+			std::string infoLog (length > 0 ? length : 1, '\0');
+			glGetProgramInfoLog(program, (GLsizei)infoLog.size(), nullptr, &infoLog[0]);
+			glDeleteProgram(program);
+			Log(LogLevel::Error) << "Failed linking " << name << ": " << infoLog.c_str();
+			throw std::exception();
+		}
+		return program;
+	}
+
+	void GLPostProcessor::SaveState(SavedState &state) {
+		glGetIntegerv(GL_CURRENT_PROGRAM, &state.program);
+		glGetIntegerv(GL_ACTIVE_TEXTURE, &state.activeTexture);
+		glActiveTexture(GL_TEXTURE0);
+		glGetIntegerv(GL_TEXTURE_BINDING_2D, &state.texture);
+		glGetIntegerv(GL_SAMPLER_BINDING, &state.sampler);
+		glGetIntegeri_v(GL_IMAGE_BINDING_NAME, 0, &state.imageTexture);
+		glGetIntegeri_v(GL_IMAGE_BINDING_LEVEL, 0, &state.imageLevel);
+		glGetIntegeri_v(GL_IMAGE_BINDING_LAYERED, 0, &state.imageLayered);
+		glGetIntegeri_v(GL_IMAGE_BINDING_LAYER, 0, &state.imageLayer);
+		glGetIntegeri_v(GL_IMAGE_BINDING_ACCESS, 0, &state.imageAccess);
+		glGetIntegeri_v(GL_IMAGE_BINDING_FORMAT, 0, &state.imageFormat);
+		glGetIntegerv(GL_UNIFORM_BUFFER_BINDING, &state.uniformBuffer);
+		glGetIntegeri_v(GL_UNIFORM_BUFFER_BINDING, 0, &state.indexedUniformBuffer);
+		glGetInteger64i_v(GL_UNIFORM_BUFFER_START, 0, &state.indexedUniformBufferStart);
+		glGetInteger64i_v(GL_UNIFORM_BUFFER_SIZE, 0, &state.indexedUniformBufferSize);
+	}
+
+	void GLPostProcessor::RestoreState(const SavedState &state) {
+		glUseProgram(state.program);
+		glBindTexture(GL_TEXTURE_2D, state.texture);
+		glBindSampler(0, state.sampler);
+		glActiveTexture(state.activeTexture);
+		glBindImageTexture(0, state.imageTexture, state.imageLevel, (GLboolean)state.imageLayered, state.imageLayer, state.imageAccess, state.imageFormat);
+		if (state.indexedUniformBufferSize > 0) {
+			glBindBufferRange(GL_UNIFORM_BUFFER, 0, state.indexedUniformBuffer, (GLintptr)state.indexedUniformBufferStart, (GLsizeiptr)state.indexedUniformBufferSize);
+		} else {
+			glBindBufferBase(GL_UNIFORM_BUFFER, 0, state.indexedUniformBuffer);
+		}
+		glBindBuffer(GL_UNIFORM_BUFFER, state.uniformBuffer);
+	}
+
+	void GLPostProcessor::PrepareResources(GLuint inputTexture, EColorSpace colorSpace) {
+		Log() << "Creating OpenGL post-processing resources";
+		// the GL objects now exist in this context, so Reset must clean them up
+		initialized = true;
+
+		while (glGetError() != GL_NO_ERROR) {
+			// errors left over by the game
+		}
+		GLint width = 0, height = 0, format = 0;
+		glBindTexture(GL_TEXTURE_2D, inputTexture);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &format);
+		if (glGetError() != GL_NO_ERROR || width <= 0 || height <= 0) {
+			Log(LogLevel::Error) << "Submitted texture " << inputTexture << " is not a 2D texture";
+			throw std::exception();
+		}
+		inputWidth = width;
+		inputHeight = height;
+		inputFormat = format;
+		inputIsSrgb = colorSpace == ColorSpace_Gamma || (colorSpace == ColorSpace_Auto && IsSrgbFormat(inputFormat));
+		if (inputIsSrgb) {
+			Log() << "Input texture is in SRGB color space";
+		}
+		if (Config::Instance().useNis) {
+			Log() << "NVIDIA Image Scaling is not available for OpenGL, using FSR instead";
+		}
+		upscale = Config::Instance().renderScale != 1.f;
+		sharpen = true;
+
+		if ( Config::Instance().renderScale < 1.f) {
+			outputWidth = inputWidth / Config::Instance().renderScale;
+			outputHeight = inputHeight / Config::Instance().renderScale;
+		} else {
+			outputWidth = inputWidth * Config::Instance().renderScale;
+			outputHeight = inputHeight * Config::Instance().renderScale;
+		}
+		outputFormat = DetermineOutputFormat(inputFormat);
+		Log() << "Creating output textures in format " << std::hex << outputFormat << std::dec;
+		Log() << "Using AMD FidelityFX SuperResolution";
+
+		plannedSettings = CurrentPipelineSettings();
+		memset(&shaderConstants, 0, sizeof(shaderConstants));
+		CalculateShaderConstants(shaderConstants, inputWidth, inputHeight, outputWidth, outputHeight, textureContainsOnlyOneEye);
+
+		// constant blocks: upscale left, upscale right, sharpen left, sharpen right
+		GLint alignment = 0;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		constantsBlockSize = MIN_CONSTANTS_BLOCK_SIZE;
+		while (alignment > 0 && constantsBlockSize % alignment != 0) {
+			constantsBlockSize += MIN_CONSTANTS_BLOCK_SIZE;
+		}
+		glGenBuffers(1, &constantsBuffer);
+		glBindBuffer(GL_UNIFORM_BUFFER, constantsBuffer);
+		glBufferData(GL_UNIFORM_BUFFER, 4 * constantsBlockSize, nullptr, GL_DYNAMIC_DRAW);
+		UploadConstants();
+
+		glGenSamplers(1, &sampler);
+		glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		if (inputIsSrgb) {
+			// sampling an sRGB texture would decode it to linear, but the shaders work on the gamma
+			// encoded values, like the D3D11 path
+			copiedTexture = CreateTexture(MakeSrgbFormatsUnorm(inputFormat), inputWidth, inputHeight, "copy texture");
+		}
+		if (upscale) {
+			upscaleProgram = CreateProgram("fsr_easu.glsl", "FSR upscale shader");
+			upscaledTexture = CreateTexture(outputFormat, outputWidth, outputHeight, "upscaled texture");
+		}
+		sharpenProgram = CreateProgram("fsr_rcas.glsl", "rCAS sharpening shader");
+		sharpenedTexture = CreateTexture(outputFormat, outputWidth, outputHeight, "sharpened texture");
+		outputTexture = sharpenedTexture;
+
+		GLenum error = glGetError();
+		if (error != GL_NO_ERROR) {
+			Log(LogLevel::Error) << "Failed (" << std::hex << error << std::dec << "): Creating OpenGL resources";
+			throw std::exception();
+		}
+	}
+
+	void GLPostProcessor::UpdateConstants(const PipelineSettings &settings) {
+		// sharpness, radius and the like only change the constants, like in the D3D11 pipeline
+		float projectionCentre[2][2];
+		memcpy(projectionCentre, shaderConstants.projectionCentre, sizeof(projectionCentre));
+		CalculateShaderConstants(shaderConstants, settings, projectionCentre, inputWidth, inputHeight, outputWidth, outputHeight, textureContainsOnlyOneEye);
+		plannedSettings = settings;
+		UploadConstants();
+	}
+
+	void GLPostProcessor::UploadConstants() {
+		std::string constants (4 * constantsBlockSize, '\0');
+		for (int eye = 0; eye < 2; ++eye) {
+			memcpy(&constants[eye * constantsBlockSize], &shaderConstants.upscale[eye], sizeof(UpscaleConstants));
+			memcpy(&constants[(2 + eye) * constantsBlockSize], &shaderConstants.sharpen[eye], sizeof(SharpenConstants));
+		}
+		glBindBuffer(GL_UNIFORM_BUFFER, constantsBuffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, constants.size(), constants.data());
+	}
+
+	void GLPostProcessor::Dispatch(GLuint program, GLintptr constantsOffset, GLsizeiptr constantsSize, GLuint input, GLuint output) {
+		glUseProgram(program);
+		glBindBufferRange(GL_UNIFORM_BUFFER, 0, constantsBuffer, constantsOffset, constantsSize);
+		glBindTexture(GL_TEXTURE_2D, input);
+		glBindSampler(0, sampler);
+		glBindImageTexture(0, output, 0, false, 0, GL_WRITE_ONLY, outputFormat);
+		glDispatchCompute((outputWidth+15)>>4, (outputHeight+15)>>4, 1);
+	}
+
+	void GLPostProcessor::ApplyPostProcess(EVREye eEye, GLuint inputTexture) {
+		GLint width = 0, height = 0;
+		glBindTexture(GL_TEXTURE_2D, inputTexture);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+		if ((uint32_t)width != inputWidth || (uint32_t)height != inputHeight) {
+			Log() << "Texture size changed, recreating resources...";
+			Reset();
+			return;
+		}
+
+		GLuint input = inputTexture;
+		if (copiedTexture != 0) {
+			glCopyImageSubData(inputTexture, GL_TEXTURE_2D, 0, 0, 0, 0, copiedTexture, GL_TEXTURE_2D, 0, 0, 0, 0, inputWidth, inputHeight, 1);
+			input = copiedTexture;
+		}
+
+		if (upscale) {
+			Dispatch(upscaleProgram, eEye * constantsBlockSize, sizeof(UpscaleConstants), input, upscaledTexture);
+			glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+			input = upscaledTexture;
+		}
+		Dispatch(sharpenProgram, (2 + eEye) * constantsBlockSize, sizeof(SharpenConstants), input, sharpenedTexture);
+		// the compositor may read the output through any path
+		glMemoryBarrier(GL_ALL_BARRIER_BITS);
+	}
+}
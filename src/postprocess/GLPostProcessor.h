@@ -0,0 +1,145 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "openvr.h"
+#include "FrameDump.h"
+#include "PostProcessPipeline.h"
+
+#ifdef _WIN32
+#define VR_GL_APIENTRY __stdcall
+#else
+#define VR_GL_APIENTRY
+#endif
+
+namespace vr {
+	typedef unsigned int GLenum;
+	typedef unsigned int GLuint;
+	typedef int GLint;
+	typedef int GLsizei;
+	typedef unsigned char GLboolean;
+	typedef unsigned int GLbitfield;
+	typedef char GLchar;
+	typedef ptrdiff_t GLintptr;
+	typedef ptrdiff_t GLsizeiptr;
+	typedef int64_t GLint64;
+
+	// OpenGL counterpart of the D3D11 PostProcessor for TextureType_OpenGL submissions. It runs the FSR
+	// kernels as GLSL 4.3 compute shaders built from the same ffx_fsr1.h, with the same constants, on the
+	// game's GL context, which OpenVR requires to be current during Submit. Any GL state that is touched
+	// is restored before returning to the game.
+	//
+	// NIS has no GLSL path in the bundled NIS_Scaler.h, so GL games are always upscaled with FSR.
+	class GLPostProcessor {
+	public:
+		void Apply(EVREye eEye, const Texture_t *pTexture, const VRTextureBounds_t* pBounds, EVRSubmitFlags nSubmitFlags);
+		void Reset();
+
+	private:
+#define VR_GL_FUNCTIONS(X) \
+		X(glGetError, GLenum, (void)) \
+		X(glGetIntegerv, void, (GLenum pname, GLint *data)) \
+		X(glGetIntegeri_v, void, (GLenum target, GLuint index, GLint *data)) \
+		X(glGetInteger64i_v, void, (GLenum target, GLuint index, GLint64 *data)) \
+		X(glGenTextures, void, (GLsizei n, GLuint *textures)) \
+		X(glDeleteTextures, void, (GLsizei n, const GLuint *textures)) \
+		X(glBindTexture, void, (GLenum target, GLuint texture)) \
+		X(glActiveTexture, void, (GLenum texture)) \
+		X(glTexStorage2D, void, (GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height)) \
+		X(glGetTexLevelParameteriv, void, (GLenum target, GLint level, GLenum pname, GLint *params)) \
+		X(glCopyImageSubData, void, (GLuint srcName, GLenum srcTarget, GLint srcLevel, GLint srcX, GLint srcY, GLint srcZ, GLuint dstName, GLenum dstTarget, GLint dstLevel, GLint dstX, GLint dstY, GLint dstZ, GLsizei srcWidth, GLsizei srcHeight, GLsizei srcDepth)) \
+		X(glGenSamplers, void, (GLsizei count, GLuint *samplers)) \
+		X(glDeleteSamplers, void, (GLsizei count, const GLuint *samplers)) \
+		X(glSamplerParameteri, void, (GLuint sampler, GLenum pname, GLint param)) \
+		X(glBindSampler, void, (GLuint unit, GLuint sampler)) \
+		X(glGenBuffers, void, (GLsizei n, GLuint *buffers)) \
+		X(glDeleteBuffers, void, (GLsizei n, const GLuint *buffers)) \
+		X(glBindBuffer, void, (GLenum target, GLuint buffer)) \
+		X(glBufferData, void, (GLenum target, GLsizeiptr size, const void *data, GLenum usage)) \
+		X(glBufferSubData, void, (GLenum target, GLintptr offset, GLsizeiptr size, const void *data)) \
+		X(glBindBufferBase, void, (GLenum target, GLuint index, GLuint buffer)) \
+		X(glBindBufferRange, void, (GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)) \
+		X(glCreateShader, GLuint, (GLenum type)) \
+		X(glShaderSource, void, (GLuint shader, GLsizei count, const GLchar *const *string, const GLint *length)) \
+		X(glCompileShader, void, (GLuint shader)) \
+		X(glGetShaderiv, void, (GLuint shader, GLenum pname, GLint *params)) \
+		X(glGetShaderInfoLog, void, (GLuint shader, GLsizei bufSize, GLsizei *length, GLchar *infoLog)) \
+		X(glDeleteShader, void, (GLuint shader)) \
+		X(glCreateProgram, GLuint, (void)) \
+		X(glAttachShader, void, (GLuint program, GLuint shader)) \
+		X(glLinkProgram, void, (GLuint program)) \
+		X(glGetProgramiv, void, (GLuint program, GLenum pname, GLint *params)) \
+		X(glGetProgramInfoLog, void, (GLuint program, GLsizei bufSize, GLsizei *length, GLchar *infoLog)) \
+		X(glDeleteProgram, void, (GLuint program)) \
+		X(glUseProgram, void, (GLuint program)) \
+		X(glBindImageTexture, void, (GLuint unit, GLuint texture, GLint level, GLboolean layered, GLint layer, GLenum access, GLenum format)) \
+		X(glDispatchCompute, void, (GLuint numGroupsX, GLuint numGroupsY, GLuint numGroupsZ)) \
+		X(glMemoryBarrier, void, (GLbitfield barriers))
+
+#define VR_DECLARE_GL_FUNCTION(name, ret, args) typedef ret (VR_GL_APIENTRY *PFN_##name) args; PFN_##name name = nullptr;
+		VR_GL_FUNCTIONS(VR_DECLARE_GL_FUNCTION)
+#undef VR_DECLARE_GL_FUNCTION
+
+		// GL state changed by the post-processing, restored after each Submit
+		struct SavedState {
+			GLint program;
+			GLint activeTexture;
+			GLint texture;
+			GLint sampler;
+			GLint imageTexture;
+			GLint imageLevel;
+			GLint imageLayered;
+			GLint imageLayer;
+			GLint imageAccess;
+			GLint imageFormat;
+			GLint uniformBuffer;
+			GLint indexedUniformBuffer;
+			GLint64 indexedUniformBufferStart;
+			GLint64 indexedUniformBufferSize;
+		};
+
+		bool enabled = true;
+		bool initialized = false;
+		// the GL context our objects belong to; they can only be deleted while it is current
+		void *context = nullptr;
+		uint32_t inputWidth = 0;
+		uint32_t inputHeight = 0;
+		uint32_t outputWidth = 0;
+		uint32_t outputHeight = 0;
+		GLenum inputFormat = 0;
+		bool textureContainsOnlyOneEye = true;
+		bool inputIsSrgb = false;
+		bool upscale = false;
+		bool sharpen = false;
+		GLenum outputFormat = 0;
+
+		GLuint sampler = 0;
+		GLuint constantsBuffer = 0;
+		GLint constantsBlockSize = 0;
+		// the shaders sample the game's texture directly, unless it is an sRGB texture
+		GLuint copiedTexture = 0;
+		GLuint upscaleProgram = 0;
+		GLuint upscaledTexture = 0;
+		GLuint sharpenProgram = 0;
+		GLuint sharpenedTexture = 0;
+
+		GLuint lastSubmittedTexture = 0;
+		GLuint outputTexture = 0;
+		int eyeCount = 0;
+
+		// the settings the resources and constants were created for
+		PipelineSettings plannedSettings;
+		framedump::Constants shaderConstants;
+
+		bool LoadFunctions();
+		GLuint CreateTexture(GLenum format, uint32_t width, uint32_t height, const char *name);
+		GLuint CreateProgram(const char *mainFile, const char *name);
+		void SaveState(SavedState &state);
+		void RestoreState(const SavedState &state);
+
+		void PrepareResources(GLuint inputTexture, EColorSpace colorSpace);
+		void UpdateConstants(const PipelineSettings &settings);
+		void UploadConstants();
+		void ApplyPostProcess(EVREye eEye, GLuint inputTexture);
+		void Dispatch(GLuint program, GLintptr constantsOffset, GLsizeiptr constantsSize, GLuint input, GLuint output);
+	};
+}
@@ -0,0 +1,91 @@
+#include "HotkeyListener.h"
+#include <chrono>
+#include <windows.h>
+#include "Config.h"
+
+namespace vr {
+	HotkeyListener & HotkeyListener::Instance() {
+		static HotkeyListener *instance = new HotkeyListener;
+		return *instance;
+	}
+
+	void HotkeyListener::Start() {
+		if (thread != nullptr) {
+			return;
+		}
+		stopRequested = false;
+		UpdateBindings();
+		thread = new std::thread([this]() { Run(); });
+	}
+
+	void HotkeyListener::Stop() {
+		if (thread == nullptr) {
+			return;
+		}
+		stopRequested = true;
+		thread->join();
+		delete thread;
+		thread = nullptr;
+		wasKeyPressedBefore.clear();
+	}
+
+	void HotkeyListener::UpdateBindings() {
+		const Config &config = Config::Instance();
+		keyCodes[(int)HotkeyCommand::ToggleUseNis] = config.hotkeyToggleUseNis;
+		keyCodes[(int)HotkeyCommand::ToggleDebugMode] = config.hotkeyToggleDebugMode;
+		keyCodes[(int)HotkeyCommand::DecreaseSharpness] = config.hotkeyDecreaseSharpness;
+		keyCodes[(int)HotkeyCommand::IncreaseSharpness] = config.hotkeyIncreaseSharpness;
+		keyCodes[(int)HotkeyCommand::DecreaseRadius] = config.hotkeyDecreaseRadius;
+		keyCodes[(int)HotkeyCommand::IncreaseRadius] = config.hotkeyIncreaseRadius;
+		keyCodes[(int)HotkeyCommand::CaptureOutput] = config.hotkeyCaptureOutput;
+		keyCodes[(int)HotkeyCommand::RecordFrameDump] = config.hotkeyRecordFrameDump;
+		keyCodes[(int)HotkeyCommand::WriteTrace] = config.hotkeyWriteTrace;
+		requireShift = config.hotkeysRequireShift;
+		requireCtrl = config.hotkeysRequireCtrl;
+		requireAlt = config.hotkeysRequireAlt;
+		listening = config.fsrEnabled && config.hotkeysEnabled;
+	}
+
+	void HotkeyListener::Run() {
+		SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+		while (!stopRequested) {
+			if (listening) {
+				CheckHotkeys();
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(POLL_INTERVAL_MS));
+		}
+	}
+
+	void HotkeyListener::CheckHotkeys() {
+		bool isShiftPressed = GetAsyncKeyState( VK_LSHIFT ) || GetAsyncKeyState( VK_RSHIFT );
+		if (!isShiftPressed && requireShift)
+			return;
+		bool isCtrlPressed = GetAsyncKeyState( VK_LCONTROL ) || GetAsyncKeyState( VK_RCONTROL );
+		if (!isCtrlPressed && requireCtrl)
+			return;
+		bool isAltPressed = GetAsyncKeyState( VK_LMENU ) || GetAsyncKeyState( VK_RMENU );
+		if (!isAltPressed && requireAlt)
+			return;
+
+		for (int command = 0; command < (int)HotkeyCommand::Count; ++command) {
+			if (IsHotkeyActive( keyCodes[command] ))
+				Post( (HotkeyCommand)command );
+		}
+	}
+
+	bool HotkeyListener::IsHotkeyActive( int keyCode ) {
+		bool isPressedNow = GetAsyncKeyState( keyCode );
+		bool isNewlyPressed = !wasKeyPressedBefore[keyCode] && isPressedNow;
+		wasKeyPressedBefore[keyCode] = isPressedNow;
+		return isNewlyPressed;
+	}
+
+	void HotkeyListener::Post( HotkeyCommand command ) {
+		uint32_t pos = writePos.load(std::memory_order_relaxed);
+		if (pos - publishedReadPos.load(std::memory_order_acquire) >= CAPACITY) {
+			return;
+		}
+		commands[pos & (CAPACITY - 1)] = command;
+		writePos.store(pos + 1, std::memory_order_release);
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <unordered_map>
+
+namespace vr {
+	enum class HotkeyCommand : uint8_t {
+		ToggleUseNis,
+		ToggleDebugMode,
+		DecreaseSharpness,
+		IncreaseSharpness,
+		DecreaseRadius,
+		IncreaseRadius,
+		CaptureOutput,
+		RecordFrameDump,
+		WriteTrace,
+		Count,
+	};
+
+	// Polls the configured hotkeys on a low priority background thread, so that the render thread
+	// doesn't query the keyboard state before every Submit. Pressed hotkeys are posted as commands to
+	// a bounded single-producer single-consumer queue; checking it for commands costs the render
+	// thread a single atomic load. The thread never reads the Config, which the render thread
+	// changes; it polls the keys last passed to UpdateBindings instead.
+	class HotkeyListener {
+	public:
+		// intentionally leaked, like the log writer, so that nothing waits for the thread during DLL unload
+		static HotkeyListener & Instance();
+
+		void Start();
+		void Stop();
+		// takes the key codes and modifiers from the current Config, and whether hotkeys are
+		// active at all; call on the render thread whenever those settings may have changed
+		void UpdateBindings();
+
+		// must only be called from one thread at a time; returns false if no command is waiting
+		bool Poll(HotkeyCommand &command) {
+			if (writePos.load(std::memory_order_acquire) == readPos) {
+				return false;
+			}
+			command = commands[readPos & (CAPACITY - 1)];
+			++readPos;
+			publishedReadPos.store(readPos, std::memory_order_release);
+			return true;
+		}
+
+	private:
+		static const uint32_t CAPACITY = 16;
+		static const uint32_t POLL_INTERVAL_MS = 10;
+
+		HotkeyCommand commands[CAPACITY];
+		// keep producer and consumer positions on separate cache lines
+		std::atomic<uint32_t> writePos { 0 };
+		char padding[60];
+		uint32_t readPos = 0;
+		std::atomic<uint32_t> publishedReadPos { 0 };
+
+		std::thread *thread = nullptr;
+		std::atomic<bool> stopRequested { false };
+		// the listener's copy of the hotkey settings; they are independent of each other, so it
+		// doesn't matter if an update is seen half applied for one poll
+		std::atomic<bool> listening { false };
+		std::atomic<bool> requireShift { false };
+		std::atomic<bool> requireCtrl { false };
+		std::atomic<bool> requireAlt { false };
+		std::atomic<int> keyCodes[(int)HotkeyCommand::Count] {};
+		// only used by the listener thread
+		std::unordered_map<int, bool> wasKeyPressedBefore;
+
+		void Run();
+		void CheckHotkeys();
+		bool IsHotkeyActive(int keyCode);
+		// drops the command if the render thread hasn't taken the earlier ones yet
+		void Post(HotkeyCommand command);
+	};
+}
@@ -0,0 +1,77 @@
+#include "LensDistortion.h"
+#include <algorithm>
+#include <cmath>
+
+namespace vr {
+	bool BuildDistortionMap(DistortionFunction distortion, EVREye eye, uint32_t outputWidth, uint32_t outputHeight, DistortionMap &map) {
+		map.width = (outputWidth + DISTORTION_MAP_SPACING - 1) / DISTORTION_MAP_SPACING + 1;
+		map.height = (outputHeight + DISTORTION_MAP_SPACING - 1) / DISTORTION_MAP_SPACING + 1;
+		size_t planeSize = (size_t)map.width * map.height * 2;
+		map.coords.resize(planeSize * 3);
+		for (uint32_t y = 0; y < map.height; ++y) {
+			for (uint32_t x = 0; x < map.width; ++x) {
+				float coords[6];
+				if (!distortion(eye, x / float(map.width - 1), y / float(map.height - 1), coords)) {
+					return false;
+				}
+				size_t index = ((size_t)y * map.width + x) * 2;
+				for (int ch = 0; ch < 3; ++ch) {
+					map.coords[ch * planeSize + index] = coords[ch * 2];
+					map.coords[ch * planeSize + index + 1] = coords[ch * 2 + 1];
+				}
+			}
+		}
+		return true;
+	}
+
+	void GetDistortionMapTransform(const DistortionMap &map, float transform[4]) {
+		transform[0] = (map.width - 1) / float(map.width);
+		transform[1] = (map.height - 1) / float(map.height);
+		transform[2] = .5f / map.width;
+		transform[3] = .5f / map.height;
+	}
+
+	void SampleDistortionMap(const DistortionMap &map, float u, float v, float coords[6]) {
+		float transform[4];
+		GetDistortionMapTransform(map, transform);
+		float tx = (u * transform[0] + transform[2]) * map.width - .5f;
+		float ty = (v * transform[1] + transform[3]) * map.height - .5f;
+		float fx = std::floor(tx);
+		float fy = std::floor(ty);
+		float wx = tx - fx;
+		float wy = ty - fy;
+		uint32_t x0 = (uint32_t)(std::min)((std::max)((int)fx, 0), (int)map.width - 1);
+		uint32_t y0 = (uint32_t)(std::min)((std::max)((int)fy, 0), (int)map.height - 1);
+		uint32_t x1 = (uint32_t)(std::min)((std::max)((int)fx + 1, 0), (int)map.width - 1);
+		uint32_t y1 = (uint32_t)(std::min)((std::max)((int)fy + 1, 0), (int)map.height - 1);
+		for (int ch = 0; ch < 3; ++ch) {
+			const float *plane = map.Plane(ch);
+			for (int i = 0; i < 2; ++i) {
+				float a = plane[(y0 * map.width + x0) * 2 + i];
+				float b = plane[(y0 * map.width + x1) * 2 + i];
+				float c = plane[(y1 * map.width + x0) * 2 + i];
+				float d = plane[(y1 * map.width + x1) * 2 + i];
+				float top = a + (b - a) * wx;
+				float bottom = c + (d - c) * wx;
+				coords[ch * 2 + i] = top + (bottom - top) * wy;
+			}
+		}
+	}
+
+	bool RadialDistortion(EVREye eye, float u, float v, float coords[6]) {
+		// lens centres sit a little towards the nose
+		float centreU = eye == Eye_Left ? .53f : .47f;
+		float centreV = .5f;
+		float dx = u - centreU;
+		float dy = v - centreV;
+		// squared distance from the centre, 1 at the middle of the edges
+		float r2 = 4 * (dx * dx + dy * dy);
+		float scale = .8f * (1 + .25f * r2 + .1f * r2 * r2);
+		const float channelScale[3] = { .99f, 1.f, 1.015f };
+		for (int ch = 0; ch < 3; ++ch) {
+			coords[ch * 2] = centreU + dx * scale * channelScale[ch];
+			coords[ch * 2 + 1] = centreV + dy * scale * channelScale[ch];
+		}
+		return true;
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "openvr.h"
+
+// Lens distortion as the compositor applies it: every pixel of the panel image samples the red,
+// green and blue channels of the submitted eye image at slightly different positions. When the
+// upscaler produces the panel image directly, it samples the game's texture once per channel at
+// those positions, so the image is resampled once instead of twice and the compositor skips its own
+// distortion pass.
+namespace vr {
+	// where the given eye's distorted image samples each channel of the undistorted one, as
+	// IVRSystem::ComputeDistortion reports it: red, green and blue u,v in the eye's viewport, which may
+	// fall outside [0, 1] where the panel sees past the rendered image. Returns false on failure.
+	typedef bool (*DistortionFunction)(EVREye eye, float u, float v, float coords[6]);
+
+	// output pixels between the points of a distortion map in either direction
+	const uint32_t DISTORTION_MAP_SPACING = 16;
+
+	// The distortion function sampled on a coarse grid over the output, so that the shaders can
+	// interpolate it with a bilinear sampler. Point (x, y) lies at (x / (width - 1), y / (height - 1)),
+	// so the outermost points sit on the edges of the output and nothing is clamped; see
+	// DistortionConstants::mapTransform for where the shaders sample the texture.
+	struct DistortionMap {
+		uint32_t width = 0;
+		uint32_t height = 0;
+		// one plane of u,v pairs per channel, red first, rows top to bottom; one slice each of the
+		// texture array the shaders sample
+		std::vector<float> coords;
+
+		const float * Plane(int channel) const { return &coords[(size_t)channel * width * height * 2]; }
+	};
+
+	// samples the function for an output of the given size; returns false if it fails anywhere
+	bool BuildDistortionMap(DistortionFunction distortion, EVREye eye, uint32_t outputWidth, uint32_t outputHeight, DistortionMap &map);
+	// scale and offset from output texture coordinates to those of the map's texel centres
+	void GetDistortionMapTransform(const DistortionMap &map, float transform[4]);
+	// what a bilinear, clamping sampler returns from the map at the given output position
+	void SampleDistortionMap(const DistortionMap &map, float u, float v, float coords[6]);
+
+	// A radial model with a little chromatic aberration, close to what common headsets report. The
+	// offline tools use it in place of the runtime.
+	bool RadialDistortion(EVREye eye, float u, float v, float coords[6]);
+}
@@ -0,0 +1,401 @@
+#include "Logging.h"
+#ifndef OPENVR_MOD_LOG_TO_CONSOLE
+#include "Config.h"
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace {
+	std::atomic<uint8_t> minLogLevel { (uint8_t)LogLevel::Info };
+	std::atomic<bool> writerCreated { false };
+
+	int64_t CurrentTimeMs() {
+		using namespace std::chrono;
+		return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+	}
+
+	uint32_t CurrentThreadIndex() {
+		static std::atomic<uint32_t> nextIndex { 0 };
+		static thread_local uint32_t index = nextIndex++;
+		return index;
+	}
+
+	const char * LevelName(LogLevel level) {
+		switch (level) {
+		case LogLevel::Debug: return "DEBUG";
+		case LogLevel::Info: return "INFO ";
+		case LogLevel::Warning: return "WARN ";
+		case LogLevel::Error: return "ERROR";
+		default: return "?????";
+		}
+	}
+
+	struct LogRecord {
+		std::atomic<uint32_t> sequence;
+		LogLevel level;
+		uint16_t length;
+		uint32_t threadIndex;
+		int64_t timestampMs;
+		char text[LogLine::MAX_LENGTH];
+	};
+
+	// Bounded lock-free multi-producer single-consumer queue. Producers claim a slot with a single CAS
+	// and publish it through the slot's sequence number; when the queue is full the line is dropped
+	// and counted instead of waiting for the writer to catch up.
+	class LogQueue {
+	public:
+		static const uint32_t CAPACITY = 1024;
+
+		LogQueue() {
+			for (uint32_t i = 0; i < CAPACITY; ++i) {
+				records[i].sequence.store(i, std::memory_order_relaxed);
+			}
+		}
+
+		bool TryPush(LogLevel level, const char *text, uint16_t length, int64_t timestampMs, uint32_t threadIndex) {
+			uint32_t pos = enqueuePos.load(std::memory_order_relaxed);
+			for (;;) {
+				LogRecord &record = records[pos & (CAPACITY - 1)];
+				uint32_t seq = record.sequence.load(std::memory_order_acquire);
+				int32_t diff = (int32_t)(seq - pos);
+				if (diff == 0) {
+					if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+						record.level = level;
+						record.length = length;
+						record.threadIndex = threadIndex;
+						record.timestampMs = timestampMs;
+						memcpy(record.text, text, length);
+						record.sequence.store(pos + 1, std::memory_order_release);
+						return true;
+					}
+				} else if (diff < 0) {
+					dropped.fetch_add(1, std::memory_order_relaxed);
+					return false;
+				} else {
+					pos = enqueuePos.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		// must only be called by one consumer at a time
+		LogRecord * Peek() {
+			LogRecord &record = records[dequeuePos & (CAPACITY - 1)];
+			uint32_t seq = record.sequence.load(std::memory_order_acquire);
+			if ((int32_t)(seq - (dequeuePos + 1)) < 0) {
+				return nullptr;
+			}
+			return &record;
+		}
+
+		void Pop(LogRecord *record) {
+			record->sequence.store(dequeuePos + CAPACITY, std::memory_order_release);
+			++dequeuePos;
+		}
+
+		uint32_t TakeDroppedCount() {
+			return dropped.exchange(0, std::memory_order_relaxed);
+		}
+
+	private:
+		LogRecord records[CAPACITY];
+		// keep producer and consumer positions on separate cache lines
+		std::atomic<uint32_t> enqueuePos { 0 };
+		char padding[60];
+		uint32_t dequeuePos = 0;
+		std::atomic<uint32_t> dropped { 0 };
+	};
+
+	class LogWriter {
+	public:
+		LogWriter() {
+			// the offline tools log to the console instead of a file next to the DLL
+#ifndef OPENVR_MOD_LOG_TO_CONSOLE
+			try {
+				file.open(GetDllPath() + L"\\openvr_mod.log");
+			} catch (...) {}
+#endif
+			out = file.is_open() ? &file : &std::cout;
+			writerCreated = true;
+			writerThread = std::thread([this]() { Run(); });
+			// the writer is never joined: it must not keep the process alive or deadlock on the loader lock
+			// during DLL unload; pending lines are written synchronously by FlushLog() at shutdown instead,
+			// or on a best effort basis when the process exits
+			writerThread.detach();
+		}
+
+		static LogWriter & Instance() {
+			// intentionally leaked, see above
+			static LogWriter *instance = new LogWriter;
+			return *instance;
+		}
+
+		void Push(LogLevel level, const char *text, uint16_t length) {
+			queue.TryPush(level, text, length, CurrentTimeMs(), CurrentThreadIndex());
+		}
+
+		void Drain() {
+			std::lock_guard<std::mutex> lock (writeMutex);
+			DrainLocked();
+		}
+
+		// for the exit path: the writer thread may have been terminated while holding the mutex, and
+		// waiting for it would deadlock under the loader lock, so give up instead
+		void TryDrain() {
+			std::unique_lock<std::mutex> lock (writeMutex, std::try_to_lock);
+			if (lock.owns_lock()) {
+				DrainLocked();
+			}
+		}
+
+	private:
+		LogQueue queue;
+		std::mutex writeMutex;
+		std::ofstream file;
+		std::ostream *out;
+		std::thread writerThread;
+
+		void DrainLocked() {
+			bool wroteAnything = false;
+			while (LogRecord *record = queue.Peek()) {
+				WriteRecord(*record);
+				queue.Pop(record);
+				wroteAnything = true;
+			}
+			uint32_t dropped = queue.TakeDroppedCount();
+			if (dropped > 0) {
+				*out << "(" << dropped << " log lines dropped, log queue was full)\n";
+				wroteAnything = true;
+			}
+			if (wroteAnything) {
+				out->flush();
+			}
+		}
+
+		void Run() {
+			for (;;) {
+				Drain();
+				std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			}
+		}
+
+		void WriteRecord(const LogRecord &record) {
+			std::time_t seconds = record.timestampMs / 1000;
+			std::tm local = *std::localtime(&seconds);
+			char prefix[48];
+			snprintf(prefix, sizeof(prefix), "[%02d:%02d:%02d.%03d] [%s] [T%u] ", local.tm_hour, local.tm_min, local.tm_sec,
+				(int)(record.timestampMs % 1000), LevelName(record.level), record.threadIndex);
+			*out << prefix;
+			out->write(record.text, record.length);
+			*out << '\n';
+		}
+	};
+
+	// makes sure that lines queued right before the process exits still make it into the file
+	struct LogFlushAtExit {
+		~LogFlushAtExit() {
+			if (writerCreated) {
+				LogWriter::Instance().TryDrain();
+			}
+		}
+	} logFlushAtExit;
+}
+
+void SetLogLevel(LogLevel level) {
+	minLogLevel.store((uint8_t)level, std::memory_order_relaxed);
+}
+
+bool IsLogLevelEnabled(LogLevel level) {
+	return (uint8_t)level >= minLogLevel.load(std::memory_order_relaxed);
+}
+
+void FlushLog() {
+	LogWriter::Instance().Drain();
+}
+
+bool LogRateLimit::Allow(uint32_t &suppressedBefore) {
+	int64_t now = CurrentTimeMs();
+	int64_t nextAllowed = nextAllowedMs.load(std::memory_order_relaxed);
+	if (now < nextAllowed || !nextAllowedMs.compare_exchange_strong(nextAllowed, now + intervalMs, std::memory_order_relaxed)) {
+		suppressed.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	suppressedBefore = suppressed.exchange(0, std::memory_order_relaxed);
+	return true;
+}
+
+LogLine::LogLine(LogLevel level, bool enabled) : level(level), enabled(enabled) {}
+
+LogLine::LogLine(LogLine &&other) : level(other.level), enabled(other.enabled), hex(other.hex), length(other.length) {
+	memcpy(text, other.text, length);
+	other.enabled = false;
+}
+
+LogLine::~LogLine() {
+	if (!enabled) {
+		return;
+	}
+	// lines are terminated by the writer
+	while (length > 0 && text[length - 1] == '\n') {
+		--length;
+	}
+	LogWriter::Instance().Push(level, text, length);
+}
+
+void LogLine::Append(const char *str, size_t len) {
+	if (!enabled) {
+		return;
+	}
+	size_t toCopy = (std::min)(len, MAX_LENGTH - length);
+	memcpy(text + length, str, toCopy);
+	length += (uint16_t)toCopy;
+}
+
+void LogLine::AppendFormatted(const char *fmt, ...) {
+	if (!enabled) {
+		return;
+	}
+	char buf[64];
+	va_list args;
+	va_start(args, fmt);
+	int len = vsnprintf(buf, sizeof(buf), fmt, args);
+	va_end(args);
+	if (len > 0) {
+		Append(buf, (std::min)((size_t)len, sizeof(buf) - 1));
+	}
+}
+
+void LogLine::AppendInteger(unsigned long long value, bool negative) {
+	// formatted by hand, vsnprintf would dominate the cost of a typical log line
+	char buf[24];
+	char *end = buf + sizeof(buf);
+	char *p = end;
+	if (hex) {
+		do {
+			*--p = "0123456789abcdef"[value & 0xf];
+			value >>= 4;
+		} while (value != 0);
+	} else {
+		do {
+			*--p = char('0' + value % 10);
+			value /= 10;
+		} while (value != 0);
+		if (negative) {
+			*--p = '-';
+		}
+	}
+	Append(p, end - p);
+}
+
+LogLine & LogLine::operator<<(const char *str) {
+	if (str == nullptr) {
+		str = "(null)";
+	}
+	Append(str, strlen(str));
+	return *this;
+}
+
+LogLine & LogLine::operator<<(const std::string &str) {
+	Append(str.data(), str.size());
+	return *this;
+}
+
+LogLine & LogLine::operator<<(char c) {
+	Append(&c, 1);
+	return *this;
+}
+
+LogLine & LogLine::operator<<(bool value) {
+	return *this << (value ? "true" : "false");
+}
+
+LogLine & LogLine::operator<<(int value) {
+	if (hex) {
+		// two's complement of the value's own width, as std::ostream prints it; HRESULTs read as 80070057
+		AppendInteger((unsigned int)value, false);
+	} else {
+		AppendInteger(value < 0 ? 0ull - (unsigned long long)value : (unsigned long long)value, value < 0);
+	}
+	return *this;
+}
+
+LogLine & LogLine::operator<<(unsigned int value) {
+	AppendInteger(value, false);
+	return *this;
+}
+
+LogLine & LogLine::operator<<(long value) {
+	if (hex) {
+		AppendInteger((unsigned long)value, false);
+	} else {
+		AppendInteger(value < 0 ? 0ull - (unsigned long long)value : (unsigned long long)value, value < 0);
+	}
+	return *this;
+}
+
+LogLine & LogLine::operator<<(unsigned long value) {
+	AppendInteger(value, false);
+	return *this;
+}
+
+LogLine & LogLine::operator<<(long long value) {
+	if (hex) {
+		AppendInteger((unsigned long long)value, false);
+	} else {
+		AppendInteger(value < 0 ? 0ull - (unsigned long long)value : (unsigned long long)value, value < 0);
+	}
+	return *this;
+}
+
+LogLine & LogLine::operator<<(unsigned long long value) {
+	AppendInteger(value, false);
+	return *this;
+}
+
+LogLine & LogLine::operator<<(double value) {
+	AppendFormatted("%g", value);
+	return *this;
+}
+
+LogLine & LogLine::operator<<(const void *ptr) {
+	AppendFormatted("%p", ptr);
+	return *this;
+}
+
+LogLine & LogLine::operator<<(std::ios_base& (*manipulator)(std::ios_base&)) {
+	if (manipulator == static_cast<std::ios_base& (*)(std::ios_base&)>(std::hex)) {
+		hex = true;
+	} else if (manipulator == static_cast<std::ios_base& (*)(std::ios_base&)>(std::dec)) {
+		hex = false;
+	}
+	return *this;
+}
+
+LogLine & LogLine::operator<<(std::ostream& (*manipulator)(std::ostream&)) {
+	return *this;
+}
+
+LogLine Log(LogLevel level) {
+	return LogLine(level, IsLogLevelEnabled(level));
+}
+
+LogLine Log(LogLevel level, LogRateLimit &limit) {
+	uint32_t suppressedBefore = 0;
+	if (!IsLogLevelEnabled(level) || !limit.Allow(suppressedBefore)) {
+		return LogLine(level, false);
+	}
+	LogLine line (level, true);
+	if (suppressedBefore > 0) {
+		line << "(" << suppressedBefore << " similar lines suppressed) ";
+	}
+	return line;
+}
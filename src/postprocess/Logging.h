@@ -0,0 +1,76 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+enum class LogLevel : uint8_t {
+	Debug,
+	Info,
+	Warning,
+	Error,
+};
+
+void SetLogLevel(LogLevel level);
+bool IsLogLevelEnabled(LogLevel level);
+// blocks until every line queued so far has been written to the log file
+void FlushLog();
+
+// Limits how often a single call site may produce log output. Keep one as a function-local static
+// next to the call site and pass it to Log(). Lines dropped by the limit are counted and reported
+// alongside the next line that passes.
+class LogRateLimit {
+public:
+	explicit LogRateLimit(uint32_t intervalMs) : intervalMs(intervalMs) {}
+	bool Allow(uint32_t &suppressedBefore);
+
+private:
+	const uint32_t intervalMs;
+	std::atomic<int64_t> nextAllowedMs { 0 };
+	std::atomic<uint32_t> suppressed { 0 };
+};
+
+// A single log line. Text is formatted into a fixed buffer on the caller's stack and handed to the
+// background writer thread when the line goes out of scope, so logging never touches the disk or
+// allocates on the calling thread.
+class LogLine {
+public:
+	static const size_t MAX_LENGTH = 232;
+
+	LogLine(LogLevel level, bool enabled);
+	LogLine(LogLine &&other);
+	~LogLine();
+
+	LogLine& operator<<(const char *str);
+	LogLine& operator<<(const std::string &str);
+	LogLine& operator<<(char c);
+	LogLine& operator<<(bool value);
+	LogLine& operator<<(int value);
+	LogLine& operator<<(unsigned int value);
+	LogLine& operator<<(long value);
+	LogLine& operator<<(unsigned long value);
+	LogLine& operator<<(long long value);
+	LogLine& operator<<(unsigned long long value);
+	LogLine& operator<<(double value);
+	LogLine& operator<<(const void *ptr);
+	// std::hex and std::dec switch integer formatting, std::endl is accepted but does not flush
+	LogLine& operator<<(std::ios_base& (*manipulator)(std::ios_base&));
+	LogLine& operator<<(std::ostream& (*manipulator)(std::ostream&));
+
+private:
+	LogLine(const LogLine&) = delete;
+	LogLine& operator=(const LogLine&) = delete;
+
+	void Append(const char *str, size_t len);
+	void AppendInteger(unsigned long long value, bool negative);
+	void AppendFormatted(const char *fmt, ...);
+
+	LogLevel level;
+	bool enabled;
+	bool hex = false;
+	uint16_t length = 0;
+	char text[MAX_LENGTH];
+};
+
+LogLine Log(LogLevel level = LogLevel::Info);
+LogLine Log(LogLevel level, LogRateLimit &limit);
@@ -0,0 +1,329 @@
+#include "PerformanceHud.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "Logging.h"
+#include "PostProcessGraph.h"
+#include "Tracing.h"
+
+namespace vr {
+	void CheckResult(const std::string &operation, HRESULT result);
+
+	namespace {
+		// 0xAABBGGRR, so that the bytes are RGBA in memory
+		const uint32_t BACKGROUND = 0xc0181818;
+		const uint32_t TEXT = 0xffffffff;
+		const uint32_t LABEL = 0xffa0a0a0;
+		const uint32_t IN_BUDGET = 0xff40c040;
+		const uint32_t OVER_BUDGET = 0xff4040e0;
+		const uint32_t MOD_GPU = 0xffe0c040;
+		const uint32_t BUDGET_LINE = 0xff40e0e0;
+
+		const int GLYPH_WIDTH = 5;
+		const int GLYPH_HEIGHT = 7;
+		const int GLYPH_SCALE = 2;
+		const int CHAR_ADVANCE = (GLYPH_WIDTH + 1) * GLYPH_SCALE;
+		const int LINE_HEIGHT = (GLYPH_HEIGHT + 2) * GLYPH_SCALE;
+		const int MARGIN = 8;
+
+		// 5x7 glyphs of the characters from ' ' to 'Z', one row per byte with the leftmost pixel in bit 4;
+		// lower case is drawn as upper case, anything else as a space
+		const uint8_t FONT[][GLYPH_HEIGHT] = {
+			{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // ' '
+			{ 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04 }, // '!'
+			{ 0x0a, 0x0a, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '"'
+			{ 0x0a, 0x0a, 0x1f, 0x0a, 0x1f, 0x0a, 0x0a }, // '#'
+			{ 0x04, 0x0f, 0x14, 0x0e, 0x05, 0x1e, 0x04 }, // '$'
+			{ 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 }, // '%'
+			{ 0x0c, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0d }, // '&'
+			{ 0x04, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '''
+			{ 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02 }, // '('
+			{ 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08 }, // ')'
+			{ 0x00, 0x04, 0x15, 0x0e, 0x15, 0x04, 0x00 }, // '*'
+			{ 0x00, 0x04, 0x04, 0x1f, 0x04, 0x04, 0x00 }, // '+'
+			{ 0x00, 0x00, 0x00, 0x00, 0x0c, 0x04, 0x08 }, // ','
+			{ 0x00, 0x00, 0x00, 0x1f, 0x00, 0x00, 0x00 }, // '-'
+			{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x0c }, // '.'
+			{ 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 }, // '/'
+			{ 0x0e, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0e }, // '0'
+			{ 0x04, 0x0c, 0x04, 0x04, 0x04, 0x04, 0x0e }, // '1'
+			{ 0x0e, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1f }, // '2'
+			{ 0x1f, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0e }, // '3'
+			{ 0x02, 0x06, 0x0a, 0x12, 0x1f, 0x02, 0x02 }, // '4'
+			{ 0x1f, 0x10, 0x1e, 0x01, 0x01, 0x11, 0x0e }, // '5'
+			{ 0x06, 0x08, 0x10, 0x1e, 0x11, 0x11, 0x0e }, // '6'
+			{ 0x1f, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 }, // '7'
+			{ 0x0e, 0x11, 0x11, 0x0e, 0x11, 0x11, 0x0e }, // '8'
+			{ 0x0e, 0x11, 0x11, 0x0f, 0x01, 0x02, 0x0c }, // '9'
+			{ 0x00, 0x0c, 0x0c, 0x00, 0x0c, 0x0c, 0x00 }, // ':'
+			{ 0x00, 0x0c, 0x0c, 0x00, 0x0c, 0x04, 0x08 }, // ';'
+			{ 0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02 }, // '<'
+			{ 0x00, 0x00, 0x1f, 0x00, 0x1f, 0x00, 0x00 }, // '='
+			{ 0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08 }, // '>'
+			{ 0x0e, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 }, // '?'
+			{ 0x0e, 0x11, 0x01, 0x0d, 0x15, 0x15, 0x0e }, // '@'
+			{ 0x0e, 0x11, 0x11, 0x11, 0x1f, 0x11, 0x11 }, // 'A'
+			{ 0x1e, 0x11, 0x11, 0x1e, 0x11, 0x11, 0x1e }, // 'B'
+			{ 0x0e, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0e }, // 'C'
+			{ 0x1c, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1c }, // 'D'
+			{ 0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x1f }, // 'E'
+			{ 0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x10 }, // 'F'
+			{ 0x0e, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0f }, // 'G'
+			{ 0x11, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11 }, // 'H'
+			{ 0x0e, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0e }, // 'I'
+			{ 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0c }, // 'J'
+			{ 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 }, // 'K'
+			{ 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1f }, // 'L'
+			{ 0x11, 0x1b, 0x15, 0x15, 0x11, 0x11, 0x11 }, // 'M'
+			{ 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 }, // 'N'
+			{ 0x0e, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e }, // 'O'
+			{ 0x1e, 0x11, 0x11, 0x1e, 0x10, 0x10, 0x10 }, // 'P'
+			{ 0x0e, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0d }, // 'Q'
+			{ 0x1e, 0x11, 0x11, 0x1e, 0x14, 0x12, 0x11 }, // 'R'
+			{ 0x0f, 0x10, 0x10, 0x0e, 0x01, 0x01, 0x1e }, // 'S'
+			{ 0x1f, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 }, // 'T'
+			{ 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e }, // 'U'
+			{ 0x11, 0x11, 0x11, 0x11, 0x11, 0x0a, 0x04 }, // 'V'
+			{ 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0a }, // 'W'
+			{ 0x11, 0x11, 0x0a, 0x04, 0x0a, 0x11, 0x11 }, // 'X'
+			{ 0x11, 0x11, 0x11, 0x0a, 0x04, 0x04, 0x04 }, // 'Y'
+			{ 0x1f, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1f }, // 'Z'
+		};
+		const int FONT_FIRST = ' ';
+		const int FONT_LAST = 'Z';
+
+		// placement relative to the HMD, in meters: below the center of view, far enough to focus on
+		const float OVERLAY_WIDTH = 0.3f;
+		const float OVERLAY_DOWN = 0.22f;
+		const float OVERLAY_DISTANCE = 0.8f;
+	}
+
+	void PerformanceHud::SetInterfaces(IVROverlay *overlay, IVRCompositor *compositor, float displayFrequency) {
+		DestroyOverlay();
+		texture.Reset();
+		device.Reset();
+		this->overlay = overlay;
+		this->compositor = compositor;
+		frameBudgetMs = displayFrequency > 0 ? 1000.f / displayFrequency : 0;
+		failed = false;
+		hasLastFrame = false;
+		lastStatsTime = Clock::time_point();
+		reprojectedPercent = 0;
+	}
+
+	void PerformanceHud::Update(ID3D11Device *device, const telemetry::Snapshot &stats) {
+		Clock::time_point now = Clock::now();
+		if (hasLastFrame) {
+			frameMs[nextFrame] = std::chrono::duration<float, std::milli>(now - lastFrame).count();
+			gpuMs[nextFrame] = stats.gpuMs;
+			nextFrame = (nextFrame + 1) % GRAPH_FRAMES;
+		}
+		lastFrame = now;
+		hasLastFrame = true;
+
+		if (visible && now - lastDraw < std::chrono::milliseconds(1000 / UPDATES_PER_SECOND)) {
+			return;
+		}
+		if (handle == k_ulOverlayHandleInvalid && !CreateOverlay()) {
+			return;
+		}
+
+		TRACE_SCOPE("PerformanceHud::Update");
+		lastDraw = now;
+		try {
+			if (this->device.Get() != device) {
+				CreateTexture(device);
+			}
+			UpdateReprojection(now);
+			Draw(stats);
+
+			ComPtr<ID3D11DeviceContext> context;
+			device->GetImmediateContext(context.GetAddressOf());
+			context->UpdateSubresource(texture.Get(), 0, nullptr, pixels.data(), WIDTH * sizeof(uint32_t), 0);
+
+			Texture_t overlayTexture { texture.Get(), TextureType_DirectX, ColorSpace_Auto };
+			EVROverlayError error = overlay->SetOverlayTexture(handle, &overlayTexture);
+			if (error != VROverlayError_None) {
+				Log(LogLevel::Error) << "Failed to set the HUD texture: " << overlay->GetOverlayErrorNameFromEnum(error);
+				DestroyOverlay();
+				failed = true;
+				return;
+			}
+			if (!visible) {
+				overlay->ShowOverlay(handle);
+				visible = true;
+			}
+		} catch (...) {
+			Log(LogLevel::Error) << "Failed to update the HUD, disabling it";
+			DestroyOverlay();
+			failed = true;
+		}
+	}
+
+	void PerformanceHud::Hide() {
+		if (visible) {
+			overlay->HideOverlay(handle);
+			visible = false;
+		}
+		hasLastFrame = false;
+	}
+
+	bool PerformanceHud::CreateOverlay() {
+		if (overlay == nullptr || failed) {
+			return false;
+		}
+		EVROverlayError error = overlay->CreateOverlay("openvr_mod.hud", "OpenVR mod performance", &handle);
+		if (error != VROverlayError_None) {
+			Log(LogLevel::Error) << "Could not create the HUD overlay: " << overlay->GetOverlayErrorNameFromEnum(error);
+			handle = k_ulOverlayHandleInvalid;
+			failed = true;
+			return false;
+		}
+
+		HmdMatrix34_t transform = {{
+			{ 1, 0, 0, 0 },
+			{ 0, 1, 0, -OVERLAY_DOWN },
+			{ 0, 0, 1, -OVERLAY_DISTANCE },
+		}};
+		overlay->SetOverlayTransformTrackedDeviceRelative(handle, k_unTrackedDeviceIndex_Hmd, &transform);
+		overlay->SetOverlayWidthInMeters(handle, OVERLAY_WIDTH);
+		Log() << "Created the HUD overlay";
+		return true;
+	}
+
+	void PerformanceHud::DestroyOverlay() {
+		if (handle != k_ulOverlayHandleInvalid && overlay != nullptr) {
+			overlay->DestroyOverlay(handle);
+		}
+		handle = k_ulOverlayHandleInvalid;
+		visible = false;
+	}
+
+	void PerformanceHud::CreateTexture(ID3D11Device *device) {
+		D3D11_TEXTURE2D_DESC td;
+		td.Width = WIDTH;
+		td.Height = HEIGHT;
+		td.MipLevels = 1;
+		td.ArraySize = 1;
+		td.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		td.SampleDesc.Count = 1;
+		td.SampleDesc.Quality = 0;
+		td.Usage = D3D11_USAGE_DEFAULT;
+		td.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		td.CPUAccessFlags = 0;
+		td.MiscFlags = 0;
+		texture.Reset();
+		CheckResult("Creating HUD texture", device->CreateTexture2D(&td, nullptr, texture.GetAddressOf()));
+		this->device = device;
+		pixels.resize(WIDTH * HEIGHT);
+	}
+
+	void PerformanceHud::UpdateReprojection(Clock::time_point now) {
+		if (compositor == nullptr || now - lastStatsTime < std::chrono::seconds(1)) {
+			return;
+		}
+		Compositor_CumulativeStats stats;
+		compositor->GetCumulativeStats(&stats, sizeof(stats));
+		uint32_t presents = stats.m_nNumFramePresents - lastStats.m_nNumFramePresents;
+		uint32_t reprojected = stats.m_nNumReprojectedFrames - lastStats.m_nNumReprojectedFrames;
+		if (lastStatsTime != Clock::time_point() && presents > 0) {
+			reprojectedPercent = 100.f * reprojected / presents;
+		}
+		lastStats = stats;
+		lastStatsTime = now;
+	}
+
+	void PerformanceHud::Draw(const telemetry::Snapshot &stats) {
+		std::fill(pixels.begin(), pixels.end(), BACKGROUND);
+		char buf[64];
+		int y = MARGIN;
+
+		snprintf(buf, sizeof(buf), " SCALE %.2f  SHARP %.2f  RADIUS %.2f", stats.renderScale, stats.sharpness, stats.radius);
+		DrawText(DrawText(MARGIN, y, stats.algorithm == telemetry::ALGORITHM_NIS ? "NIS" : "FSR", TEXT), y, buf, LABEL);
+		y += LINE_HEIGHT;
+
+		snprintf(buf, sizeof(buf), "%ux%u -> %ux%u", stats.inputWidth, stats.inputHeight, stats.outputWidth, stats.outputHeight);
+		DrawText(MARGIN, y, buf, LABEL);
+		y += LINE_HEIGHT;
+
+		float sumMs = 0, maxMs = 0;
+		for (float ms : frameMs) {
+			sumMs += ms;
+			maxMs = (std::max)(maxMs, ms);
+		}
+		snprintf(buf, sizeof(buf), "FRAME %.1f MS  MAX %.1f  REPROJ %.1f%%", sumMs / GRAPH_FRAMES, maxMs, reprojectedPercent);
+		DrawText(MARGIN, y, buf, TEXT);
+		y += LINE_HEIGHT;
+
+		snprintf(buf, sizeof(buf), "GPU %.2f MS  CPU %.2f MS", stats.gpuMs, stats.cpuApplyMs);
+		DrawText(MARGIN, y, buf, TEXT);
+		y += LINE_HEIGHT;
+
+		int x = MARGIN;
+		for (uint32_t i = 0; i < stats.stageCount; ++i) {
+			snprintf(buf, sizeof(buf), "%s%s %.2f  ", PipelineStageName((PipelineStage)stats.stages[i]),
+				stats.stageFusedGrain[i] ? "+GRAIN" : "", stats.stageGpuMs[i]);
+			int width = (int)strlen(buf) * CHAR_ADVANCE;
+			if (x > MARGIN && x + width > (int)WIDTH) {
+				x = MARGIN;
+				y += LINE_HEIGHT;
+			}
+			x = DrawText(x, y, buf, LABEL);
+		}
+		y += LINE_HEIGHT;
+
+		DrawGraph(y + MARGIN, HEIGHT - MARGIN);
+	}
+
+	void PerformanceHud::DrawGraph(int top, int bottom) {
+		int height = bottom - top;
+		if (height <= 0) {
+			return;
+		}
+		// twice the budget fits, so frames that were missed once stand out
+		float scaleMs = frameBudgetMs > 0 ? 2 * frameBudgetMs : 25.f;
+		int barWidth = WIDTH / GRAPH_FRAMES;
+		for (uint32_t i = 0; i < GRAPH_FRAMES; ++i) {
+			uint32_t frame = (nextFrame + i) % GRAPH_FRAMES;
+			int x = i * barWidth;
+			int frameHeight = (int)(height * (std::min)(1.f, frameMs[frame] / scaleMs));
+			int gpuHeight = (int)(height * (std::min)(1.f, gpuMs[frame] / scaleMs));
+			bool overBudget = frameBudgetMs > 0 && frameMs[frame] > frameBudgetMs * 1.05f;
+			FillRect(x, bottom - frameHeight, barWidth - 1, frameHeight, overBudget ? OVER_BUDGET : IN_BUDGET);
+			FillRect(x, bottom - gpuHeight, barWidth - 1, gpuHeight, MOD_GPU);
+		}
+		if (frameBudgetMs > 0) {
+			FillRect(0, bottom - height / 2, WIDTH, 1, BUDGET_LINE);
+		}
+	}
+
+	void PerformanceHud::FillRect(int x, int y, int width, int height, uint32_t color) {
+		int x0 = (std::max)(x, 0), x1 = (std::min)(x + width, (int)WIDTH);
+		int y0 = (std::max)(y, 0), y1 = (std::min)(y + height, (int)HEIGHT);
+		for (int row = y0; row < y1; ++row) {
+			for (int column = x0; column < x1; ++column) {
+				pixels[row * WIDTH + column] = color;
+			}
+		}
+	}
+
+	int PerformanceHud::DrawText(int x, int y, const char *text, uint32_t color) {
+		for (; *text != 0; ++text, x += CHAR_ADVANCE) {
+			int c = toupper((unsigned char)*text);
+			if (c < FONT_FIRST || c > FONT_LAST) {
+				continue;
+			}
+			const uint8_t *glyph = FONT[c - FONT_FIRST];
+			for (int row = 0; row < GLYPH_HEIGHT; ++row) {
+				for (int column = 0; column < GLYPH_WIDTH; ++column) {
+					if (glyph[row] & (0x10 >> column)) {
+						FillRect(x + column * GLYPH_SCALE, y + row * GLYPH_SCALE, GLYPH_SCALE, GLYPH_SCALE, color);
+					}
+				}
+			}
+		}
+		return x;
+	}
+}
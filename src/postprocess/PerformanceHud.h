@@ -0,0 +1,72 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include "openvr.h"
+#include "Telemetry.h"
+
+namespace vr {
+	using Microsoft::WRL::ComPtr;
+
+	// Shows the mod's live statistics in the headset, on an overlay fixed below the center of view:
+	// algorithm, render scale and resolutions, frame and post-processing times, the GPU time of each
+	// stage, the compositor's reprojection rate, and a graph of the recent frame times against the
+	// frame budget. The HUD is drawn on the CPU into a small texture on the game's device and handed
+	// to the overlay only a few times per second, so it costs next to nothing in the frames between.
+	class PerformanceHud {
+	public:
+		// interfaces of the current version, queried directly from the runtime; nullptr at shutdown,
+		// which destroys the overlay
+		void SetInterfaces(IVROverlay *overlay, IVRCompositor *compositor, float displayFrequency);
+
+		// must be called at every Submit of the left eye while the HUD is enabled
+		void Update(ID3D11Device *device, const telemetry::Snapshot &stats);
+		void Hide();
+
+	private:
+		typedef std::chrono::steady_clock Clock;
+
+		static const uint32_t WIDTH = 512;
+		static const uint32_t HEIGHT = 256;
+		static const uint32_t GRAPH_FRAMES = 128;
+		static const int UPDATES_PER_SECOND = 4;
+
+		IVROverlay *overlay = nullptr;
+		IVRCompositor *compositor = nullptr;
+		float frameBudgetMs = 0;
+		VROverlayHandle_t handle = k_ulOverlayHandleInvalid;
+		// set when the overlay could not be created, so that it isn't tried at every frame
+		bool failed = false;
+		bool visible = false;
+
+		ComPtr<ID3D11Device> device;
+		ComPtr<ID3D11Texture2D> texture;
+		// RGBA8, drawn on the CPU and uploaded as a whole
+		std::vector<uint32_t> pixels;
+
+		// frame times and the post-processing GPU time at each of the last frames, oldest first
+		float frameMs[GRAPH_FRAMES] = {};
+		float gpuMs[GRAPH_FRAMES] = {};
+		uint32_t nextFrame = 0;
+		Clock::time_point lastFrame;
+		bool hasLastFrame = false;
+		Clock::time_point lastDraw;
+
+		// the compositor's counters at the start of the current reprojection interval
+		Compositor_CumulativeStats lastStats = {};
+		Clock::time_point lastStatsTime;
+		float reprojectedPercent = 0;
+
+		bool CreateOverlay();
+		void DestroyOverlay();
+		void CreateTexture(ID3D11Device *device);
+		void UpdateReprojection(Clock::time_point now);
+		void Draw(const telemetry::Snapshot &stats);
+		void DrawGraph(int top, int bottom);
+		void FillRect(int x, int y, int width, int height, uint32_t color);
+		// returns the x coordinate after the text
+		int DrawText(int x, int y, const char *text, uint32_t color);
+	};
+}
@@ -0,0 +1,69 @@
+#include <cmath>
+#include <cstring>
+#include "PostProcessConstants.h"
+
+#include "Config.h"
+
+namespace vr {
+	PipelineSettings CurrentPipelineSettings() {
+		PipelineSettings settings;
+		settings.renderScale = Config::Instance().renderScale;
+		settings.sharpness = Config::Instance().sharpness;
+		settings.radius = Config::Instance().radius;
+		settings.useNis = Config::Instance().useNis;
+		settings.debugMode = Config::Instance().debugMode;
+		settings.chain = Config::Instance().chain;
+		settings.grainAmount = Config::Instance().grainAmount;
+		settings.outputRingSize = Config::Instance().outputRingSize;
+		settings.intermediateFormat = Config::Instance().intermediateFormat;
+		settings.dither = Config::Instance().dither;
+		settings.lensDistortion = Config::Instance().lensDistortion;
+		settings.supersample = Config::Instance().supersample;
+		settings.tileClassification = Config::Instance().tileClassification;
+		settings.flatTileThreshold = Config::Instance().flatTileThreshold;
+		settings.lumaUpscale = Config::Instance().lumaUpscale;
+		return settings;
+	}
+
+	void CalculateProjectionCenter(EVREye eye, float &x, float &y) {
+		IVRSystem *vrSystem = (IVRSystem*) VR_GetGenericInterface(IVRSystem_Version, nullptr);
+		float left, right, top, bottom;
+		vrSystem->GetProjectionRaw(eye, &left, &right, &top, &bottom);
+		Log() << "Raw projection for eye " << eye << ": l " << left << ", r " << right << ", t " << top << ", b " << bottom;
+
+		// calculate canted angle between the eyes
+		auto ml = vrSystem->GetEyeToHeadTransform(Eye_Left);
+		auto mr = vrSystem->GetEyeToHeadTransform(Eye_Right);
+		float dotForward = ml.m[2][0] * mr.m[2][0] + ml.m[2][1] * mr.m[2][1] + ml.m[2][2] * mr.m[2][2];
+		float cantedAngle = std::abs(std::acosf(dotForward) / 2) * (eye == Eye_Right ? -1 : 1);
+		Log() << "Display is canted by " << cantedAngle << " RAD";
+
+		float canted = std::tanf(cantedAngle);
+		x = 0.5f * (1.f + (right + left - 2*canted) / (left - right));
+		y = 0.5f * (1.f + (bottom + top) / (top - bottom));
+		Log() << "Projection center for eye " << eye << ": " << x << ", " << y;
+	}
+
+	bool ComputeLensDistortion(EVREye eye, float u, float v, float coords[6]) {
+		IVRSystem *vrSystem = (IVRSystem*) VR_GetGenericInterface(IVRSystem_Version, nullptr);
+		DistortionCoordinates_t distorted;
+		if (vrSystem == nullptr || !vrSystem->ComputeDistortion(eye, u, v, &distorted)) {
+			return false;
+		}
+		coords[0] = distorted.rfRed[0];
+		coords[1] = distorted.rfRed[1];
+		coords[2] = distorted.rfGreen[0];
+		coords[3] = distorted.rfGreen[1];
+		coords[4] = distorted.rfBlue[0];
+		coords[5] = distorted.rfBlue[1];
+		return true;
+	}
+
+	void CalculateShaderConstants(framedump::Constants &constants, uint32_t inputWidth, uint32_t inputHeight,
+			uint32_t outputWidth, uint32_t outputHeight, bool textureContainsOnlyOneEye) {
+		float centre[2][2];
+		CalculateProjectionCenter(Eye_Left, centre[0][0], centre[0][1]);
+		CalculateProjectionCenter(Eye_Right, centre[1][0], centre[1][1]);
+		CalculateShaderConstants(constants, CurrentPipelineSettings(), centre, inputWidth, inputHeight, outputWidth, outputHeight, textureContainsOnlyOneEye);
+	}
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdint>
+#include "openvr.h"
+#include "FrameDump.h"
+#include "PostProcessPipeline.h"
+
+// Shader constants shared by all post-processing backends, so that the D3D11 and OpenGL paths
+// upscale and sharpen with exactly the same parameters.
+namespace vr {
+	// the pipeline settings from the current config
+	PipelineSettings CurrentPipelineSettings();
+
+	// projection centre of the given eye in normalized texture coordinates, as reported by the runtime
+	void CalculateProjectionCenter(EVREye eye, float &x, float &y);
+
+	// the DistortionFunction of the runtime, see LensDistortion.h
+	bool ComputeLensDistortion(EVREye eye, float u, float v, float coords[6]);
+
+	// fills in the projection centres and the FSR and NIS constants of both stages for both eyes
+	// from the current config. If both eyes share a texture, both entries hold the same constants.
+	void CalculateShaderConstants(framedump::Constants &constants, uint32_t inputWidth, uint32_t inputHeight,
+			uint32_t outputWidth, uint32_t outputHeight, bool textureContainsOnlyOneEye);
+}
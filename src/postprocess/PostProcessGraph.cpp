@@ -0,0 +1,90 @@
+#include "PostProcessGraph.h"
+
+namespace vr {
+	bool ParsePipelineStage(const std::string &name, PipelineStage &stage) {
+		if (name == "upscale") {
+			stage = PipelineStage::Upscale;
+		} else if (name == "sharpen") {
+			stage = PipelineStage::Sharpen;
+		} else if (name == "cas") {
+			stage = PipelineStage::Cas;
+		} else if (name == "grain") {
+			stage = PipelineStage::Grain;
+		} else {
+			return false;
+		}
+		return true;
+	}
+
+	const char * PipelineStageName(PipelineStage stage) {
+		switch (stage) {
+		case PipelineStage::Upscale: return "upscale";
+		case PipelineStage::Sharpen: return "sharpen";
+		case PipelineStage::Cas: return "cas";
+		case PipelineStage::Grain: return "grain";
+		default: return "?";
+		}
+	}
+
+	PipelineGraph CompilePipelineGraph(const std::vector<PipelineStage> &chain, bool useNis,
+			uint32_t inputWidth, uint32_t inputHeight, uint32_t outputWidth, uint32_t outputHeight) {
+		PipelineGraph graph;
+
+		// fuse grain into the pass before it where that pass can apply it
+		for (PipelineStage stage : chain) {
+			if (stage == PipelineStage::Grain && !graph.passes.empty()) {
+				PipelinePass &previous = graph.passes.back();
+				bool canApplyGrain = !useNis && (previous.stage == PipelineStage::Upscale || previous.stage == PipelineStage::Sharpen);
+				if (canApplyGrain && !previous.fusedGrain) {
+					previous.fusedGrain = true;
+					continue;
+				}
+			}
+			PipelinePass pass;
+			pass.stage = stage;
+			graph.passes.push_back(pass);
+		}
+
+		// Each pass output is alive from its pass until the next pass has read it; the last one until
+		// the end of the frame, since it is handed to the compositor. A texture can be reused as soon
+		// as the output it holds is dead.
+		// for every texture, the pass reading what it currently holds
+		std::vector<size_t> textureBusyUntil;
+		uint32_t width = inputWidth;
+		uint32_t height = inputHeight;
+		PipelineSurface current = INPUT_SURFACE;
+		for (size_t i = 0; i < graph.passes.size(); ++i) {
+			PipelinePass &pass = graph.passes[i];
+			if (pass.stage == PipelineStage::Upscale) {
+				width = outputWidth;
+				height = outputHeight;
+			}
+			pass.input = current;
+			pass.width = width;
+			pass.height = height;
+
+			pass.output = INPUT_SURFACE;
+			bool isLast = i + 1 == graph.passes.size();
+			for (size_t t = 0; t < graph.textures.size() && !isLast; ++t) {
+				if (textureBusyUntil[t] < i && graph.textures[t].width == width && graph.textures[t].height == height) {
+					pass.output = (PipelineSurface)t;
+					break;
+				}
+			}
+			if (pass.output == INPUT_SURFACE) {
+				TransientTexture texture;
+				texture.width = width;
+				texture.height = height;
+				texture.isOutput = isLast;
+				graph.textures.push_back(texture);
+				textureBusyUntil.push_back(0);
+				pass.output = (PipelineSurface)(graph.textures.size() - 1);
+			}
+			// read by the next pass; for the last pass, no later pass exists to reuse it
+			textureBusyUntil[pass.output] = i + 1;
+			current = pass.output;
+		}
+		graph.output = current;
+		return graph;
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A small frame graph for the post-processing chain. The chain is a list of stages from the config;
+// compiling it fuses stages that a preceding shader can apply on its own output, and assigns each
+// remaining pass an output texture. Textures are transient and shared by passes whose outputs are
+// never alive at the same time, so a longer chain only needs another texture if a pass would
+// otherwise overwrite the texture it reads from. The last pass always gets a texture of its own,
+// since that one is handed to the compositor and backends may keep several copies of it.
+namespace vr {
+	enum class PipelineStage {
+		// FSR EASU, or the NIS scaler with useNIS
+		Upscale,
+		// FSR RCAS, or NIS sharpening with useNIS
+		Sharpen,
+		// FidelityFX CAS, sharpening only
+		Cas,
+		// film grain through FsrLfgaF
+		Grain,
+	};
+
+	// stage names as used in the config's chain setting
+	bool ParsePipelineStage(const std::string &name, PipelineStage &stage);
+	const char * PipelineStageName(PipelineStage stage);
+
+	// index of a texture in PipelineGraph::textures, or INPUT_SURFACE for the submitted texture (or the
+	// copy of it, if it can't be read directly)
+	typedef int PipelineSurface;
+	const PipelineSurface INPUT_SURFACE = -1;
+
+	struct TransientTexture {
+		uint32_t width;
+		uint32_t height;
+		// written by the last pass and submitted to the compositor
+		bool isOutput;
+		// filled in by PlanPipeline: the framedump::Format to create the texture in, and whether the
+		// passes writing it dither their output
+		uint32_t format = 0;
+		bool dither = false;
+	};
+
+	struct PipelinePass {
+		PipelineStage stage;
+		// film grain is applied by this pass as it writes its output, instead of by a pass of its own
+		bool fusedGrain = false;
+		PipelineSurface input = INPUT_SURFACE;
+		PipelineSurface output = INPUT_SURFACE;
+		// size of the output
+		uint32_t width = 0;
+		uint32_t height = 0;
+		// filled in by PlanPipeline: the pass skips the tiles the classification prepass found flat
+		bool skipFlatTiles = false;
+	};
+
+	struct PipelineGraph {
+		std::vector<PipelinePass> passes;
+		std::vector<TransientTexture> textures;
+		// the surface holding the result of the last pass
+		PipelineSurface output = INPUT_SURFACE;
+	};
+
+	// Upscale stages scale from the input to the output size, all others keep the size of their input.
+	// Grain is fused into a directly preceding FSR stage, since EASU and RCAS have variants that add
+	// it; the NIS and CAS shaders don't.
+	PipelineGraph CompilePipelineGraph(const std::vector<PipelineStage> &chain, bool useNis,
+			uint32_t inputWidth, uint32_t inputHeight, uint32_t outputWidth, uint32_t outputHeight);
+}
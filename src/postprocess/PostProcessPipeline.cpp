@@ -0,0 +1,446 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "PostProcessPipeline.h"
+#include "Logging.h"
+#include "Tracing.h"
+
+#define A_CPU
+#include "fsr/ffx_a.h"
+#include "fsr/ffx_fsr1.h"
+#include "cas/ffx_cas.h"
+
+#include "nis/NIS_Config.h"
+
+namespace vr {
+	static_assert(sizeof(NISConfig) == framedump::NIS_CONFIG_SIZE, "frame dumps store NISConfig as raw bytes");
+
+	void CalculateShaderConstants(framedump::Constants &constants, const PipelineSettings &settings, const float projectionCentre[2][2],
+			uint32_t inputWidth, uint32_t inputHeight, uint32_t outputWidth, uint32_t outputHeight, bool textureContainsOnlyOneEye) {
+		memcpy(constants.projectionCentre, projectionCentre, sizeof(constants.projectionCentre));
+
+		// foveation parameters, identical for all stages
+		uint32_t imageCentre[2][4];
+		imageCentre[0][0] = textureContainsOnlyOneEye ? outputWidth * projectionCentre[0][0] : outputWidth / 2 * projectionCentre[0][0];
+		imageCentre[0][1] = outputHeight * projectionCentre[0][1];
+		imageCentre[0][2] = textureContainsOnlyOneEye ? outputWidth * projectionCentre[0][0] : outputWidth / 2 * (1 + projectionCentre[1][0]);
+		imageCentre[0][3] = outputHeight * (textureContainsOnlyOneEye ? projectionCentre[0][1] : projectionCentre[1][1]);
+		if (textureContainsOnlyOneEye) {
+			imageCentre[1][0] = outputWidth * projectionCentre[1][0];
+			imageCentre[1][1] = outputHeight * projectionCentre[1][1];
+			imageCentre[1][2] = outputWidth * projectionCentre[1][0];
+			imageCentre[1][3] = outputHeight * projectionCentre[1][1];
+		} else {
+			memcpy(imageCentre[1], imageCentre[0], sizeof(imageCentre[0]));
+		}
+		uint32_t radius[4];
+		radius[0] = 0.5f * settings.radius * outputHeight;
+		radius[1] = radius[0] * radius[0];
+		radius[2] = outputWidth;
+		radius[3] = outputHeight;
+
+		uint32_t easuWidth = outputWidth;
+		uint32_t easuHeight = outputHeight;
+		if (UsesSupersampling(settings)) {
+			easuWidth = inputWidth * settings.renderScale;
+			easuHeight = inputHeight * settings.renderScale;
+		}
+		UpscaleConstants upscale;
+		FsrEasuCon(upscale.const0, upscale.const1, upscale.const2, upscale.const3, inputWidth, inputHeight, inputWidth, inputHeight, easuWidth, easuHeight);
+		memcpy(upscale.radius, radius, sizeof(radius));
+
+		SharpenConstants sharpen;
+		float sharpness = AClampF1( settings.sharpness, 0, 1 );
+		FsrRcasCon(sharpen.const0, 2.f - 2*sharpness);
+		sharpen.const0[3] = settings.debugMode;
+		memcpy(sharpen.radius, radius, sizeof(radius));
+
+		NISConfig nisUpscale;
+		NVScalerUpdateConfig( nisUpscale, settings.sharpness, 0, 0, inputWidth, inputHeight, inputWidth, inputHeight, 0, 0, outputWidth, outputHeight, outputWidth, outputHeight );
+		nisUpscale.reserved1 = settings.debugMode ? 1.f : 0.f;
+		memcpy(&nisUpscale.radius[0], radius, sizeof(radius));
+
+		NISConfig nisSharpen;
+		NVSharpenUpdateConfig( nisSharpen, settings.sharpness, 0, 0, inputWidth, inputHeight, inputWidth, inputHeight, 0, 0 );
+		nisSharpen.reserved1 = settings.debugMode ? 1.f : 0.f;
+		memcpy(&nisSharpen.radius[0], radius, sizeof(radius));
+
+		for (int eye = 0; eye < 2; ++eye) {
+			memcpy(upscale.imageCentre, imageCentre[eye], sizeof(imageCentre[eye]));
+			memcpy(sharpen.imageCentre, imageCentre[eye], sizeof(imageCentre[eye]));
+			memcpy(&nisUpscale.imageCentre[0], imageCentre[eye], sizeof(imageCentre[eye]));
+			memcpy(&nisSharpen.imageCentre[0], imageCentre[eye], sizeof(imageCentre[eye]));
+			constants.upscale[eye] = upscale;
+			constants.sharpen[eye] = sharpen;
+			memcpy(constants.nisUpscale[eye], &nisUpscale, sizeof(NISConfig));
+			memcpy(constants.nisSharpen[eye], &nisSharpen, sizeof(NISConfig));
+		}
+	}
+
+	bool UsesSupersampling(const PipelineSettings &settings) {
+		return settings.supersample && settings.renderScale > 1.f && !settings.useNis;
+	}
+
+	std::vector<PipelineStage> ResolvePipelineChain(const PipelineSettings &settings) {
+		bool upscale = settings.renderScale != 1.f;
+		if (settings.chain.empty()) {
+			std::vector<PipelineStage> chain;
+			if (upscale) {
+				chain.push_back(PipelineStage::Upscale);
+			}
+			// NIS upscaling sharpens on its own
+			if (!settings.useNis || !upscale) {
+				chain.push_back(PipelineStage::Sharpen);
+			}
+			return chain;
+		}
+
+		std::vector<PipelineStage> chain;
+		bool hasUpscale = false;
+		for (PipelineStage stage : settings.chain) {
+			if (stage == PipelineStage::Upscale) {
+				if (!upscale) {
+					Log() << "Render scale is 1, ignoring upscale stage in chain";
+					continue;
+				}
+				if (hasUpscale) {
+					Log() << "Ignoring repeated upscale stage in chain";
+					continue;
+				}
+				hasUpscale = true;
+			}
+			chain.push_back(stage);
+		}
+		if (upscale && !hasUpscale) {
+			Log() << "Chain has no upscale stage, but render scale is not 1; upscaling first";
+			chain.insert(chain.begin(), PipelineStage::Upscale);
+		}
+		return chain;
+	}
+
+	bool ParseIntermediateFormat(const std::string &name, uint32_t &format) {
+		if (name == "output") {
+			format = 0;
+		} else if (name == "rgba8") {
+			format = framedump::FORMAT_R8G8B8A8_UNORM;
+		} else if (name == "rgb10a2") {
+			format = framedump::FORMAT_R10G10B10A2_UNORM;
+		} else if (name == "r11g11b10") {
+			format = framedump::FORMAT_R11G11B10_FLOAT;
+		} else if (name == "rgb565") {
+			format = framedump::FORMAT_B5G6R5_UNORM;
+		} else {
+			return false;
+		}
+		return true;
+	}
+
+	void GetDitherLevels(uint32_t format, float levels[4]) {
+		switch (format) {
+		case framedump::FORMAT_R8G8B8A8_UNORM:
+			levels[0] = levels[1] = levels[2] = 255.f;
+			break;
+		case framedump::FORMAT_R10G10B10A2_UNORM:
+			levels[0] = levels[1] = levels[2] = 1023.f;
+			break;
+		case framedump::FORMAT_B5G6R5_UNORM:
+			levels[0] = levels[2] = 31.f;
+			levels[1] = 63.f;
+			break;
+		default:
+			levels[0] = levels[1] = levels[2] = 0.f;
+			break;
+		}
+		levels[3] = 0.f;
+	}
+
+	bool RequiresNewResources(const PipelineSettings &planned, const PipelineSettings &settings) {
+		return planned.renderScale != settings.renderScale
+			|| planned.useNis != settings.useNis
+			|| planned.debugMode != settings.debugMode
+			|| planned.chain != settings.chain
+			|| planned.outputRingSize != settings.outputRingSize
+			|| planned.intermediateFormat != settings.intermediateFormat
+			|| planned.dither != settings.dither
+			|| planned.lensDistortion != settings.lensDistortion
+			|| planned.supersample != settings.supersample
+			|| planned.tileClassification != settings.tileClassification
+			|| planned.lumaUpscale != settings.lumaUpscale;
+	}
+
+	bool ParametersDiffer(const PipelineSettings &planned, const PipelineSettings &settings) {
+		return planned.sharpness != settings.sharpness
+			|| planned.radius != settings.radius
+			|| planned.grainAmount != settings.grainAmount
+			|| planned.flatTileThreshold != settings.flatTileThreshold;
+	}
+
+	void UpdatePlanParameters(PipelinePlan &plan, const PipelineSettings &settings) {
+		framedump::Constants &constants = plan.constants;
+		float projectionCentre[2][2];
+		memcpy(projectionCentre, constants.projectionCentre, sizeof(projectionCentre));
+		CalculateShaderConstants(constants, settings, projectionCentre, plan.inputWidth, plan.inputHeight, plan.outputWidth, plan.outputHeight, plan.textureContainsOnlyOneEye);
+		constants.sharpness = settings.sharpness;
+		constants.radius = settings.radius;
+
+		// only the CAS sharpening path is used, which doesn't depend on the size it runs at
+		float casSharpness = AClampF1( settings.sharpness, 0, 1 );
+		CasSetup(plan.cas.const0, plan.cas.const1, casSharpness, 1.f, plan.outputWidth, plan.outputHeight, plan.outputWidth, plan.outputHeight);
+		plan.grainAmount = settings.grainAmount;
+
+		memset(&plan.classify, 0, sizeof(plan.classify));
+		plan.classify.inputSize[0] = plan.inputWidth;
+		plan.classify.inputSize[1] = plan.inputHeight;
+		plan.classify.scale[0] = plan.inputWidth / float(plan.outputWidth);
+		plan.classify.scale[1] = plan.inputHeight / float(plan.outputHeight);
+		plan.classify.threshold = settings.flatTileThreshold;
+	}
+
+	bool UpdateDistortionBounds(PipelinePlan &plan, EVREye eye, const VRTextureBounds_t &bounds) {
+		float *planned = plan.distortion[eye].bounds;
+		if (planned[0] == bounds.uMin && planned[1] == bounds.vMin && planned[2] == bounds.uMax && planned[3] == bounds.vMax) {
+			return false;
+		}
+		planned[0] = bounds.uMin;
+		planned[1] = bounds.vMin;
+		planned[2] = bounds.uMax;
+		planned[3] = bounds.vMax;
+		return true;
+	}
+
+	namespace {
+		void PlanLensDistortion(PipelinePlan &plan, DistortionFunction distortion, const VRTextureBounds_t &bounds) {
+			if (distortion == nullptr) {
+				Log() << "Lens distortion is not supported here, leaving it to the compositor";
+				return;
+			}
+			if (!plan.textureContainsOnlyOneEye) {
+				Log() << "Lens distortion needs a texture per eye, leaving it to the compositor";
+				return;
+			}
+			if (!plan.upscale || plan.useNis || plan.supersample) {
+				Log() << "Lens distortion is only applied when upscaling with FSR without supersampling, leaving it to the compositor";
+				return;
+			}
+			for (int eye = 0; eye < 2; ++eye) {
+				if (!BuildDistortionMap(distortion, (EVREye)eye, plan.outputWidth, plan.outputHeight, plan.distortionMap[eye])) {
+					Log(LogLevel::Warning) << "Could not compute the lens distortion, leaving it to the compositor";
+					return;
+				}
+			}
+			// the other eye's bounds are only known once it is submitted, until then assume they are the same
+			for (int eye = 0; eye < 2; ++eye) {
+				UpdateDistortionBounds(plan, (EVREye)eye, bounds);
+				GetDistortionMapTransform(plan.distortionMap[eye], plan.distortion[eye].mapTransform);
+			}
+			plan.lensDistortion = true;
+			Log() << "Upscaling to the lens distorted image, " << plan.distortionMap[0].width << "x" << plan.distortionMap[0].height
+				<< " distortion map per eye";
+		}
+
+		void PlanLumaUpscale(PipelinePlan &plan) {
+			if (!plan.upscale || plan.useNis || plan.supersample || plan.lensDistortion) {
+				Log() << "Luma guided upscaling is only available with FSR without supersampling or lens distortion";
+				return;
+			}
+			plan.lumaUpscale = true;
+			Log() << "Upscaling the luma with EASU and the chroma bilinearly";
+		}
+
+		void PlanTileClassification(PipelinePlan &plan) {
+			if (plan.useNis) {
+				Log() << "Tile classification is only available with FSR";
+				return;
+			}
+			// the mask has a texel per output tile, so only passes writing at the output size can use it
+			for (PipelinePass &pass : plan.graph.passes) {
+				bool fsrPass = (pass.stage == PipelineStage::Upscale && !plan.lensDistortion) || pass.stage == PipelineStage::Sharpen;
+				if (fsrPass && pass.width == plan.outputWidth && pass.height == plan.outputHeight) {
+					pass.skipFlatTiles = true;
+					plan.classifyTiles = true;
+				}
+			}
+			if (plan.classifyTiles) {
+				Log() << "Classifying " << (plan.outputWidth + 15) / 16 << "x" << (plan.outputHeight + 15) / 16 << " tiles, skipping those with a luma range below "
+					<< plan.classify.threshold;
+			} else {
+				Log() << "No pass of the chain can skip flat tiles, not classifying them";
+			}
+		}
+	}
+
+	PipelinePlan PlanPipeline(const PipelineSettings &settings, const InputTextureInfo &input, EColorSpace colorSpace,
+			const VRTextureBounds_t &bounds, const float projectionCentre[2][2], DistortionFunction distortion) {
+		PipelinePlan plan;
+		plan.inputWidth = input.width;
+		plan.inputHeight = input.height;
+		plan.textureContainsOnlyOneEye = std::abs(bounds.uMax - bounds.uMin) > .5f;
+		plan.inputIsSrgb = colorSpace == ColorSpace_Gamma || (colorSpace == ColorSpace_Auto && input.consideredSrgb);
+		if (plan.inputIsSrgb) {
+			Log() << "Input texture is in SRGB color space";
+		}
+
+		plan.supersample = UsesSupersampling(settings);
+		if (settings.supersample && settings.renderScale > 1.f && !plan.supersample) {
+			Log() << "Supersampling is only available with FSR, submitting the larger image";
+		}
+		if (plan.supersample) {
+			plan.outputWidth = input.width;
+			plan.outputHeight = input.height;
+			Log() << "Supersampling from " << uint32_t(input.width * settings.renderScale) << "x" << uint32_t(input.height * settings.renderScale);
+		} else if (settings.renderScale < 1.f) {
+			plan.outputWidth = input.width / settings.renderScale;
+			plan.outputHeight = input.height / settings.renderScale;
+		} else {
+			plan.outputWidth = input.width * settings.renderScale;
+			plan.outputHeight = input.height * settings.renderScale;
+		}
+
+		if (!input.shaderReadable || input.sampleCount > 1 || input.srgbFormat) {
+			Log() << "Input texture can't be bound directly, need to copy";
+			plan.requiresCopy = true;
+		}
+
+		plan.useNis = settings.useNis;
+		std::vector<PipelineStage> chain = ResolvePipelineChain(settings);
+		plan.upscale = std::find(chain.begin(), chain.end(), PipelineStage::Upscale) != chain.end();
+		plan.sharpen = std::find(chain.begin(), chain.end(), PipelineStage::Sharpen) != chain.end();
+		plan.graph = CompilePipelineGraph(chain, plan.useNis, plan.inputWidth, plan.inputHeight, plan.outputWidth, plan.outputHeight);
+		// what the passes read and write each time they run, to compare intermediate formats by
+		uint64_t bytesMoved = 0;
+		for (TransientTexture &texture : plan.graph.textures) {
+			texture.format = texture.isOutput || settings.intermediateFormat == 0 ? input.outputFormat : settings.intermediateFormat;
+			float levels[4];
+			GetDitherLevels(texture.format, levels);
+			texture.dither = levels[0] > 0 && (settings.dither || texture.format == framedump::FORMAT_B5G6R5_UNORM);
+		}
+		for (const PipelinePass &pass : plan.graph.passes) {
+			if (pass.input == INPUT_SURFACE) {
+				bytesMoved += (uint64_t)plan.inputWidth * plan.inputHeight * framedump::BytesPerPixel(input.format);
+			} else {
+				const TransientTexture &texture = plan.graph.textures[pass.input];
+				bytesMoved += (uint64_t)texture.width * texture.height * framedump::BytesPerPixel(texture.format);
+			}
+			bytesMoved += (uint64_t)pass.width * pass.height * framedump::BytesPerPixel(plan.graph.textures[pass.output].format);
+		}
+		if (!plan.graph.passes.empty()) {
+			LogLine log = Log();
+			log << "Post-processing chain:";
+			for (const PipelinePass &pass : plan.graph.passes) {
+				log << " " << PipelineStageName(pass.stage) << (pass.fusedGrain ? "+grain" : "");
+			}
+			log << " using " << plan.graph.textures.size() << " intermediate texture(s), "
+				<< bytesMoved / (1024.0 * 1024.0) << " MB read and written per run";
+		}
+
+		framedump::Constants &constants = plan.constants;
+		memset(&constants, 0, sizeof(constants));
+		memcpy(constants.projectionCentre, projectionCentre, sizeof(constants.projectionCentre));
+		constants.inputWidth = plan.inputWidth;
+		constants.inputHeight = plan.inputHeight;
+		constants.outputWidth = plan.outputWidth;
+		constants.outputHeight = plan.outputHeight;
+		constants.inputFormat = input.format;
+		constants.outputFormat = input.outputFormat;
+		constants.flags = (plan.textureContainsOnlyOneEye ? framedump::FLAG_ONE_EYE_PER_TEXTURE : 0)
+			| (plan.inputIsSrgb ? framedump::FLAG_INPUT_SRGB : 0)
+			| (plan.upscale ? framedump::FLAG_UPSCALE : 0)
+			| (plan.sharpen ? framedump::FLAG_SHARPEN : 0)
+			| (plan.useNis ? framedump::FLAG_USE_NIS : 0)
+			| (settings.debugMode ? framedump::FLAG_DEBUG_MODE : 0)
+			| (plan.supersample ? framedump::FLAG_SUPERSAMPLE : 0);
+		constants.renderScale = settings.renderScale;
+		UpdatePlanParameters(plan, settings);
+		if (settings.lensDistortion) {
+			PlanLensDistortion(plan, distortion, bounds);
+		}
+		if (settings.lumaUpscale) {
+			PlanLumaUpscale(plan);
+		}
+		if (settings.tileClassification) {
+			PlanTileClassification(plan);
+		}
+		if (plan.lumaUpscale) {
+			constants.flags |= framedump::FLAG_LUMA_UPSCALE;
+		}
+		plan.outputRingSize = (std::max)(1, (std::min)(settings.outputRingSize, MAX_OUTPUT_RING_SIZE));
+		return plan;
+	}
+
+	void * PostProcessPipeline::Process(EVREye eEye, void *texture, const VRTextureBounds_t &bounds, EColorSpace colorSpace, const PipelineSettings &settings) {
+		TRACE_SCOPE("PostProcessPipeline::Process");
+		if (!enabled || texture == nullptr) {
+			return nullptr;
+		}
+
+		InputTextureInfo info;
+		if (!backend.DescribeInput(texture, info)) {
+			return nullptr;
+		}
+
+		if (initialized && (info.width != plan.inputWidth || info.height != plan.inputHeight)) {
+			Log() << "Texture size changed, recreating resources...";
+			Reset();
+		}
+		if (initialized && RequiresNewResources(plannedSettings, settings)) {
+			Log() << "Settings changed, recreating resources...";
+			Reset();
+		} else if (initialized && ParametersDiffer(plannedSettings, settings)) {
+			UpdatePlanParameters(plan, settings);
+			backend.UpdateConstants(plan);
+			plannedSettings = settings;
+		}
+		// each eye's viewport of the texture may differ, and may change without the texture changing
+		if (initialized && plan.lensDistortion && UpdateDistortionBounds(plan, eEye, bounds)) {
+			backend.UpdateConstants(plan);
+		}
+		if (!initialized) {
+			try {
+				TRACE_SCOPE("PostProcessPipeline::CreateResources");
+				Log() << "Creating post-processing resources";
+				float centre[2][2];
+				projectionCentre(Eye_Left, centre[0][0], centre[0][1]);
+				projectionCentre(Eye_Right, centre[1][0], centre[1][1]);
+				plan = PlanPipeline(settings, info, colorSpace, bounds, centre, distortion);
+				plannedSettings = settings;
+				Log() << "Using " << (plan.useNis ? "NVIDIA Image Scaling" : "AMD FidelityFX SuperResolution");
+				backend.PrepareResources(texture, plan);
+				initialized = true;
+			} catch (...) {
+				Log(LogLevel::Error) << "Resource creation failed, disabling";
+				enabled = false;
+				return nullptr;
+			}
+		}
+
+		// if a single shared texture is used for both eyes, only apply effects on the first Submit
+		if (eyeCount == 0 || plan.textureContainsOnlyOneEye || texture != lastSubmittedTexture) {
+			outputSurface = Run(plan.textureContainsOnlyOneEye ? eEye : Eye_Left, texture);
+		}
+		lastSubmittedTexture = texture;
+		eyeCount = (eyeCount + 1) % 2;
+		return backend.GetSubmitTexture(outputSurface, texture);
+	}
+
+	void PostProcessPipeline::Reset() {
+		backend.ReleaseResources();
+		enabled = true;
+		initialized = false;
+		lastSubmittedTexture = nullptr;
+		outputSurface = INPUT_SURFACE;
+		eyeCount = 0;
+	}
+
+	PipelineSurface PostProcessPipeline::Run(EVREye eEye, void *texture) {
+		if (!backend.BeginPostProcess(eEye, texture, frameIndex++)) {
+			return INPUT_SURFACE;
+		}
+
+		for (const PipelinePass &pass : plan.graph.passes) {
+			backend.RunPass(pass, eEye);
+		}
+
+		backend.EndPostProcess(eEye, plan.graph.output);
+		return plan.graph.output;
+	}
+}
@@ -0,0 +1,198 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "openvr.h"
+#include "FrameDump.h"
+#include "LensDistortion.h"
+#include "PostProcessGraph.h"
+
+// The graphics API independent part of the post processor: it decides how a submitted texture is
+// processed (eye layout, whether it must be copied, output size, shader constants, foveation radius,
+// which stages run in which order and on which textures) and drives a PostProcessBackend that does
+// the actual work. The offline tools run it on the CPU backend.
+namespace vr {
+	// the settings the pipeline is planned with; the mod takes them from its Config
+	struct PipelineSettings {
+		float renderScale = 1.f;
+		float sharpness = 0.75f;
+		float radius = 0.5f;
+		bool useNis = false;
+		bool debugMode = false;
+		// the stages to run; if empty, the upscaler's own stages are used
+		std::vector<PipelineStage> chain;
+		float grainAmount = 0.3f;
+		// number of copies of the output texture per eye that backends rotate through
+		int outputRingSize = 2;
+		// framedump::Format of the textures between passes, or 0 to use the output format
+		uint32_t intermediateFormat = 0;
+		// dither all UNORM textures the passes write, not just those that need it (see PlanPipeline)
+		bool dither = false;
+		// upscale straight to the lens distorted image, see LensDistortion.h
+		bool lensDistortion = false;
+		// with a render scale above 1, run EASU at the scaled resolution but filter its result back
+		// down to the input size in the same pass, instead of submitting the larger image
+		bool supersample = false;
+		// classify the output tiles by the contrast of the input first, and let the FSR passes skip the
+		// flat ones, where bilinear filtering and a copy look the same
+		bool tileClassification = false;
+		// luma range below which a tile counts as flat
+		float flatTileThreshold = 0.01f;
+		// run EASU on the luma only and take the chroma from a bilinear sample
+		bool lumaUpscale = false;
+	};
+
+	// what the pipeline needs to know about a submitted texture, as reported by the backend
+	struct InputTextureInfo {
+		uint32_t width = 0;
+		uint32_t height = 0;
+		// backend specific format of the texture as the stages read it, and of the textures they write;
+		// only recorded in frame dumps
+		uint32_t format = 0;
+		uint32_t outputFormat = 0;
+		uint32_t sampleCount = 1;
+		// the texture can be read by the stages without copying it first
+		bool shaderReadable = true;
+		// the stages would read linear values from the texture and need a copy holding the gamma encoded ones
+		bool srgbFormat = false;
+		// OpenVR treats the format as gamma encoded when the game submits it with ColorSpace_Auto
+		bool consideredSrgb = false;
+	};
+
+	// decisions taken once when the resources for a texture are created
+	struct PipelinePlan {
+		uint32_t inputWidth = 0;
+		uint32_t inputHeight = 0;
+		uint32_t outputWidth = 0;
+		uint32_t outputHeight = 0;
+		bool textureContainsOnlyOneEye = true;
+		bool requiresCopy = false;
+		bool inputIsSrgb = false;
+		bool useNis = false;
+		// the chain contains an upscale or sharpen stage
+		bool upscale = false;
+		bool sharpen = false;
+		// the upscale stage supersamples, so the output has the input's size
+		bool supersample = false;
+		PipelineGraph graph;
+		// the constant buffers of the upscale and sharpen stages for both eyes, plus everything a frame
+		// dump records except the submitted bounds
+		framedump::Constants constants;
+		CasConstants cas;
+		float grainAmount = 0.f;
+		// between 1 and MAX_OUTPUT_RING_SIZE
+		int outputRingSize = 1;
+		// the upscale pass writes the lens distorted image of each eye, which must be submitted with
+		// Submit_LensDistortionAlreadyApplied and the full texture as bounds
+		bool lensDistortion = false;
+		DistortionMap distortionMap[2];
+		// per eye, with the bounds of the eye's latest Submit, see UpdateDistortionBounds
+		DistortionConstants distortion[2];
+		// the classification prepass runs on the submitted texture before the passes, writing a mask
+		// with a texel per 16x16 pixel output tile for the passes that skip flat tiles
+		bool classifyTiles = false;
+		ClassifyConstants classify;
+		// the upscale pass computes the luma of its input first and runs EASU on that alone
+		bool lumaUpscale = false;
+	};
+
+	const int MAX_OUTPUT_RING_SIZE = 3;
+
+	// intermediate format names as used in the config: output, rgba8, rgb10a2, r11g11b10 and rgb565
+	bool ParseIntermediateFormat(const std::string &name, uint32_t &format);
+	// the levels fsr/fsr_dither.h rounds the channels of the given format to, all 0 if it doesn't dither it
+	void GetDitherLevels(uint32_t format, float levels[4]);
+
+	// whether the settings supersample, which only FSR does
+	bool UsesSupersampling(const PipelineSettings &settings);
+
+	// the chain to run with the given settings: the configured one, or upscale followed by sharpen as
+	// the upscaler needs. An upscale stage is added or dropped depending on the render scale.
+	std::vector<PipelineStage> ResolvePipelineChain(const PipelineSettings &settings);
+
+	// fills in the projection centres and the FSR and NIS constants of both stages for both eyes.
+	// If both eyes share a texture, both entries hold the same constants. When supersampling, the
+	// EASU constants scale to the input size times the render scale rather than to the output.
+	void CalculateShaderConstants(framedump::Constants &constants, const PipelineSettings &settings, const float projectionCentre[2][2],
+			uint32_t inputWidth, uint32_t inputHeight, uint32_t outputWidth, uint32_t outputHeight, bool textureContainsOnlyOneEye);
+
+	// Settings that only feed the plan's constants can change without recreating any resources; all
+	// others change what the backend prepares.
+	bool RequiresNewResources(const PipelineSettings &planned, const PipelineSettings &settings);
+	bool ParametersDiffer(const PipelineSettings &planned, const PipelineSettings &settings);
+	// recalculates the constants of a plan that depend on sharpness, radius, grainAmount and flatTileThreshold
+	void UpdatePlanParameters(PipelinePlan &plan, const PipelineSettings &settings);
+	// takes the bounds of an eye's Submit into its distortion constants; returns whether they changed
+	bool UpdateDistortionBounds(PipelinePlan &plan, EVREye eye, const VRTextureBounds_t &bounds);
+
+	// Besides the chain, this picks the format of every transient texture: the output textures use the
+	// output format, the others the configured intermediate format. Textures in a format with less
+	// than 8 bits per channel are always dithered, others in UNORM formats if settings.dither is set.
+	// Lens distortion is only planned if there is a distortion function, each eye has its own texture
+	// and the chain upscales with FSR. Tile classification only applies to the FSR passes that write
+	// at the output size, except for a lens distorted upscale, whose tiles don't line up with the input.
+	// The luma guided upscale is only planned for FSR without supersampling or lens distortion.
+	PipelinePlan PlanPipeline(const PipelineSettings &settings, const InputTextureInfo &input, EColorSpace colorSpace,
+			const VRTextureBounds_t &bounds, const float projectionCentre[2][2], DistortionFunction distortion = nullptr);
+
+	// The graphics API specific part of the post processor. Textures are passed around as the opaque
+	// handles that were submitted. Errors during PrepareResources are reported by throwing.
+	class PostProcessBackend {
+	public:
+		virtual ~PostProcessBackend() {}
+
+		// returns false if the texture can't be post-processed at all
+		virtual bool DescribeInput(void *texture, InputTextureInfo &info) = 0;
+		virtual void PrepareResources(void *texture, const PipelinePlan &plan) = 0;
+		virtual void ReleaseResources() = 0;
+		// takes the new constants of a plan that only changed in its parameters or distortion bounds, see
+		// UpdatePlanParameters and UpdateDistortionBounds
+		virtual void UpdateConstants(const PipelinePlan &plan) = 0;
+
+		// makes the given eye of the texture available as INPUT_SURFACE, copying it if the plan requires
+		// it, and classifies its tiles if the plan says so; returns false if the texture can't be read.
+		// frameIndex counts the processed frames and seeds the film grain.
+		virtual bool BeginPostProcess(EVREye eEye, void *texture, uint32_t frameIndex) = 0;
+		virtual void RunPass(const PipelinePass &pass, EVREye eEye) = 0;
+		// called after the last pass with the surface that holds the result
+		virtual void EndPostProcess(EVREye eEye, PipelineSurface output) = 0;
+
+		// the handle to submit to the compositor for the given surface
+		virtual void * GetSubmitTexture(PipelineSurface surface, void *texture) = 0;
+	};
+
+	class PostProcessPipeline {
+	public:
+		typedef void (*ProjectionCentreFunction)(EVREye eye, float &x, float &y);
+
+		// the distortion function may be nullptr where lens distortion can't be applied
+		PostProcessPipeline(PostProcessBackend &backend, ProjectionCentreFunction projectionCentre, DistortionFunction distortion = nullptr)
+			: backend(backend), projectionCentre(projectionCentre), distortion(distortion) {}
+
+		// runs the stages for a submitted texture and returns the handle to submit in its place, or
+		// nullptr if the texture should be submitted unchanged. Changed settings are picked up here,
+		// recreating the resources only if they require it.
+		void * Process(EVREye eEye, void *texture, const VRTextureBounds_t &bounds, EColorSpace colorSpace, const PipelineSettings &settings);
+		void Reset();
+
+		bool IsInitialized() const { return initialized; }
+		const PipelinePlan & GetPlan() const { return plan; }
+
+	private:
+		PostProcessBackend &backend;
+		ProjectionCentreFunction projectionCentre;
+		DistortionFunction distortion;
+
+		bool enabled = true;
+		bool initialized = false;
+		PipelinePlan plan;
+		// the settings the plan currently reflects
+		PipelineSettings plannedSettings;
+		void *lastSubmittedTexture = nullptr;
+		PipelineSurface outputSurface = INPUT_SURFACE;
+		int eyeCount = 0;
+		uint32_t frameIndex = 0;
+
+		PipelineSurface Run(EVREye eEye, void *texture);
+	};
+}
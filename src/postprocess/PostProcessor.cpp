@@ -1,28 +1,44 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
 #include <fstream>
+#include <sstream>
+#include <thread>
 #include "PostProcessor.h"
 #define no_init_all deprecated
 #include <d3d11.h>
 #include <wrl/client.h>
 
-#define A_CPU
-#include "fsr/ffx_a.h"
-#include "fsr/ffx_fsr1.h"
-
 #include "nis/NIS_Config.h"
 #include "Config.h"
+#include "HotkeyListener.h"
+#include "PostProcessConstants.h"
+#include "Tracing.h"
 #include "shader_fsr_easu.h"
 #include "shader_fsr_rcas.h"
+#include "shader_fsr_easu_grain.h"
+#include "shader_fsr_easu_distort.h"
+#include "shader_fsr_easu_distort_grain.h"
+#include "shader_fsr_easu_supersample.h"
+#include "shader_fsr_easu_supersample_grain.h"
+#include "shader_fsr_easu_luma.h"
+#include "shader_fsr_easu_luma_grain.h"
+#include "shader_fsr_luma.h"
+#include "shader_fsr_rcas_grain.h"
+#include "shader_fsr_grain.h"
+#include "shader_fsr_classify.h"
+#include "shader_cas_sharpen.h"
 #include "shader_nis_upscale.h"
 #include "shader_nis_sharpen.h"
 #include "VrHooks.h"
-#include "postprocess/ScreenGrab11.h"
 
 using Microsoft::WRL::ComPtr;
 
 namespace vr {
 	void CheckResult(const std::string &operation, HRESULT result) {
 		if (FAILED(result)) {
-			Log() << "Failed (" << std::hex << result << std::dec << "): " << operation << std::endl;
+			Log(LogLevel::Error) << "Failed (" << std::hex << result << std::dec << "): " << operation;
 			throw std::exception();
 		}
 	}
@@ -101,27 +117,9 @@ namespace vr {
 		}
 	}
 
-	void CalculateProjectionCenter(EVREye eye, float &x, float &y) {
-		IVRSystem *vrSystem = (IVRSystem*) VR_GetGenericInterface(IVRSystem_Version, nullptr);
-		float left, right, top, bottom;
-		vrSystem->GetProjectionRaw(eye, &left, &right, &top, &bottom);
-		Log() << "Raw projection for eye " << eye << ": l " << left << ", r " << right << ", t " << top << ", b " << bottom << "\n";
-
-		// calculate canted angle between the eyes
-		auto ml = vrSystem->GetEyeToHeadTransform(Eye_Left);
-		auto mr = vrSystem->GetEyeToHeadTransform(Eye_Right);
-		float dotForward = ml.m[2][0] * mr.m[2][0] + ml.m[2][1] * mr.m[2][1] + ml.m[2][2] * mr.m[2][2];
-		float cantedAngle = std::abs(std::acosf(dotForward) / 2) * (eye == Eye_Right ? -1 : 1);
-		Log() << "Display is canted by " << cantedAngle << " RAD\n";
-
-		float canted = std::tanf(cantedAngle);
-		x = 0.5f * (1.f + (right + left - 2*canted) / (left - right));
-		y = 0.5f * (1.f + (bottom + top) / (top - bottom));
-		Log() << "Projection center for eye " << eye << ": " << x << ", " << y << "\n";
-	}
-
-	void PostProcessor::Apply(EVREye eEye, const Texture_t *pTexture, const VRTextureBounds_t* pBounds, EVRSubmitFlags nSubmitFlags) {
-		if (!enabled || pTexture == nullptr || pTexture->eType != TextureType_DirectX || pTexture->handle == nullptr) {
+	void PostProcessor::Apply(EVREye eEye, const Texture_t *pTexture, const VRTextureBounds_t *&pBounds, EVRSubmitFlags *pSubmitFlags) {
+		TRACE_SCOPE("PostProcessor::Apply");
+		if (pTexture == nullptr || pTexture->eType != TextureType_DirectX || pTexture->handle == nullptr) {
 			return;
 		}
 
@@ -130,115 +128,259 @@ namespace vr {
 			pBounds = &defaultBounds;
 		}
 
-		ID3D11Texture2D *texture = (ID3D11Texture2D*)pTexture->handle;
+		submittedBounds[eEye] = *pBounds;
+		// may switch the settings, including whether the mod is enabled
+		benchmark.Update(eEye);
 
+		bool showHud = false;
 		if ( Config::Instance().fsrEnabled ) {
-			if (initialized) {
-				D3D11_TEXTURE2D_DESC td;
-				texture->GetDesc(&td);
-				if (td.Width != inputWidth || td.Height != inputHeight) {
-					Log() << "Texture size changed, recreating resources...\n";
-					Reset();
+			// hotkeys may reset the resources, so handle them before this texture is processed
+			HandleHotkeys();
+			if (pipeline.IsInitialized() && gpuTiming != WantsGpuTiming()) {
+				// timing queries are only created with the resources
+				Reset();
+			}
+			bool framePacingEnabled = Config::Instance().framePacing;
+			if (framePacingEnabled && eEye == Eye_Left) {
+				framePacing.BeginFrame();
+			}
+			if (eEye == Eye_Left) {
+				++submitFrame;
+			}
+
+			PipelineSettings settings = CurrentPipelineSettings();
+			if (Config::Instance().gpuBudgetEnabled && !benchmark.IsRunning()) {
+				if (eEye == Eye_Left || radiusGovernor.Radius() < 0) {
+					radiusGovernor.Update(settings.radius, Config::Instance().gpuBudgetMinRadius, Config::Instance().gpuBudgetMs);
 				}
+				settings.radius = radiusGovernor.Radius();
+			} else {
+				radiusGovernor.Reset();
 			}
-			if (!initialized) {
-				try {
-					textureContainsOnlyOneEye = std::abs(pBounds->uMax - pBounds->uMin) > .5f;
-					PrepareResources(texture, pTexture->eColorSpace);
-				} catch (...) {
-					Log() << "Resource creation failed, disabling\n";
-					enabled = false;
-					return;
+			// games that distort their frames themselves are left alone
+			settings.lensDistortion = settings.lensDistortion && pSubmitFlags != nullptr
+				&& (*pSubmitFlags & Submit_LensDistortionAlreadyApplied) == 0;
+
+			auto start = std::chrono::high_resolution_clock::now();
+			void *output = pipeline.Process(eEye, pTexture->handle, *pBounds, pTexture->eColorSpace, settings);
+			if (output != nullptr) {
+				const_cast<Texture_t*>(pTexture)->handle = output;
+				const_cast<Texture_t*>(pTexture)->eColorSpace = pipeline.GetPlan().inputIsSrgb ? ColorSpace_Gamma : ColorSpace_Auto;
+				if (pipeline.GetPlan().lensDistortion) {
+					// the output covers exactly the eye's panel
+					pBounds = &defaultBounds;
+					*pSubmitFlags = (EVRSubmitFlags)(*pSubmitFlags | Submit_LensDistortionAlreadyApplied);
 				}
 			}
-
-			// if a single shared texture is used for both eyes, only apply effects on the first Submit
-			if (eyeCount == 0 || textureContainsOnlyOneEye || texture != lastSubmittedTexture) {
-				ApplyPostProcess(textureContainsOnlyOneEye ? eEye : Eye_Left, texture);
+			float cpuApplyMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+			if (framePacingEnabled) {
+				framePacing.AddCpuTime(cpuApplyMs);
+			}
+			if (pipeline.IsInitialized()) {
+				++submitCount;
+				if (Config::Instance().telemetry) {
+					PublishTelemetry(cpuApplyMs);
+				}
+				showHud = Config::Instance().hud;
+				if (showHud && eEye == Eye_Left) {
+					hud.Update(device.Get(), CollectStatistics(cpuApplyMs));
+				}
 			}
-			lastSubmittedTexture = texture;
-			eyeCount = (eyeCount + 1) % 2;
-			const_cast<Texture_t*>(pTexture)->handle = outputTexture;
-			const_cast<Texture_t*>(pTexture)->eColorSpace = inputIsSrgb ? ColorSpace_Gamma : ColorSpace_Auto;
 		}
+		if (!showHud) {
+			hud.Hide();
+		}
+	}
+
+	void PostProcessor::InitFramePacing( IVRCompositor *compositor, float displayFrequency ) {
+		framePacing.SetCompositor(compositor, displayFrequency);
+	}
+
+	void PostProcessor::InitHud( IVROverlay *overlay, IVRCompositor *compositor, float displayFrequency ) {
+		hud.SetInterfaces(overlay, compositor, displayFrequency);
 	}
 
 	void PostProcessor::Reset() {
-		enabled = true;
-		initialized = false;
+		pipeline.Reset();
+	}
+
+	void PostProcessor::PublishTelemetry(float cpuApplyMs) {
+		if (!telemetryPublisher.IsOpen() && !telemetryPublisher.Open()) {
+			return;
+		}
+		telemetryPublisher.Publish(CollectStatistics(cpuApplyMs));
+	}
+
+	telemetry::Snapshot PostProcessor::CollectStatistics(float cpuApplyMs) {
+		const PipelinePlan &plan = pipeline.GetPlan();
+		telemetry::Snapshot snapshot = {};
+		snapshot.frameIndex = submitCount;
+		snapshot.algorithm = plan.useNis ? telemetry::ALGORITHM_NIS : telemetry::ALGORITHM_FSR;
+		snapshot.stageCount = (uint32_t)(std::min)(plan.graph.passes.size(), (size_t)telemetry::MAX_STAGES);
+		for (uint32_t i = 0; i < snapshot.stageCount; ++i) {
+			snapshot.stages[i] = (uint32_t)plan.graph.passes[i].stage;
+			snapshot.stageFusedGrain[i] = plan.graph.passes[i].fusedGrain;
+			snapshot.stageGpuMs[i] = lastStageGpuMs[i];
+		}
+		snapshot.gpuMs = lastGpuMs;
+		snapshot.cpuApplyMs = cpuApplyMs;
+		snapshot.renderScale = plan.constants.renderScale;
+		snapshot.sharpness = plan.constants.sharpness;
+		snapshot.radius = plan.constants.radius;
+		snapshot.inputWidth = plan.inputWidth;
+		snapshot.inputHeight = plan.inputHeight;
+		snapshot.outputWidth = plan.outputWidth;
+		snapshot.outputHeight = plan.outputHeight;
+		snapshot.vramBytesInUse = texturePool.BytesInUse();
+		snapshot.vramBytesCached = texturePool.BytesCached();
+		snapshot.samplerCacheSize = (uint32_t)GetSamplerCacheSize();
+		return snapshot;
+	}
+
+	bool PostProcessor::DescribeInput(void *texture, InputTextureInfo &info) {
+		D3D11_TEXTURE2D_DESC td;
+		((ID3D11Texture2D*)texture)->GetDesc(&td);
+		info.width = td.Width;
+		info.height = td.Height;
+		info.format = MakeSrgbFormatsTypeless(td.Format);
+		info.outputFormat = DetermineOutputFormat(td.Format);
+		info.sampleCount = td.SampleDesc.Count;
+		info.shaderReadable = (td.BindFlags & D3D11_BIND_SHADER_RESOURCE) != 0;
+		info.srgbFormat = IsSrgbFormat(td.Format);
+		info.consideredSrgb = IsConsideredSrgbByOpenVR(td.Format);
+		return true;
+	}
+
+	void PostProcessor::ReleaseResources() {
+		capture.Reset(context.Get());
+		frameDump.Reset(context.Get());
 		device.Reset();
 		context.Reset();
 		sampler.Reset();
 		inputTextureViews.clear();
-		copiedTexture.Reset();
-		copiedTextureView.Reset();
+		if (copiedTexture.texture) {
+			texturePool.Release(copiedTexture);
+			copiedTexture = TexturePool::Texture();
+		}
+		for (const TexturePool::Texture &texture : transientTextures) {
+			if (texture.texture) {
+				texturePool.Release(texture);
+			}
+		}
+		transientTextures.clear();
+		ditherConstantsBuffers.clear();
+		for (int eye = 0; eye < 2; ++eye) {
+			for (const TexturePool::Texture &texture : outputRing[eye]) {
+				texturePool.Release(texture);
+			}
+			outputRing[eye].clear();
+			outputSlot[eye] = 0;
+		}
 		upscaleShader.Reset();
+		upscaleGrainShader.Reset();
 		upscaleConstantsBuffer[0].Reset();
 		upscaleConstantsBuffer[1].Reset();
-		upscaledTexture.Reset();
-		upscaledTextureUav.Reset();
-		upscaledTextureView.Reset();
+		for (int eye = 0; eye < 2; ++eye) {
+			distortionMapTexture[eye].Reset();
+			distortionMapView[eye].Reset();
+			distortionConstantsBuffer[eye].Reset();
+		}
+		lumaShader.Reset();
+		lumaTexture.Reset();
+		lumaView.Reset();
+		lumaUav.Reset();
+		scalerCoeffTexture.Reset();
+		usmCoeffTexture.Reset();
+		scalerCoeffView.Reset();
+		usmCoeffView.Reset();
 		sharpenShader.Reset();
+		sharpenGrainShader.Reset();
 		sharpenConstantsBuffer[0].Reset();
 		sharpenConstantsBuffer[1].Reset();
-		sharpenedTexture.Reset();
-		sharpenedTextureUav.Reset();
-		lastSubmittedTexture = nullptr;
-		outputTexture = nullptr;
-		eyeCount = 0;
+		casShader.Reset();
+		casConstantsBuffer.Reset();
+		grainShader.Reset();
+		grainConstantsBuffer.Reset();
+		classifyShader.Reset();
+		classifyConstantsBuffer.Reset();
+		flatTilesTexture.Reset();
+		flatTilesView.Reset();
+		flatTilesUav.Reset();
+		currentInputTexture = nullptr;
+		currentInputView = nullptr;
 		for (int i = 0; i < QUERY_COUNT; ++i) {
 			profileQueries[i].queryStart.Reset();
 			profileQueries[i].queryEnd.Reset();
 			profileQueries[i].queryDisjoint.Reset();
+			for (uint32_t pass = 0; pass < telemetry::MAX_STAGES; ++pass) {
+				profileQueries[i].queryPass[pass].Reset();
+			}
+			profileQueries[i].pending = false;
+		}
+		currentQuery = 0;
+		pendingQuery = 0;
+		timingActive = false;
+		framePacing.Reset();
+	}
+
+	void PostProcessor::UpdateConstants( const PipelinePlan &plan ) {
+		for (int eye = 0; eye < (plan.textureContainsOnlyOneEye ? 2 : 1); ++eye) {
+			if (upscaleConstantsBuffer[eye]) {
+				const void *data = plan.useNis ? (const void*)plan.constants.nisUpscale[eye] : &plan.constants.upscale[eye];
+				context->UpdateSubresource( upscaleConstantsBuffer[eye].Get(), 0, nullptr, data, 0, 0 );
+			}
+			if (sharpenConstantsBuffer[eye]) {
+				const void *data = plan.useNis ? (const void*)plan.constants.nisSharpen[eye] : &plan.constants.sharpen[eye];
+				context->UpdateSubresource( sharpenConstantsBuffer[eye].Get(), 0, nullptr, data, 0, 0 );
+			}
+			if (distortionConstantsBuffer[eye]) {
+				context->UpdateSubresource( distortionConstantsBuffer[eye].Get(), 0, nullptr, &plan.distortion[eye], 0, 0 );
+			}
+		}
+		if (casConstantsBuffer) {
+			context->UpdateSubresource( casConstantsBuffer.Get(), 0, nullptr, &plan.cas, 0, 0 );
 		}
+		if (classifyConstantsBuffer) {
+			context->UpdateSubresource( classifyConstantsBuffer.Get(), 0, nullptr, &plan.classify, 0, 0 );
+		}
+		// the grain amount is taken from the plan every frame in BeginPostProcess
 	}
 
 	void PostProcessor::PrepareCopyResources( DXGI_FORMAT format ) {
-		Log() << "Creating copy texture of size " << inputWidth << "x" << inputHeight << "\n";
-		D3D11_TEXTURE2D_DESC td;
-		td.Width = inputWidth;
-		td.Height = inputHeight;
-		td.MipLevels = 1;
-		td.CPUAccessFlags = 0;
-		td.Usage = D3D11_USAGE_DEFAULT;
-		td.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-		td.Format = MakeSrgbFormatsTypeless(format);
-		td.MiscFlags = 0;
-		td.SampleDesc.Count = 1;
-		td.SampleDesc.Quality = 0;
-		td.ArraySize = 1;
-		CheckResult("Creating copy texture", device->CreateTexture2D( &td, nullptr, copiedTexture.GetAddressOf()));
-		D3D11_SHADER_RESOURCE_VIEW_DESC srv;
-		srv.Format = TranslateTypelessFormats(td.Format);
-		srv.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-		srv.Texture2D.MipLevels = 1;
-		srv.Texture2D.MostDetailedMip = 0;
-		CheckResult("Creating copy SRV", device->CreateShaderResourceView(copiedTexture.Get(), &srv, copiedTextureView.GetAddressOf()));
+		const PipelinePlan &plan = pipeline.GetPlan();
+		TexturePool::Desc desc;
+		desc.width = plan.inputWidth;
+		desc.height = plan.inputHeight;
+		desc.format = MakeSrgbFormatsTypeless(format);
+		desc.viewFormat = TranslateTypelessFormats(desc.format);
+		desc.bindFlags = D3D11_BIND_SHADER_RESOURCE;
+		copiedTexture = texturePool.Acquire(device.Get(), desc, "copy texture");
 	}
 
 	ID3D11ShaderResourceView * PostProcessor::GetInputView( ID3D11Texture2D *inputTexture, int eye ) {
-		if (requiresCopy) {
+		TRACE_SCOPE("PostProcessor::GetInputView");
+		if (pipeline.GetPlan().requiresCopy) {
 			D3D11_TEXTURE2D_DESC td;
 			inputTexture->GetDesc(&td);
 			if (td.SampleDesc.Count > 1) {
-				context->ResolveSubresource(copiedTexture.Get(), 0, inputTexture, 0, td.Format);
+				context->ResolveSubresource(copiedTexture.texture.Get(), 0, inputTexture, 0, td.Format);
 			} else {
 				D3D11_BOX region;
 				region.left = region.top = region.front = 0;
 				region.right = td.Width;
 				region.bottom = td.Height;
 				region.back = 1;
-				context->CopySubresourceRegion(copiedTexture.Get(), 0, 0, 0, 0, inputTexture, 0, &region);
+				context->CopySubresourceRegion(copiedTexture.texture.Get(), 0, 0, 0, 0, inputTexture, 0, &region);
 			}
-			return copiedTextureView.Get();
+			return copiedTexture.view.Get();
 		}
 		
 		if (inputTextureViews.find(inputTexture) == inputTextureViews.end()) {
-			Log() << "Creating shader resource view for input texture " << inputTexture << std::endl;
+			Log() << "Creating shader resource view for input texture " << inputTexture;
 			// create resource view for input texture
 			D3D11_TEXTURE2D_DESC std;
 			inputTexture->GetDesc( &std );
-			Log() << "Texture has size " << std.Width << "x" << std.Height << " and format " << std.Format << "\n";
+			Log() << "Texture has size " << std.Width << "x" << std.Height << " and format " << std.Format;
 			D3D11_SHADER_RESOURCE_VIEW_DESC svd;
 			svd.Format = TranslateTypelessFormats(std.Format);
 			svd.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
@@ -247,14 +389,14 @@ namespace vr {
 			EyeViews &views = inputTextureViews[inputTexture];
 			HRESULT result = device->CreateShaderResourceView( inputTexture, &svd, views.view[0].GetAddressOf() );
 			if (FAILED(result)) {
-				Log() << "Failed to create resource view: " << std::hex << (unsigned long)result << std::dec << std::endl;
+				Log(LogLevel::Error) << "Failed to create resource view: " << std::hex << (unsigned long)result << std::dec;
 				inputTextureViews.erase( inputTexture );
 				return nullptr;
 			}
 			if (std.ArraySize > 1) {
 				// if an array texture was submitted, the right eye will be placed in the second entry, so we need
 				// a separate view for that eye
-				Log() << "Texture is an array texture, using separate subview for right eye\n";
+				Log() << "Texture is an array texture, using separate subview for right eye";
 				svd.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
 				svd.Texture2DArray.ArraySize = 1;
 				svd.Texture2DArray.FirstArraySlice = D3D11CalcSubresource( 0, 1, 1 );
@@ -262,7 +404,7 @@ namespace vr {
 				svd.Texture2DArray.MipLevels = 1;
 				result = device->CreateShaderResourceView( inputTexture, &svd, views.view[1].GetAddressOf() );
 				if (FAILED(result)) {
-					Log() << "Failed to create secondary resource view: " << std::hex << (unsigned long)result << std::dec << std::endl;
+					Log(LogLevel::Error) << "Failed to create secondary resource view: " << std::hex << (unsigned long)result << std::dec;
 					inputTextureViews.erase( inputTexture );
 					return nullptr;
 				}
@@ -273,445 +415,781 @@ namespace vr {
 		return inputTextureViews[inputTexture].view[eye].Get();
 	}
 
-	struct UpscaleConstants {
-		AU1 const0[4];
-		AU1 const1[4];
-		AU1 const2[4];
-		AU1 const3[4];
-		AU1 imageCentre[4];
-		AU1 radius[4];
-	};
-	
-	void PostProcessor::PrepareUpscalingResources(DXGI_FORMAT format) {
-		if (Config::Instance().useNis) {
-			CheckResult("Creating NIS upscale shader", device->CreateComputeShader( g_NISUpscaleShader, sizeof(g_NISUpscaleShader), nullptr, upscaleShader.GetAddressOf()));
+	bool PostProcessor::SupportsTypedUavStore(DXGI_FORMAT format) {
+		UINT support = 0;
+		if (FAILED(device->CheckFormatSupport(format, &support)) || !(support & D3D11_FORMAT_SUPPORT_TYPED_UNORDERED_ACCESS_VIEW)) {
+			return false;
+		}
+		D3D11_FEATURE_DATA_FORMAT_SUPPORT2 support2 = { format, 0 };
+		return SUCCEEDED(device->CheckFeatureSupport(D3D11_FEATURE_FORMAT_SUPPORT2, &support2, sizeof(support2)))
+			&& (support2.OutFormatSupport2 & D3D11_FORMAT_SUPPORT2_UAV_TYPED_STORE);
+	}
+
+	void PostProcessor::PrepareTransientTextures(DXGI_FORMAT outputFormat) {
+		const PipelinePlan &plan = pipeline.GetPlan();
+		for (const vr::TransientTexture &texture : plan.graph.textures) {
+			DXGI_FORMAT format = (DXGI_FORMAT)texture.format;
+			if (format != outputFormat && !SupportsTypedUavStore(format)) {
+				Log() << "Intermediate format " << format << " can't be written by the shaders, using " << outputFormat << " instead";
+				format = outputFormat;
+			}
+
+			TexturePool::Desc desc;
+			desc.width = texture.width;
+			desc.height = texture.height;
+			desc.format = format;
+			desc.viewFormat = format;
+			desc.bindFlags = D3D11_BIND_UNORDERED_ACCESS|D3D11_BIND_SHADER_RESOURCE;
+			if (texture.isOutput) {
+				// a shared texture is processed once per frame, as the left eye
+				for (int eye = 0; eye < (plan.textureContainsOnlyOneEye ? 2 : 1); ++eye) {
+					for (int slot = 0; slot < plan.outputRingSize; ++slot) {
+						outputRing[eye].push_back(texturePool.Acquire(device.Get(), desc, "output texture"));
+					}
+				}
+				transientTextures.push_back(TexturePool::Texture());
+			} else {
+				transientTextures.push_back(texturePool.Acquire(device.Get(), desc, "intermediate texture"));
+			}
+
+			// rounded to the format the texture actually ended up in
+			DitherConstants dither = {};
+			if (texture.dither) {
+				GetDitherLevels(format, dither.levels);
+			}
+			D3D11_BUFFER_DESC bd;
+			bd.Usage = D3D11_USAGE_IMMUTABLE;
+			bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+			bd.CPUAccessFlags = 0;
+			bd.MiscFlags = 0;
+			bd.StructureByteStride = 0;
+			bd.ByteWidth = sizeof(DitherConstants);
+			D3D11_SUBRESOURCE_DATA initData;
+			initData.pSysMem = &dither;
+			initData.SysMemPitch = sizeof(DitherConstants);
+			initData.SysMemSlicePitch = 0;
+			ComPtr<ID3D11Buffer> buffer;
+			CheckResult("Creating dither constants buffer", device->CreateBuffer( &bd, &initData, buffer.GetAddressOf()));
+			ditherConstantsBuffers.push_back(buffer);
+		}
+		if (plan.outputRingSize > 1) {
+			Log() << "Rotating " << plan.outputRingSize << " output textures per eye";
+		}
+	}
+
+	ComPtr<ID3D11ComputeShader> PostProcessor::GetComputeShader( const char *name, const void *bytecode, size_t size ) {
+		if (shaderCacheDevice != device) {
+			shaderCache.clear();
+			shaderCacheDevice = device;
+		}
+		ComPtr<ID3D11ComputeShader> &shader = shaderCache[bytecode];
+		if (!shader) {
+			Log(LogLevel::Debug) << "Creating " << name;
+			CheckResult(std::string("Creating ") + name, device->CreateComputeShader( bytecode, size, nullptr, shader.GetAddressOf()));
+		}
+		return shader;
+	}
+
+	void PostProcessor::PrepareUpscalingResources(bool fusedGrain) {
+		const PipelinePlan &plan = pipeline.GetPlan();
+		if (plan.useNis) {
+			upscaleShader = GetComputeShader("NIS upscale shader", g_NISUpscaleShader, sizeof(g_NISUpscaleShader));
+		} else if (plan.lensDistortion) {
+			upscaleShader = GetComputeShader("FSR lens distortion shader", g_FSRUpscaleDistortShader, sizeof(g_FSRUpscaleDistortShader));
+			if (fusedGrain) {
+				upscaleGrainShader = GetComputeShader("FSR lens distortion shader with grain", g_FSRUpscaleDistortGrainShader, sizeof(g_FSRUpscaleDistortGrainShader));
+			}
+			PrepareDistortionResources();
+		} else if (plan.supersample) {
+			upscaleShader = GetComputeShader("FSR supersampling shader", g_FSRUpscaleSupersampleShader, sizeof(g_FSRUpscaleSupersampleShader));
+			if (fusedGrain) {
+				upscaleGrainShader = GetComputeShader("FSR supersampling shader with grain", g_FSRUpscaleSupersampleGrainShader, sizeof(g_FSRUpscaleSupersampleGrainShader));
+			}
+		} else if (plan.lumaUpscale) {
+			upscaleShader = GetComputeShader("FSR luma upscale shader", g_FSRUpscaleLumaShader, sizeof(g_FSRUpscaleLumaShader));
+			if (fusedGrain) {
+				upscaleGrainShader = GetComputeShader("FSR luma upscale shader with grain", g_FSRUpscaleLumaGrainShader, sizeof(g_FSRUpscaleLumaGrainShader));
+			}
+			PrepareLumaResources();
 		} else {
-			CheckResult("Creating FSR upscale shader", device->CreateComputeShader( g_FSRUpscaleShader, sizeof(g_FSRUpscaleShader), nullptr, upscaleShader.GetAddressOf()));
-		}
-
-		// set up shader constants
-		float proj[4];
-		CalculateProjectionCenter(Eye_Left, proj[0], proj[1]);
-		CalculateProjectionCenter(Eye_Right, proj[2], proj[3]);
-		UpscaleConstants constants;
-		FsrEasuCon(constants.const0, constants.const1, constants.const2, constants.const3, inputWidth, inputHeight, inputWidth, inputHeight, outputWidth, outputHeight);
-		constants.imageCentre[0] = textureContainsOnlyOneEye ? outputWidth * proj[0] : outputWidth / 2 * proj[0];
-		constants.imageCentre[1] = outputHeight * proj[1];
-		constants.imageCentre[2] = textureContainsOnlyOneEye ? outputWidth * proj[0] : outputWidth / 2 * (1 + proj[2]);
-		constants.imageCentre[3] = outputHeight * (textureContainsOnlyOneEye ? proj[1] : proj[3]);
-		constants.radius[0] = 0.5f * Config::Instance().radius * outputHeight;
-		constants.radius[1] = constants.radius[0] * constants.radius[0];
-		constants.radius[2] = outputWidth;
-		constants.radius[3] = outputHeight;
-
-		NISConfig nisConfig;
-		NVScalerUpdateConfig( nisConfig, Config::Instance().sharpness, 0, 0, inputWidth, inputHeight, inputWidth, inputHeight, 0, 0, outputWidth, outputHeight, outputWidth, outputHeight );
-		nisConfig.reserved1 = Config::Instance().debugMode ? 1.f : 0.f;
-		memcpy(&nisConfig.imageCentre[0], &constants.imageCentre[0], sizeof(AU1) * 8);
-
-		// create shader constants buffers
+			upscaleShader = GetComputeShader("FSR upscale shader", g_FSRUpscaleShader, sizeof(g_FSRUpscaleShader));
+			if (fusedGrain) {
+				upscaleGrainShader = GetComputeShader("FSR upscale shader with grain", g_FSRUpscaleGrainShader, sizeof(g_FSRUpscaleGrainShader));
+			}
+		}
+
+		// create shader constants buffers, updated by UpdateConstants when only the parameters change
 		D3D11_BUFFER_DESC bd;
-		bd.Usage = D3D11_USAGE_IMMUTABLE;
+		bd.Usage = D3D11_USAGE_DEFAULT;
 		bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
 		bd.CPUAccessFlags = 0;
 		bd.MiscFlags = 0;
 		bd.StructureByteStride = 0;
-		bd.ByteWidth = sizeof(UpscaleConstants);
+		bd.ByteWidth = plan.useNis ? framedump::NIS_CONFIG_SIZE : sizeof(UpscaleConstants);
 		D3D11_SUBRESOURCE_DATA init;
 		init.SysMemPitch = 0;
 		init.SysMemSlicePitch = 0;
-		init.pSysMem = &constants;
+		for (int eye = 0; eye < (plan.textureContainsOnlyOneEye ? 2 : 1); ++eye) {
+			if (plan.useNis) {
+				init.pSysMem = plan.constants.nisUpscale[eye];
+			} else {
+				init.pSysMem = &plan.constants.upscale[eye];
+			}
+			CheckResult("Creating upscale constants buffer", device->CreateBuffer( &bd, &init, upscaleConstantsBuffer[eye].GetAddressOf()));
+		}
+
+		if (plan.useNis) {
+			Log() << "Creating NIS coefficients lookup textures";
+			D3D11_TEXTURE2D_DESC td;
+			td.Width = kFilterSize / 4;
+			td.Height = kPhaseCount;
+			td.MipLevels = 1;
+			td.CPUAccessFlags = 0;
+			td.Usage = D3D11_USAGE_DEFAULT;
+			td.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+			td.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+			td.MiscFlags = 0;
+			td.SampleDesc.Count = 1;
+			td.SampleDesc.Quality = 0;
+			td.ArraySize = 1;
+			D3D11_SUBRESOURCE_DATA texData;
+			texData.pSysMem = coef_scale;
+			texData.SysMemPitch = kFilterSize * 4;
+			texData.SysMemSlicePitch = kFilterSize * 4 * kPhaseCount;
+			CheckResult("Creating NIS upscale coefficients texture", device->CreateTexture2D( &td, &texData, scalerCoeffTexture.GetAddressOf() ));
+			D3D11_SHADER_RESOURCE_VIEW_DESC srv;
+			srv.Format = td.Format;
+			srv.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+			srv.Texture2D.MipLevels = 1;
+			srv.Texture2D.MostDetailedMip = 0;
+			CheckResult("Creating NIS upscale coefficients view", device->CreateShaderResourceView( scalerCoeffTexture.Get(), &srv, scalerCoeffView.GetAddressOf() ));
+			texData.pSysMem = coef_usm;
+			CheckResult("Creating NIS USM coefficients texture", device->CreateTexture2D( &td, &texData, usmCoeffTexture.GetAddressOf() ));
+			CheckResult("Creating NIS USM coefficients view", device->CreateShaderResourceView( usmCoeffTexture.Get(), &srv, usmCoeffView.GetAddressOf() ));
+		}
+	}
 
-		if (Config::Instance().useNis) {
-			init.pSysMem = &nisConfig;
-			bd.ByteWidth = sizeof(NISConfig);
+	void PostProcessor::PrepareDistortionResources() {
+		const PipelinePlan &plan = pipeline.GetPlan();
+		D3D11_TEXTURE2D_DESC td;
+		td.Width = plan.distortionMap[0].width;
+		td.Height = plan.distortionMap[0].height;
+		td.MipLevels = 1;
+		td.CPUAccessFlags = 0;
+		td.Usage = D3D11_USAGE_IMMUTABLE;
+		td.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		td.Format = DXGI_FORMAT_R32G32_FLOAT;
+		td.MiscFlags = 0;
+		td.SampleDesc.Count = 1;
+		td.SampleDesc.Quality = 0;
+		// one slice per channel
+		td.ArraySize = 3;
+		D3D11_SHADER_RESOURCE_VIEW_DESC srv;
+		srv.Format = td.Format;
+		srv.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+		srv.Texture2DArray.MostDetailedMip = 0;
+		srv.Texture2DArray.MipLevels = 1;
+		srv.Texture2DArray.FirstArraySlice = 0;
+		srv.Texture2DArray.ArraySize = 3;
+		for (int eye = 0; eye < 2; ++eye) {
+			const DistortionMap &map = plan.distortionMap[eye];
+			D3D11_SUBRESOURCE_DATA texData[3];
+			for (int ch = 0; ch < 3; ++ch) {
+				texData[ch].pSysMem = map.Plane(ch);
+				texData[ch].SysMemPitch = map.width * 2 * sizeof(float);
+				texData[ch].SysMemSlicePitch = 0;
+			}
+			CheckResult("Creating lens distortion map", device->CreateTexture2D( &td, texData, distortionMapTexture[eye].GetAddressOf() ));
+			CheckResult("Creating lens distortion map view", device->CreateShaderResourceView( distortionMapTexture[eye].Get(), &srv, distortionMapView[eye].GetAddressOf() ));
 		}
 
-		CheckResult("Creating upscale constants buffer", device->CreateBuffer( &bd, &init, upscaleConstantsBuffer[0].GetAddressOf()));
-		if (textureContainsOnlyOneEye) {
-			constants.imageCentre[0] = outputWidth * proj[2];
-			constants.imageCentre[1] = outputHeight * proj[3];
-			constants.imageCentre[2] = outputWidth * proj[2];
-			constants.imageCentre[3] = outputHeight * proj[3];
-			memcpy(&nisConfig.imageCentre[0], &constants.imageCentre[0], sizeof(AU1) * 4);
-			CheckResult("Creating upscale constants buffer", device->CreateBuffer( &bd, &init, upscaleConstantsBuffer[1].GetAddressOf()));
+		// per eye, updated by UpdateConstants when the bounds an eye is submitted with change
+		D3D11_BUFFER_DESC bd;
+		bd.Usage = D3D11_USAGE_DEFAULT;
+		bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		bd.CPUAccessFlags = 0;
+		bd.MiscFlags = 0;
+		bd.StructureByteStride = 0;
+		bd.ByteWidth = sizeof(DistortionConstants);
+		D3D11_SUBRESOURCE_DATA init;
+		init.SysMemPitch = 0;
+		init.SysMemSlicePitch = 0;
+		for (int eye = 0; eye < 2; ++eye) {
+			init.pSysMem = &plan.distortion[eye];
+			CheckResult("Creating lens distortion constants buffer", device->CreateBuffer( &bd, &init, distortionConstantsBuffer[eye].GetAddressOf() ));
 		}
+	}
 
-		Log() << "Creating upscaled texture of size " << outputWidth << "x" << outputHeight << "\n";
+	void PostProcessor::PrepareLumaResources() {
+		const PipelinePlan &plan = pipeline.GetPlan();
+		lumaShader = GetComputeShader("FSR luma shader", g_FSRLumaShader, sizeof(g_FSRLumaShader));
+
+		// the upscale reads the input at its full size, both eyes if they share the texture
 		D3D11_TEXTURE2D_DESC td;
-		td.Width = outputWidth;
-		td.Height = outputHeight;
+		td.Width = plan.inputWidth;
+		td.Height = plan.inputHeight;
 		td.MipLevels = 1;
 		td.CPUAccessFlags = 0;
 		td.Usage = D3D11_USAGE_DEFAULT;
-		td.BindFlags = D3D11_BIND_UNORDERED_ACCESS|D3D11_BIND_SHADER_RESOURCE;
-		td.Format = format;
+		td.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+		td.Format = DXGI_FORMAT_R16_FLOAT;
 		td.MiscFlags = 0;
 		td.SampleDesc.Count = 1;
 		td.SampleDesc.Quality = 0;
 		td.ArraySize = 1;
-		CheckResult("Creating upscaled texture", device->CreateTexture2D( &td, nullptr, upscaledTexture.GetAddressOf()));
-		D3D11_UNORDERED_ACCESS_VIEW_DESC uav;
-		uav.Format = format;
-		uav.ViewDimension = D3D11_UAV_DIMENSION_TEXTURE2D;
-		uav.Texture2D.MipSlice = 0;
-		CheckResult("Creating upscaled UAV", device->CreateUnorderedAccessView( upscaledTexture.Get(), &uav, upscaledTextureUav.GetAddressOf()));
+		CheckResult("Creating luma texture", device->CreateTexture2D( &td, nullptr, lumaTexture.GetAddressOf() ));
 		D3D11_SHADER_RESOURCE_VIEW_DESC srv;
-		srv.Format = format;
+		srv.Format = td.Format;
 		srv.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
 		srv.Texture2D.MipLevels = 1;
 		srv.Texture2D.MostDetailedMip = 0;
-		CheckResult("Creating upscaled SRV", device->CreateShaderResourceView(upscaledTexture.Get(), &srv, upscaledTextureView.GetAddressOf()));
-
-		if (Config::Instance().useNis) {
-			Log() << "Creating NIS coefficients lookup textures\n";
-			td.Width = kFilterSize / 4;
-			td.Height = kPhaseCount;
-			td.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
-			td.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-			D3D11_SUBRESOURCE_DATA texData;
-			texData.pSysMem = coef_scale;
-			texData.SysMemPitch = kFilterSize * 4;
-			texData.SysMemSlicePitch = kFilterSize * 4 * kPhaseCount;
-			CheckResult("Creating NIS upscale coefficients texture", device->CreateTexture2D( &td, &texData, scalerCoeffTexture.GetAddressOf() ));
-			srv.Format = td.Format;
-			CheckResult("Creating NIS upscale coefficients view", device->CreateShaderResourceView( scalerCoeffTexture.Get(), &srv, scalerCoeffView.GetAddressOf() ));
-			texData.pSysMem = coef_usm;
-			CheckResult("Creating NIS USM coefficients texture", device->CreateTexture2D( &td, &texData, usmCoeffTexture.GetAddressOf() ));
-			CheckResult("Creating NIS USM coefficients view", device->CreateShaderResourceView( usmCoeffTexture.Get(), &srv, usmCoeffView.GetAddressOf() ));
-		}
+		CheckResult("Creating luma view", device->CreateShaderResourceView( lumaTexture.Get(), &srv, lumaView.GetAddressOf() ));
+		D3D11_UNORDERED_ACCESS_VIEW_DESC uav;
+		uav.Format = td.Format;
+		uav.ViewDimension = D3D11_UAV_DIMENSION_TEXTURE2D;
+		uav.Texture2D.MipSlice = 0;
+		CheckResult("Creating luma UAV", device->CreateUnorderedAccessView( lumaTexture.Get(), &uav, lumaUav.GetAddressOf() ));
 	}
 
-	void PostProcessor::ApplyUpscaling( EVREye eEye, ID3D11ShaderResourceView *inputView ) {
+	void PostProcessor::ApplyUpscaling( EVREye eEye, const PipelinePass &pass, ID3D11ShaderResourceView *inputView, ID3D11UnorderedAccessView *outputView ) {
+		TRACE_SCOPE("PostProcessor::ApplyUpscaling");
 		UINT uavCount = -1;
-		context->CSSetUnorderedAccessViews( 0, 1, upscaledTextureUav.GetAddressOf(), &uavCount );
+		if (lumaShader) {
+			// the luma prepass; binding the output below unbinds its UAV before the luma is read
+			context->CSSetUnorderedAccessViews( 0, 1, lumaUav.GetAddressOf(), &uavCount );
+			context->CSSetShaderResources( 0, 1, &inputView );
+			context->CSSetShader( lumaShader.Get(), nullptr, 0 );
+			const PipelinePlan &plan = pipeline.GetPlan();
+			context->Dispatch( (plan.inputWidth+7)>>3, (plan.inputHeight+7)>>3, 1 );
+		}
+		context->CSSetUnorderedAccessViews( 0, 1, &outputView, &uavCount );
 		context->CSSetConstantBuffers( 0, 1, upscaleConstantsBuffer[eEye].GetAddressOf() );
 		ID3D11ShaderResourceView *srvs[1] = {inputView};
 		context->CSSetShaderResources( 0, 1, srvs );
-		context->CSSetShader( upscaleShader.Get(), nullptr, 0 );
+		context->CSSetShader( pass.fusedGrain ? upscaleGrainShader.Get() : upscaleShader.Get(), nullptr, 0 );
 		context->CSSetSamplers( 0, 1, sampler.GetAddressOf() );
 
-		if (Config::Instance().useNis) {
+		if (pipeline.GetPlan().useNis) {
 			context->CSSetShaderResources( 1, 1, scalerCoeffView.GetAddressOf() );
 			context->CSSetShaderResources( 2, 1, usmCoeffView.GetAddressOf() );
-			context->Dispatch( (UINT)std::ceil(outputWidth / 32.f), (UINT)std::ceil(outputHeight / 24.f), 1 );
+			context->Dispatch( (UINT)std::ceil(pass.width / 32.f), (UINT)std::ceil(pass.height / 24.f), 1 );
 		} else {
-			context->Dispatch( (outputWidth+15)>>4, (outputHeight+15)>>4, 1 );
+			if (distortionMapView[eEye]) {
+				context->CSSetShaderResources( 1, 1, distortionMapView[eEye].GetAddressOf() );
+				context->CSSetConstantBuffers( 3, 1, distortionConstantsBuffer[eEye].GetAddressOf() );
+			}
+			if (lumaView) {
+				context->CSSetShaderResources( 2, 1, lumaView.GetAddressOf() );
+			}
+			BindFlatTiles(pass);
+			context->Dispatch( (pass.width+15)>>4, (pass.height+15)>>4, 1 );
 		}
 	}
 
-	struct SharpenConstants {
-		AU1 const0[4];
-		AU1 imageCentre[4];
-		AU1 radius[4];
-	};
-
-	void PostProcessor::PrepareSharpeningResources(DXGI_FORMAT format) {
-		if (Config::Instance().useNis) {
-			CheckResult("Creating NIS sharpening shader", device->CreateComputeShader( g_NISSharpenShader, sizeof(g_NISSharpenShader), nullptr, sharpenShader.GetAddressOf()));
+	void PostProcessor::PrepareSharpeningResources(bool fusedGrain) {
+		const PipelinePlan &plan = pipeline.GetPlan();
+		if (plan.useNis) {
+			sharpenShader = GetComputeShader("NIS sharpening shader", g_NISSharpenShader, sizeof(g_NISSharpenShader));
 		} else {
-			CheckResult("Creating rCAS sharpening shader", device->CreateComputeShader( g_FSRSharpenShader, sizeof(g_FSRSharpenShader), nullptr, sharpenShader.GetAddressOf()));
-		}
-
-		float proj[4];
-		CalculateProjectionCenter(Eye_Left, proj[0], proj[1]);
-		CalculateProjectionCenter(Eye_Right, proj[2], proj[3]);
-		SharpenConstants constants;
-		float sharpness = AClampF1( Config::Instance().sharpness, 0, 1 );
-		FsrRcasCon(constants.const0, 2.f - 2*sharpness);
-		constants.imageCentre[0] = textureContainsOnlyOneEye ? outputWidth * proj[0] : outputWidth / 2 * proj[0];
-		constants.imageCentre[1] = outputHeight * proj[1];
-		constants.imageCentre[2] = textureContainsOnlyOneEye ? outputWidth * proj[0] : outputWidth / 2 * (1 + proj[2]);
-		constants.imageCentre[3] = outputHeight * (textureContainsOnlyOneEye ? proj[1] : proj[3]);
-		constants.radius[0] = 0.5f * Config::Instance().radius * outputHeight;
-		constants.radius[1] = constants.radius[0] * constants.radius[0];
-		constants.radius[2] = outputWidth;
-		constants.radius[3] = outputHeight;
-		constants.const0[3] = Config::Instance().debugMode;
-
-		NISConfig nisConfig;
-		NVSharpenUpdateConfig( nisConfig, Config::Instance().sharpness, 0, 0, inputWidth, inputHeight, inputWidth, inputHeight, 0, 0 );
-		nisConfig.reserved1 = Config::Instance().debugMode ? 1.f : 0.f;
-		memcpy(&nisConfig.imageCentre[0], &constants.imageCentre[0], sizeof(AU1) * 8);
+			sharpenShader = GetComputeShader("rCAS sharpening shader", g_FSRSharpenShader, sizeof(g_FSRSharpenShader));
+			if (fusedGrain) {
+				sharpenGrainShader = GetComputeShader("rCAS sharpening shader with grain", g_FSRSharpenGrainShader, sizeof(g_FSRSharpenGrainShader));
+			}
+		}
 
 		D3D11_BUFFER_DESC bd;
-		bd.Usage = D3D11_USAGE_IMMUTABLE;
+		bd.Usage = D3D11_USAGE_DEFAULT;
 		bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
 		bd.CPUAccessFlags = 0;
 		bd.MiscFlags = 0;
 		bd.StructureByteStride = 0;
-		bd.ByteWidth = sizeof(SharpenConstants);
+		bd.ByteWidth = plan.useNis ? framedump::NIS_CONFIG_SIZE : sizeof(SharpenConstants);
 		D3D11_SUBRESOURCE_DATA init;
 		init.SysMemPitch = 0;
 		init.SysMemSlicePitch = 0;
-		init.pSysMem = &constants;
-		if (Config::Instance().useNis) {
-			init.pSysMem = &nisConfig;
-			bd.ByteWidth = sizeof(NISConfig);
-		}
-		CheckResult("Creating sharpen constants buffer", device->CreateBuffer( &bd, &init, sharpenConstantsBuffer[0].GetAddressOf()));
-		if (textureContainsOnlyOneEye) {
-			constants.imageCentre[0] = outputWidth * proj[2];
-			constants.imageCentre[1] = outputHeight * proj[3];
-			constants.imageCentre[2] = outputWidth * proj[2];
-			constants.imageCentre[3] = outputHeight * proj[3];
-			memcpy(&nisConfig.imageCentre[0], &constants.imageCentre[0], sizeof(AU1) * 4);
-			CheckResult("Creating sharpen constants buffer", device->CreateBuffer( &bd, &init, sharpenConstantsBuffer[1].GetAddressOf()));
+		for (int eye = 0; eye < (plan.textureContainsOnlyOneEye ? 2 : 1); ++eye) {
+			if (plan.useNis) {
+				init.pSysMem = plan.constants.nisSharpen[eye];
+			} else {
+				init.pSysMem = &plan.constants.sharpen[eye];
+			}
+			CheckResult("Creating sharpen constants buffer", device->CreateBuffer( &bd, &init, sharpenConstantsBuffer[eye].GetAddressOf()));
 		}
-		
-		Log() << "Creating sharpened texture of size " << outputWidth << "x" << outputHeight << "\n";
+	}
+
+	void PostProcessor::ApplySharpening( EVREye eEye, const PipelinePass &pass, ID3D11ShaderResourceView *inputView, ID3D11UnorderedAccessView *outputView ) {
+		TRACE_SCOPE("PostProcessor::ApplySharpening");
+		UINT uavCount = -1;
+		context->CSSetUnorderedAccessViews( 0, 1, &outputView, &uavCount );
+		context->CSSetConstantBuffers( 0, 1, sharpenConstantsBuffer[eEye].GetAddressOf() );
+		ID3D11ShaderResourceView *srvs[1] = {inputView};
+		context->CSSetShaderResources( 0, 1, srvs );
+		context->CSSetSamplers( 0, 1, sampler.GetAddressOf() );
+		context->CSSetShader( pass.fusedGrain ? sharpenGrainShader.Get() : sharpenShader.Get(), nullptr, 0 );
+		if (pipeline.GetPlan().useNis) {
+			context->Dispatch( (UINT)std::ceil(pass.width / 32.f), (UINT)std::ceil(pass.height / 32.f), 1 );
+		} else {
+			BindFlatTiles(pass);
+			context->Dispatch( (pass.width+15)>>4, (pass.height+15)>>4, 1 );
+		}
+	}
+
+	void PostProcessor::PrepareCasResources() {
+		casShader = GetComputeShader("CAS sharpening shader", g_CASSharpenShader, sizeof(g_CASSharpenShader));
+
+		D3D11_BUFFER_DESC bd;
+		bd.Usage = D3D11_USAGE_DEFAULT;
+		bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		bd.CPUAccessFlags = 0;
+		bd.MiscFlags = 0;
+		bd.StructureByteStride = 0;
+		bd.ByteWidth = sizeof(CasConstants);
+		D3D11_SUBRESOURCE_DATA init;
+		init.pSysMem = &pipeline.GetPlan().cas;
+		init.SysMemPitch = 0;
+		init.SysMemSlicePitch = 0;
+		CheckResult("Creating CAS constants buffer", device->CreateBuffer( &bd, &init, casConstantsBuffer.GetAddressOf()));
+	}
+
+	void PostProcessor::ApplyCas( const PipelinePass &pass, ID3D11ShaderResourceView *inputView, ID3D11UnorderedAccessView *outputView ) {
+		TRACE_SCOPE("PostProcessor::ApplyCas");
+		UINT uavCount = -1;
+		context->CSSetUnorderedAccessViews( 0, 1, &outputView, &uavCount );
+		context->CSSetConstantBuffers( 0, 1, casConstantsBuffer.GetAddressOf() );
+		ID3D11ShaderResourceView *srvs[1] = {inputView};
+		context->CSSetShaderResources( 0, 1, srvs );
+		context->CSSetShader( casShader.Get(), nullptr, 0 );
+		context->Dispatch( (pass.width+15)>>4, (pass.height+15)>>4, 1 );
+	}
+
+	void PostProcessor::PrepareClassificationResources() {
+		const PipelinePlan &plan = pipeline.GetPlan();
+		classifyShader = GetComputeShader("tile classification shader", g_FSRClassifyShader, sizeof(g_FSRClassifyShader));
+
 		D3D11_TEXTURE2D_DESC td;
-		td.Width = outputWidth;
-		td.Height = outputHeight;
+		td.Width = (plan.outputWidth + 15) >> 4;
+		td.Height = (plan.outputHeight + 15) >> 4;
 		td.MipLevels = 1;
 		td.CPUAccessFlags = 0;
 		td.Usage = D3D11_USAGE_DEFAULT;
-		td.BindFlags = D3D11_BIND_UNORDERED_ACCESS|D3D11_BIND_SHADER_RESOURCE;
-		td.Format = format;
+		td.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+		td.Format = DXGI_FORMAT_R8_UINT;
 		td.MiscFlags = 0;
 		td.SampleDesc.Count = 1;
 		td.SampleDesc.Quality = 0;
 		td.ArraySize = 1;
-		CheckResult("Creating sharpened texture", device->CreateTexture2D( &td, nullptr, sharpenedTexture.GetAddressOf()));
+		CheckResult("Creating flat tiles texture", device->CreateTexture2D( &td, nullptr, flatTilesTexture.GetAddressOf() ));
+		D3D11_SHADER_RESOURCE_VIEW_DESC srv;
+		srv.Format = td.Format;
+		srv.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+		srv.Texture2D.MipLevels = 1;
+		srv.Texture2D.MostDetailedMip = 0;
+		CheckResult("Creating flat tiles view", device->CreateShaderResourceView( flatTilesTexture.Get(), &srv, flatTilesView.GetAddressOf() ));
 		D3D11_UNORDERED_ACCESS_VIEW_DESC uav;
-		uav.Format = format;
+		uav.Format = td.Format;
 		uav.ViewDimension = D3D11_UAV_DIMENSION_TEXTURE2D;
 		uav.Texture2D.MipSlice = 0;
-		CheckResult("Creating sharpened UAV", device->CreateUnorderedAccessView( sharpenedTexture.Get(), &uav, sharpenedTextureUav.GetAddressOf()));
+		CheckResult("Creating flat tiles UAV", device->CreateUnorderedAccessView( flatTilesTexture.Get(), &uav, flatTilesUav.GetAddressOf() ));
+
+		D3D11_BUFFER_DESC bd;
+		bd.Usage = D3D11_USAGE_DEFAULT;
+		bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		bd.CPUAccessFlags = 0;
+		bd.MiscFlags = 0;
+		bd.StructureByteStride = 0;
+		bd.ByteWidth = sizeof(ClassifyConstants);
+		D3D11_SUBRESOURCE_DATA init;
+		init.pSysMem = &plan.classify;
+		init.SysMemPitch = 0;
+		init.SysMemSlicePitch = 0;
+		CheckResult("Creating tile classification constants buffer", device->CreateBuffer( &bd, &init, classifyConstantsBuffer.GetAddressOf()));
 	}
 
-	void PostProcessor::ApplySharpening( EVREye eEye, ID3D11ShaderResourceView *inputView ) {
+	void PostProcessor::ClassifyTiles() {
+		TRACE_SCOPE("PostProcessor::ClassifyTiles");
 		UINT uavCount = -1;
-		context->CSSetUnorderedAccessViews( 0, 1, sharpenedTextureUav.GetAddressOf(), &uavCount );
-		context->CSSetConstantBuffers( 0, 1, sharpenConstantsBuffer[eEye].GetAddressOf() );
+		context->CSSetUnorderedAccessViews( 0, 1, flatTilesUav.GetAddressOf(), &uavCount );
+		context->CSSetConstantBuffers( 0, 1, classifyConstantsBuffer.GetAddressOf() );
+		context->CSSetShaderResources( 0, 1, &currentInputView );
+		context->CSSetShader( classifyShader.Get(), nullptr, 0 );
+		const PipelinePlan &plan = pipeline.GetPlan();
+		context->Dispatch( (plan.outputWidth+15)>>4, (plan.outputHeight+15)>>4, 1 );
+	}
+
+	void PostProcessor::BindFlatTiles( const PipelinePass &pass ) {
+		ID3D11ShaderResourceView *view = pass.skipFlatTiles ? flatTilesView.Get() : nullptr;
+		context->CSSetShaderResources( 3, 1, &view );
+	}
+
+	void PostProcessor::PrepareGrainResources(bool standalonePass) {
+		if (standalonePass) {
+			grainShader = GetComputeShader("grain shader", g_FSRGrainShader, sizeof(g_FSRGrainShader));
+		}
+
+		// the seed changes every frame, so this one is updated in BeginPostProcess
+		D3D11_BUFFER_DESC bd;
+		bd.Usage = D3D11_USAGE_DEFAULT;
+		bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		bd.CPUAccessFlags = 0;
+		bd.MiscFlags = 0;
+		bd.StructureByteStride = 0;
+		bd.ByteWidth = sizeof(GrainConstants);
+		CheckResult("Creating grain constants buffer", device->CreateBuffer( &bd, nullptr, grainConstantsBuffer.GetAddressOf()));
+	}
+
+	void PostProcessor::ApplyGrain( const PipelinePass &pass, ID3D11ShaderResourceView *inputView, ID3D11UnorderedAccessView *outputView ) {
+		TRACE_SCOPE("PostProcessor::ApplyGrain");
+		UINT uavCount = -1;
+		context->CSSetUnorderedAccessViews( 0, 1, &outputView, &uavCount );
 		ID3D11ShaderResourceView *srvs[1] = {inputView};
 		context->CSSetShaderResources( 0, 1, srvs );
-		context->CSSetSamplers( 0, 1, sampler.GetAddressOf() );
-		context->CSSetShader( sharpenShader.Get(), nullptr, 0 );
-		if (Config::Instance().useNis) {
-			context->Dispatch( (UINT)std::ceil(outputWidth / 32.f), (UINT)std::ceil(outputHeight / 32.f), 1 );
-		} else {
-			context->Dispatch( (outputWidth+15)>>4, (outputHeight+15)>>4, 1 );
-		}
+		context->CSSetShader( grainShader.Get(), nullptr, 0 );
+		context->Dispatch( (pass.width+7)>>3, (pass.height+7)>>3, 1 );
 	}
 
-	void PostProcessor::PrepareResources( ID3D11Texture2D *inputTexture, EColorSpace colorSpace ) {
-		Log() << "Creating post-processing resources\n";
+	void PostProcessor::PrepareResources( void *texture, const PipelinePlan &plan ) {
+		ID3D11Texture2D *inputTexture = (ID3D11Texture2D*)texture;
 		inputTexture->GetDevice( device.GetAddressOf() );
 		device->GetImmediateContext( context.GetAddressOf() );
 		D3D11_TEXTURE2D_DESC std;
 		inputTexture->GetDesc( &std );
-		inputIsSrgb = colorSpace == ColorSpace_Gamma || (colorSpace == ColorSpace_Auto && IsConsideredSrgbByOpenVR(std.Format));
-		if (inputIsSrgb) {
-			Log() << "Input texture is in SRGB color space\n";
+
+		if (plan.requiresCopy) {
+			PrepareCopyResources(std.Format);
 		}
 
-		inputWidth = std.Width;
-		inputHeight = std.Height;
+		DXGI_FORMAT textureFormat = (DXGI_FORMAT)plan.constants.outputFormat;
+		Log() << "Creating output textures in format " << textureFormat;
+		PrepareTransientTextures(textureFormat);
 
-		if ( Config::Instance().renderScale < 1.f) {
-			outputWidth = std.Width / Config::Instance().renderScale;
-			outputHeight = std.Height / Config::Instance().renderScale;
-		} else {
-			outputWidth = std.Width * Config::Instance().renderScale;
-			outputHeight = std.Height * Config::Instance().renderScale;
+		// every stage's shader is created once, with the grain variant only if a pass needs it
+		bool hasStage[4] = {};
+		bool hasFusedGrain[4] = {};
+		for (const PipelinePass &pass : plan.graph.passes) {
+			hasStage[(int)pass.stage] = true;
+			hasFusedGrain[(int)pass.stage] |= pass.fusedGrain;
 		}
-
-		if (!(std.BindFlags & D3D11_BIND_SHADER_RESOURCE) || std.SampleDesc.Count > 1 || IsSrgbFormat(std.Format)) {
-			Log() << "Input texture can't be bound directly, need to copy\n";
-			requiresCopy = true;
-			PrepareCopyResources(std.Format);
+		if (hasStage[(int)PipelineStage::Upscale]) {
+			PrepareUpscalingResources(hasFusedGrain[(int)PipelineStage::Upscale]);
+		}
+		if (hasStage[(int)PipelineStage::Sharpen]) {
+			PrepareSharpeningResources(hasFusedGrain[(int)PipelineStage::Sharpen]);
+		}
+		if (hasStage[(int)PipelineStage::Cas]) {
+			PrepareCasResources();
+		}
+		if (hasStage[(int)PipelineStage::Grain] || hasFusedGrain[(int)PipelineStage::Upscale] || hasFusedGrain[(int)PipelineStage::Sharpen]) {
+			PrepareGrainResources(hasStage[(int)PipelineStage::Grain]);
+		}
+		if (plan.classifyTiles) {
+			PrepareClassificationResources();
+		}
+		texturePool.Trim();
+		texturePool.LogUsage();
+
+		if (Config::Instance().applyMIPBias) {
+			float mipLodBias = -log2(plan.outputWidth / (float)plan.inputWidth);
+			HookD3D11Context(context.Get(), device.Get(), mipLodBias);
+			// ensure that all currently set samplers get LOD bias applied, even if the engine
+			// never changes them again
+			ID3D11SamplerState *samplers[D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT];
+			context->PSGetSamplers(0, D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT, samplers);
+			context->PSSetSamplers(0, D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT, samplers);
 		}
 
-		if (Config::Instance().fsrEnabled) {
-			DXGI_FORMAT textureFormat = DetermineOutputFormat(std.Format);
-			Log() << "Creating output textures in format " << textureFormat << "\n";
-			Log() << "Using " << (Config::Instance().useNis ? "NVIDIA Image Scaling" : "AMD FidelityFX SuperResolution") << "\n";
-			if (Config::Instance().renderScale != 1.f) {
-				PrepareUpscalingResources(textureFormat);
-			}
-			if (!Config::Instance().useNis || Config::Instance().renderScale == 1.f) {
-				PrepareSharpeningResources(textureFormat);
-			}
-
-			if (Config::Instance().applyMIPBias) {
-				float mipLodBias = -log2(outputWidth / (float)inputWidth);
-				HookD3D11Context(context.Get(), device.Get(), mipLodBias);
-				// ensure that all currently set samplers get LOD bias applied, even if the engine
-				// never changes them again
-				ID3D11SamplerState *samplers[D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT];
-				context->PSGetSamplers(0, D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT, samplers);
-				context->PSSetSamplers(0, D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT, samplers);
-			}
-
-			if (Config::Instance().debugMode) {
-				for (int i = 0; i < QUERY_COUNT; ++i) {
-					D3D11_QUERY_DESC qd;
-					qd.Query = D3D11_QUERY_TIMESTAMP;
-					qd.MiscFlags = 0;
-					device->CreateQuery(&qd, profileQueries[i].queryStart.GetAddressOf());
-					device->CreateQuery(&qd, profileQueries[i].queryEnd.GetAddressOf());
-					qd.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
-					device->CreateQuery(&qd, profileQueries[i].queryDisjoint.GetAddressOf());
+		gpuTiming = WantsGpuTiming();
+		if (gpuTiming) {
+			for (int i = 0; i < QUERY_COUNT; ++i) {
+				D3D11_QUERY_DESC qd;
+				qd.Query = D3D11_QUERY_TIMESTAMP;
+				qd.MiscFlags = 0;
+				device->CreateQuery(&qd, profileQueries[i].queryStart.GetAddressOf());
+				device->CreateQuery(&qd, profileQueries[i].queryEnd.GetAddressOf());
+				for (uint32_t pass = 0; pass < telemetry::MAX_STAGES; ++pass) {
+					device->CreateQuery(&qd, profileQueries[i].queryPass[pass].GetAddressOf());
 				}
+				qd.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
+				device->CreateQuery(&qd, profileQueries[i].queryDisjoint.GetAddressOf());
 			}
 		}
-
-		initialized = true;
 	}
 
-	void PostProcessor::ApplyPostProcess( EVREye eEye, ID3D11Texture2D *inputTexture ) {
-		ID3D11Buffer* currentConstBuffs[1];
-		ID3D11ShaderResourceView* currentSRVs[3];
-		ID3D11UnorderedAccessView* currentUAVs[1];
-
-		context->CSGetShaderResources(0, 3, currentSRVs);
-		context->CSGetUnorderedAccessViews(0, 1, currentUAVs);
-		context->CSGetConstantBuffers(0, 1, currentConstBuffs);
-
-		outputTexture = inputTexture;
+	bool PostProcessor::BeginPostProcess( EVREye eEye, void *texture, uint32_t frameIndex ) {
+		ID3D11Texture2D *inputTexture = (ID3D11Texture2D*)texture;
+		currentInputView = GetInputView(inputTexture, eEye);
+		if (currentInputView == nullptr) {
+			return false;
+		}
+		currentInputTexture = inputTexture;
+		if (!outputRing[eEye].empty()) {
+			outputSlot[eEye] = (outputSlot[eEye] + 1) % (int)outputRing[eEye].size();
+		}
+		currentOutputEye = eEye;
+
+		context->CSGetShaderResources(0, 4, savedSRVs);
+		context->CSGetUnorderedAccessViews(0, 1, savedUAVs);
+		context->CSGetConstantBuffers(0, 4, savedConstBuffs);
+
+		if (grainConstantsBuffer) {
+			GrainConstants grain;
+			grain.amount = pipeline.GetPlan().grainAmount;
+			grain.seed = frameIndex;
+			grain.padding[0] = grain.padding[1] = 0;
+			context->UpdateSubresource(grainConstantsBuffer.Get(), 0, nullptr, &grain, 0, 0);
+			context->CSSetConstantBuffers(1, 1, grainConstantsBuffer.GetAddressOf());
+		}
 
-		ID3D11ShaderResourceView *inputView = GetInputView(inputTexture, eEye);
-		if (inputView == nullptr) {
-			return;
+		if (frameDump.IsRecording()) {
+			RecordFrameDumpInput(eEye, inputTexture);
 		}
 
-		if (Config::Instance().debugMode) {
+		// all queries still pending means the GPU is several frames behind; skip measuring this one
+		timingActive = gpuTiming && !profileQueries[currentQuery].pending;
+		if (timingActive) {
 			context->Begin(profileQueries[currentQuery].queryDisjoint.Get());
 			context->End(profileQueries[currentQuery].queryStart.Get());
+			profileQueries[currentQuery].frame = framePacing.CurrentFrame();
+			profileQueries[currentQuery].submitFrame = submitFrame;
 		}
+		currentPass = 0;
 
 		context->OMSetRenderTargets(0, nullptr, nullptr);
+		// part of the first pass's time in the statistics
+		if (classifyShader) {
+			ClassifyTiles();
+		}
+		return true;
+	}
 
-		if (Config::Instance().fsrEnabled && Config::Instance().renderScale != 1.f) {
-			ApplyUpscaling(eEye, inputView);
-			inputView = upscaledTextureView.Get();
-			outputTexture = upscaledTexture.Get();
+	void PostProcessor::RunPass( const PipelinePass &pass, EVREye eEye ) {
+		ID3D11ShaderResourceView *inputView = pass.input == INPUT_SURFACE ? currentInputView : GetSurfaceTexture(pass.input).view.Get();
+		ID3D11UnorderedAccessView *outputView = GetSurfaceTexture(pass.output).uav.Get();
+		context->CSSetConstantBuffers( 2, 1, ditherConstantsBuffers[pass.output].GetAddressOf() );
+		switch (pass.stage) {
+		case PipelineStage::Upscale:
+			ApplyUpscaling(eEye, pass, inputView, outputView);
+			break;
+		case PipelineStage::Sharpen:
+			ApplySharpening(eEye, pass, inputView, outputView);
+			break;
+		case PipelineStage::Cas:
+			ApplyCas(pass, inputView, outputView);
+			break;
+		case PipelineStage::Grain:
+			ApplyGrain(pass, inputView, outputView);
+			break;
 		}
-		if (Config::Instance().fsrEnabled && (!Config::Instance().useNis || Config::Instance().renderScale == 1.f)) {
-			ApplySharpening(eEye, inputView);
-			outputTexture = sharpenedTexture.Get();
+		if (timingActive && currentPass < telemetry::MAX_STAGES) {
+			context->End(profileQueries[currentQuery].queryPass[currentPass].Get());
 		}
+		++currentPass;
+	}
 
-		context->CSSetShaderResources(0, 3, currentSRVs);
+	void PostProcessor::EndPostProcess( EVREye eEye, PipelineSurface output ) {
+		TRACE_SCOPE("PostProcessor::EndPostProcess");
+		context->CSSetShaderResources(0, 4, savedSRVs);
 		UINT uavCount = -1;
-		context->CSSetUnorderedAccessViews(0, 1, currentUAVs, &uavCount);
-		context->CSSetConstantBuffers(0, 1, currentConstBuffs);
+		context->CSSetUnorderedAccessViews(0, 1, savedUAVs, &uavCount);
+		context->CSSetConstantBuffers(0, 4, savedConstBuffs);
 
-		if (Config::Instance().debugMode) {
+		if (timingActive) {
 			context->End(profileQueries[currentQuery].queryEnd.Get());
 			context->End(profileQueries[currentQuery].queryDisjoint.Get());
-
+			profileQueries[currentQuery].pending = true;
+			profileQueries[currentQuery].passCount = currentPass;
 			currentQuery = (currentQuery + 1) % QUERY_COUNT;
-			while (context->GetData(profileQueries[currentQuery].queryDisjoint.Get(), nullptr, 0, 0) == S_FALSE) {
-				Sleep(1);
+		}
+		if (gpuTiming) {
+			ReadProfileQueries();
+		}
+
+		if (eEye == Eye_Left) {
+			if (takeCapture) {
+				capture.Request(Config::Instance().captureBurstFrames, GetCaptureFilename("capture_"), Config::Instance().captureFormat);
+				takeCapture = false;
+			}
+			capture.CaptureFrame(context.Get(), (ID3D11Texture2D*)GetSubmitTexture(output, currentInputTexture));
+			capture.Poll(context.Get());
+
+			if (recordFrameDump) {
+				frameDump.Start(GetCaptureFilename("framedump_") + L".vrdump", Config::Instance().frameDumpFrames);
+				recordFrameDump = false;
 			}
+			frameDump.Poll(context.Get());
+		}
+	}
+
+	bool PostProcessor::WantsGpuTiming() const {
+		const Config &config = Config::Instance();
+		return config.debugMode || config.telemetry || config.framePacing || config.hud || config.gpuBudgetEnabled || benchmark.IsRunning();
+	}
+
+	void PostProcessor::ReadProfileQueries() {
+		TRACE_SCOPE("PostProcessor::ReadProfileQueries");
+		while (profileQueries[pendingQuery].pending) {
+			ProfileQuery &query = profileQueries[pendingQuery];
 			D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
-			HRESULT result = context->GetData(profileQueries[currentQuery].queryDisjoint.Get(), &disjoint, sizeof(disjoint), 0);
+			HRESULT result = context->GetData(query.queryDisjoint.Get(), &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH);
+			if (result == S_FALSE) {
+				// still in flight; try again after the next frame instead of waiting for the GPU
+				break;
+			}
 			if (result == S_OK && !disjoint.Disjoint) {
-				UINT64 begin, end;
-				context->GetData(profileQueries[currentQuery].queryStart.Get(), &begin, sizeof(UINT64), 0);
-				context->GetData(profileQueries[currentQuery].queryEnd.Get(), &end, sizeof(UINT64), 0);
-				float duration = (end - begin) / float(disjoint.Frequency);
-				summedGpuTime += duration;
-				++countedQueries;
-
-				if (countedQueries >= 500) {
-					float avgTimeMs = 1000.f / countedQueries * summedGpuTime;
-					if (textureContainsOnlyOneEye)
-						avgTimeMs *= 2;
-					Log() << "Average GPU processing time for upscale: " << avgTimeMs << " ms\n";
-					countedQueries = 0;
-					summedGpuTime = 0.f;
-				}
+				ProcessProfileQuery(query, disjoint.Frequency);
+			}
+			query.pending = false;
+			pendingQuery = (pendingQuery + 1) % QUERY_COUNT;
+		}
+	}
+
+	void PostProcessor::ProcessProfileQuery( const ProfileQuery &query, UINT64 frequency ) {
+		// the timestamps are done once the disjoint query is
+		UINT64 begin, end;
+		context->GetData(query.queryStart.Get(), &begin, sizeof(UINT64), D3D11_ASYNC_GETDATA_DONOTFLUSH);
+		context->GetData(query.queryEnd.Get(), &end, sizeof(UINT64), D3D11_ASYNC_GETDATA_DONOTFLUSH);
+		float duration = (end - begin) / float(frequency);
+		lastGpuMs = 1000.f * duration;
+		UINT64 passBegin = begin;
+		for (uint32_t pass = 0; pass < telemetry::MAX_STAGES; ++pass) {
+			UINT64 passEnd;
+			if (pass < query.passCount && context->GetData(query.queryPass[pass].Get(), &passEnd, sizeof(UINT64), D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK) {
+				lastStageGpuMs[pass] = 1000.f * (passEnd - passBegin) / float(frequency);
+				passBegin = passEnd;
+			} else {
+				lastStageGpuMs[pass] = 0.f;
 			}
 		}
+		framePacing.AddGpuTime(query.frame, lastGpuMs);
+		benchmark.AddGpuTime(lastGpuMs);
+		radiusGovernor.AddGpuTime(query.submitFrame, lastGpuMs);
+
+		if (!Config::Instance().debugMode) {
+			return;
+		}
+		summedGpuTime += duration;
+		maxGpuTime = max(maxGpuTime, duration);
+		++countedQueries;
+
+		if (countedQueries >= 500) {
+			float avgTimeMs = 1000.f / countedQueries * summedGpuTime;
+			if (pipeline.GetPlan().textureContainsOnlyOneEye)
+				avgTimeMs *= 2;
+			// waits for the compositor to release the output show up as outliers in the maximum, so
+			// compare it between output ring sizes
+			Log() << "Average GPU processing time for upscale: " << avgTimeMs << " ms, slowest submit "
+				<< 1000.f * maxGpuTime << " ms, " << pipeline.GetPlan().outputRingSize << " output texture(s) per eye";
+			texturePool.LogUsage();
+			countedQueries = 0;
+			summedGpuTime = 0.f;
+			maxGpuTime = 0.f;
+		}
+	}
+
+	void * PostProcessor::GetSubmitTexture( PipelineSurface surface, void *texture ) {
+		if (surface == INPUT_SURFACE) {
+			return texture;
+		}
+		return GetSurfaceTexture(surface).texture.Get();
+	}
 
-		if (Config::Instance().hotkeysEnabled) {
-			CheckHotkeys();
+	const TexturePool::Texture & PostProcessor::GetSurfaceTexture( PipelineSurface surface ) {
+		if (pipeline.GetPlan().graph.textures[surface].isOutput) {
+			return outputRing[currentOutputEye][outputSlot[currentOutputEye]];
 		}
+		return transientTextures[surface];
+	}
+
+	void PostProcessor::RecordFrameDumpInput( EVREye eEye, ID3D11Texture2D *inputTexture ) {
+		framedump::Constants dumpConstants = pipeline.GetPlan().constants;
+		memcpy(dumpConstants.bounds[0], &submittedBounds[0], sizeof(dumpConstants.bounds[0]));
+		memcpy(dumpConstants.bounds[1], &submittedBounds[1], sizeof(dumpConstants.bounds[1]));
+		frameDump.SetConstants(dumpConstants);
 
-		if (takeCapture && eEye == Eye_Left) {
-			SaveTextureToFile(outputTexture);
-			takeCapture = false;
+		// record exactly what the shaders read for this eye
+		if (pipeline.GetPlan().requiresCopy) {
+			frameDump.RecordFrame(context.Get(), copiedTexture.texture.Get(), 0, eEye);
+		} else {
+			D3D11_TEXTURE2D_DESC td;
+			inputTexture->GetDesc(&td);
+			UINT subresource = td.ArraySize > 1 && eEye == Eye_Right ? D3D11CalcSubresource(0, 1, td.MipLevels) : 0;
+			frameDump.RecordFrame(context.Get(), inputTexture, subresource, eEye);
 		}
 	}
 
-	void PostProcessor::SaveTextureToFile( ID3D11Texture2D *texture ) {
+	std::wstring PostProcessor::GetCaptureFilename(const char *prefix) {
 		static char timeBuf[16];
 		std::time_t now = std::time(nullptr);
 		std::strftime(timeBuf, sizeof(timeBuf), "%Y%m%d_%H%M%S", std::localtime(&now));
 
 		std::wostringstream filename;
 		filename << GetDllPath() << "\\"
-				 << "capture_" << timeBuf
+				 << prefix << timeBuf
 				 << "_" << (Config::Instance().useNis ? "nis" : "fsr")
 				 << "_s" << int(roundf(Config::Instance().sharpness * 100))
-				 << "_r" << int(roundf(Config::Instance().radius * 100))
-				 << ".dds";
-
-		HRESULT result = DirectX::SaveDDSTextureToFile( context.Get(), texture, filename.str().c_str() );
-		if (FAILED(result)) {
-			Log() << "Error taking screen capture: " << std::hex << result << std::dec << std::endl;
-		}
+				 << "_r" << int(roundf(Config::Instance().radius * 100));
+		return filename.str();
 	}
 
-	void PostProcessor::CheckHotkeys() {
-		bool isShiftPressed = GetAsyncKeyState( VK_LSHIFT ) || GetAsyncKeyState( VK_RSHIFT );
-		if (!isShiftPressed && Config::Instance().hotkeysRequireShift)
+	void PostProcessor::WriteTrace() {
+		if (!trace::IsEnabled()) {
+			Log() << "Tracing is disabled, enable trace in the config file to record trace events";
 			return;
-		bool isCtrlPressed = GetAsyncKeyState( VK_LCONTROL ) || GetAsyncKeyState( VK_RCONTROL );
-		if (!isCtrlPressed && Config::Instance().hotkeysRequireCtrl)
-			return;
-		bool isAltPressed = GetAsyncKeyState( VK_LMENU ) || GetAsyncKeyState( VK_RMENU );
-		if (!isAltPressed && Config::Instance().hotkeysRequireAlt)
-			return;
-
-		if (IsHotkeyActive( Config::Instance().hotkeyToggleUseNis )) {
-			Config::Instance().useNis = !Config::Instance().useNis;
-			Log() << "Now using " << (Config::Instance().useNis ? "NIS" : "FSR") << std::endl;
-			Reset();
-		}
-
-		if (IsHotkeyActive( Config::Instance().hotkeyToggleDebugMode )) {
-			Config::Instance().debugMode = !Config::Instance().debugMode;
-			Log() << "Debug mode is now " << (Config::Instance().debugMode ? "enabled" : "disabled") << std::endl;
-			Reset();
-		}
-
-		if (IsHotkeyActive( Config::Instance().hotkeyDecreaseSharpness )) {
-			Config::Instance().sharpness = max(Config::Instance().sharpness - 0.05f, 0.0f);
-			Log() << "Sharpness is now at " << Config::Instance().sharpness << std::endl;
-			Reset();
-		}
-
-		if (IsHotkeyActive( Config::Instance().hotkeyIncreaseSharpness )) {
-			Config::Instance().sharpness += 0.05f;
-			Log() << "Sharpness is now at " << Config::Instance().sharpness << std::endl;
-			Reset();
-		}
-
-		if (IsHotkeyActive( Config::Instance().hotkeyDecreaseRadius )) {
-			Config::Instance().radius = max(Config::Instance().radius - 0.05f, 0.0f);
-			Log() << "Sharpening radius is now at " << Config::Instance().radius << std::endl;
-			Reset();
-		}
-
-		if (IsHotkeyActive( Config::Instance().hotkeyIncreaseRadius )) {
-			Config::Instance().radius += 0.05f;
-			Log() << "Sharpening radius is now at " << Config::Instance().radius << std::endl;
-			Reset();
-		}
-
-		if (IsHotkeyActive( Config::Instance().hotkeyCaptureOutput )) {
-			takeCapture = true;
 		}
+		// formatting the events takes a while, so don't hold up the render thread with it
+		std::wstring filename = GetCaptureFilename("trace_") + L".json";
+		std::thread([filename]() {
+			std::ofstream file (filename);
+			if (!file) {
+				Log(LogLevel::Error) << "Could not create the trace file";
+				return;
+			}
+			size_t events = trace::WriteChromeTrace(file);
+			Log() << "Wrote " << (unsigned long long)events << " trace events next to the DLL";
+		}).detach();
 	}
 
-	bool PostProcessor::IsHotkeyActive( int keyCode ) {
-		bool isPressedNow = GetAsyncKeyState( keyCode );
-		bool isNewlyPressed = !wasKeyPressedBefore[keyCode] && isPressedNow;
-		wasKeyPressedBefore[keyCode] = isPressedNow;
-		return isNewlyPressed;
+	void PostProcessor::HandleHotkeys() {
+		TRACE_SCOPE("PostProcessor::HandleHotkeys");
+		HotkeyCommand command;
+		while (HotkeyListener::Instance().Poll(command)) {
+			switch (command) {
+			case HotkeyCommand::ToggleUseNis:
+				Config::Instance().useNis = !Config::Instance().useNis;
+				Log() << "Now using " << (Config::Instance().useNis ? "NIS" : "FSR");
+				Reset();
+				break;
+			case HotkeyCommand::ToggleDebugMode:
+				Config::Instance().debugMode = !Config::Instance().debugMode;
+				SetLogLevel(Config::Instance().debugMode ? LogLevel::Debug : LogLevel::Info);
+				Log() << "Debug mode is now " << (Config::Instance().debugMode ? "enabled" : "disabled");
+				Reset();
+				break;
+			case HotkeyCommand::DecreaseSharpness:
+				Config::Instance().sharpness = max(Config::Instance().sharpness - 0.05f, 0.0f);
+				Log() << "Sharpness is now at " << Config::Instance().sharpness;
+				break;
+			case HotkeyCommand::IncreaseSharpness:
+				Config::Instance().sharpness += 0.05f;
+				Log() << "Sharpness is now at " << Config::Instance().sharpness;
+				break;
+			case HotkeyCommand::DecreaseRadius:
+				Config::Instance().radius = max(Config::Instance().radius - 0.05f, 0.0f);
+				Log() << "Sharpening radius is now at " << Config::Instance().radius;
+				break;
+			case HotkeyCommand::IncreaseRadius:
+				Config::Instance().radius += 0.05f;
+				Log() << "Sharpening radius is now at " << Config::Instance().radius;
+				break;
+			case HotkeyCommand::CaptureOutput:
+				takeCapture = true;
+				break;
+			case HotkeyCommand::RecordFrameDump:
+				recordFrameDump = true;
+				break;
+			case HotkeyCommand::WriteTrace:
+				WriteTrace();
+				break;
+			}
+		}
 	}
 }
@@ -2,89 +2,217 @@
 #include <d3d11.h>
 #include <wrl/client.h>
 #include <unordered_map>
+#include <vector>
 #include "openvr.h"
+#include "AsyncCapture.h"
+#include "Benchmark.h"
+#include "FrameDump.h"
+#include "FrameDumpRecorder.h"
+#include "FramePacing.h"
+#include "PerformanceHud.h"
+#include "PostProcessConstants.h"
+#include "RadiusGovernor.h"
+#include "Telemetry.h"
+#include "TelemetryPublisher.h"
+#include "TexturePool.h"
 
 namespace vr {
 	using Microsoft::WRL::ComPtr;
 
-	class PostProcessor {
+	// D3D11 backend of the PostProcessPipeline, which decides what is done with each submitted texture
+	class PostProcessor : private PostProcessBackend {
 	public:
-		void Apply(EVREye eEye, const Texture_t *pTexture, const VRTextureBounds_t* pBounds, EVRSubmitFlags nSubmitFlags);
+		// When the output is lens distorted, the bounds and flags to submit it with are changed; flags
+		// may be nullptr for Submit versions without them, which keeps the distortion to the compositor.
+		void Apply(EVREye eEye, const Texture_t *pTexture, const VRTextureBounds_t *&pBounds, EVRSubmitFlags *pSubmitFlags);
 		void Reset();
+		// enables the frame pacing analysis with the compositor of the current interface version
+		void InitFramePacing(IVRCompositor *compositor, float displayFrequency);
+		// gives the HUD the overlay and compositor of the current interface version
+		void InitHud(IVROverlay *overlay, IVRCompositor *compositor, float displayFrequency);
 
 	private:
-		bool enabled = true;
-		bool initialized = false;
-		uint32_t inputWidth = 0;
-		uint32_t inputHeight = 0;
-		uint32_t outputWidth = 0;
-		uint32_t outputHeight = 0;
-		bool textureContainsOnlyOneEye = true;
-		bool requiresCopy = false;
-		bool inputIsSrgb = false;
+		PostProcessPipeline pipeline { *this, CalculateProjectionCenter, ComputeLensDistortion };
+		VRTextureBounds_t submittedBounds[2];
 		ComPtr<ID3D11Device> device;
 		ComPtr<ID3D11DeviceContext> context;
 		ComPtr<ID3D11SamplerState> sampler;
+		// outlives ReleaseResources, so the textures are reused when the resources are prepared again
+		TexturePool texturePool;
+		// compute shaders by bytecode; like the texture pool, it outlives ReleaseResources, so switching
+		// between settings only creates each shader once
+		std::unordered_map<const void*, ComPtr<ID3D11ComputeShader>> shaderCache;
+		ComPtr<ID3D11Device> shaderCacheDevice;
+		ComPtr<ID3D11ComputeShader> GetComputeShader(const char *name, const void *bytecode, size_t size);
 
 		struct EyeViews {
 			ComPtr<ID3D11ShaderResourceView> view[2];
 		};
 		std::unordered_map<ID3D11Texture2D*, EyeViews> inputTextureViews;
 		// in case the incoming texture can't be bound as an SRV, we'll need to prepare a copy
-		ComPtr<ID3D11Texture2D> copiedTexture;
-		ComPtr<ID3D11ShaderResourceView> copiedTextureView;
+		TexturePool::Texture copiedTexture;
 
 		void PrepareCopyResources(DXGI_FORMAT format);
 		ID3D11ShaderResourceView *GetInputView(ID3D11Texture2D *inputTexture, int eye);
 
+		// the intermediate textures of the compiled pipeline graph, indexed by PipelineSurface
+		std::vector<TexturePool::Texture> transientTextures;
+		// copies of the output texture for each eye, written in turn so that the passes of a frame don't
+		// have to wait for the compositor to finish reading an earlier frame's output
+		std::vector<TexturePool::Texture> outputRing[2];
+		int outputSlot[2] = {};
+		// the eye whose ring slot holds the current output
+		EVREye currentOutputEye = Eye_Left;
+
+		// the dither levels for the passes writing each of them, bound to b2; all 0 if not dithered
+		std::vector<ComPtr<ID3D11Buffer>> ditherConstantsBuffers;
+
+		const TexturePool::Texture & GetSurfaceTexture(PipelineSurface surface);
+
+		void PrepareTransientTextures(DXGI_FORMAT outputFormat);
+		bool SupportsTypedUavStore(DXGI_FORMAT format);
+
 		// upscale resources
 		ComPtr<ID3D11ComputeShader> upscaleShader;
+		ComPtr<ID3D11ComputeShader> upscaleGrainShader;
 		ComPtr<ID3D11Buffer> upscaleConstantsBuffer[2];
-		ComPtr<ID3D11Texture2D> upscaledTexture;
-		ComPtr<ID3D11UnorderedAccessView> upscaledTextureUav;
-		ComPtr<ID3D11ShaderResourceView> upscaledTextureView;
 		// NIS specific lookup textures
 		ComPtr<ID3D11Texture2D> scalerCoeffTexture;
 		ComPtr<ID3D11Texture2D> usmCoeffTexture;
 		ComPtr<ID3D11ShaderResourceView> scalerCoeffView;
 		ComPtr<ID3D11ShaderResourceView> usmCoeffView;
 
-		void PrepareUpscalingResources(DXGI_FORMAT format);
-		void ApplyUpscaling(EVREye eEye, ID3D11ShaderResourceView *inputView);
+		// lens distortion maps of both eyes, bound to t1, and the viewport they refer to, bound to b3
+		ComPtr<ID3D11Texture2D> distortionMapTexture[2];
+		ComPtr<ID3D11ShaderResourceView> distortionMapView[2];
+		ComPtr<ID3D11Buffer> distortionConstantsBuffer[2];
+
+		// luma guided upscaling: the prepass writes the luma of the upscale's input, which the EASU
+		// variant gathers from t2
+		ComPtr<ID3D11ComputeShader> lumaShader;
+		ComPtr<ID3D11Texture2D> lumaTexture;
+		ComPtr<ID3D11ShaderResourceView> lumaView;
+		ComPtr<ID3D11UnorderedAccessView> lumaUav;
+
+		void PrepareUpscalingResources(bool fusedGrain);
+		void PrepareDistortionResources();
+		void PrepareLumaResources();
+		void ApplyUpscaling(EVREye eEye, const PipelinePass &pass, ID3D11ShaderResourceView *inputView, ID3D11UnorderedAccessView *outputView);
 
 		// sharpening resources
 		ComPtr<ID3D11ComputeShader> sharpenShader;
+		ComPtr<ID3D11ComputeShader> sharpenGrainShader;
 		ComPtr<ID3D11Buffer> sharpenConstantsBuffer[2];
-		ComPtr<ID3D11Texture2D> sharpenedTexture;
-		ComPtr<ID3D11UnorderedAccessView> sharpenedTextureUav;
 
-		void PrepareSharpeningResources(DXGI_FORMAT format);
-		void ApplySharpening(EVREye eEye, ID3D11ShaderResourceView *inputView);
+		void PrepareSharpeningResources(bool fusedGrain);
+		void ApplySharpening(EVREye eEye, const PipelinePass &pass, ID3D11ShaderResourceView *inputView, ID3D11UnorderedAccessView *outputView);
+
+		// CAS resources, the constants are the same for both eyes
+		ComPtr<ID3D11ComputeShader> casShader;
+		ComPtr<ID3D11Buffer> casConstantsBuffer;
+
+		void PrepareCasResources();
+		void ApplyCas(const PipelinePass &pass, ID3D11ShaderResourceView *inputView, ID3D11UnorderedAccessView *outputView);
+
+		// tile classification resources: the prepass writes the mask of flat tiles in BeginPostProcess,
+		// and the FSR passes read it from t3 if they skip flat tiles, or find nothing bound there
+		ComPtr<ID3D11ComputeShader> classifyShader;
+		ComPtr<ID3D11Buffer> classifyConstantsBuffer;
+		ComPtr<ID3D11Texture2D> flatTilesTexture;
+		ComPtr<ID3D11ShaderResourceView> flatTilesView;
+		ComPtr<ID3D11UnorderedAccessView> flatTilesUav;
 
-		ID3D11Texture2D *lastSubmittedTexture = nullptr;
-		ID3D11Texture2D *outputTexture = nullptr;
-		int eyeCount = 0;
+		void PrepareClassificationResources();
+		void ClassifyTiles();
+		// binds the mask for an FSR pass, or unbinds whatever the game left at t3
+		void BindFlatTiles(const PipelinePass &pass);
 
-		void PrepareResources(ID3D11Texture2D *inputTexture, EColorSpace colorSpace);
-		void ApplyPostProcess(EVREye eEye, ID3D11Texture2D *inputTexture);
-		void SaveTextureToFile( ID3D11Texture2D *texture );
+		// film grain resources; the constants are bound to b1 for the whole frame, so fused passes see them too
+		ComPtr<ID3D11ComputeShader> grainShader;
+		ComPtr<ID3D11Buffer> grainConstantsBuffer;
+
+		void PrepareGrainResources(bool standalonePass);
+		void ApplyGrain(const PipelinePass &pass, ID3D11ShaderResourceView *inputView, ID3D11UnorderedAccessView *outputView);
+
+		// state of the post-processing of one eye, between BeginPostProcess and EndPostProcess
+		ID3D11Texture2D *currentInputTexture = nullptr;
+		ID3D11ShaderResourceView *currentInputView = nullptr;
+		ID3D11Buffer* savedConstBuffs[4];
+		ID3D11ShaderResourceView* savedSRVs[4];
+		ID3D11UnorderedAccessView* savedUAVs[1];
+
+		bool DescribeInput(void *texture, InputTextureInfo &info) override;
+		void PrepareResources(void *texture, const PipelinePlan &plan) override;
+		void ReleaseResources() override;
+		void UpdateConstants(const PipelinePlan &plan) override;
+		bool BeginPostProcess(EVREye eEye, void *texture, uint32_t frameIndex) override;
+		void RunPass(const PipelinePass &pass, EVREye eEye) override;
+		void EndPostProcess(EVREye eEye, PipelineSurface output) override;
+		void * GetSubmitTexture(PipelineSurface surface, void *texture) override;
+		std::wstring GetCaptureFilename(const char *prefix);
 
 		struct ProfileQuery {
 			ComPtr<ID3D11Query> queryDisjoint;
 			ComPtr<ID3D11Query> queryStart;
 			ComPtr<ID3D11Query> queryEnd;
+			// timestamps after each of the first MAX_STAGES passes
+			ComPtr<ID3D11Query> queryPass[telemetry::MAX_STAGES];
+			// issued, but the results haven't been read yet
+			bool pending = false;
+			uint32_t passCount = 0;
+			// FramePacingAnalyzer frame the queries were issued in
+			uint32_t frame = 0;
+			// submitFrame the queries were issued in
+			uint32_t submitFrame = 0;
 		};
 
+		// GPU times are measured in debug mode, for the telemetry, the frame pacing analysis, the HUD, the GPU
+		// budget and benchmarks
+		bool gpuTiming = false;
 		static const int QUERY_COUNT = 6;
 		ProfileQuery profileQueries[QUERY_COUNT];
 		int currentQuery = 0;
+		// the oldest queries whose results haven't been read
+		int pendingQuery = 0;
+		// whether the current post-processing is measured; skipped while all queries are pending
+		bool timingActive = false;
+		uint32_t currentPass = 0;
 		float summedGpuTime = 0.0f;
+		float maxGpuTime = 0.0f;
 		int countedQueries = 0;
 
-		void CheckHotkeys();
-		bool IsHotkeyActive(int keyCode);
+		TelemetryPublisher telemetryPublisher;
+		// the GPU times of the last frame whose queries were read, in milliseconds
+		float lastStageGpuMs[telemetry::MAX_STAGES] = {};
+		float lastGpuMs = 0.f;
+		uint64_t submitCount = 0;
+		// counts the frames by their left eye submits, so that the runs of both eyes can be summed
+		uint32_t submitFrame = 0;
+
+		void PublishTelemetry(float cpuApplyMs);
+		telemetry::Snapshot CollectStatistics(float cpuApplyMs);
+
+		FramePacingAnalyzer framePacing;
+		Benchmark benchmark;
+		PerformanceHud hud;
+		RadiusGovernor radiusGovernor;
+
+		bool WantsGpuTiming() const;
+		// reads the results of the queries the GPU has finished with, without waiting for any others
+		void ReadProfileQueries();
+		void ProcessProfileQuery(const ProfileQuery &query, UINT64 frequency);
+
+		// applies the commands of the hotkeys pressed since the last frame, see HotkeyListener
+		void HandleHotkeys();
+		// writes the recorded trace events to a Chrome trace file next to the DLL
+		void WriteTrace();
 
-		std::unordered_map<int, bool> wasKeyPressedBefore;
 		bool takeCapture = false;
+		AsyncCapture capture;
+
+		bool recordFrameDump = false;
+		FrameDumpRecorder frameDump;
+
+		void RecordFrameDumpInput(EVREye eEye, ID3D11Texture2D *inputTexture);
 	};
 }
@@ -0,0 +1,93 @@
+#include "RadiusGovernor.h"
+#include <algorithm>
+#include <cmath>
+#include "Logging.h"
+
+namespace vr {
+	namespace {
+		// grow only while the cost is below this fraction of the budget
+		const float GROW_THRESHOLD = 0.85f;
+		const float GROW_STEP = 0.01f;
+		// shrinking aims for the middle of the band between that and the budget, so that one step lands in it
+		const float SHRINK_TARGET = (1.f + GROW_THRESHOLD) / 2;
+	}
+
+	void RadiusGovernor::AddGpuTime(uint32_t runFrame, float ms) {
+		if (radius < 0) {
+			return;
+		}
+		if (hasFrame && runFrame == frame) {
+			frameMs += ms;
+			return;
+		}
+		// the first run of a new frame completes the previous one
+		if (hasFrame) {
+			AddFrameTime(frameMs);
+		}
+		hasFrame = true;
+		frame = runFrame;
+		frameMs = ms;
+	}
+
+	void RadiusGovernor::AddFrameTime(float ms) {
+		if (settleFrames > 0) {
+			--settleFrames;
+			return;
+		}
+		++samples;
+		averageMs += (ms - averageMs) / samples;
+	}
+
+	void RadiusGovernor::Update(float maxRadius, float minRadius, float budgetMs) {
+		minRadius = (std::min)(minRadius, maxRadius);
+		if (radius < 0 || radius > maxRadius || radius < minRadius) {
+			// started, or the limits changed
+			SetRadius((std::max)(minRadius, (std::min)(radius < 0 ? maxRadius : radius, maxRadius)));
+			return;
+		}
+		if (samples < MIN_SAMPLES || budgetMs <= 0) {
+			return;
+		}
+
+		if (averageMs > budgetMs) {
+			if (radius <= minRadius) {
+				if (!warnedBudgetTooLow) {
+					Log(LogLevel::Warning) << "Post-processing takes " << averageMs << " ms per frame at the smallest radius, over the GPU budget of "
+						<< budgetMs << " ms";
+					warnedBudgetTooLow = true;
+				}
+				samples = 0;
+				averageMs = 0;
+				return;
+			}
+			SetRadius((std::max)(minRadius, radius * std::sqrt(budgetMs * SHRINK_TARGET / averageMs)));
+		} else if (averageMs < budgetMs * GROW_THRESHOLD && radius < maxRadius) {
+			SetRadius((std::min)(maxRadius, radius + GROW_STEP));
+		} else {
+			// within the hysteresis band, or nothing to grow into; keep averaging over a fresh window
+			samples = 0;
+			averageMs = 0;
+		}
+	}
+
+	void RadiusGovernor::Reset() {
+		radius = -1.f;
+		samples = 0;
+		averageMs = 0;
+		settleFrames = 0;
+		hasFrame = false;
+		warnedBudgetTooLow = false;
+	}
+
+	void RadiusGovernor::SetRadius(float newRadius) {
+		if (radius >= 0) {
+			Log(LogLevel::Debug) << "GPU budget: radius " << radius << " -> " << newRadius << " at " << averageMs << " ms";
+		}
+		radius = newRadius;
+		samples = 0;
+		averageMs = 0;
+		settleFrames = SETTLE_FRAMES;
+		// the frame being summed may have been started with the old radius
+		hasFrame = false;
+	}
+}
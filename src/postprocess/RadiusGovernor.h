@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+
+namespace vr {
+	// Keeps the GPU time the post-processing takes per frame under a budget by shrinking the radius of the area
+	// that is upscaled at full quality, and growing it back once there is room again. The radius
+	// from the settings is the largest it will use, so the governor only ever trades quality away
+	// when the budget requires it, whatever the output resolution.
+	//
+	// The cost of the upscaling grows with the area inside the radius, so an overrun is corrected in
+	// one step by scaling the radius with the square root of budget / cost, aiming a little below the budget. Growing happens in small
+	// steps, and only once the cost is clearly below the budget, so that the radius doesn't oscillate
+	// around the point where the budget is met. The runs of both eyes are summed per frame, so the
+	// budget means the same whether a game submits one texture per eye or one for both. GPU timings
+	// arrive a few frames late; those of the frames that were in flight when the radius changed are
+	// ignored.
+	class RadiusGovernor {
+	public:
+		// GPU time of one post-processing run of the given frame, in milliseconds; runs arrive in order
+		void AddGpuTime(uint32_t frame, float ms);
+		// picks the radius for the next frame; must be called once per frame, before the settings are used
+		void Update(float maxRadius, float minRadius, float budgetMs);
+		// the radius to post-process with
+		float Radius() const { return radius; }
+		// starts over from the largest radius, e.g. while the governor is disabled
+		void Reset();
+
+	private:
+		// frames whose timings are ignored after a change, more than the GPU queries in flight
+		static const uint32_t SETTLE_FRAMES = 8;
+		// frames to average before deciding
+		static const uint32_t MIN_SAMPLES = 8;
+
+		float radius = -1.f;
+		// averaged GPU time of the frames since the last change
+		float averageMs = 0;
+		uint32_t samples = 0;
+		uint32_t settleFrames = 0;
+		// the frame whose runs are being summed
+		bool hasFrame = false;
+		uint32_t frame = 0;
+		float frameMs = 0;
+		bool warnedBudgetTooLow = false;
+
+		void AddFrameTime(float ms);
+		void SetRadius(float newRadius);
+	};
+}
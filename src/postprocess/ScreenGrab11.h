@@ -43,4 +43,22 @@ namespace DirectX
         _In_opt_ const GUID* targetFormat = nullptr,
         _In_opt_ std::function<void __cdecl(IPropertyBag2*)> setCustomProps = nullptr,
         _In_ bool forceSRGB = false);
+
+    // Variants that encode pixel data which has already been read back, e.g. from a mapped
+    // staging texture. These do not touch the device context and may be called from any thread.
+    HRESULT __cdecl SaveDDSTextureToFile(
+        _In_ const D3D11_TEXTURE2D_DESC& desc,
+        _In_ const void* pPixels,
+        _In_ size_t rowPitch,
+        _In_z_ const wchar_t* fileName) noexcept;
+
+    HRESULT __cdecl SaveWICTextureToFile(
+        _In_ const D3D11_TEXTURE2D_DESC& desc,
+        _In_ const void* pPixels,
+        _In_ size_t rowPitch,
+        _In_ REFGUID guidContainerFormat,
+        _In_z_ const wchar_t* fileName,
+        _In_opt_ const GUID* targetFormat = nullptr,
+        _In_opt_ std::function<void __cdecl(IPropertyBag2*)> setCustomProps = nullptr,
+        _In_ bool forceSRGB = false);
 }
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+
+namespace vr {
+	// constant buffer layout of fsr/fsr_easu.hlsl
+	struct UpscaleConstants {
+		uint32_t const0[4];
+		uint32_t const1[4];
+		uint32_t const2[4];
+		uint32_t const3[4];
+		// x,y: centre of the left eye, z,w: centre of the right eye, in output pixels
+		uint32_t imageCentre[4];
+		// x: radius in output pixels, y: radius squared, z,w: output size
+		uint32_t radius[4];
+	};
+
+	// constant buffer layout of fsr/fsr_rcas.hlsl
+	struct SharpenConstants {
+		uint32_t const0[4];
+		uint32_t imageCentre[4];
+		uint32_t radius[4];
+	};
+
+	// constant buffer layout of cas/cas.sharpen.hlsl
+	struct CasConstants {
+		uint32_t const0[4];
+		uint32_t const1[4];
+	};
+
+	// constant buffer layout of fsr/fsr_dither.h
+	struct DitherConstants {
+		// 2^bits - 1 for each channel of the output, or 0 to write values unchanged
+		float levels[4];
+	};
+
+	// constant buffer layout of fsr/fsr_grain.h, bound next to the stage's own constants
+	struct GrainConstants {
+		float amount;
+		uint32_t seed;
+		uint32_t padding[2];
+	};
+
+	// constant buffer layout of the LENS_DISTORTION variants of fsr/fsr_easu.hlsl, bound to b3
+	struct DistortionConstants {
+		// uMin, vMin, uMax, vMax of the eye's viewport in the input texture, which the distortion
+		// map's coordinates are relative to
+		float bounds[4];
+		// scale x,y and offset z,w from output texture coordinates to the distortion map's, see
+		// GetDistortionMapTransform; the same for both eyes
+		float mapTransform[4];
+	};
+
+	// constant buffer layout of fsr/fsr_classify.hlsl
+	struct ClassifyConstants {
+		uint32_t inputSize[2];
+		// input pixels per output pixel
+		float scale[2];
+		// luma range below which a tile counts as flat
+		float threshold;
+		uint32_t padding[3];
+	};
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+// Layout of the shared memory block the mod publishes live performance statistics in, for external
+// tools to read without any IPC round-trips. The block is a Header followed by a Snapshot. The
+// writer updates the snapshot under a sequence lock: the sequence is odd while a write is in
+// progress, so a reader copies the snapshot and retries if the sequence was odd or changed in the
+// meantime. Readers must check the magic and that the version is at least theirs, and may read
+// fewer bytes than snapshotSize reports if the mod is newer than them; fields are only ever appended.
+namespace vr {
+namespace telemetry {
+	const uint32_t MAGIC = 0x4d4c5454; // "TTLM"
+	const uint32_t VERSION = 1;
+	// name of the file mapping
+	const char * const SHARED_MEMORY_NAME = "openvr_mod_telemetry";
+	const uint32_t MAX_STAGES = 8;
+
+	enum Algorithm : uint32_t {
+		ALGORITHM_FSR = 0,
+		ALGORITHM_NIS = 1,
+	};
+
+	struct Snapshot {
+		// Submit calls the statistics cover; GPU times lag behind by a few frames
+		uint64_t frameIndex;
+		uint32_t algorithm;
+		// vr::PipelineStage of every pass, in order; stageFusedGrain is set for passes that apply grain
+		uint32_t stageCount;
+		uint32_t stages[MAX_STAGES];
+		uint32_t stageFusedGrain[MAX_STAGES];
+		// GPU time of each pass and of all of them, in milliseconds;
+		// 0 until timing data is available
+		float stageGpuMs[MAX_STAGES];
+		float gpuMs;
+		// CPU time the last Submit spent in the mod, in milliseconds
+		float cpuApplyMs;
+		float renderScale;
+		float sharpness;
+		float radius;
+		uint32_t inputWidth;
+		uint32_t inputHeight;
+		uint32_t outputWidth;
+		uint32_t outputHeight;
+		// video memory held by the mod's textures, in use and cached for reuse
+		uint64_t vramBytesInUse;
+		uint64_t vramBytesCached;
+		// samplers replaced with a mip-biased copy
+		uint32_t samplerCacheSize;
+		uint32_t padding;
+	};
+
+	struct Header {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t snapshotSize;
+		std::atomic<uint32_t> sequence;
+	};
+
+	struct Block {
+		Header header;
+		Snapshot snapshot;
+	};
+
+	static_assert(ATOMIC_INT_LOCK_FREE == 2 && sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+		"the sequence is shared between processes and must not need a lock");
+
+	inline void WriteSnapshot(Block &block, const Snapshot &snapshot) {
+		uint32_t sequence = block.header.sequence.load(std::memory_order_relaxed);
+		block.header.sequence.store(sequence + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		memcpy(&block.snapshot, &snapshot, sizeof(Snapshot));
+		block.header.sequence.store(sequence + 2, std::memory_order_release);
+	}
+
+	// returns false if the writer was busy; callers retry or try again later
+	inline bool ReadSnapshot(const Block &block, Snapshot &snapshot) {
+		uint32_t before = block.header.sequence.load(std::memory_order_acquire);
+		if (before & 1) {
+			return false;
+		}
+		memcpy(&snapshot, &block.snapshot, sizeof(Snapshot));
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return block.header.sequence.load(std::memory_order_relaxed) == before;
+	}
+}
+}
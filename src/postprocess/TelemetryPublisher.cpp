@@ -0,0 +1,62 @@
+#include "TelemetryPublisher.h"
+#include <new>
+#include <string>
+#include "Logging.h"
+
+namespace vr {
+	TelemetryPublisher::~TelemetryPublisher() {
+		Close();
+	}
+
+	bool TelemetryPublisher::Open() {
+		if (block != nullptr) {
+			return true;
+		}
+		if (openFailed) {
+			return false;
+		}
+
+		std::string name = std::string("Local\\") + telemetry::SHARED_MEMORY_NAME;
+		mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(telemetry::Block), name.c_str());
+		if (mapping == nullptr || GetLastError() == ERROR_ALREADY_EXISTS) {
+			Log(LogLevel::Warning) << "Could not create the telemetry shared memory " << name << ", is another game publishing it?";
+			Close();
+			openFailed = true;
+			return false;
+		}
+		void *view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(telemetry::Block));
+		if (view == nullptr) {
+			Log(LogLevel::Warning) << "Could not map the telemetry shared memory";
+			Close();
+			openFailed = true;
+			return false;
+		}
+
+		// the mapping starts out zeroed, so readers see an invalid magic until the header is complete
+		block = (telemetry::Block*)view;
+		new (&block->header.sequence) std::atomic<uint32_t>(0);
+		block->header.snapshotSize = sizeof(telemetry::Snapshot);
+		block->header.version = telemetry::VERSION;
+		std::atomic_thread_fence(std::memory_order_release);
+		block->header.magic = telemetry::MAGIC;
+		Log() << "Publishing telemetry in " << name;
+		return true;
+	}
+
+	void TelemetryPublisher::Close() {
+		if (block != nullptr) {
+			UnmapViewOfFile(block);
+			block = nullptr;
+		}
+		if (mapping != nullptr) {
+			CloseHandle(mapping);
+			mapping = nullptr;
+		}
+	}
+
+	void TelemetryPublisher::Publish(const telemetry::Snapshot &snapshot) {
+		if (block != nullptr) {
+			telemetry::WriteSnapshot(*block, snapshot);
+		}
+	}
+}
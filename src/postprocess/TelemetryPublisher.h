@@ -0,0 +1,24 @@
+#pragma once
+#include <windows.h>
+#include "Telemetry.h"
+
+namespace vr {
+	// Owns the named file mapping the telemetry block lives in, see Telemetry.h. Readers open it as
+	// Local\openvr_mod_telemetry; if several games run the mod at once, the first one to start owns it.
+	class TelemetryPublisher {
+	public:
+		~TelemetryPublisher();
+
+		// creates the mapping; returns false, and logs once, if it can't be created
+		bool Open();
+		void Close();
+		bool IsOpen() const { return block != nullptr; }
+
+		void Publish(const telemetry::Snapshot &snapshot);
+
+	private:
+		HANDLE mapping = nullptr;
+		telemetry::Block *block = nullptr;
+		bool openFailed = false;
+	};
+}
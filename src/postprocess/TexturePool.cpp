@@ -0,0 +1,118 @@
+#include "TexturePool.h"
+#include <string>
+#include "FrameDump.h"
+#include "Logging.h"
+
+namespace vr {
+	// defined in PostProcessor.cpp
+	void CheckResult(const std::string &operation, HRESULT result);
+
+	TexturePool::Texture TexturePool::Acquire(ID3D11Device *device, const Desc &desc, const char *name) {
+		if (this->device.Get() != device) {
+			Clear();
+			this->device = device;
+		}
+
+		for (Entry &entry : entries) {
+			if (!entry.inUse && entry.desc.width == desc.width && entry.desc.height == desc.height && entry.desc.format == desc.format
+					&& entry.desc.viewFormat == desc.viewFormat && entry.desc.bindFlags == desc.bindFlags) {
+				Log(LogLevel::Debug) << "Reusing pooled texture of size " << desc.width << "x" << desc.height << " for " << name;
+				entry.inUse = true;
+				return entry.texture;
+			}
+		}
+
+		Log() << "Creating " << name << " of size " << desc.width << "x" << desc.height;
+		Entry entry;
+		entry.desc = desc;
+		entry.inUse = true;
+		entry.lastRelease = 0;
+		uint32_t bytesPerPixel = framedump::BytesPerPixel(desc.format);
+		entry.bytes = (uint64_t)desc.width * desc.height * (bytesPerPixel > 0 ? bytesPerPixel : 4);
+
+		D3D11_TEXTURE2D_DESC td;
+		td.Width = desc.width;
+		td.Height = desc.height;
+		td.MipLevels = 1;
+		td.CPUAccessFlags = 0;
+		td.Usage = D3D11_USAGE_DEFAULT;
+		td.BindFlags = desc.bindFlags;
+		td.Format = desc.format;
+		td.MiscFlags = 0;
+		td.SampleDesc.Count = 1;
+		td.SampleDesc.Quality = 0;
+		td.ArraySize = 1;
+		CheckResult(std::string("Creating ") + name, device->CreateTexture2D( &td, nullptr, entry.texture.texture.GetAddressOf()));
+		if (desc.bindFlags & D3D11_BIND_SHADER_RESOURCE) {
+			D3D11_SHADER_RESOURCE_VIEW_DESC srv;
+			srv.Format = desc.viewFormat;
+			srv.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+			srv.Texture2D.MipLevels = 1;
+			srv.Texture2D.MostDetailedMip = 0;
+			CheckResult(std::string("Creating SRV for ") + name, device->CreateShaderResourceView( entry.texture.texture.Get(), &srv, entry.texture.view.GetAddressOf()));
+		}
+		if (desc.bindFlags & D3D11_BIND_UNORDERED_ACCESS) {
+			D3D11_UNORDERED_ACCESS_VIEW_DESC uav;
+			uav.Format = desc.viewFormat;
+			uav.ViewDimension = D3D11_UAV_DIMENSION_TEXTURE2D;
+			uav.Texture2D.MipSlice = 0;
+			CheckResult(std::string("Creating UAV for ") + name, device->CreateUnorderedAccessView( entry.texture.texture.Get(), &uav, entry.texture.uav.GetAddressOf()));
+		}
+		entries.push_back(entry);
+		return entry.texture;
+	}
+
+	void TexturePool::Release(const Texture &texture) {
+		for (Entry &entry : entries) {
+			if (entry.inUse && entry.texture.texture.Get() == texture.texture.Get()) {
+				entry.inUse = false;
+				entry.lastRelease = ++releaseCounter;
+				return;
+			}
+		}
+	}
+
+	void TexturePool::Trim() {
+		uint64_t limit = BytesInUse();
+		while (BytesCached() > limit) {
+			size_t oldest = entries.size();
+			for (size_t i = 0; i < entries.size(); ++i) {
+				if (!entries[i].inUse && (oldest == entries.size() || entries[i].lastRelease < entries[oldest].lastRelease)) {
+					oldest = i;
+				}
+			}
+			Log() << "Releasing pooled texture of size " << entries[oldest].desc.width << "x" << entries[oldest].desc.height;
+			entries.erase(entries.begin() + oldest);
+		}
+	}
+
+	void TexturePool::Clear() {
+		entries.clear();
+		device.Reset();
+	}
+
+	uint64_t TexturePool::BytesInUse() const {
+		uint64_t bytes = 0;
+		for (const Entry &entry : entries) {
+			if (entry.inUse) {
+				bytes += entry.bytes;
+			}
+		}
+		return bytes;
+	}
+
+	uint64_t TexturePool::BytesCached() const {
+		uint64_t bytes = 0;
+		for (const Entry &entry : entries) {
+			if (!entry.inUse) {
+				bytes += entry.bytes;
+			}
+		}
+		return bytes;
+	}
+
+	void TexturePool::LogUsage() const {
+		Log() << "Texture pool holds " << (unsigned long)entries.size() << " texture(s): "
+			<< BytesInUse() / (1024.0 * 1024.0) << " MB in use, " << BytesCached() / (1024.0 * 1024.0) << " MB unused";
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <cstdint>
+#include <vector>
+
+namespace vr {
+	using Microsoft::WRL::ComPtr;
+
+	// Keeps the post processor's textures alive across resource resets. Resetting hands the textures
+	// back to the pool instead of releasing them, and preparing the resources again takes matching ones
+	// out of it, so toggling settings with the hotkeys doesn't reallocate anything. Textures are
+	// matched on their exact size, format and bind flags: they are sampled with normalized coordinates
+	// and handed to the compositor whole, so a larger texture can't stand in for a smaller one.
+	//
+	// Textures that weren't taken again are kept up to the size of those in use, so switching back and
+	// forth between two resolutions reuses both sets; beyond that the least recently used are released.
+	class TexturePool {
+	public:
+		struct Desc {
+			uint32_t width;
+			uint32_t height;
+			DXGI_FORMAT format;
+			// format of the views, for typeless textures
+			DXGI_FORMAT viewFormat;
+			// D3D11_BIND_SHADER_RESOURCE and/or D3D11_BIND_UNORDERED_ACCESS; views are created for both
+			UINT bindFlags;
+		};
+
+		struct Texture {
+			ComPtr<ID3D11Texture2D> texture;
+			ComPtr<ID3D11ShaderResourceView> view;
+			ComPtr<ID3D11UnorderedAccessView> uav;
+		};
+
+		// returns a texture matching desc, creating it if no unused one is left; throws if creation fails
+		Texture Acquire(ID3D11Device *device, const Desc &desc, const char *name);
+		// returns a texture to the pool; the caller must drop its references to it
+		void Release(const Texture &texture);
+		// releases unused textures beyond the limit described above; call after preparing resources
+		void Trim();
+		// releases all textures, e.g. when the game switches to a different device
+		void Clear();
+
+		uint64_t BytesInUse() const;
+		uint64_t BytesCached() const;
+		// logs the number and size of the textures held
+		void LogUsage() const;
+
+	private:
+		struct Entry {
+			Desc desc;
+			Texture texture;
+			uint64_t bytes;
+			bool inUse;
+			// value of releaseCounter when the texture was last released
+			uint64_t lastRelease;
+		};
+
+		ComPtr<ID3D11Device> device;
+		std::vector<Entry> entries;
+		uint64_t releaseCounter = 0;
+	};
+}
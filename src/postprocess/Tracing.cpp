@@ -0,0 +1,138 @@
+#include "Tracing.h"
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+namespace vr {
+namespace trace {
+	std::atomic<bool> enabled { false };
+
+	namespace {
+		struct Event {
+			const char *name;
+			int64_t beginNs;
+			int64_t endNs;
+		};
+
+		// Written by its thread only. The writer fills a slot before publishing it through writeCount;
+		// since it never waits for readers, a reader checks writeCount again after copying and discards
+		// the slots the writer may have overwritten in the meantime.
+		struct ThreadRing {
+			static const uint32_t CAPACITY = 1 << 16;
+
+			Event events[CAPACITY];
+			std::atomic<uint64_t> writeCount { 0 };
+			uint32_t index = 0;
+		};
+
+		// rings are never freed, so that writing a trace doesn't race with exiting threads
+		const uint32_t MAX_THREADS = 64;
+		std::atomic<ThreadRing*> rings[MAX_THREADS];
+		std::atomic<uint32_t> ringCount { 0 };
+
+		ThreadRing * CurrentThreadRing() {
+			static thread_local ThreadRing *ring = nullptr;
+			static thread_local bool registered = false;
+			if (!registered) {
+				registered = true;
+				uint32_t index = ringCount.fetch_add(1, std::memory_order_relaxed);
+				if (index < MAX_THREADS) {
+					ring = new ThreadRing;
+					ring->index = index;
+					rings[index].store(ring, std::memory_order_release);
+				}
+			}
+			return ring;
+		}
+
+		void WriteEscaped(std::ostream &out, const char *str) {
+			for (; *str != 0; ++str) {
+				if (*str == '"' || *str == '\\') {
+					out << '\\';
+				}
+				out << *str;
+			}
+		}
+
+		void WriteMicroseconds(std::ostream &out, int64_t ns) {
+			char buf[32];
+			snprintf(buf, sizeof(buf), "%lld.%03d", (long long)(ns / 1000), (int)(ns % 1000));
+			out << buf;
+		}
+	}
+
+	void SetEnabled(bool enable) {
+		enabled.store(enable, std::memory_order_relaxed);
+	}
+
+	void Record(const char *name, int64_t beginNs, int64_t endNs) {
+		ThreadRing *ring = CurrentThreadRing();
+		if (ring == nullptr) {
+			return;
+		}
+		uint64_t count = ring->writeCount.load(std::memory_order_relaxed);
+		Event &event = ring->events[count & (ThreadRing::CAPACITY - 1)];
+		event.name = name;
+		event.beginNs = beginNs;
+		event.endNs = endNs;
+		ring->writeCount.store(count + 1, std::memory_order_release);
+	}
+
+	size_t WriteChromeTrace(std::ostream &out) {
+		struct ThreadEvents {
+			uint32_t index;
+			std::vector<Event> events;
+		};
+		std::vector<ThreadEvents> threads;
+		int64_t firstNs = INT64_MAX;
+
+		uint32_t count = (std::min)(ringCount.load(std::memory_order_relaxed), MAX_THREADS);
+		for (uint32_t i = 0; i < count; ++i) {
+			ThreadRing *ring = rings[i].load(std::memory_order_acquire);
+			if (ring == nullptr) {
+				continue;
+			}
+			uint64_t end = ring->writeCount.load(std::memory_order_acquire);
+			uint64_t begin = end > ThreadRing::CAPACITY ? end - ThreadRing::CAPACITY : 0;
+			ThreadEvents thread;
+			thread.index = ring->index;
+			thread.events.reserve((size_t)(end - begin));
+			for (uint64_t e = begin; e < end; ++e) {
+				thread.events.push_back(ring->events[e & (ThreadRing::CAPACITY - 1)]);
+			}
+			std::atomic_thread_fence(std::memory_order_acquire);
+			// the writer may be filling the slot of index written - CAPACITY right now, and has reused
+			// all slots before it
+			uint64_t written = ring->writeCount.load(std::memory_order_relaxed);
+			if (written + 1 > begin + ThreadRing::CAPACITY) {
+				uint64_t overwritten = (std::min)(written + 1 - ThreadRing::CAPACITY - begin, end - begin);
+				thread.events.erase(thread.events.begin(), thread.events.begin() + (size_t)overwritten);
+			}
+			for (const Event &event : thread.events) {
+				firstNs = (std::min)(firstNs, event.beginNs);
+			}
+			threads.push_back(std::move(thread));
+		}
+
+		size_t eventCount = 0;
+		out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"openvr_mod\"}}";
+		for (const ThreadEvents &thread : threads) {
+			out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.index
+				<< ",\"args\":{\"name\":\"thread " << thread.index << "\"}}";
+			for (const Event &event : thread.events) {
+				out << ",\n{\"name\":\"";
+				WriteEscaped(out, event.name);
+				out << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread.index << ",\"ts\":";
+				WriteMicroseconds(out, event.beginNs - firstNs);
+				out << ",\"dur\":";
+				WriteMicroseconds(out, event.endNs - event.beginNs);
+				out << "}";
+				++eventCount;
+			}
+		}
+		out << "\n]}\n";
+		return eventCount;
+	}
+}
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+// Scoped CPU trace events for finding out where the time of a Submit goes. Each thread records into
+// a ring buffer of its own, so recording an event takes two clock reads and a few stores without any
+// locking; when the ring is full the oldest events are overwritten. WriteChromeTrace collects the
+// rings into the Chrome trace event format, which chrome://tracing and ui.perfetto.dev open.
+//
+// Tracing is off by default, and a TRACE_SCOPE then costs a single relaxed load. The offline tools
+// record traces with it too.
+namespace vr {
+namespace trace {
+	extern std::atomic<bool> enabled;
+
+	void SetEnabled(bool enable);
+	inline bool IsEnabled() {
+		return enabled.load(std::memory_order_relaxed);
+	}
+
+	// nanoseconds on a monotonic clock
+	inline int64_t Now() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// name must be a string literal, or otherwise outlive all traces written afterwards
+	void Record(const char *name, int64_t beginNs, int64_t endNs);
+
+	// Writes the events currently held by all rings as a Chrome trace JSON document; may be called
+	// from any thread while others keep recording. Returns the number of events written.
+	size_t WriteChromeTrace(std::ostream &out);
+
+	class Scope {
+	public:
+		explicit Scope(const char *name) : name(name), beginNs(IsEnabled() ? Now() : 0) {}
+		~Scope() {
+			if (beginNs != 0) {
+				Record(name, beginNs, Now());
+			}
+		}
+
+	private:
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+		const char *name;
+		int64_t beginNs;
+	};
+}
+}
+
+#define TRACE_SCOPE_CONCAT2(a, b) a##b
+#define TRACE_SCOPE_CONCAT(a, b) TRACE_SCOPE_CONCAT2(a, b)
+// records the time until the end of the enclosing block as an event with the given name
+#define TRACE_SCOPE(name) vr::trace::Scope TRACE_SCOPE_CONCAT(traceScope, __LINE__) (name)
@@ -1,6 +1,9 @@
 #include "VrHooks.h"
 #include "Config.h"
+#include "HotkeyListener.h"
 #include "PostProcessor.h"
+#include "Tracing.h"
+#include "GLPostProcessor.h"
 
 #include <openvr.h>
 #include <MinHook.h>
@@ -17,6 +20,7 @@ namespace {
 	float mipLodBias;
 
 	vr::PostProcessor postProcessor;
+	vr::GLPostProcessor glPostProcessor;
 
 	void InstallVirtualFunctionHook(void *instance, uint32_t methodPos, void *hookFunction) {
 		LPVOID* vtable = *((LPVOID**)instance);
@@ -47,14 +51,30 @@ namespace {
 		}
 	}
 
+	void ApplyConfigReload() {
+		if (Config::Instance().ApplyPendingReload()) {
+			vr::trace::SetEnabled(Config::Instance().trace);
+			vr::HotkeyListener::Instance().UpdateBindings();
+			// the post processors pick up changed settings by themselves and only recreate their
+			// resources if they need it
+		}
+	}
+
 	vr::EVRCompositorError IVRCompositor_Submit(vr::IVRCompositor *self, vr::EVREye eEye, const vr::Texture_t *pTexture, const vr::VRTextureBounds_t *pBounds, vr::EVRSubmitFlags nSubmitFlags) {
+		TRACE_SCOPE("IVRCompositor_Submit");
 		void *origHandle = pTexture->handle;
+		ApplyConfigReload();
 
-		postProcessor.Apply(eEye, pTexture, pBounds, nSubmitFlags);
-		vr::EVRCompositorError error = CallOriginal(IVRCompositor_Submit)(self, eEye, pTexture, pBounds, nSubmitFlags);
+		postProcessor.Apply(eEye, pTexture, pBounds, &nSubmitFlags);
+		glPostProcessor.Apply(eEye, pTexture, pBounds, nSubmitFlags);
+		vr::EVRCompositorError error;
+		{
+			TRACE_SCOPE("vrclient Submit");
+			error = CallOriginal(IVRCompositor_Submit)(self, eEye, pTexture, pBounds, nSubmitFlags);
+		}
 		if (error != vr::VRCompositorError_None) {
-			if (Config::Instance().debugMode)
-				Log() << "Error when submitting for eye " << eEye << ": " << error << std::endl;
+			static LogRateLimit submitErrorLimit (1000);
+			Log(LogLevel::Debug, submitErrorLimit) << "Error when submitting for eye " << eEye << ": " << error;
 		}
 
 		const_cast<vr::Texture_t*>(pTexture)->handle = origHandle;
@@ -62,26 +82,46 @@ namespace {
 	}
 
 	vr::EVRCompositorError IVRCompositor_Submit_008(vr::IVRCompositor *self, vr::EVREye eEye, unsigned int eTextureType, void *pTexture, const vr::VRTextureBounds_t *pBounds, vr::EVRSubmitFlags nSubmitFlags) {
+		TRACE_SCOPE("IVRCompositor_Submit");
+		ApplyConfigReload();
 		if (eTextureType == 0) {
 			// texture type is DirectX
 			vr::Texture_t texture;
 			texture.eType = vr::TextureType_DirectX;
 			texture.eColorSpace = vr::ColorSpace_Auto;
 			texture.handle = pTexture;
-			postProcessor.Apply(eEye, &texture, pBounds, nSubmitFlags);
+			postProcessor.Apply(eEye, &texture, pBounds, &nSubmitFlags);
+			pTexture = texture.handle;
+		} else if (eTextureType == 1) {
+			// texture type is OpenGL
+			vr::Texture_t texture;
+			texture.eType = vr::TextureType_OpenGL;
+			texture.eColorSpace = vr::ColorSpace_Auto;
+			texture.handle = pTexture;
+			glPostProcessor.Apply(eEye, &texture, pBounds, nSubmitFlags);
 			pTexture = texture.handle;
 		}
 		return CallOriginal(IVRCompositor_Submit_008)(self, eEye, eTextureType, pTexture, pBounds, nSubmitFlags);
 	}
 
 	vr::EVRCompositorError IVRCompositor_Submit_007(vr::IVRCompositor *self, vr::EVREye eEye, unsigned int eTextureType, void *pTexture, const vr::VRTextureBounds_t *pBounds) {
+		TRACE_SCOPE("IVRCompositor_Submit");
+		ApplyConfigReload();
 		if (eTextureType == 0) {
 			// texture type is DirectX
 			vr::Texture_t texture;
 			texture.eType = vr::TextureType_DirectX;
 			texture.eColorSpace = vr::ColorSpace_Auto;
 			texture.handle = pTexture;
-			postProcessor.Apply(eEye, &texture, pBounds, vr::Submit_Default);
+			postProcessor.Apply(eEye, &texture, pBounds, nullptr);
+			pTexture = texture.handle;
+		} else if (eTextureType == 1) {
+			// texture type is OpenGL
+			vr::Texture_t texture;
+			texture.eType = vr::TextureType_OpenGL;
+			texture.eColorSpace = vr::ColorSpace_Auto;
+			texture.handle = pTexture;
+			glPostProcessor.Apply(eEye, &texture, pBounds, vr::Submit_Default);
 			pTexture = texture.handle;
 		}
 		return CallOriginal(IVRCompositor_Submit_007)(self, eEye, eTextureType, pTexture, pBounds);
@@ -92,6 +132,7 @@ namespace {
 	std::unordered_map<ID3D11SamplerState*, ComPtr<ID3D11SamplerState>> mappedSamplers;
 
 	void D3D11Context_PSSetSamplers(ID3D11DeviceContext *self, UINT StartSlot, UINT NumSamplers, ID3D11SamplerState * const *ppSamplers) {
+		TRACE_SCOPE("D3D11Context_PSSetSamplers");
 		static ID3D11SamplerState *samplers[D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT];
 		for (UINT i = 0; i < NumSamplers; ++i) {
 			ID3D11SamplerState *orig = ppSamplers[i];
@@ -101,7 +142,8 @@ namespace {
 				continue;
 
 			if (mappedSamplers.find(orig) == mappedSamplers.end()) {
-				Log() << "Creating replacement sampler for " << orig << " with MIP LOD bias " << mipLodBias << std::endl;
+				static LogRateLimit samplerLogLimit (1000);
+				Log(LogLevel::Debug, samplerLogLimit) << "Creating replacement sampler for " << orig << " with MIP LOD bias " << mipLodBias;
 				D3D11_SAMPLER_DESC sd;
 				if (orig != nullptr) {
 					orig->GetDesc(&sd);
@@ -137,12 +179,17 @@ namespace {
 }
 
 void InitHooks() {
-	Log() << "Initializing hooks...\n";
+	Log() << "Initializing hooks...";
 	MH_Initialize();
+	Config::StartWatching();
+	vr::trace::SetEnabled(Config::Instance().trace);
+	vr::HotkeyListener::Instance().Start();
 }
 
 void ShutdownHooks() {
-	Log() << "Shutting down hooks...\n";
+	Log() << "Shutting down hooks...";
+	Config::StopWatching();
+	vr::HotkeyListener::Instance().Stop();
 	MH_Uninitialize();
 	hooksToOriginal.clear();
 	ivrSystemHooked = false;
@@ -153,6 +200,35 @@ void ShutdownHooks() {
 	passThroughSamplers.clear();
 	mappedSamplers.clear();
 	postProcessor.Reset();
+	postProcessor.InitFramePacing(nullptr, 0);
+	postProcessor.InitHud(nullptr, nullptr, 0);
+	glPostProcessor.Reset();
+	FlushLog();
+}
+
+void ResolveConfigProfile(vr::IVRSystem *system) {
+	char model[256] = "";
+	if (system != nullptr) {
+		system->GetStringTrackedDeviceProperty(vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_ModelNumber_String, model, sizeof(model));
+	}
+	Config::Instance().ResolveProfile(model);
+}
+
+namespace {
+	float GetDisplayFrequency(vr::IVRSystem *system) {
+		if (system == nullptr) {
+			return 0;
+		}
+		return system->GetFloatTrackedDeviceProperty(vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_DisplayFrequency_Float);
+	}
+}
+
+void InitFramePacing(vr::IVRSystem *system, vr::IVRCompositor *compositor) {
+	postProcessor.InitFramePacing(compositor, GetDisplayFrequency(system));
+}
+
+void InitHud(vr::IVRSystem *system, vr::IVROverlay *overlay, vr::IVRCompositor *compositor) {
+	postProcessor.InitHud(overlay, compositor, GetDisplayFrequency(system));
 }
 
 void HookVRInterface(const char *version, void *instance) {
@@ -161,7 +237,7 @@ void HookVRInterface(const char *version, void *instance) {
 	// than the application to translate older versions, which with hooks installed for both would cause
 	// an infinite loop
 
-	Log() << "Requested interface " << version << "\n";
+	Log() << "Requested interface " << version;
 
 	// -----------------------
 	// - Hooks for IVRSystem -
@@ -171,7 +247,7 @@ void HookVRInterface(const char *version, void *instance) {
 		// The 'IVRSystem::GetRecommendedRenderTargetSize' function definition has been the same since the initial
 		// release of OpenVR; however, in early versions there was an additional method in front of it.
 		uint32_t methodPos = (system_version >= 9 ? 0 : 1);
-		Log() << "Injecting GetRecommendedRenderTargetSize into " << version << std::endl;
+		Log() << "Injecting GetRecommendedRenderTargetSize into " << version;
 		InstallVirtualFunctionHook(instance, methodPos, IVRSystem_GetRecommendedRenderTargetSize);
 
 		ivrSystemHooked = true;
@@ -184,31 +260,35 @@ void HookVRInterface(const char *version, void *instance) {
 	if (!ivrCompositorHooked && std::sscanf(version, "IVRCompositor_%u", &compositor_version))
 	{
 		if (compositor_version >= 9) {
-		Log() << "Injecting Submit into " << version << std::endl;
+		Log() << "Injecting Submit into " << version;
 			uint32_t methodPos = compositor_version >= 12 ? 5 : 4;
 			InstallVirtualFunctionHook(instance, methodPos, IVRCompositor_Submit);
 			ivrCompositorHooked = true;
 		}
 		else if (compositor_version == 8) {
-			Log() << "Injecting Submit into " << version << std::endl;
+			Log() << "Injecting Submit into " << version;
 			InstallVirtualFunctionHook(instance, 6, IVRCompositor_Submit_008);
 			ivrCompositorHooked = true;
 		}
 		else if (compositor_version == 7) {
-			Log() << "Injecting Submit into " << version << std::endl;
+			Log() << "Injecting Submit into " << version;
 			InstallVirtualFunctionHook(instance, 6, IVRCompositor_Submit_007);
 			ivrCompositorHooked = true;
 		}
 	}
 }
 
+size_t GetSamplerCacheSize() {
+	return mappedSamplers.size();
+}
+
 void HookD3D11Context( ID3D11DeviceContext *context, ID3D11Device *pDevice, float bias ) {
 	device = pDevice;
 	mipLodBias = bias;
 	mappedSamplers.clear();
 	passThroughSamplers.clear();
 	if (context != hookedContext) {
-		Log() << "Injecting PSSetSamplers into D3D11DeviceContext" << std::endl;
+		Log() << "Injecting PSSetSamplers into D3D11DeviceContext";
 		InstallVirtualFunctionHook(context, 10, D3D11Context_PSSetSamplers);
 		hookedContext = context;
 	}
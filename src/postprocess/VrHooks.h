@@ -1,8 +1,18 @@
 #pragma once
 #include <d3d11.h>
+#include <openvr.h>
 
 void InitHooks();
 void ShutdownHooks();
 
+// picks the config profile for the running game and HMD, once the runtime is initialized
+void ResolveConfigProfile(vr::IVRSystem *system);
+// hands the frame pacing analysis the compositor of the current interface version, or nullptr at shutdown
+void InitFramePacing(vr::IVRSystem *system, vr::IVRCompositor *compositor);
+// hands the HUD the overlay and compositor of the current interface version, or nullptrs at shutdown
+void InitHud(vr::IVRSystem *system, vr::IVROverlay *overlay, vr::IVRCompositor *compositor);
+
 void HookVRInterface(const char *version, void *instance);
+// number of samplers replaced with a mip-biased copy
+size_t GetSamplerCacheSize();
 void HookD3D11Context(ID3D11DeviceContext *context, ID3D11Device *device, float mipLodBias);
@@ -0,0 +1,318 @@
+#include <cstring>
+
+#include "NullInterfaces.h"
+
+namespace nullvr {
+	void NullCompositor::Init(const Settings &settings, const VsyncClock *clock, const NullSystem *system) {
+		this->settings = settings;
+		this->clock = clock;
+		this->system = system;
+		trackingSpace = vr::TrackingUniverseStanding;
+		lastWaitGetPoses = 0;
+		lastFrameInterval = 0;
+		ResetSubmitStats();
+	}
+
+	void NullCompositor::GetSubmitStats(SubmitStats &stats) const {
+		stats.frames = frames.load();
+		stats.submits[0] = submits[0].load();
+		stats.submits[1] = submits[1].load();
+		stats.rejectedSubmits = rejectedSubmits.load();
+		stats.last[0] = last[0];
+		stats.last[1] = last[1];
+	}
+
+	void NullCompositor::ResetSubmitStats() {
+		frames = 0;
+		submits[0] = 0;
+		submits[1] = 0;
+		rejectedSubmits = 0;
+		std::memset(last, 0, sizeof(last));
+	}
+
+	void NullCompositor::SetSubmitCallback(SubmitCallback callback, void *userData) {
+		submitCallbackUserData = userData;
+		submitCallback = callback;
+	}
+
+	void NullCompositor::FillPoses(vr::TrackedDevicePose_t *poses, uint32_t count) const {
+		system->GetPoses(trackingSpace, poses, count);
+	}
+
+	void NullCompositor::SetTrackingSpace( vr::ETrackingUniverseOrigin eOrigin ) {
+		trackingSpace = eOrigin;
+	}
+
+	vr::ETrackingUniverseOrigin NullCompositor::GetTrackingSpace() {
+		return trackingSpace;
+	}
+
+	vr::EVRCompositorError NullCompositor::WaitGetPoses( vr::TrackedDevicePose_t* pRenderPoseArray, uint32_t unRenderPoseArrayCount, vr::TrackedDevicePose_t* pGamePoseArray, uint32_t unGamePoseArrayCount ) {
+		if (settings.vsync) {
+			clock->WaitForNextVsync();
+		}
+		double now = clock->SecondsSinceStart();
+		lastFrameInterval = lastWaitGetPoses > 0 ? now - lastWaitGetPoses : 0;
+		lastWaitGetPoses = now;
+		++frames;
+
+		FillPoses(pRenderPoseArray, unRenderPoseArrayCount);
+		FillPoses(pGamePoseArray, unGamePoseArrayCount);
+		return vr::VRCompositorError_None;
+	}
+
+	vr::EVRCompositorError NullCompositor::GetLastPoses( vr::TrackedDevicePose_t* pRenderPoseArray, uint32_t unRenderPoseArrayCount, vr::TrackedDevicePose_t* pGamePoseArray, uint32_t unGamePoseArrayCount ) {
+		FillPoses(pRenderPoseArray, unRenderPoseArrayCount);
+		FillPoses(pGamePoseArray, unGamePoseArrayCount);
+		return vr::VRCompositorError_None;
+	}
+
+	vr::EVRCompositorError NullCompositor::GetLastPoseForTrackedDeviceIndex( vr::TrackedDeviceIndex_t unDeviceIndex, vr::TrackedDevicePose_t *pOutputPose, vr::TrackedDevicePose_t *pOutputGamePose ) {
+		if (unDeviceIndex >= vr::k_unMaxTrackedDeviceCount) {
+			return vr::VRCompositorError_IndexOutOfRange;
+		}
+		vr::TrackedDevicePose_t poses[vr::k_unMaxTrackedDeviceCount];
+		FillPoses(poses, vr::k_unMaxTrackedDeviceCount);
+		if (pOutputPose) *pOutputPose = poses[unDeviceIndex];
+		if (pOutputGamePose) *pOutputGamePose = poses[unDeviceIndex];
+		return vr::VRCompositorError_None;
+	}
+
+	vr::EVRCompositorError NullCompositor::Submit( vr::EVREye eEye, const vr::Texture_t *pTexture, const vr::VRTextureBounds_t* pBounds, vr::EVRSubmitFlags nSubmitFlags ) {
+		if (eEye != vr::Eye_Left && eEye != vr::Eye_Right) {
+			++rejectedSubmits;
+			return vr::VRCompositorError_IndexOutOfRange;
+		}
+		if (pTexture == nullptr || pTexture->handle == nullptr) {
+			++rejectedSubmits;
+			return vr::VRCompositorError_InvalidTexture;
+		}
+		if (pBounds != nullptr && (pBounds->uMin < 0 || pBounds->uMax > 1 || pBounds->vMin < 0 || pBounds->vMax > 1)) {
+			++rejectedSubmits;
+			return vr::VRCompositorError_InvalidBounds;
+		}
+
+		SubmitRecord &record = last[eEye];
+		record.frameIndex = frames.load(std::memory_order_relaxed);
+		record.eye = eEye;
+		record.textureType = pTexture->eType;
+		record.colorSpace = pTexture->eColorSpace;
+		record.handle = pTexture->handle;
+		record.hasBounds = pBounds != nullptr;
+		if (pBounds != nullptr) {
+			record.bounds = *pBounds;
+		} else {
+			record.bounds = { 0, 0, 1, 1 };
+		}
+		record.flags = nSubmitFlags;
+		++submits[eEye];
+
+		if (submitCallback != nullptr) {
+			submitCallback(record, submitCallbackUserData);
+		}
+		return vr::VRCompositorError_None;
+	}
+
+	void NullCompositor::ClearLastSubmittedFrame() {
+	}
+
+	void NullCompositor::PostPresentHandoff() {
+	}
+
+	bool NullCompositor::GetFrameTiming( vr::Compositor_FrameTiming *pTiming, uint32_t unFramesAgo ) {
+		if (pTiming == nullptr || pTiming->m_nSize != sizeof(vr::Compositor_FrameTiming)) {
+			return false;
+		}
+		uint64_t frameCount = frames.load();
+		if (unFramesAgo >= frameCount) {
+			return false;
+		}
+		// only the current frame is tracked; older frames report the same intervals
+		std::memset(pTiming, 0, sizeof(*pTiming));
+		pTiming->m_nSize = sizeof(vr::Compositor_FrameTiming);
+		pTiming->m_nFrameIndex = (uint32_t)(frameCount - unFramesAgo);
+		pTiming->m_nNumFramePresents = 1;
+		pTiming->m_flSystemTimeInSeconds = lastWaitGetPoses - unFramesAgo * lastFrameInterval;
+		pTiming->m_flClientFrameIntervalMs = (float)(lastFrameInterval * 1000);
+		system->GetHmdPose(pTiming->m_HmdPose);
+		return true;
+	}
+
+	uint32_t NullCompositor::GetFrameTimings( vr::Compositor_FrameTiming *pTiming, uint32_t nFrames ) {
+		if (pTiming == nullptr) {
+			return 0;
+		}
+		uint32_t count = 0;
+		// timings are returned oldest first
+		for (uint32_t i = 0; i < nFrames; ++i) {
+			pTiming[i].m_nSize = sizeof(vr::Compositor_FrameTiming);
+			if (!GetFrameTiming(&pTiming[i], nFrames - 1 - i)) {
+				break;
+			}
+			++count;
+		}
+		return count;
+	}
+
+	float NullCompositor::GetFrameTimeRemaining() {
+		return (float)(clock->FrameDuration() - clock->SecondsSinceLastVsync());
+	}
+
+	void NullCompositor::GetCumulativeStats( vr::Compositor_CumulativeStats *pStats, uint32_t nStatsSizeInBytes ) {
+		if (pStats == nullptr || nStatsSizeInBytes < sizeof(vr::Compositor_CumulativeStats)) {
+			return;
+		}
+		std::memset(pStats, 0, sizeof(vr::Compositor_CumulativeStats));
+		pStats->m_nNumFramePresents = (uint32_t)frames.load();
+	}
+
+	void NullCompositor::FadeToColor( float fSeconds, float fRed, float fGreen, float fBlue, float fAlpha, bool bBackground ) {
+	}
+
+	vr::HmdColor_t NullCompositor::GetCurrentFadeColor( bool bBackground ) {
+		vr::HmdColor_t color = { 0, 0, 0, 0 };
+		return color;
+	}
+
+	void NullCompositor::FadeGrid( float fSeconds, bool bFadeGridIn ) {
+	}
+
+	float NullCompositor::GetCurrentGridAlpha() {
+		return 0;
+	}
+
+	vr::EVRCompositorError NullCompositor::SetSkyboxOverride( const vr::Texture_t *pTextures, uint32_t unTextureCount ) {
+		return vr::VRCompositorError_None;
+	}
+
+	void NullCompositor::ClearSkyboxOverride() {
+	}
+
+	void NullCompositor::CompositorBringToFront() {
+	}
+
+	void NullCompositor::CompositorGoToBack() {
+	}
+
+	void NullCompositor::CompositorQuit() {
+	}
+
+	bool NullCompositor::IsFullscreen() {
+		return true;
+	}
+
+	uint32_t NullCompositor::GetCurrentSceneFocusProcess() {
+		return 0;
+	}
+
+	uint32_t NullCompositor::GetLastFrameRenderer() {
+		return 0;
+	}
+
+	bool NullCompositor::CanRenderScene() {
+		return true;
+	}
+
+	void NullCompositor::ShowMirrorWindow() {
+	}
+
+	void NullCompositor::HideMirrorWindow() {
+	}
+
+	bool NullCompositor::IsMirrorWindowVisible() {
+		return false;
+	}
+
+	void NullCompositor::CompositorDumpImages() {
+	}
+
+	bool NullCompositor::ShouldAppRenderWithLowResources() {
+		return false;
+	}
+
+	void NullCompositor::ForceInterleavedReprojectionOn( bool bOverride ) {
+	}
+
+	void NullCompositor::ForceReconnectProcess() {
+	}
+
+	void NullCompositor::SuspendRendering( bool bSuspend ) {
+	}
+
+	vr::EVRCompositorError NullCompositor::GetMirrorTextureD3D11( vr::EVREye eEye, void *pD3D11DeviceOrResource, void **ppD3D11ShaderResourceView ) {
+		return vr::VRCompositorError_RequestFailed;
+	}
+
+	void NullCompositor::ReleaseMirrorTextureD3D11( void *pD3D11ShaderResourceView ) {
+	}
+
+	vr::EVRCompositorError NullCompositor::GetMirrorTextureGL( vr::EVREye eEye, vr::glUInt_t *pglTextureId, vr::glSharedTextureHandle_t *pglSharedTextureHandle ) {
+		return vr::VRCompositorError_RequestFailed;
+	}
+
+	bool NullCompositor::ReleaseSharedGLTexture( vr::glUInt_t glTextureId, vr::glSharedTextureHandle_t glSharedTextureHandle ) {
+		return false;
+	}
+
+	void NullCompositor::LockGLSharedTextureForAccess( vr::glSharedTextureHandle_t glSharedTextureHandle ) {
+	}
+
+	void NullCompositor::UnlockGLSharedTextureForAccess( vr::glSharedTextureHandle_t glSharedTextureHandle ) {
+	}
+
+	uint32_t NullCompositor::GetVulkanInstanceExtensionsRequired( char *pchValue, uint32_t unBufferSize ) {
+		if (pchValue != nullptr && unBufferSize > 0) {
+			pchValue[0] = '\0';
+		}
+		return 1;
+	}
+
+	uint32_t NullCompositor::GetVulkanDeviceExtensionsRequired( VkPhysicalDevice_T *pPhysicalDevice, char *pchValue, uint32_t unBufferSize ) {
+		if (pchValue != nullptr && unBufferSize > 0) {
+			pchValue[0] = '\0';
+		}
+		return 1;
+	}
+
+	void NullCompositor::SetExplicitTimingMode( vr::EVRCompositorTimingMode eTimingMode ) {
+	}
+
+	vr::EVRCompositorError NullCompositor::SubmitExplicitTimingData() {
+		return vr::VRCompositorError_None;
+	}
+
+	bool NullCompositor::IsMotionSmoothingEnabled() {
+		return false;
+	}
+
+	bool NullCompositor::IsMotionSmoothingSupported() {
+		return false;
+	}
+
+	bool NullCompositor::IsCurrentSceneFocusAppLoading() {
+		return false;
+	}
+
+	vr::EVRCompositorError NullCompositor::SetStageOverride_Async( const char *pchRenderModelPath, const vr::HmdMatrix34_t *pTransform, const vr::Compositor_StageRenderSettings *pRenderSettings, uint32_t nSizeOfRenderSettings ) {
+		return vr::VRCompositorError_None;
+	}
+
+	void NullCompositor::ClearStageOverride() {
+	}
+
+	bool NullCompositor::GetCompositorBenchmarkResults( vr::Compositor_BenchmarkResults *pBenchmarkResults, uint32_t nSizeOfBenchmarkResults ) {
+		return false;
+	}
+
+	vr::EVRCompositorError NullCompositor::GetLastPosePredictionIDs( uint32_t *pRenderPosePredictionID, uint32_t *pGamePosePredictionID ) {
+		uint32_t id = (uint32_t)frames.load();
+		if (pRenderPosePredictionID) *pRenderPosePredictionID = id;
+		if (pGamePosePredictionID) *pGamePosePredictionID = id;
+		return vr::VRCompositorError_None;
+	}
+
+	vr::EVRCompositorError NullCompositor::GetPosesForFrame( uint32_t unPosePredictionID, vr::TrackedDevicePose_t* pPoseArray, uint32_t unPoseArrayCount ) {
+		FillPoses(pPoseArray, unPoseArrayCount);
+		return vr::VRCompositorError_None;
+	}
+}
@@ -0,0 +1,179 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#include "NullRuntime.h"
+
+namespace nullvr {
+	struct Settings {
+		uint32_t renderWidth = 2016;
+		uint32_t renderHeight = 2240;
+		float projection[4] = { -1.39f, 1.24f, -1.47f, 1.46f };
+		float ipd = 0.063f;
+		float cantDegrees = 0;
+		float hiddenAreaRadius = 1.1f;
+		float refreshRate = 90;
+		bool vsync = false;
+
+		static Settings FromEnvironment();
+	};
+
+	// simulated display timing shared by IVRSystem and IVRCompositor
+	class VsyncClock {
+	public:
+		void Start(float refreshRate);
+		double SecondsSinceStart() const;
+		double FrameDuration() const { return frameDuration; }
+		uint64_t VsyncCount() const;
+		double SecondsSinceLastVsync() const;
+		void WaitForNextVsync() const;
+
+	private:
+		std::chrono::steady_clock::time_point start;
+		double frameDuration = 1. / 90;
+	};
+
+	class NullSystem : public vr::IVRSystem {
+	public:
+		void Init(const Settings &settings, const VsyncClock *clock);
+		void GetHmdPose(vr::TrackedDevicePose_t &pose) const;
+		void GetPoses(vr::ETrackingUniverseOrigin origin, vr::TrackedDevicePose_t *poses, uint32_t count) const;
+
+		void GetRecommendedRenderTargetSize( uint32_t *pnWidth, uint32_t *pnHeight ) override;
+		vr::HmdMatrix44_t GetProjectionMatrix( vr::EVREye eEye, float fNearZ, float fFarZ ) override;
+		void GetProjectionRaw( vr::EVREye eEye, float *pfLeft, float *pfRight, float *pfTop, float *pfBottom ) override;
+		bool ComputeDistortion( vr::EVREye eEye, float fU, float fV, vr::DistortionCoordinates_t *pDistortionCoordinates ) override;
+		vr::HmdMatrix34_t GetEyeToHeadTransform( vr::EVREye eEye ) override;
+		bool GetTimeSinceLastVsync( float *pfSecondsSinceLastVsync, uint64_t *pulFrameCounter ) override;
+		int32_t GetD3D9AdapterIndex() override;
+		void GetDXGIOutputInfo( int32_t *pnAdapterIndex ) override;
+		void GetOutputDevice( uint64_t *pnDevice, vr::ETextureType textureType, VkInstance_T *pInstance ) override;
+		bool IsDisplayOnDesktop() override;
+		bool SetDisplayVisibility( bool bIsVisibleOnDesktop ) override;
+		void GetDeviceToAbsoluteTrackingPose( vr::ETrackingUniverseOrigin eOrigin, float fPredictedSecondsToPhotonsFromNow, vr::TrackedDevicePose_t *pTrackedDevicePoseArray, uint32_t unTrackedDevicePoseArrayCount ) override;
+		vr::HmdMatrix34_t GetSeatedZeroPoseToStandingAbsoluteTrackingPose() override;
+		vr::HmdMatrix34_t GetRawZeroPoseToStandingAbsoluteTrackingPose() override;
+		uint32_t GetSortedTrackedDeviceIndicesOfClass( vr::ETrackedDeviceClass eTrackedDeviceClass, vr::TrackedDeviceIndex_t *punTrackedDeviceIndexArray, uint32_t unTrackedDeviceIndexArrayCount, vr::TrackedDeviceIndex_t unRelativeToTrackedDeviceIndex ) override;
+		vr::EDeviceActivityLevel GetTrackedDeviceActivityLevel( vr::TrackedDeviceIndex_t unDeviceId ) override;
+		void ApplyTransform( vr::TrackedDevicePose_t *pOutputPose, const vr::TrackedDevicePose_t *pTrackedDevicePose, const vr::HmdMatrix34_t *pTransform ) override;
+		vr::TrackedDeviceIndex_t GetTrackedDeviceIndexForControllerRole( vr::ETrackedControllerRole unDeviceType ) override;
+		vr::ETrackedControllerRole GetControllerRoleForTrackedDeviceIndex( vr::TrackedDeviceIndex_t unDeviceIndex ) override;
+		vr::ETrackedDeviceClass GetTrackedDeviceClass( vr::TrackedDeviceIndex_t unDeviceIndex ) override;
+		bool IsTrackedDeviceConnected( vr::TrackedDeviceIndex_t unDeviceIndex ) override;
+		bool GetBoolTrackedDeviceProperty( vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError *pError ) override;
+		float GetFloatTrackedDeviceProperty( vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError *pError ) override;
+		int32_t GetInt32TrackedDeviceProperty( vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError *pError ) override;
+		uint64_t GetUint64TrackedDeviceProperty( vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError *pError ) override;
+		vr::HmdMatrix34_t GetMatrix34TrackedDeviceProperty( vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError *pError ) override;
+		uint32_t GetArrayTrackedDeviceProperty( vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::PropertyTypeTag_t propType, void *pBuffer, uint32_t unBufferSize, vr::ETrackedPropertyError *pError ) override;
+		uint32_t GetStringTrackedDeviceProperty( vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, char *pchValue, uint32_t unBufferSize, vr::ETrackedPropertyError *pError ) override;
+		const char *GetPropErrorNameFromEnum( vr::ETrackedPropertyError error ) override;
+		bool PollNextEvent( vr::VREvent_t *pEvent, uint32_t uncbVREvent ) override;
+		bool PollNextEventWithPose( vr::ETrackingUniverseOrigin eOrigin, vr::VREvent_t *pEvent, uint32_t uncbVREvent, vr::TrackedDevicePose_t *pTrackedDevicePose ) override;
+		const char *GetEventTypeNameFromEnum( vr::EVREventType eType ) override;
+		vr::HiddenAreaMesh_t GetHiddenAreaMesh( vr::EVREye eEye, vr::EHiddenAreaMeshType type ) override;
+		bool GetControllerState( vr::TrackedDeviceIndex_t unControllerDeviceIndex, vr::VRControllerState_t *pControllerState, uint32_t unControllerStateSize ) override;
+		bool GetControllerStateWithPose( vr::ETrackingUniverseOrigin eOrigin, vr::TrackedDeviceIndex_t unControllerDeviceIndex, vr::VRControllerState_t *pControllerState, uint32_t unControllerStateSize, vr::TrackedDevicePose_t *pTrackedDevicePose ) override;
+		void TriggerHapticPulse( vr::TrackedDeviceIndex_t unControllerDeviceIndex, uint32_t unAxisId, unsigned short usDurationMicroSec ) override;
+		const char *GetButtonIdNameFromEnum( vr::EVRButtonId eButtonId ) override;
+		const char *GetControllerAxisTypeNameFromEnum( vr::EVRControllerAxisType eAxisType ) override;
+		bool IsInputAvailable() override;
+		bool IsSteamVRDrawingControllers() override;
+		bool ShouldApplicationPause() override;
+		bool ShouldApplicationReduceRenderingWork() override;
+		vr::EVRFirmwareError PerformFirmwareUpdate( vr::TrackedDeviceIndex_t unDeviceIndex ) override;
+		void AcknowledgeQuit_Exiting() override;
+		uint32_t GetAppContainerFilePaths( char *pchBuffer, uint32_t unBufferSize ) override;
+		const char *GetRuntimeVersion() override;
+
+	private:
+		Settings settings;
+		const VsyncClock *clock = nullptr;
+		// hidden area meshes per eye and EHiddenAreaMeshType
+		std::vector<vr::HmdVector2_t> hiddenArea[2][vr::k_eHiddenAreaMesh_Max];
+
+		void CreateHiddenAreaMeshes(vr::EVREye eye);
+	};
+
+	class NullCompositor : public vr::IVRCompositor {
+	public:
+		void Init(const Settings &settings, const VsyncClock *clock, const NullSystem *system);
+
+		void GetSubmitStats(SubmitStats &stats) const;
+		void ResetSubmitStats();
+		void SetSubmitCallback(SubmitCallback callback, void *userData);
+
+		void SetTrackingSpace( vr::ETrackingUniverseOrigin eOrigin ) override;
+		vr::ETrackingUniverseOrigin GetTrackingSpace() override;
+		vr::EVRCompositorError WaitGetPoses( vr::TrackedDevicePose_t* pRenderPoseArray, uint32_t unRenderPoseArrayCount, vr::TrackedDevicePose_t* pGamePoseArray, uint32_t unGamePoseArrayCount ) override;
+		vr::EVRCompositorError GetLastPoses( vr::TrackedDevicePose_t* pRenderPoseArray, uint32_t unRenderPoseArrayCount, vr::TrackedDevicePose_t* pGamePoseArray, uint32_t unGamePoseArrayCount ) override;
+		vr::EVRCompositorError GetLastPoseForTrackedDeviceIndex( vr::TrackedDeviceIndex_t unDeviceIndex, vr::TrackedDevicePose_t *pOutputPose, vr::TrackedDevicePose_t *pOutputGamePose ) override;
+		vr::EVRCompositorError Submit( vr::EVREye eEye, const vr::Texture_t *pTexture, const vr::VRTextureBounds_t* pBounds, vr::EVRSubmitFlags nSubmitFlags ) override;
+		void ClearLastSubmittedFrame() override;
+		void PostPresentHandoff() override;
+		bool GetFrameTiming( vr::Compositor_FrameTiming *pTiming, uint32_t unFramesAgo ) override;
+		uint32_t GetFrameTimings( vr::Compositor_FrameTiming *pTiming, uint32_t nFrames ) override;
+		float GetFrameTimeRemaining() override;
+		void GetCumulativeStats( vr::Compositor_CumulativeStats *pStats, uint32_t nStatsSizeInBytes ) override;
+		void FadeToColor( float fSeconds, float fRed, float fGreen, float fBlue, float fAlpha, bool bBackground ) override;
+		vr::HmdColor_t GetCurrentFadeColor( bool bBackground ) override;
+		void FadeGrid( float fSeconds, bool bFadeGridIn ) override;
+		float GetCurrentGridAlpha() override;
+		vr::EVRCompositorError SetSkyboxOverride( const vr::Texture_t *pTextures, uint32_t unTextureCount ) override;
+		void ClearSkyboxOverride() override;
+		void CompositorBringToFront() override;
+		void CompositorGoToBack() override;
+		void CompositorQuit() override;
+		bool IsFullscreen() override;
+		uint32_t GetCurrentSceneFocusProcess() override;
+		uint32_t GetLastFrameRenderer() override;
+		bool CanRenderScene() override;
+		void ShowMirrorWindow() override;
+		void HideMirrorWindow() override;
+		bool IsMirrorWindowVisible() override;
+		void CompositorDumpImages() override;
+		bool ShouldAppRenderWithLowResources() override;
+		void ForceInterleavedReprojectionOn( bool bOverride ) override;
+		void ForceReconnectProcess() override;
+		void SuspendRendering( bool bSuspend ) override;
+		vr::EVRCompositorError GetMirrorTextureD3D11( vr::EVREye eEye, void *pD3D11DeviceOrResource, void **ppD3D11ShaderResourceView ) override;
+		void ReleaseMirrorTextureD3D11( void *pD3D11ShaderResourceView ) override;
+		vr::EVRCompositorError GetMirrorTextureGL( vr::EVREye eEye, vr::glUInt_t *pglTextureId, vr::glSharedTextureHandle_t *pglSharedTextureHandle ) override;
+		bool ReleaseSharedGLTexture( vr::glUInt_t glTextureId, vr::glSharedTextureHandle_t glSharedTextureHandle ) override;
+		void LockGLSharedTextureForAccess( vr::glSharedTextureHandle_t glSharedTextureHandle ) override;
+		void UnlockGLSharedTextureForAccess( vr::glSharedTextureHandle_t glSharedTextureHandle ) override;
+		uint32_t GetVulkanInstanceExtensionsRequired( char *pchValue, uint32_t unBufferSize ) override;
+		uint32_t GetVulkanDeviceExtensionsRequired( VkPhysicalDevice_T *pPhysicalDevice, char *pchValue, uint32_t unBufferSize ) override;
+		void SetExplicitTimingMode( vr::EVRCompositorTimingMode eTimingMode ) override;
+		vr::EVRCompositorError SubmitExplicitTimingData() override;
+		bool IsMotionSmoothingEnabled() override;
+		bool IsMotionSmoothingSupported() override;
+		bool IsCurrentSceneFocusAppLoading() override;
+		vr::EVRCompositorError SetStageOverride_Async( const char *pchRenderModelPath, const vr::HmdMatrix34_t *pTransform, const vr::Compositor_StageRenderSettings *pRenderSettings, uint32_t nSizeOfRenderSettings ) override;
+		void ClearStageOverride() override;
+		bool GetCompositorBenchmarkResults( vr::Compositor_BenchmarkResults *pBenchmarkResults, uint32_t nSizeOfBenchmarkResults ) override;
+		vr::EVRCompositorError GetLastPosePredictionIDs( uint32_t *pRenderPosePredictionID, uint32_t *pGamePosePredictionID ) override;
+		vr::EVRCompositorError GetPosesForFrame( uint32_t unPosePredictionID, vr::TrackedDevicePose_t* pPoseArray, uint32_t unPoseArrayCount ) override;
+
+	private:
+		Settings settings;
+		const VsyncClock *clock = nullptr;
+		const NullSystem *system = nullptr;
+		vr::ETrackingUniverseOrigin trackingSpace = vr::TrackingUniverseStanding;
+		double lastWaitGetPoses = 0;
+		double lastFrameInterval = 0;
+
+		// Submit is called from the game's render thread while a benchmark may read the stats from
+		// another one, so the counters are atomic. The last records are only meant to be read once
+		// the render thread is idle.
+		std::atomic<uint64_t> frames;
+		std::atomic<uint64_t> submits[2];
+		std::atomic<uint64_t> rejectedSubmits;
+		SubmitRecord last[2];
+		SubmitCallback submitCallback = nullptr;
+		void *submitCallbackUserData = nullptr;
+
+		void FillPoses(vr::TrackedDevicePose_t *poses, uint32_t count) const;
+	};
+}
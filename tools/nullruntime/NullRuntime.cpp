@@ -0,0 +1,214 @@
+// A vrclient stand-in that provides IVRSystem and IVRCompositor for a virtual headset. Point
+// VR_OVERRIDE at the directory containing bin/<vrclient library> and openvr_api will load this instead
+// of SteamVR. See NullRuntime.h for the settings and the benchmark exports.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "NullInterfaces.h"
+#include "ivrclientcore.h"
+
+#if defined(_WIN32)
+#define NULLVR_EXPORT extern "C" __declspec( dllexport )
+#else
+#define NULLVR_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+namespace nullvr {
+	namespace {
+		const char * GetSetting(const char *name) {
+			const char *value = std::getenv(name);
+			return value != nullptr && *value != '\0' ? value : nullptr;
+		}
+
+		void ReadFloat(const char *name, float &value) {
+			const char *setting = GetSetting(name);
+			if (setting == nullptr) {
+				return;
+			}
+			char *end = nullptr;
+			float parsed = std::strtof(setting, &end);
+			if (end == setting) {
+				std::fprintf(stderr, "nullvr: ignoring invalid %s '%s'\n", name, setting);
+				return;
+			}
+			value = parsed;
+		}
+	}
+
+	Settings Settings::FromEnvironment() {
+		Settings settings;
+
+		if (const char *size = GetSetting("NULLVR_RENDER_SIZE")) {
+			unsigned width = 0, height = 0;
+			if (std::sscanf(size, "%ux%u", &width, &height) == 2 && width > 0 && height > 0) {
+				settings.renderWidth = width;
+				settings.renderHeight = height;
+			} else {
+				std::fprintf(stderr, "nullvr: ignoring invalid NULLVR_RENDER_SIZE '%s'\n", size);
+			}
+		}
+
+		if (const char *projection = GetSetting("NULLVR_PROJECTION")) {
+			float p[4];
+			if (std::sscanf(projection, "%f,%f,%f,%f", &p[0], &p[1], &p[2], &p[3]) == 4 && p[0] < p[1] && p[2] < p[3]) {
+				std::memcpy(settings.projection, p, sizeof(p));
+			} else {
+				std::fprintf(stderr, "nullvr: ignoring invalid NULLVR_PROJECTION '%s'\n", projection);
+			}
+		}
+
+		ReadFloat("NULLVR_IPD", settings.ipd);
+		ReadFloat("NULLVR_CANT", settings.cantDegrees);
+		ReadFloat("NULLVR_HIDDEN_AREA", settings.hiddenAreaRadius);
+		if (settings.hiddenAreaRadius < 0) settings.hiddenAreaRadius = 0;
+		ReadFloat("NULLVR_REFRESH_RATE", settings.refreshRate);
+		if (settings.refreshRate < 1) settings.refreshRate = 1;
+		if (const char *vsync = GetSetting("NULLVR_VSYNC")) {
+			settings.vsync = std::strcmp(vsync, "0") != 0;
+		}
+
+		return settings;
+	}
+
+	void VsyncClock::Start(float refreshRate) {
+		start = std::chrono::steady_clock::now();
+		frameDuration = 1. / refreshRate;
+	}
+
+	double VsyncClock::SecondsSinceStart() const {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	uint64_t VsyncClock::VsyncCount() const {
+		return (uint64_t)(SecondsSinceStart() / frameDuration);
+	}
+
+	double VsyncClock::SecondsSinceLastVsync() const {
+		double now = SecondsSinceStart();
+		return now - (uint64_t)(now / frameDuration) * frameDuration;
+	}
+
+	void VsyncClock::WaitForNextVsync() const {
+		double remaining = frameDuration - SecondsSinceLastVsync();
+		std::this_thread::sleep_for(std::chrono::duration<double>(remaining));
+	}
+
+	namespace {
+		class NullClientCore : public vr::IVRClientCore {
+		public:
+			vr::EVRInitError Init( vr::EVRApplicationType eApplicationType, const char *pStartupInfo ) override {
+				std::lock_guard<std::mutex> lock (mutex);
+				// the benchmark loads the runtime directly besides going through openvr_api, so
+				// tolerate nested Init/Cleanup pairs and keep the state of the first one
+				if (initCount++ == 0) {
+					settings = Settings::FromEnvironment();
+					clock.Start(settings.refreshRate);
+					system.Init(settings, &clock);
+					compositor.Init(settings, &clock, &system);
+				}
+				return vr::VRInitError_None;
+			}
+
+			void Cleanup() override {
+				std::lock_guard<std::mutex> lock (mutex);
+				if (initCount > 0) {
+					--initCount;
+				}
+			}
+
+			vr::EVRInitError IsInterfaceVersionValid( const char *pchInterfaceVersion ) override {
+				return FindInterface(pchInterfaceVersion) != nullptr ? vr::VRInitError_None : vr::VRInitError_Init_InterfaceNotFound;
+			}
+
+			void *GetGenericInterface( const char *pchNameAndVersion, vr::EVRInitError *peError ) override {
+				std::lock_guard<std::mutex> lock (mutex);
+				void *result = initCount > 0 ? FindInterface(pchNameAndVersion) : nullptr;
+				if (peError) {
+					if (initCount == 0) {
+						*peError = vr::VRInitError_Init_NotInitialized;
+					} else {
+						*peError = result != nullptr ? vr::VRInitError_None : vr::VRInitError_Init_InterfaceNotFound;
+					}
+				}
+				return result;
+			}
+
+			bool BIsHmdPresent() override {
+				return true;
+			}
+
+			const char *GetEnglishStringForHmdError( vr::EVRInitError eError ) override {
+				switch (eError) {
+				case vr::VRInitError_None: return "No Error (0)";
+				case vr::VRInitError_Init_InterfaceNotFound: return "The null runtime does not provide this interface version (105)";
+				case vr::VRInitError_Init_NotInitialized: return "The null runtime has not been initialized (109)";
+				default: return "Unknown error";
+				}
+			}
+
+			const char *GetIDForVRInitError( vr::EVRInitError eError ) override {
+				switch (eError) {
+				case vr::VRInitError_None: return "VRInitError_None";
+				case vr::VRInitError_Init_InterfaceNotFound: return "VRInitError_Init_InterfaceNotFound";
+				case vr::VRInitError_Init_NotInitialized: return "VRInitError_Init_NotInitialized";
+				default: return "VRInitError_Unknown";
+				}
+			}
+
+			NullCompositor & Compositor() { return compositor; }
+
+		private:
+			std::mutex mutex;
+			int initCount = 0;
+			Settings settings;
+			VsyncClock clock;
+			NullSystem system;
+			NullCompositor compositor;
+
+			// only the interface versions of the bundled openvr.h are provided, as the classes
+			// implement exactly those vtables
+			void * FindInterface(const char *version) {
+				if (version == nullptr) {
+					return nullptr;
+				}
+				if (std::strcmp(version, vr::IVRSystem_Version) == 0) {
+					return static_cast<vr::IVRSystem*>(&system);
+				}
+				if (std::strcmp(version, vr::IVRCompositor_Version) == 0) {
+					return static_cast<vr::IVRCompositor*>(&compositor);
+				}
+				return nullptr;
+			}
+		};
+
+		NullClientCore clientCore;
+	}
+}
+
+NULLVR_EXPORT void *VRClientCoreFactory( const char *pInterfaceName, int *pReturnCode ) {
+	if (pInterfaceName != nullptr && std::strcmp(pInterfaceName, vr::IVRClientCore_Version) == 0) {
+		if (pReturnCode) *pReturnCode = vr::VRInitError_None;
+		return static_cast<vr::IVRClientCore*>(&nullvr::clientCore);
+	}
+	if (pReturnCode) *pReturnCode = vr::VRInitError_Init_InterfaceNotFound;
+	return nullptr;
+}
+
+NULLVR_EXPORT void NullRuntime_GetSubmitStats( nullvr::SubmitStats *stats ) {
+	if (stats != nullptr) {
+		nullvr::clientCore.Compositor().GetSubmitStats(*stats);
+	}
+}
+
+NULLVR_EXPORT void NullRuntime_ResetSubmitStats() {
+	nullvr::clientCore.Compositor().ResetSubmitStats();
+}
+
+NULLVR_EXPORT void NullRuntime_SetSubmitCallback( nullvr::SubmitCallback callback, void *userData ) {
+	nullvr::clientCore.Compositor().SetSubmitCallback(callback, userData);
+}
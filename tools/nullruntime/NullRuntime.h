@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+
+#include <openvr.h>
+
+// Exports of the null runtime (vrclient built from tools/nullruntime) that let a benchmark inspect
+// what reached the compositor. The null runtime stands in for SteamVR when VR_OVERRIDE points at its
+// directory, so VR_Init, the mod's hooks and the post processor run as they would in a game, but
+// without a headset or a running compositor. Look the functions up with SharedLib_GetFunction /
+// GetProcAddress on the already loaded vrclient module.
+//
+// The headset is configured through environment variables read during IVRClientCore::Init:
+//   NULLVR_RENDER_SIZE    recommended render target size per eye, "<width>x<height>" (default 2016x2240)
+//   NULLVR_PROJECTION     raw projection of the left eye, "<left>,<right>,<top>,<bottom>" as tangents of
+//                         the half angles; the right eye is mirrored (default -1.39,1.24,-1.47,1.46)
+//   NULLVR_IPD            distance between the eyes in metres (default 0.063)
+//   NULLVR_CANT           outward rotation of each eye's display in degrees (default 0)
+//   NULLVR_HIDDEN_AREA    radius of the visible ellipse relative to the half extents of each eye's
+//                         image; 0 disables the hidden area mesh (default 1.1)
+//   NULLVR_REFRESH_RATE   display refresh rate in Hz (default 90)
+//   NULLVR_VSYNC          if 1, WaitGetPoses blocks until the next simulated vsync (default 0)
+namespace nullvr {
+	// one call to IVRCompositor::Submit as the runtime received it, i.e. after the mod's hook
+	struct SubmitRecord {
+		uint64_t frameIndex;
+		vr::EVREye eye;
+		vr::ETextureType textureType;
+		vr::EColorSpace colorSpace;
+		void *handle;
+		vr::VRTextureBounds_t bounds;
+		bool hasBounds;
+		vr::EVRSubmitFlags flags;
+	};
+
+	struct SubmitStats {
+		uint64_t frames;			// calls to WaitGetPoses
+		uint64_t submits[2];		// successful submits per eye
+		uint64_t rejectedSubmits;	// submits with an invalid eye or texture
+		SubmitRecord last[2];		// most recent successful submit per eye
+	};
+
+	// called from within Submit; keep it cheap, it is timed along with everything else
+	typedef void (*SubmitCallback)(const SubmitRecord &record, void *userData);
+}
+
+typedef void (*NullRuntime_GetSubmitStatsFn)(nullvr::SubmitStats *stats);
+typedef void (*NullRuntime_ResetSubmitStatsFn)();
+typedef void (*NullRuntime_SetSubmitCallbackFn)(nullvr::SubmitCallback callback, void *userData);
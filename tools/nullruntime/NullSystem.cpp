@@ -0,0 +1,436 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "NullInterfaces.h"
+
+namespace nullvr {
+	namespace {
+		const float HMD_STANDING_HEIGHT = 1.7f;
+		const uint32_t HIDDEN_AREA_SEGMENTS = 64;
+		const float PI = 3.14159265358979f;
+
+		vr::HmdMatrix34_t Translation(float x, float y, float z) {
+			vr::HmdMatrix34_t m = {{
+				{ 1, 0, 0, x },
+				{ 0, 1, 0, y },
+				{ 0, 0, 1, z },
+			}};
+			return m;
+		}
+
+		vr::HmdMatrix34_t Multiply(const vr::HmdMatrix34_t &a, const vr::HmdMatrix34_t &b) {
+			vr::HmdMatrix34_t result;
+			for (int row = 0; row < 3; ++row) {
+				for (int col = 0; col < 4; ++col) {
+					result.m[row][col] = a.m[row][0] * b.m[0][col] + a.m[row][1] * b.m[1][col] + a.m[row][2] * b.m[2][col];
+				}
+				result.m[row][3] += a.m[row][3];
+			}
+			return result;
+		}
+
+		vr::HmdVector3_t Rotate(const vr::HmdMatrix34_t &m, const vr::HmdVector3_t &v) {
+			vr::HmdVector3_t result;
+			for (int row = 0; row < 3; ++row) {
+				result.v[row] = m.m[row][0] * v.v[0] + m.m[row][1] * v.v[1] + m.m[row][2] * v.v[2];
+			}
+			return result;
+		}
+
+		uint32_t CopyString(const char *value, char *buffer, uint32_t bufferSize, vr::ETrackedPropertyError *pError) {
+			uint32_t required = (uint32_t)std::strlen(value) + 1;
+			if (buffer == nullptr || bufferSize < required) {
+				if (pError) *pError = vr::TrackedProp_BufferTooSmall;
+			} else {
+				std::memcpy(buffer, value, required);
+				if (pError) *pError = vr::TrackedProp_Success;
+			}
+			return required;
+		}
+	}
+
+	void NullSystem::Init(const Settings &settings, const VsyncClock *clock) {
+		this->settings = settings;
+		this->clock = clock;
+		CreateHiddenAreaMeshes(vr::Eye_Left);
+		CreateHiddenAreaMeshes(vr::Eye_Right);
+	}
+
+	void NullSystem::GetHmdPose(vr::TrackedDevicePose_t &pose) const {
+		std::memset(&pose, 0, sizeof(pose));
+		pose.mDeviceToAbsoluteTracking = Translation(0, HMD_STANDING_HEIGHT, 0);
+		pose.eTrackingResult = vr::TrackingResult_Running_OK;
+		pose.bPoseIsValid = true;
+		pose.bDeviceIsConnected = true;
+	}
+
+	// the headset never moves; only the HMD slot of the pose array is connected
+	void NullSystem::GetPoses(vr::ETrackingUniverseOrigin origin, vr::TrackedDevicePose_t *poses, uint32_t count) const {
+		if (poses == nullptr) {
+			return;
+		}
+		std::memset(poses, 0, sizeof(vr::TrackedDevicePose_t) * count);
+		if (count > 0) {
+			GetHmdPose(poses[0]);
+			if (origin == vr::TrackingUniverseSeated) {
+				poses[0].mDeviceToAbsoluteTracking = Translation(0, 0, 0);
+			}
+		}
+	}
+
+	// The hidden area is everything outside an ellipse around the eye's projection centre. Its outline is
+	// sampled at regular angles plus the angles of the image corners, so that between two neighbouring
+	// samples the image border is a straight line and the quads between outline and border cover the
+	// hidden area exactly.
+	void NullSystem::CreateHiddenAreaMeshes(vr::EVREye eye) {
+		for (auto &mesh : hiddenArea[eye]) {
+			mesh.clear();
+		}
+		if (settings.hiddenAreaRadius <= 0) {
+			return;
+		}
+
+		float left, right, top, bottom;
+		GetProjectionRaw(eye, &left, &right, &top, &bottom);
+		float cu = (std::min)((std::max)(-left / (right - left), 0.01f), 0.99f);
+		float cv = (std::min)((std::max)(-top / (bottom - top), 0.01f), 0.99f);
+		float semiAxis = .5f * settings.hiddenAreaRadius;
+
+		std::vector<float> angles;
+		for (uint32_t i = 0; i < HIDDEN_AREA_SEGMENTS; ++i) {
+			angles.push_back(-PI + 2 * PI * i / HIDDEN_AREA_SEGMENTS);
+		}
+		angles.push_back(std::atan2(0 - cv, 0 - cu));
+		angles.push_back(std::atan2(0 - cv, 1 - cu));
+		angles.push_back(std::atan2(1 - cv, 0 - cu));
+		angles.push_back(std::atan2(1 - cv, 1 - cu));
+		std::sort(angles.begin(), angles.end());
+
+		std::vector<vr::HmdVector2_t> inner, outer;
+		bool anyHidden = false;
+		for (float angle : angles) {
+			float dx = std::cos(angle), dy = std::sin(angle);
+			float border = 1e9f;
+			if (dx > 1e-6f) border = (std::min)(border, (1 - cu) / dx);
+			if (dx < -1e-6f) border = (std::min)(border, -cu / dx);
+			if (dy > 1e-6f) border = (std::min)(border, (1 - cv) / dy);
+			if (dy < -1e-6f) border = (std::min)(border, -cv / dy);
+			float ellipse = semiAxis / std::sqrt(dx * dx + dy * dy);
+			float visible = (std::min)(ellipse, border);
+			anyHidden = anyHidden || visible < border;
+
+			vr::HmdVector2_t in = {{ cu + dx * visible, cv + dy * visible }};
+			vr::HmdVector2_t out = {{ cu + dx * border, cv + dy * border }};
+			inner.push_back(in);
+			outer.push_back(out);
+		}
+		if (!anyHidden) {
+			// the ellipse covers the whole image, so there is nothing to hide
+			return;
+		}
+
+		vr::HmdVector2_t centre = {{ cu, cv }};
+		auto &standard = hiddenArea[eye][vr::k_eHiddenAreaMesh_Standard];
+		auto &inverse = hiddenArea[eye][vr::k_eHiddenAreaMesh_Inverse];
+		auto &lineLoop = hiddenArea[eye][vr::k_eHiddenAreaMesh_LineLoop];
+		for (size_t i = 0; i < inner.size(); ++i) {
+			size_t next = (i + 1) % inner.size();
+			bool hidden = inner[i].v[0] != outer[i].v[0] || inner[i].v[1] != outer[i].v[1]
+				|| inner[next].v[0] != outer[next].v[0] || inner[next].v[1] != outer[next].v[1];
+			if (hidden) {
+				standard.insert(standard.end(), { inner[i], outer[i], outer[next] });
+				standard.insert(standard.end(), { inner[i], outer[next], inner[next] });
+			}
+			inverse.insert(inverse.end(), { centre, inner[i], inner[next] });
+			lineLoop.push_back(inner[i]);
+		}
+	}
+
+	void NullSystem::GetRecommendedRenderTargetSize( uint32_t *pnWidth, uint32_t *pnHeight ) {
+		if (pnWidth) *pnWidth = settings.renderWidth;
+		if (pnHeight) *pnHeight = settings.renderHeight;
+	}
+
+	vr::HmdMatrix44_t NullSystem::GetProjectionMatrix( vr::EVREye eEye, float fNearZ, float fFarZ ) {
+		float left, right, top, bottom;
+		GetProjectionRaw(eEye, &left, &right, &top, &bottom);
+		float idx = 1.f / (right - left);
+		float idy = 1.f / (bottom - top);
+		float idz = 1.f / (fFarZ - fNearZ);
+		float sx = right + left;
+		float sy = bottom + top;
+
+		vr::HmdMatrix44_t m = {{
+			{ 2 * idx, 0, sx * idx, 0 },
+			{ 0, 2 * idy, sy * idy, 0 },
+			{ 0, 0, -fFarZ * idz, -fFarZ * fNearZ * idz },
+			{ 0, 0, -1, 0 },
+		}};
+		return m;
+	}
+
+	void NullSystem::GetProjectionRaw( vr::EVREye eEye, float *pfLeft, float *pfRight, float *pfTop, float *pfBottom ) {
+		// the right eye mirrors the left one horizontally
+		float left = eEye == vr::Eye_Left ? settings.projection[0] : -settings.projection[1];
+		float right = eEye == vr::Eye_Left ? settings.projection[1] : -settings.projection[0];
+		if (pfLeft) *pfLeft = left;
+		if (pfRight) *pfRight = right;
+		if (pfTop) *pfTop = settings.projection[2];
+		if (pfBottom) *pfBottom = settings.projection[3];
+	}
+
+	bool NullSystem::ComputeDistortion( vr::EVREye eEye, float fU, float fV, vr::DistortionCoordinates_t *pDistortionCoordinates ) {
+		if (pDistortionCoordinates == nullptr) {
+			return false;
+		}
+		// no lens, no distortion
+		for (int i = 0; i < 2; ++i) {
+			pDistortionCoordinates->rfRed[i] = i == 0 ? fU : fV;
+			pDistortionCoordinates->rfGreen[i] = i == 0 ? fU : fV;
+			pDistortionCoordinates->rfBlue[i] = i == 0 ? fU : fV;
+		}
+		return true;
+	}
+
+	vr::HmdMatrix34_t NullSystem::GetEyeToHeadTransform( vr::EVREye eEye ) {
+		float sign = eEye == vr::Eye_Left ? 1.f : -1.f;
+		// cant rotates each display outwards around the vertical axis
+		float cant = sign * settings.cantDegrees * PI / 180;
+		vr::HmdMatrix34_t m = {{
+			{ std::cos(cant), 0, std::sin(cant), -sign * .5f * settings.ipd },
+			{ 0, 1, 0, 0 },
+			{ -std::sin(cant), 0, std::cos(cant), 0 },
+		}};
+		return m;
+	}
+
+	bool NullSystem::GetTimeSinceLastVsync( float *pfSecondsSinceLastVsync, uint64_t *pulFrameCounter ) {
+		if (pfSecondsSinceLastVsync) *pfSecondsSinceLastVsync = (float)clock->SecondsSinceLastVsync();
+		if (pulFrameCounter) *pulFrameCounter = clock->VsyncCount();
+		return true;
+	}
+
+	int32_t NullSystem::GetD3D9AdapterIndex() {
+		return 0;
+	}
+
+	void NullSystem::GetDXGIOutputInfo( int32_t *pnAdapterIndex ) {
+		if (pnAdapterIndex) *pnAdapterIndex = 0;
+	}
+
+	void NullSystem::GetOutputDevice( uint64_t *pnDevice, vr::ETextureType textureType, VkInstance_T *pInstance ) {
+		if (pnDevice) *pnDevice = 0;
+	}
+
+	bool NullSystem::IsDisplayOnDesktop() {
+		return false;
+	}
+
+	bool NullSystem::SetDisplayVisibility( bool bIsVisibleOnDesktop ) {
+		return false;
+	}
+
+	void NullSystem::GetDeviceToAbsoluteTrackingPose( vr::ETrackingUniverseOrigin eOrigin, float fPredictedSecondsToPhotonsFromNow, vr::TrackedDevicePose_t *pTrackedDevicePoseArray, uint32_t unTrackedDevicePoseArrayCount ) {
+		GetPoses(eOrigin, pTrackedDevicePoseArray, unTrackedDevicePoseArrayCount);
+	}
+
+	vr::HmdMatrix34_t NullSystem::GetSeatedZeroPoseToStandingAbsoluteTrackingPose() {
+		return Translation(0, HMD_STANDING_HEIGHT, 0);
+	}
+
+	vr::HmdMatrix34_t NullSystem::GetRawZeroPoseToStandingAbsoluteTrackingPose() {
+		return Translation(0, 0, 0);
+	}
+
+	uint32_t NullSystem::GetSortedTrackedDeviceIndicesOfClass( vr::ETrackedDeviceClass eTrackedDeviceClass, vr::TrackedDeviceIndex_t *punTrackedDeviceIndexArray, uint32_t unTrackedDeviceIndexArrayCount, vr::TrackedDeviceIndex_t unRelativeToTrackedDeviceIndex ) {
+		if (eTrackedDeviceClass != vr::TrackedDeviceClass_HMD) {
+			return 0;
+		}
+		if (punTrackedDeviceIndexArray != nullptr && unTrackedDeviceIndexArrayCount > 0) {
+			punTrackedDeviceIndexArray[0] = vr::k_unTrackedDeviceIndex_Hmd;
+		}
+		return 1;
+	}
+
+	vr::EDeviceActivityLevel NullSystem::GetTrackedDeviceActivityLevel( vr::TrackedDeviceIndex_t unDeviceId ) {
+		return unDeviceId == vr::k_unTrackedDeviceIndex_Hmd ? vr::k_EDeviceActivityLevel_UserInteraction : vr::k_EDeviceActivityLevel_Unknown;
+	}
+
+	void NullSystem::ApplyTransform( vr::TrackedDevicePose_t *pOutputPose, const vr::TrackedDevicePose_t *pTrackedDevicePose, const vr::HmdMatrix34_t *pTransform ) {
+		if (pOutputPose == nullptr || pTrackedDevicePose == nullptr || pTransform == nullptr) {
+			return;
+		}
+		vr::TrackedDevicePose_t pose = *pTrackedDevicePose;
+		pose.mDeviceToAbsoluteTracking = Multiply(*pTransform, pTrackedDevicePose->mDeviceToAbsoluteTracking);
+		pose.vVelocity = Rotate(*pTransform, pTrackedDevicePose->vVelocity);
+		pose.vAngularVelocity = Rotate(*pTransform, pTrackedDevicePose->vAngularVelocity);
+		*pOutputPose = pose;
+	}
+
+	vr::TrackedDeviceIndex_t NullSystem::GetTrackedDeviceIndexForControllerRole( vr::ETrackedControllerRole unDeviceType ) {
+		return vr::k_unTrackedDeviceIndexInvalid;
+	}
+
+	vr::ETrackedControllerRole NullSystem::GetControllerRoleForTrackedDeviceIndex( vr::TrackedDeviceIndex_t unDeviceIndex ) {
+		return vr::TrackedControllerRole_Invalid;
+	}
+
+	vr::ETrackedDeviceClass NullSystem::GetTrackedDeviceClass( vr::TrackedDeviceIndex_t unDeviceIndex ) {
+		return unDeviceIndex == vr::k_unTrackedDeviceIndex_Hmd ? vr::TrackedDeviceClass_HMD : vr::TrackedDeviceClass_Invalid;
+	}
+
+	bool NullSystem::IsTrackedDeviceConnected( vr::TrackedDeviceIndex_t unDeviceIndex ) {
+		return unDeviceIndex == vr::k_unTrackedDeviceIndex_Hmd;
+	}
+
+	bool NullSystem::GetBoolTrackedDeviceProperty( vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError *pError ) {
+		if (pError) *pError = unDeviceIndex == vr::k_unTrackedDeviceIndex_Hmd ? vr::TrackedProp_UnknownProperty : vr::TrackedProp_InvalidDevice;
+		return false;
+	}
+
+	float NullSystem::GetFloatTrackedDeviceProperty( vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError *pError ) {
+		if (unDeviceIndex != vr::k_unTrackedDeviceIndex_Hmd) {
+			if (pError) *pError = vr::TrackedProp_InvalidDevice;
+			return 0;
+		}
+		if (pError) *pError = vr::TrackedProp_Success;
+		switch (prop) {
+		case vr::Prop_DisplayFrequency_Float: return settings.refreshRate;
+		case vr::Prop_UserIpdMeters_Float: return settings.ipd;
+		case vr::Prop_SecondsFromVsyncToPhotons_Float: return (float)clock->FrameDuration();
+		default:
+			if (pError) *pError = vr::TrackedProp_UnknownProperty;
+			return 0;
+		}
+	}
+
+	int32_t NullSystem::GetInt32TrackedDeviceProperty( vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError *pError ) {
+		if (unDeviceIndex != vr::k_unTrackedDeviceIndex_Hmd) {
+			if (pError) *pError = vr::TrackedProp_InvalidDevice;
+			return 0;
+		}
+		if (prop == vr::Prop_DeviceClass_Int32) {
+			if (pError) *pError = vr::TrackedProp_Success;
+			return vr::TrackedDeviceClass_HMD;
+		}
+		if (pError) *pError = vr::TrackedProp_UnknownProperty;
+		return 0;
+	}
+
+	uint64_t NullSystem::GetUint64TrackedDeviceProperty( vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError *pError ) {
+		if (pError) *pError = unDeviceIndex == vr::k_unTrackedDeviceIndex_Hmd ? vr::TrackedProp_UnknownProperty : vr::TrackedProp_InvalidDevice;
+		return 0;
+	}
+
+	vr::HmdMatrix34_t NullSystem::GetMatrix34TrackedDeviceProperty( vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError *pError ) {
+		if (pError) *pError = unDeviceIndex == vr::k_unTrackedDeviceIndex_Hmd ? vr::TrackedProp_UnknownProperty : vr::TrackedProp_InvalidDevice;
+		return Translation(0, 0, 0);
+	}
+
+	uint32_t NullSystem::GetArrayTrackedDeviceProperty( vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::PropertyTypeTag_t propType, void *pBuffer, uint32_t unBufferSize, vr::ETrackedPropertyError *pError ) {
+		if (pError) *pError = unDeviceIndex == vr::k_unTrackedDeviceIndex_Hmd ? vr::TrackedProp_UnknownProperty : vr::TrackedProp_InvalidDevice;
+		return 0;
+	}
+
+	uint32_t NullSystem::GetStringTrackedDeviceProperty( vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, char *pchValue, uint32_t unBufferSize, vr::ETrackedPropertyError *pError ) {
+		if (unDeviceIndex != vr::k_unTrackedDeviceIndex_Hmd) {
+			if (pError) *pError = vr::TrackedProp_InvalidDevice;
+			return 0;
+		}
+		switch (prop) {
+		case vr::Prop_TrackingSystemName_String: return CopyString("null", pchValue, unBufferSize, pError);
+		case vr::Prop_ModelNumber_String: return CopyString("Null HMD", pchValue, unBufferSize, pError);
+		case vr::Prop_SerialNumber_String: return CopyString("NULL-0000", pchValue, unBufferSize, pError);
+		case vr::Prop_ManufacturerName_String: return CopyString("openvr_fsr", pchValue, unBufferSize, pError);
+		default:
+			if (pError) *pError = vr::TrackedProp_UnknownProperty;
+			return 0;
+		}
+	}
+
+	const char *NullSystem::GetPropErrorNameFromEnum( vr::ETrackedPropertyError error ) {
+		switch (error) {
+		case vr::TrackedProp_Success: return "TrackedProp_Success";
+		case vr::TrackedProp_BufferTooSmall: return "TrackedProp_BufferTooSmall";
+		case vr::TrackedProp_UnknownProperty: return "TrackedProp_UnknownProperty";
+		case vr::TrackedProp_InvalidDevice: return "TrackedProp_InvalidDevice";
+		default: return "TrackedProp_Unknown";
+		}
+	}
+
+	bool NullSystem::PollNextEvent( vr::VREvent_t *pEvent, uint32_t uncbVREvent ) {
+		return false;
+	}
+
+	bool NullSystem::PollNextEventWithPose( vr::ETrackingUniverseOrigin eOrigin, vr::VREvent_t *pEvent, uint32_t uncbVREvent, vr::TrackedDevicePose_t *pTrackedDevicePose ) {
+		return false;
+	}
+
+	const char *NullSystem::GetEventTypeNameFromEnum( vr::EVREventType eType ) {
+		return "VREvent_Unknown";
+	}
+
+	vr::HiddenAreaMesh_t NullSystem::GetHiddenAreaMesh( vr::EVREye eEye, vr::EHiddenAreaMeshType type ) {
+		vr::HiddenAreaMesh_t mesh = { nullptr, 0 };
+		if ((eEye != vr::Eye_Left && eEye != vr::Eye_Right) || type < 0 || type >= vr::k_eHiddenAreaMesh_Max) {
+			return mesh;
+		}
+		const auto &vertices = hiddenArea[eEye][type];
+		if (!vertices.empty()) {
+			mesh.pVertexData = vertices.data();
+			mesh.unTriangleCount = (uint32_t)(type == vr::k_eHiddenAreaMesh_LineLoop ? vertices.size() : vertices.size() / 3);
+		}
+		return mesh;
+	}
+
+	bool NullSystem::GetControllerState( vr::TrackedDeviceIndex_t unControllerDeviceIndex, vr::VRControllerState_t *pControllerState, uint32_t unControllerStateSize ) {
+		return false;
+	}
+
+	bool NullSystem::GetControllerStateWithPose( vr::ETrackingUniverseOrigin eOrigin, vr::TrackedDeviceIndex_t unControllerDeviceIndex, vr::VRControllerState_t *pControllerState, uint32_t unControllerStateSize, vr::TrackedDevicePose_t *pTrackedDevicePose ) {
+		return false;
+	}
+
+	void NullSystem::TriggerHapticPulse( vr::TrackedDeviceIndex_t unControllerDeviceIndex, uint32_t unAxisId, unsigned short usDurationMicroSec ) {
+	}
+
+	const char *NullSystem::GetButtonIdNameFromEnum( vr::EVRButtonId eButtonId ) {
+		return "k_EButton_Unknown";
+	}
+
+	const char *NullSystem::GetControllerAxisTypeNameFromEnum( vr::EVRControllerAxisType eAxisType ) {
+		return "k_eControllerAxis_None";
+	}
+
+	bool NullSystem::IsInputAvailable() {
+		return true;
+	}
+
+	bool NullSystem::IsSteamVRDrawingControllers() {
+		return false;
+	}
+
+	bool NullSystem::ShouldApplicationPause() {
+		return false;
+	}
+
+	bool NullSystem::ShouldApplicationReduceRenderingWork() {
+		return false;
+	}
+
+	vr::EVRFirmwareError NullSystem::PerformFirmwareUpdate( vr::TrackedDeviceIndex_t unDeviceIndex ) {
+		return vr::VRFirmwareError_None;
+	}
+
+	void NullSystem::AcknowledgeQuit_Exiting() {
+	}
+
+	uint32_t NullSystem::GetAppContainerFilePaths( char *pchBuffer, uint32_t unBufferSize ) {
+		return CopyString("", pchBuffer, unBufferSize, nullptr);
+	}
+
+	const char *NullSystem::GetRuntimeVersion() {
+		return "null";
+	}
+}
@@ -0,0 +1,536 @@
+// Runs the mod's post-processing pipeline (src/postprocess/PostProcessPipeline.h) on the CPU backend,
+// so the planning, resource and stage logic that every Submit goes through can be benchmarked on
+// machines without a GPU or headset, such as CI runners. Frames come either from a frame dump, with
+// the recorded settings, or are generated from a fixed seed, so runs are reproducible. After timing,
+// a checksum of the last output is printed; identical settings must always give the same checksum.
+//
+// usage: pipeline_bench [options]
+//   --dump <file>          submit the eye images of a frame dump instead of generated frames
+//   --size <WxH>           size of a generated eye texture (default 1440x1600)
+//   --layout <l>           separate: one texture per eye, shared: both eyes side by side in one
+//                          texture with bounds (default separate)
+//   --format <f>           generated texture format: srgb, unorm or rgb10a2 (default srgb)
+//   --render-scale <s>     renderScale (default 0.77, or the recorded value)
+//   --sharpness <s>        sharpness (default 0.75, or the recorded value)
+//   --radius <r>           radius (default 0.5, or the recorded value)
+//   --chain <stages>       comma separated stages as in the config's chain, e.g. upscale,sharpen,grain
+//                          (default: the upscaler's own stages)
+//   --grain <a>            grainAmount (default 0.3)
+//   --intermediate-format <f>  intermediateFormat: output, rgba8, rgb10a2, r11g11b10 or rgb565
+//                          (default output)
+//   --dither               dither the output of every stage, as the dither setting
+//   --supersample          with a render scale above 1, filter back down to the input size, as the
+//                          supersample setting
+//   --lens-distortion      upscale to the lens distorted image with a radial model of the lenses, and
+//                          check the fused upscaling against distorting the upscaled image afterwards
+//   --flat-tiles <t>       classify tiles first and skip FSR on those with a luma range below t, as
+//                          the tileClassification setting
+//   --luma-upscale         run EASU on the luma only, as the lumaUpscale setting
+//   --frames <n>           measured frames (default 100)
+//   --warmup <n>           frames submitted before measuring (default 5)
+//   --threads <n>          worker threads for the stages (default all cores)
+//   --csv <file>           write the time of every measured frame to a CSV file
+//   --trace <file>         record trace events of all frames and write them as a Chrome trace JSON file
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CpuBackend.h"
+#include "FrameDump.h"
+#include "Logging.h"
+#include "PostProcessPipeline.h"
+#include "Tracing.h"
+
+using namespace vr;
+
+namespace {
+	struct Options {
+		std::string dumpPath;
+		uint32_t width = 1440;
+		uint32_t height = 1600;
+		bool sharedTexture = false;
+		uint32_t format = framedump::FORMAT_R8G8B8A8_UNORM_SRGB;
+		float renderScale = -1;
+		float sharpness = -1;
+		float radius = -1;
+		std::vector<PipelineStage> chain;
+		float grainAmount = -1;
+		uint32_t intermediateFormat = 0;
+		bool dither = false;
+		bool supersample = false;
+		bool lensDistortion = false;
+		bool lumaUpscale = false;
+		float flatTileThreshold = -1;
+		int frames = 100;
+		int warmup = 5;
+		int threads = 0;
+		std::string csvPath;
+		std::string tracePath;
+	};
+
+	// one Submit call: the texture and bounds the game hands to the compositor for an eye
+	struct Submit {
+		EVREye eye;
+		size_t texture;
+		VRTextureBounds_t bounds;
+	};
+
+	float projectionCentres[2][2] = { { .5f, .5f }, { .5f, .5f } };
+
+	void GetProjectionCentre(EVREye eye, float &x, float &y) {
+		x = projectionCentres[eye][0];
+		y = projectionCentres[eye][1];
+	}
+
+	// xorshift, so generated frames are identical on every platform
+	uint32_t NextRandom(uint32_t &state) {
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+
+	// a test pattern with smooth gradients, hard edges, thin lines and noise, shifted per frame
+	void GenerateFrame(std::vector<uint8_t> &pixels, uint32_t width, uint32_t height, uint32_t format, uint32_t seed) {
+		pixels.resize((size_t)width * height * 4);
+		uint32_t random = 0x9e3779b9u ^ seed;
+		for (uint32_t y = 0; y < height; ++y) {
+			for (uint32_t x = 0; x < width; ++x) {
+				uint32_t px = x + seed * 3;
+				float value[3];
+				value[0] = float(px % 256) / 255.f;
+				value[1] = float(y) / height;
+				value[2] = ((px / 64 + y / 64) % 2) ? .85f : .15f;
+				if (px % 37 == 0 || (y + seed) % 41 == 0) {
+					value[0] = value[1] = value[2] = 1.f;
+				}
+				float noise = float(NextRandom(random) & 0xff) / 255.f * .08f - .04f;
+				uint8_t *out = &pixels[((size_t)y * width + x) * 4];
+				if (format == framedump::FORMAT_R10G10B10A2_UNORM) {
+					uint32_t v = 3u << 30;
+					for (int ch = 0; ch < 3; ++ch) {
+						float c = (std::min)((std::max)(value[ch] + noise, 0.f), 1.f);
+						v |= uint32_t(c * 1023.f + .5f) << (10 * ch);
+					}
+					memcpy(out, &v, 4);
+				} else {
+					for (int ch = 0; ch < 3; ++ch) {
+						float c = (std::min)((std::max)(value[ch] + noise, 0.f), 1.f);
+						out[ch] = uint8_t(c * 255.f + .5f);
+					}
+					out[3] = 255;
+				}
+			}
+		}
+	}
+
+	// FNV-1a over the output values
+	uint64_t Checksum(const cpu::HostTexture &texture) {
+		uint64_t hash = 14695981039346656037ull;
+		for (uint32_t y = 0; y < texture.height; ++y) {
+			const uint8_t *row = (const uint8_t*)texture.pixels + y * texture.rowPitch;
+			size_t rowSize = (size_t)texture.width * framedump::BytesPerPixel(texture.format);
+			for (size_t i = 0; i < rowSize; ++i) {
+				hash = (hash ^ row[i]) * 1099511628211ull;
+			}
+		}
+		return hash;
+	}
+
+	double Percentile(std::vector<double> sorted, double p) {
+		if (sorted.empty()) {
+			return 0;
+		}
+		std::sort(sorted.begin(), sorted.end());
+		size_t index = (size_t)std::ceil(p / 100 * sorted.size());
+		return sorted[index > 0 ? index - 1 : 0];
+	}
+
+	void PrintUsage() {
+		fprintf(stderr, "usage: pipeline_bench [--dump file] [--size WxH] [--layout separate|shared] [--format srgb|unorm|rgb10a2]\n"
+			"                      [--render-scale s] [--sharpness s] [--radius r] [--chain stages] [--grain a]\n"
+			"                      [--intermediate-format f] [--dither] [--supersample] [--lens-distortion]\n"
+			"                      [--flat-tiles t] [--luma-upscale] [--frames n] [--warmup n] [--threads n] [--csv file] [--trace file]\n");
+	}
+
+	bool ParseOptions(int argc, char **argv, Options &options) {
+		for (int i = 1; i < argc; ++i) {
+			std::string arg = argv[i];
+			bool hasValue = i + 1 < argc;
+			if (arg == "--dump" && hasValue) {
+				options.dumpPath = argv[++i];
+			} else if (arg == "--size" && hasValue) {
+				if (sscanf(argv[++i], "%ux%u", &options.width, &options.height) != 2 || options.width == 0 || options.height == 0) {
+					return false;
+				}
+			} else if (arg == "--layout" && hasValue) {
+				std::string layout = argv[++i];
+				if (layout != "separate" && layout != "shared") {
+					return false;
+				}
+				options.sharedTexture = layout == "shared";
+			} else if (arg == "--format" && hasValue) {
+				std::string format = argv[++i];
+				if (format == "srgb") {
+					options.format = framedump::FORMAT_R8G8B8A8_UNORM_SRGB;
+				} else if (format == "unorm") {
+					options.format = framedump::FORMAT_R8G8B8A8_UNORM;
+				} else if (format == "rgb10a2") {
+					options.format = framedump::FORMAT_R10G10B10A2_UNORM;
+				} else {
+					return false;
+				}
+			} else if (arg == "--render-scale" && hasValue) {
+				options.renderScale = (float)atof(argv[++i]);
+			} else if (arg == "--sharpness" && hasValue) {
+				options.sharpness = (float)atof(argv[++i]);
+			} else if (arg == "--radius" && hasValue) {
+				options.radius = (float)atof(argv[++i]);
+			} else if (arg == "--chain" && hasValue) {
+				std::string chain = argv[++i];
+				size_t begin = 0;
+				while (begin <= chain.size()) {
+					size_t end = (std::min)(chain.find(',', begin), chain.size());
+					PipelineStage stage;
+					if (!ParsePipelineStage(chain.substr(begin, end - begin), stage)) {
+						return false;
+					}
+					options.chain.push_back(stage);
+					begin = end + 1;
+				}
+			} else if (arg == "--grain" && hasValue) {
+				options.grainAmount = (float)atof(argv[++i]);
+			} else if (arg == "--intermediate-format" && hasValue) {
+				if (!ParseIntermediateFormat(argv[++i], options.intermediateFormat)) {
+					return false;
+				}
+			} else if (arg == "--dither") {
+				options.dither = true;
+			} else if (arg == "--supersample") {
+				options.supersample = true;
+			} else if (arg == "--lens-distortion") {
+				options.lensDistortion = true;
+			} else if (arg == "--luma-upscale") {
+				options.lumaUpscale = true;
+			} else if (arg == "--flat-tiles" && hasValue) {
+				options.flatTileThreshold = (std::max)(0.f, (float)atof(argv[++i]));
+			} else if (arg == "--frames" && hasValue) {
+				options.frames = (std::max)(1, atoi(argv[++i]));
+			} else if (arg == "--warmup" && hasValue) {
+				options.warmup = (std::max)(0, atoi(argv[++i]));
+			} else if (arg == "--threads" && hasValue) {
+				options.threads = (std::max)(1, atoi(argv[++i]));
+			} else if (arg == "--csv" && hasValue) {
+				options.csvPath = argv[++i];
+			} else if (arg == "--trace" && hasValue) {
+				options.tracePath = argv[++i];
+			} else {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// PSNR of two images over all channels, or of their averages over blocks of the given size
+	double Psnr(const cpu::Image &a, const cpu::Image &b, uint32_t blockSize) {
+		double squaredError = 0;
+		size_t count = 0;
+		for (uint32_t y = 0; y + blockSize <= a.height; y += blockSize) {
+			for (uint32_t x = 0; x + blockSize <= a.width; x += blockSize) {
+				for (int ch = 0; ch < 3; ++ch) {
+					double difference = 0;
+					for (uint32_t by = y; by < y + blockSize; ++by) {
+						for (uint32_t bx = x; bx < x + blockSize; ++bx) {
+							difference += a.Pixel(bx, by)[ch] - b.Pixel(bx, by)[ch];
+						}
+					}
+					difference /= blockSize * blockSize;
+					squaredError += difference * difference;
+					++count;
+				}
+			}
+		}
+		return squaredError > 0 ? 10 * std::log10(count / squaredError) : INFINITY;
+	}
+
+	struct LensDistortionCheck {
+		double psnr = INFINITY;
+		double blockPsnr = INFINITY;
+		double fusedMs = 0;
+		double separateMs = 0;
+	};
+
+	// Upscales the given eye texture with the lens distortion fused into EASU, as the pipeline does,
+	// and compares that to what the compositor would show from the plain upscaled image, i.e.
+	// distort(upscale(x)). Both resample each channel at the same positions, so they only differ in
+	// the fine detail the second resampling loses, which averaging over 4x4 blocks mostly removes;
+	// positions that are off by half a pixel or more show up there. Returns false if the texture
+	// can't be decoded.
+	bool CheckLensDistortion(const PipelinePlan &plan, const cpu::HostTexture &texture, EVREye eye, LensDistortionCheck &check) {
+		cpu::Image input;
+		if (!cpu::DecodeImage(texture.pixels, texture.width, texture.height, texture.rowPitch, texture.format, input)) {
+			fprintf(stderr, "Could not decode the input for the lens distortion check\n");
+			return false;
+		}
+		const UpscaleConstants &constants = plan.constants.upscale[eye];
+		const DistortionMap &map = plan.distortionMap[eye];
+
+		auto start = std::chrono::high_resolution_clock::now();
+		cpu::Image fused;
+		fused.Resize(plan.outputWidth, plan.outputHeight);
+		cpu::EasuDistorted(input, fused, constants, map, plan.distortion[eye], 0, fused.height);
+		auto fusedEnd = std::chrono::high_resolution_clock::now();
+		cpu::Image upscaled, reference;
+		upscaled.Resize(plan.outputWidth, plan.outputHeight);
+		reference.Resize(plan.outputWidth, plan.outputHeight);
+		cpu::Easu(input, upscaled, constants, 0, upscaled.height);
+		cpu::Distort(upscaled, reference, map, plan.distortion[eye], 0, reference.height);
+		auto referenceEnd = std::chrono::high_resolution_clock::now();
+
+		check.psnr = Psnr(fused, reference, 1);
+		check.blockPsnr = Psnr(fused, reference, 4);
+		check.fusedMs = std::chrono::duration<double, std::milli>(fusedEnd - start).count();
+		check.separateMs = std::chrono::duration<double, std::milli>(referenceEnd - fusedEnd).count();
+		return true;
+	}
+}
+
+int main(int argc, char **argv) {
+	Options options;
+	if (!ParseOptions(argc, argv, options)) {
+		PrintUsage();
+		return 1;
+	}
+	SetLogLevel(LogLevel::Warning);
+
+	PipelineSettings settings;
+	settings.renderScale = .77f;
+	EColorSpace colorSpace = ColorSpace_Auto;
+	std::vector<cpu::HostTexture> textures;
+	std::vector<std::vector<uint8_t>> generatedPixels;
+	// the Submit calls of one frame each
+	std::vector<std::vector<Submit>> frames;
+
+	framedump::FrameDumpReader reader;
+	if (!options.dumpPath.empty()) {
+		if (!reader.Open(options.dumpPath)) {
+			fprintf(stderr, "Could not read %s: %s\n", options.dumpPath.c_str(), reader.GetError().c_str());
+			return 1;
+		}
+		if (reader.GetFrames().empty()) {
+			fprintf(stderr, "%s contains no frames\n", options.dumpPath.c_str());
+			return 1;
+		}
+		const framedump::Constants &recorded = reader.GetConstants()[reader.GetFrames()[0].header.constantsIndex];
+		if (recorded.renderScale > 0) {
+			settings.renderScale = recorded.renderScale;
+		}
+		settings.sharpness = recorded.sharpness;
+		settings.radius = recorded.radius;
+		settings.supersample = (recorded.flags & framedump::FLAG_SUPERSAMPLE) != 0;
+		settings.lumaUpscale = (recorded.flags & framedump::FLAG_LUMA_UPSCALE) != 0;
+		memcpy(projectionCentres, recorded.projectionCentre, sizeof(projectionCentres));
+		colorSpace = recorded.flags & framedump::FLAG_INPUT_SRGB ? ColorSpace_Gamma : ColorSpace_Linear;
+		if (recorded.flags & framedump::FLAG_USE_NIS) {
+			printf("note: NIS has no CPU port, the dump is processed with FSR\n");
+		}
+
+		uint64_t currentFrame = ~0ull;
+		for (const auto &frame : reader.GetFrames()) {
+			const framedump::Constants &constants = reader.GetConstants()[frame.header.constantsIndex];
+			cpu::HostTexture texture;
+			texture.width = frame.header.width;
+			texture.height = frame.header.height;
+			texture.format = frame.header.format;
+			texture.rowPitch = frame.header.rowPitch;
+			texture.pixels = frame.pixels;
+			textures.push_back(texture);
+
+			if (frame.header.frameIndex != currentFrame) {
+				frames.push_back(std::vector<Submit>());
+				currentFrame = frame.header.frameIndex;
+			}
+			for (uint32_t eye = frame.header.eye; eye < 2; ++eye) {
+				Submit submit;
+				submit.eye = (EVREye)eye;
+				submit.texture = textures.size() - 1;
+				memcpy(&submit.bounds, constants.bounds[eye], sizeof(submit.bounds));
+				frames.back().push_back(submit);
+				// a texture shared by both eyes was only recorded once, but is submitted for both
+				if (constants.flags & framedump::FLAG_ONE_EYE_PER_TEXTURE) {
+					break;
+				}
+			}
+		}
+	} else {
+		// a few distinct frames, so the pipeline sees new content and new textures each frame
+		const uint32_t distinctFrames = 4;
+		uint32_t textureWidth = options.sharedTexture ? options.width * 2 : options.width;
+		uint32_t pixelFormat = options.format == framedump::FORMAT_R8G8B8A8_UNORM_SRGB ? framedump::FORMAT_R8G8B8A8_UNORM : options.format;
+		uint32_t texturesPerFrame = options.sharedTexture ? 1 : 2;
+		generatedPixels.resize(distinctFrames * texturesPerFrame);
+		for (uint32_t i = 0; i < generatedPixels.size(); ++i) {
+			GenerateFrame(generatedPixels[i], textureWidth, options.height, pixelFormat, i);
+			cpu::HostTexture texture;
+			texture.width = textureWidth;
+			texture.height = options.height;
+			texture.format = options.format;
+			texture.rowPitch = (size_t)textureWidth * 4;
+			texture.pixels = generatedPixels[i].data();
+			textures.push_back(texture);
+		}
+		for (uint32_t f = 0; f < distinctFrames; ++f) {
+			frames.push_back(std::vector<Submit>());
+			for (int eye = 0; eye < 2; ++eye) {
+				Submit submit;
+				submit.eye = (EVREye)eye;
+				submit.texture = f * texturesPerFrame + (options.sharedTexture ? 0 : eye);
+				VRTextureBounds_t full = { 0, 0, 1, 1 };
+				VRTextureBounds_t half = { eye * .5f, 0, eye * .5f + .5f, 1 };
+				submit.bounds = options.sharedTexture ? half : full;
+				frames.back().push_back(submit);
+			}
+		}
+	}
+
+	if (options.renderScale > 0) settings.renderScale = options.renderScale;
+	if (options.sharpness >= 0) settings.sharpness = options.sharpness;
+	if (options.radius >= 0) settings.radius = options.radius;
+	if (options.grainAmount >= 0) settings.grainAmount = options.grainAmount;
+	settings.chain = options.chain;
+	settings.intermediateFormat = options.intermediateFormat;
+	settings.dither = options.dither;
+	settings.supersample = settings.supersample || options.supersample;
+	settings.lensDistortion = options.lensDistortion;
+	settings.lumaUpscale = settings.lumaUpscale || options.lumaUpscale;
+	if (options.flatTileThreshold >= 0) {
+		settings.tileClassification = true;
+		settings.flatTileThreshold = options.flatTileThreshold;
+	}
+	int threads = options.threads > 0 ? options.threads : (std::max)(1, (int)std::thread::hardware_concurrency());
+
+	cpu::CpuBackend backend (threads);
+	PostProcessPipeline pipeline (backend, GetProjectionCentre, RadialDistortion);
+
+	const cpu::HostTexture *lastOutput = nullptr;
+	auto runFrame = [&](size_t index) -> bool {
+		for (const Submit &submit : frames[index % frames.size()]) {
+			void *output = pipeline.Process(submit.eye, &textures[submit.texture], submit.bounds, colorSpace, settings);
+			if (output == nullptr) {
+				return false;
+			}
+			lastOutput = (const cpu::HostTexture*)output;
+		}
+		return true;
+	};
+
+	trace::SetEnabled(!options.tracePath.empty());
+	for (int i = 0; i < options.warmup; ++i) {
+		TRACE_SCOPE("warmup frame");
+		if (!runFrame(i)) {
+			fprintf(stderr, "The pipeline could not process the frames\n");
+			FlushLog();
+			return 1;
+		}
+	}
+
+	std::vector<double> frameMs;
+	frameMs.reserve(options.frames);
+	for (int i = 0; i < options.frames; ++i) {
+		TRACE_SCOPE("frame");
+		auto start = std::chrono::high_resolution_clock::now();
+		bool processed = runFrame(options.warmup + i);
+		frameMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+		if (!processed) {
+			fprintf(stderr, "The pipeline could not process the frames\n");
+			FlushLog();
+			return 1;
+		}
+	}
+
+	const PipelinePlan &plan = pipeline.GetPlan();
+	std::string stages;
+	for (const PipelinePass &pass : plan.graph.passes) {
+		stages += std::string(" ") + PipelineStageName(pass.stage) + (pass.fusedGrain ? "+grain" : "");
+	}
+	printf("input %ux%u, output %ux%u, %s, stages:%s (%u intermediate texture(s)), sharpness %.2f, radius %.2f, %d thread(s)\n",
+		plan.inputWidth, plan.inputHeight, plan.outputWidth, plan.outputHeight,
+		plan.textureContainsOnlyOneEye ? "one texture per eye" : "shared texture",
+		stages.c_str(), (unsigned)plan.graph.textures.size(), settings.sharpness, settings.radius, threads);
+
+	double total = 0;
+	for (double ms : frameMs) {
+		total += ms;
+	}
+	printf("%d frame(s): mean %.3f ms, median %.3f ms, p99 %.3f ms, max %.3f ms\n", options.frames, total / frameMs.size(),
+		Percentile(frameMs, 50), Percentile(frameMs, 99), Percentile(frameMs, 100));
+	if (lastOutput != nullptr) {
+		printf("output checksum %016llx\n", (unsigned long long)Checksum(*lastOutput));
+	}
+	if (options.lensDistortion) {
+		if (!plan.lensDistortion) {
+			fprintf(stderr, "The pipeline did not apply the lens distortion\n");
+			FlushLog();
+			return 1;
+		}
+		// every eye image of every frame, as some content lines up with the distortion better than other
+		LensDistortionCheck worst;
+		double fusedMs = 0, separateMs = 0;
+		size_t checked = 0;
+		for (const std::vector<Submit> &frame : frames) {
+			for (const Submit &submit : frame) {
+				LensDistortionCheck check;
+				if (!CheckLensDistortion(plan, textures[submit.texture], submit.eye, check)) {
+					FlushLog();
+					return 1;
+				}
+				worst.psnr = (std::min)(worst.psnr, check.psnr);
+				worst.blockPsnr = (std::min)(worst.blockPsnr, check.blockPsnr);
+				fusedMs += check.fusedMs;
+				separateMs += check.separateMs;
+				++checked;
+			}
+		}
+		// the generated frames reach about 44 dB over blocks; half a pixel off stays below 41
+		const double MIN_BLOCK_PSNR = 42;
+		printf("lens distortion: fused vs. distort(upscale) over %zu image(s), worst PSNR %.2f dB, %.2f dB over 4x4 blocks; "
+			"single threaded %.1f ms fused, %.1f ms separate per image\n", checked, worst.psnr, worst.blockPsnr, fusedMs / checked, separateMs / checked);
+		if (worst.blockPsnr < MIN_BLOCK_PSNR) {
+			fprintf(stderr, "The fused lens distortion differs from the reference by more than expected\n");
+			FlushLog();
+			return 1;
+		}
+	}
+
+	if (!options.csvPath.empty()) {
+		FILE *csv = fopen(options.csvPath.c_str(), "w");
+		if (csv == nullptr) {
+			fprintf(stderr, "Could not create %s\n", options.csvPath.c_str());
+			return 1;
+		}
+		fprintf(csv, "frame,ms\n");
+		for (size_t i = 0; i < frameMs.size(); ++i) {
+			fprintf(csv, "%zu,%.4f\n", i, frameMs[i]);
+		}
+		fclose(csv);
+	}
+	if (!options.tracePath.empty()) {
+		std::ofstream traceFile (options.tracePath);
+		if (!traceFile) {
+			fprintf(stderr, "Could not create %s\n", options.tracePath.c_str());
+			return 1;
+		}
+		size_t events = trace::WriteChromeTrace(traceFile);
+		printf("wrote %zu trace event(s) to %s\n", events, options.tracePath.c_str());
+	}
+	FlushLog();
+	return 0;
+}
@@ -0,0 +1,579 @@
+// Replays a frame dump (see src/postprocess/FrameDump.h) through the CPU ports of the post-processing
+// kernels. For every configuration it measures throughput across thread counts and compares each
+// frame against a reference configuration with PSNR and SSIM, so kernel or radius changes can be
+// judged on real game content without a headset. Configurations with a flat tile threshold classify
+// the tiles of every image first, as the tileClassification setting does, and the report lists the
+// fraction of tiles whose EASU and RCAS were skipped. The -luma modes upscale with the lumaUpscale
+// setting's luma guided EASU, to weigh its quality loss against the full EASU.
+//
+// usage: vrdump_replay <dump.vrdump> [options]
+//   --config <mode[:radius[:sharpness[:threshold]]]>  configuration to replay, may be repeated; modes
+//                                          are bilinear, easu, fsr (EASU + RCAS), easu-luma and
+//                                          fsr-luma (luma guided EASU); radius and
+//                                          sharpness default to the recorded values, the flat tile
+//                                          threshold to 0, which classifies nothing
+//   --reference <mode[:radius[:sharpness[:threshold]]]>  configuration to compare against (default fsr:2)
+//   --threads <n,n,...>                   thread counts to benchmark (default 1, 2, 4, ... up to all cores)
+//   --repeat <n>                          times each frame is processed per measurement (default 3)
+//   --frames <n>                          only use the first n recorded eye images
+//   --csv <file>                          write per-frame quality metrics to a CSV file
+//   --no-benchmark / --no-quality         skip either part
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FrameDump.h"
+#include "CpuKernels.h"
+
+using namespace vr;
+
+namespace {
+	enum class Mode {
+		Bilinear,
+		Easu,
+		Fsr,
+	};
+
+	struct Configuration {
+		std::string name;
+		Mode mode;
+		float radius;
+		float sharpness;
+		// luma range below which tiles count as flat and skip EASU and RCAS; 0 to not classify
+		float flatTileThreshold;
+		// EASU filters the luma only, see cpu::EasuLuma
+		bool lumaGuided;
+	};
+
+	struct Options {
+		std::string dumpPath;
+		std::vector<std::string> configSpecs;
+		std::string referenceSpec = "fsr:2";
+		std::vector<int> threadCounts;
+		int repeat = 3;
+		size_t maxFrames = std::numeric_limits<size_t>::max();
+		std::string csvPath;
+		bool benchmark = true;
+		bool quality = true;
+	};
+
+	struct QualityStats {
+		double sumPsnr = 0;
+		double minPsnr = std::numeric_limits<double>::infinity();
+		double sumSsim = 0;
+		double minSsim = 1;
+		size_t count = 0;
+		// tiles classified flat, and of the tiles inside the radius those that were skipped for it
+		uint64_t tiles = 0;
+		uint64_t flatTiles = 0;
+		uint64_t tilesInside = 0;
+		uint64_t skippedTiles = 0;
+	};
+
+	struct TileCounts {
+		uint64_t tiles = 0;
+		uint64_t flat = 0;
+		uint64_t inside = 0;
+		uint64_t skipped = 0;
+	};
+
+	const char * ModeName(Mode mode) {
+		switch (mode) {
+		case Mode::Bilinear: return "bilinear";
+		case Mode::Easu: return "easu";
+		case Mode::Fsr: return "fsr";
+		default: return "?";
+		}
+	}
+
+	bool ParseConfiguration(const std::string &spec, const framedump::Constants &recorded, Configuration &config) {
+		std::vector<std::string> parts;
+		std::stringstream stream (spec);
+		std::string part;
+		while (std::getline(stream, part, ':')) {
+			parts.push_back(part);
+		}
+		if (parts.empty() || parts.size() > 4) {
+			return false;
+		}
+		const std::string lumaSuffix = "-luma";
+		config.lumaGuided = parts[0].size() > lumaSuffix.size() && parts[0].compare(parts[0].size() - lumaSuffix.size(), lumaSuffix.size(), lumaSuffix) == 0;
+		if (config.lumaGuided) {
+			parts[0].resize(parts[0].size() - lumaSuffix.size());
+		}
+		if (parts[0] == "bilinear" && !config.lumaGuided) {
+			config.mode = Mode::Bilinear;
+		} else if (parts[0] == "easu") {
+			config.mode = Mode::Easu;
+		} else if (parts[0] == "fsr") {
+			config.mode = Mode::Fsr;
+		} else {
+			return false;
+		}
+		std::string modeName = std::string(ModeName(config.mode)) + (config.lumaGuided ? lumaSuffix : "");
+		config.radius = parts.size() > 1 ? (float)atof(parts[1].c_str()) : recorded.radius;
+		config.sharpness = parts.size() > 2 ? (float)atof(parts[2].c_str()) : recorded.sharpness;
+		config.flatTileThreshold = parts.size() > 3 ? (std::max)(0.f, (float)atof(parts[3].c_str())) : 0.f;
+		char name[64];
+		if (config.flatTileThreshold > 0) {
+			snprintf(name, sizeof(name), "%s:%.2f:%.2f:%.3f", modeName.c_str(), config.radius, config.sharpness, config.flatTileThreshold);
+		} else {
+			snprintf(name, sizeof(name), "%s:%.2f:%.2f", modeName.c_str(), config.radius, config.sharpness);
+		}
+		config.name = name;
+		return true;
+	}
+
+	std::vector<int> ParseIntList(const char *list) {
+		std::vector<int> values;
+		std::stringstream stream (list);
+		std::string item;
+		while (std::getline(stream, item, ',')) {
+			int value = atoi(item.c_str());
+			if (value > 0) {
+				values.push_back(value);
+			}
+		}
+		return values;
+	}
+
+	// runs fn over tile-aligned row ranges of the given height on the given number of threads
+	void ParallelRows(uint32_t height, int threads, const std::function<void(uint32_t, uint32_t)> &fn) {
+		const uint32_t rowsPerJob = cpu::TILE_SIZE;
+		uint32_t jobs = (height + rowsPerJob - 1) / rowsPerJob;
+		std::atomic<uint32_t> nextJob (0);
+		auto work = [&]() {
+			for (uint32_t job = nextJob++; job < jobs; job = nextJob++) {
+				fn(job * rowsPerJob, (std::min)((job + 1) * rowsPerJob, height));
+			}
+		};
+		std::vector<std::thread> workers;
+		for (int i = 1; i < threads; ++i) {
+			workers.emplace_back(work);
+		}
+		work();
+		for (auto &worker : workers) {
+			worker.join();
+		}
+	}
+
+	class Replayer {
+	public:
+		Replayer(const framedump::Constants &recorded, const Configuration &config, uint32_t eye) : recorded(recorded), config(config) {
+			uint32_t centreSource = recorded.flags & framedump::FLAG_UPSCALE ? 0 : 1;
+			const uint32_t *imageCentre = centreSource == 0 ? recorded.upscale[eye].imageCentre : recorded.sharpen[eye].imageCentre;
+
+			memset(&upscale, 0, sizeof(upscale));
+			supersample = (recorded.flags & framedump::FLAG_SUPERSAMPLE) != 0;
+			if (supersample) {
+				cpu::SetupEasuConstants(upscale, recorded.inputWidth, recorded.inputHeight,
+					recorded.inputWidth * recorded.renderScale, recorded.inputHeight * recorded.renderScale);
+			} else {
+				cpu::SetupEasuConstants(upscale, recorded.inputWidth, recorded.inputHeight, recorded.outputWidth, recorded.outputHeight);
+			}
+			memcpy(upscale.imageCentre, imageCentre, sizeof(upscale.imageCentre));
+			cpu::SetupFoveationRadius(upscale.radius, config.radius, recorded.outputWidth, recorded.outputHeight);
+
+			memset(&sharpen, 0, sizeof(sharpen));
+			cpu::SetupRcasConstants(sharpen, config.sharpness, false);
+			memcpy(sharpen.imageCentre, imageCentre, sizeof(sharpen.imageCentre));
+			cpu::SetupFoveationRadius(sharpen.radius, config.radius, recorded.outputWidth, recorded.outputHeight);
+
+			// bilinear has nothing to skip
+			classify = config.flatTileThreshold > 0 && config.mode != Mode::Bilinear;
+			cpu::SetupClassifyConstants(classifyConstants, recorded.inputWidth, recorded.inputHeight,
+				recorded.outputWidth, recorded.outputHeight, config.flatTileThreshold);
+		}
+
+		// returns the final image, which is either one of the intermediate images or the input itself
+		const cpu::Image & Process(const cpu::Image &input, int threads, bool quantize) {
+			const cpu::Image *current = &input;
+			uint32_t outWidth = recorded.outputWidth;
+			uint32_t outHeight = recorded.outputHeight;
+			const cpu::TileMask *mask = nullptr;
+			if (classify) {
+				cpu::ClassifyTiles(input, classifyConstants, outWidth, outHeight, flatTiles);
+				mask = &flatTiles;
+			}
+
+			if (input.width != outWidth || input.height != outHeight || supersample) {
+				upscaled.Resize(outWidth, outHeight);
+				if (config.mode == Mode::Bilinear) {
+					ParallelRows(outHeight, threads, [&](uint32_t begin, uint32_t end) { cpu::Bilinear(input, upscaled, begin, end); });
+				} else if (supersample) {
+					// the pipeline doesn't plan the luma guided EASU when supersampling either
+					ParallelRows(outHeight, threads, [&](uint32_t begin, uint32_t end) { cpu::EasuSupersampled(input, upscaled, upscale, begin, end, mask); });
+				} else if (config.lumaGuided) {
+					luma.Resize(input.width, input.height);
+					ParallelRows(input.height, threads, [&](uint32_t begin, uint32_t end) { cpu::Luma(input, luma, begin, end); });
+					ParallelRows(outHeight, threads, [&](uint32_t begin, uint32_t end) { cpu::EasuLuma(input, luma, upscaled, upscale, begin, end, mask); });
+				} else {
+					ParallelRows(outHeight, threads, [&](uint32_t begin, uint32_t end) { cpu::Easu(input, upscaled, upscale, begin, end, mask); });
+				}
+				if (quantize) {
+					cpu::QuantizeImage(upscaled, recorded.outputFormat);
+				}
+				current = &upscaled;
+			}
+
+			if (config.mode == Mode::Fsr) {
+				const cpu::Image &source = *current;
+				sharpened.Resize(source.width, source.height);
+				ParallelRows(source.height, threads, [&](uint32_t begin, uint32_t end) { cpu::Rcas(source, sharpened, sharpen, begin, end, mask); });
+				if (quantize) {
+					cpu::QuantizeImage(sharpened, recorded.outputFormat);
+				}
+				current = &sharpened;
+			}
+			return *current;
+		}
+
+		// the tiles of the last processed image
+		TileCounts CountTiles() const {
+			TileCounts counts;
+			if (!classify) {
+				return counts;
+			}
+			for (uint32_t y = 0; y < flatTiles.height; ++y) {
+				for (uint32_t x = 0; x < flatTiles.width; ++x) {
+					bool inside = cpu::IsTileInsideRadius(upscale.imageCentre, upscale.radius, x, y);
+					++counts.tiles;
+					counts.flat += flatTiles.IsFlat(x, y);
+					counts.inside += inside;
+					counts.skipped += inside && flatTiles.IsFlat(x, y);
+				}
+			}
+			return counts;
+		}
+
+	private:
+		const framedump::Constants &recorded;
+		const Configuration &config;
+		// EASU ran at a higher resolution and was filtered down to the input size, see FLAG_SUPERSAMPLE
+		bool supersample = false;
+		UpscaleConstants upscale;
+		SharpenConstants sharpen;
+		bool classify = false;
+		ClassifyConstants classifyConstants;
+		cpu::TileMask flatTiles;
+		cpu::Image luma;
+		cpu::Image upscaled;
+		cpu::Image sharpened;
+	};
+
+	double Psnr(const cpu::Image &a, const cpu::Image &b) {
+		double sum = 0;
+		for (size_t i = 0; i < a.pixels.size(); i += 4) {
+			for (int ch = 0; ch < 3; ++ch) {
+				double d = a.pixels[i + ch] - b.pixels[i + ch];
+				sum += d * d;
+			}
+		}
+		double mse = sum / (a.pixels.size() / 4 * 3);
+		return mse == 0 ? std::numeric_limits<double>::infinity() : 10 * std::log10(1 / mse);
+	}
+
+	// mean SSIM of the luma over 8x8 windows with a stride of 4
+	double Ssim(const cpu::Image &a, const cpu::Image &b) {
+		const int window = 8;
+		const int stride = 4;
+		const double c1 = 0.01 * 0.01;
+		const double c2 = 0.03 * 0.03;
+		auto luma = [](const float *p) { return 0.2126 * p[0] + 0.7152 * p[1] + 0.0722 * p[2]; };
+
+		double total = 0;
+		size_t windows = 0;
+		for (uint32_t y = 0; y + window <= a.height; y += stride) {
+			for (uint32_t x = 0; x + window <= a.width; x += stride) {
+				double sumA = 0, sumB = 0, sumAA = 0, sumBB = 0, sumAB = 0;
+				for (int wy = 0; wy < window; ++wy) {
+					for (int wx = 0; wx < window; ++wx) {
+						double la = luma(a.Pixel(x + wx, y + wy));
+						double lb = luma(b.Pixel(x + wx, y + wy));
+						sumA += la;
+						sumB += lb;
+						sumAA += la * la;
+						sumBB += lb * lb;
+						sumAB += la * lb;
+					}
+				}
+				const double n = window * window;
+				double meanA = sumA / n, meanB = sumB / n;
+				double varA = sumAA / n - meanA * meanA;
+				double varB = sumBB / n - meanB * meanB;
+				double cov = sumAB / n - meanA * meanB;
+				total += ((2 * meanA * meanB + c1) * (2 * cov + c2)) / ((meanA * meanA + meanB * meanB + c1) * (varA + varB + c2));
+				++windows;
+			}
+		}
+		return windows > 0 ? total / windows : 1;
+	}
+
+	// NIS has no CPU port; replaying such frames with the FSR kernels would measure something else
+	// than what the game showed, so they are left out
+	bool RecordedWithNis(const framedump::FrameDumpReader &reader, const framedump::FrameDumpReader::Frame &frame) {
+		return (reader.GetConstants()[frame.header.constantsIndex].flags & framedump::FLAG_USE_NIS) != 0;
+	}
+
+	bool Decode(const framedump::FrameDumpReader::Frame &frame, cpu::Image &image) {
+		return cpu::DecodeImage(frame.pixels, frame.header.width, frame.header.height, frame.header.rowPitch, frame.header.format, image);
+	}
+
+	void RunQuality(const framedump::FrameDumpReader &reader, const std::vector<Configuration> &configs, const Configuration &reference,
+			size_t frameCount, int threads, const std::string &csvPath) {
+		FILE *csv = nullptr;
+		if (!csvPath.empty()) {
+			csv = fopen(csvPath.c_str(), "w");
+			if (csv == nullptr) {
+				fprintf(stderr, "Could not create %s\n", csvPath.c_str());
+			} else {
+				fprintf(csv, "frame,eye,configuration,psnr,ssim,skipped_tiles\n");
+			}
+		}
+
+		std::vector<QualityStats> stats (configs.size());
+		cpu::Image input;
+		for (size_t i = 0; i < frameCount; ++i) {
+			const auto &frame = reader.GetFrames()[i];
+			const framedump::Constants &constants = reader.GetConstants()[frame.header.constantsIndex];
+			if (RecordedWithNis(reader, frame)) {
+				if (csv != nullptr) {
+					fprintf(csv, "%llu,%u,recorded-with-nis,,,\n", (unsigned long long)frame.header.frameIndex, frame.header.eye);
+				}
+				continue;
+			}
+			if (!Decode(frame, input)) {
+				continue;
+			}
+			Replayer referenceReplayer (constants, reference, frame.header.eye);
+			const cpu::Image &referenceImage = referenceReplayer.Process(input, threads, true);
+			for (size_t c = 0; c < configs.size(); ++c) {
+				Replayer replayer (constants, configs[c], frame.header.eye);
+				const cpu::Image &image = replayer.Process(input, threads, true);
+				double psnr = Psnr(image, referenceImage);
+				double ssim = Ssim(image, referenceImage);
+				QualityStats &s = stats[c];
+				if (std::isfinite(psnr)) {
+					s.sumPsnr += psnr;
+				}
+				s.minPsnr = (std::min)(s.minPsnr, psnr);
+				s.sumSsim += ssim;
+				s.minSsim = (std::min)(s.minSsim, ssim);
+				++s.count;
+				TileCounts tiles = replayer.CountTiles();
+				s.tiles += tiles.tiles;
+				s.flatTiles += tiles.flat;
+				s.tilesInside += tiles.inside;
+				s.skippedTiles += tiles.skipped;
+				if (csv != nullptr) {
+					fprintf(csv, "%llu,%u,%s,%.4f,%.6f,%.4f\n", (unsigned long long)frame.header.frameIndex, frame.header.eye, configs[c].name.c_str(), psnr, ssim,
+						tiles.inside > 0 ? tiles.skipped / (double)tiles.inside : 0.0);
+				}
+			}
+		}
+		if (csv != nullptr) {
+			fclose(csv);
+		}
+
+		printf("\nQuality against %s\n", reference.name.c_str());
+		printf("%-26s %12s %12s %10s %10s\n", "configuration", "mean PSNR", "min PSNR", "mean SSIM", "min SSIM");
+		for (size_t c = 0; c < configs.size(); ++c) {
+			const QualityStats &s = stats[c];
+			if (s.count == 0) {
+				continue;
+			}
+			if (std::isinf(s.minPsnr)) {
+				printf("%-26s %12s %12s %10.6f %10.6f\n", configs[c].name.c_str(), "identical", "identical", s.sumSsim / s.count, s.minSsim);
+			} else {
+				printf("%-26s %12.3f %12.3f %10.6f %10.6f\n", configs[c].name.c_str(), s.sumPsnr / s.count, s.minPsnr, s.sumSsim / s.count, s.minSsim);
+			}
+		}
+
+		bool classified = false;
+		for (const QualityStats &s : stats) {
+			classified |= s.tiles > 0;
+		}
+		if (!classified) {
+			return;
+		}
+		printf("\nTile classification\n");
+		printf("%-26s %12s %22s\n", "configuration", "flat tiles", "skipped within radius");
+		for (size_t c = 0; c < configs.size(); ++c) {
+			const QualityStats &s = stats[c];
+			if (s.tiles == 0) {
+				continue;
+			}
+			printf("%-26s %11.1f%% %21.1f%%\n", configs[c].name.c_str(), 100.0 * s.flatTiles / s.tiles,
+				s.tilesInside > 0 ? 100.0 * s.skippedTiles / s.tilesInside : 0.0);
+		}
+	}
+
+	void RunBenchmark(const framedump::FrameDumpReader &reader, const std::vector<Configuration> &configs, size_t frameCount,
+			const std::vector<int> &threadCounts, int repeat) {
+		std::set<uint64_t> frameIndices;
+		size_t imageCount = 0;
+		for (size_t i = 0; i < frameCount; ++i) {
+			if (!RecordedWithNis(reader, reader.GetFrames()[i])) {
+				frameIndices.insert(reader.GetFrames()[i].header.frameIndex);
+				++imageCount;
+			}
+		}
+
+		printf("\nThroughput over %zu eye image(s) of %zu frame(s), %d repetition(s)\n", imageCount, frameIndices.size(), repeat);
+		printf("%-26s %8s %12s %12s %12s %9s\n", "configuration", "threads", "frames/s", "ms/image", "ns/pixel", "speedup");
+		cpu::Image input;
+		for (const Configuration &config : configs) {
+			double baseline = 0;
+			for (int threads : threadCounts) {
+				double seconds = 0;
+				uint64_t pixels = 0;
+				size_t images = 0;
+				for (size_t i = 0; i < frameCount; ++i) {
+					const auto &frame = reader.GetFrames()[i];
+					const framedump::Constants &constants = reader.GetConstants()[frame.header.constantsIndex];
+					if (RecordedWithNis(reader, frame) || !Decode(frame, input)) {
+						continue;
+					}
+					Replayer replayer (constants, config, frame.header.eye);
+					// once untimed, so that the intermediate images are allocated
+					replayer.Process(input, threads, false);
+					auto start = std::chrono::high_resolution_clock::now();
+					for (int r = 0; r < repeat; ++r) {
+						replayer.Process(input, threads, false);
+					}
+					seconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+					pixels += (uint64_t)constants.outputWidth * constants.outputHeight * repeat;
+					images += repeat;
+				}
+				if (images == 0 || seconds <= 0) {
+					continue;
+				}
+				double framesPerSecond = frameIndices.size() * repeat / seconds;
+				if (baseline == 0) {
+					baseline = framesPerSecond;
+				}
+				printf("%-26s %8d %12.2f %12.3f %12.3f %8.2fx\n", config.name.c_str(), threads, framesPerSecond,
+					seconds * 1000 / images, seconds * 1e9 / pixels, framesPerSecond / baseline);
+			}
+		}
+	}
+
+	void PrintUsage() {
+		fprintf(stderr, "usage: vrdump_replay <dump.vrdump> [--config mode[:radius[:sharpness[:threshold]]]]...\n"
+			"                     [--reference mode[:radius[:sharpness[:threshold]]]]\n"
+			"                     [--threads n,n,...] [--repeat n] [--frames n] [--csv file] [--no-benchmark] [--no-quality]\n"
+			"modes: bilinear, easu, fsr, easu-luma, fsr-luma\n");
+	}
+
+	bool ParseOptions(int argc, char **argv, Options &options) {
+		for (int i = 1; i < argc; ++i) {
+			std::string arg = argv[i];
+			bool hasValue = i + 1 < argc;
+			if (arg == "--config" && hasValue) {
+				options.configSpecs.push_back(argv[++i]);
+			} else if (arg == "--reference" && hasValue) {
+				options.referenceSpec = argv[++i];
+			} else if (arg == "--threads" && hasValue) {
+				options.threadCounts = ParseIntList(argv[++i]);
+			} else if (arg == "--repeat" && hasValue) {
+				options.repeat = (std::max)(1, atoi(argv[++i]));
+			} else if (arg == "--frames" && hasValue) {
+				options.maxFrames = (size_t)(std::max)(1, atoi(argv[++i]));
+			} else if (arg == "--csv" && hasValue) {
+				options.csvPath = argv[++i];
+			} else if (arg == "--no-benchmark") {
+				options.benchmark = false;
+			} else if (arg == "--no-quality") {
+				options.quality = false;
+			} else if (arg[0] != '-' && options.dumpPath.empty()) {
+				options.dumpPath = arg;
+			} else {
+				return false;
+			}
+		}
+		return !options.dumpPath.empty();
+	}
+}
+
+int main(int argc, char **argv) {
+	Options options;
+	if (!ParseOptions(argc, argv, options)) {
+		PrintUsage();
+		return 1;
+	}
+
+	framedump::FrameDumpReader reader;
+	if (!reader.Open(options.dumpPath)) {
+		fprintf(stderr, "Could not read %s: %s\n", options.dumpPath.c_str(), reader.GetError().c_str());
+		return 1;
+	}
+	if (reader.GetFrames().empty()) {
+		fprintf(stderr, "%s contains no frames\n", options.dumpPath.c_str());
+		return 1;
+	}
+
+	const framedump::Constants &first = reader.GetConstants()[reader.GetFrames()[0].header.constantsIndex];
+	printf("%s: %zu eye image(s), %zu constant set(s)\n", options.dumpPath.c_str(), reader.GetFrames().size(), reader.GetConstants().size());
+	printf("input %ux%u (format %u), output %ux%u (format %u), recorded with %s, sharpness %.2f, radius %.2f\n",
+		first.inputWidth, first.inputHeight, first.inputFormat, first.outputWidth, first.outputHeight, first.outputFormat,
+		first.flags & framedump::FLAG_USE_NIS ? "NIS" : "FSR", first.sharpness, first.radius);
+
+	if (options.configSpecs.empty()) {
+		options.configSpecs = { "bilinear", "easu", "fsr", "fsr:2" };
+	}
+	std::vector<Configuration> configs;
+	for (const std::string &spec : options.configSpecs) {
+		Configuration config;
+		if (!ParseConfiguration(spec, first, config)) {
+			fprintf(stderr, "Invalid configuration '%s'\n", spec.c_str());
+			return 1;
+		}
+		configs.push_back(config);
+	}
+	Configuration reference;
+	if (!ParseConfiguration(options.referenceSpec, first, reference)) {
+		fprintf(stderr, "Invalid reference configuration '%s'\n", options.referenceSpec.c_str());
+		return 1;
+	}
+
+	int hardwareThreads = (std::max)(1, (int)std::thread::hardware_concurrency());
+	if (options.threadCounts.empty()) {
+		for (int threads = 1; threads < hardwareThreads; threads *= 2) {
+			options.threadCounts.push_back(threads);
+		}
+		options.threadCounts.push_back(hardwareThreads);
+	}
+
+	size_t frameCount = (std::min)(options.maxFrames, reader.GetFrames().size());
+	size_t nisImages = 0;
+	for (size_t i = 0; i < frameCount; ++i) {
+		nisImages += RecordedWithNis(reader, reader.GetFrames()[i]) ? 1 : 0;
+	}
+	if (nisImages == frameCount) {
+		fprintf(stderr, "%s was recorded with NIS, which has no CPU port to replay it with\n", options.dumpPath.c_str());
+		return 1;
+	}
+	if (nisImages > 0) {
+		printf("note: %zu eye image(s) were recorded with NIS, which has no CPU port; they are left out and marked recorded-with-nis in the CSV\n",
+			nisImages);
+	}
+	if (options.quality) {
+		RunQuality(reader, configs, reference, frameCount, hardwareThreads, options.csvPath);
+	}
+	if (options.benchmark) {
+		RunBenchmark(reader, configs, frameCount, options.threadCounts, options.repeat);
+	}
+	return 0;
+}
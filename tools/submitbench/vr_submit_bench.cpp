@@ -0,0 +1,428 @@
+// Drives the mod end to end without a headset: VR_Init loads the null runtime (tools/nullruntime)
+// through VR_OVERRIDE, the hooks get installed on its IVRSystem and IVRCompositor, and every Submit
+// goes through the post processor on a D3D11 device (WARP by default, so no GPU is needed either).
+// The benchmark first submits directly to the null runtime before any hooks exist, then through the
+// hooked compositor, and reports the CPU time each Submit call takes in both phases. The difference
+// is the per-Submit overhead the mod adds on the game's render thread.
+//
+// Which upscaler runs is determined by the openvr_mod.cfg next to the executable, as it would be
+// next to a game's openvr_api.dll. Headset properties can be set through the NULLVR_* environment
+// variables described in nullruntime/NullRuntime.h.
+//
+// usage: vr_submit_bench [options]
+//   --runtime <dir>      null runtime directory (default: nullruntime next to the executable)
+//   --frames <n>         measured frames per phase (default 2000)
+//   --warmup <n>         frames submitted before measuring (default 100)
+//   --layout <l>         separate: one texture per eye, shared: both eyes side by side in one
+//                        texture with bounds (default separate)
+//   --format <f>         eye texture format: srgb, unorm, typeless, rgb10a2 or rgba16f (default srgb)
+//   --latency <n>        frames the GPU may lag behind before the benchmark waits for it (default 2)
+//   --hardware           use the default hardware adapter instead of WARP
+//   --csv <file>         write every measured Submit to a CSV file
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <openvr.h>
+
+#include "ivrclientcore.h"
+#include "NullRuntime.h"
+
+using Microsoft::WRL::ComPtr;
+
+namespace {
+	enum class Layout {
+		Separate,
+		Shared,
+	};
+
+	struct Options {
+		std::string runtimeDir;
+		int frames = 2000;
+		int warmup = 100;
+		Layout layout = Layout::Separate;
+		DXGI_FORMAT textureFormat = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+		DXGI_FORMAT viewFormat = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+		int latency = 2;
+		bool hardware = false;
+		std::string csvPath;
+	};
+
+	struct Sample {
+		int frame;
+		vr::EVREye eye;
+		double microseconds;
+	};
+
+	struct PhaseResult {
+		std::string name;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		std::vector<Sample> samples;
+		double seconds = 0;
+		bool textureReplaced = false;
+		uint64_t rejectedSubmits = 0;
+	};
+
+	typedef std::chrono::high_resolution_clock Clock;
+
+	std::string GetExecutableDir() {
+		char path[MAX_PATH];
+		DWORD length = GetModuleFileNameA(nullptr, path, MAX_PATH);
+		std::string p (path, length);
+		return p.substr(0, p.find_last_of('\\'));
+	}
+
+	bool ParseFormat(const std::string &name, Options &options) {
+		if (name == "srgb") {
+			options.textureFormat = options.viewFormat = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+		} else if (name == "unorm") {
+			options.textureFormat = options.viewFormat = DXGI_FORMAT_R8G8B8A8_UNORM;
+		} else if (name == "typeless") {
+			options.textureFormat = DXGI_FORMAT_R8G8B8A8_TYPELESS;
+			options.viewFormat = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+		} else if (name == "rgb10a2") {
+			options.textureFormat = options.viewFormat = DXGI_FORMAT_R10G10B10A2_UNORM;
+		} else if (name == "rgba16f") {
+			options.textureFormat = options.viewFormat = DXGI_FORMAT_R16G16B16A16_FLOAT;
+		} else {
+			return false;
+		}
+		return true;
+	}
+
+	bool ParseOptions(int argc, char **argv, Options &options) {
+		for (int i = 1; i < argc; ++i) {
+			std::string arg = argv[i];
+			bool hasValue = i + 1 < argc;
+			if (arg == "--runtime" && hasValue) {
+				options.runtimeDir = argv[++i];
+			} else if (arg == "--frames" && hasValue) {
+				options.frames = (std::max)(1, std::atoi(argv[++i]));
+			} else if (arg == "--warmup" && hasValue) {
+				options.warmup = (std::max)(0, std::atoi(argv[++i]));
+			} else if (arg == "--layout" && hasValue) {
+				std::string layout = argv[++i];
+				if (layout == "separate") {
+					options.layout = Layout::Separate;
+				} else if (layout == "shared") {
+					options.layout = Layout::Shared;
+				} else {
+					std::fprintf(stderr, "Unknown layout '%s'\n", layout.c_str());
+					return false;
+				}
+			} else if (arg == "--format" && hasValue) {
+				if (!ParseFormat(argv[++i], options)) {
+					std::fprintf(stderr, "Unknown format '%s'\n", argv[i]);
+					return false;
+				}
+			} else if (arg == "--latency" && hasValue) {
+				options.latency = (std::max)(1, std::atoi(argv[++i]));
+			} else if (arg == "--hardware") {
+				options.hardware = true;
+			} else if (arg == "--csv" && hasValue) {
+				options.csvPath = argv[++i];
+			} else {
+				std::fprintf(stderr, "Unknown or incomplete option '%s'\n", arg.c_str());
+				return false;
+			}
+		}
+		if (options.runtimeDir.empty()) {
+			options.runtimeDir = GetExecutableDir() + "\\nullruntime";
+		}
+		return true;
+	}
+
+	// The game side of the benchmark: eye textures that get cleared every frame as a stand-in for
+	// rendering, and a bounded number of frames in flight like a real swap chain would enforce.
+	class EyeRenderer {
+	public:
+		bool Init(const Options &options) {
+			this->options = options;
+			D3D_FEATURE_LEVEL featureLevel = D3D_FEATURE_LEVEL_11_0;
+			HRESULT result = D3D11CreateDevice(nullptr, options.hardware ? D3D_DRIVER_TYPE_HARDWARE : D3D_DRIVER_TYPE_WARP,
+				nullptr, 0, &featureLevel, 1, D3D11_SDK_VERSION, device.GetAddressOf(), nullptr, context.GetAddressOf());
+			if (FAILED(result)) {
+				std::fprintf(stderr, "Could not create D3D11 device: %08x\n", (unsigned)result);
+				return false;
+			}
+			return true;
+		}
+
+		bool CreateTextures(uint32_t width, uint32_t height) {
+			for (int i = 0; i < 2; ++i) {
+				textures[i].Reset();
+				views[i].Reset();
+			}
+			int count = options.layout == Layout::Separate ? 2 : 1;
+			D3D11_TEXTURE2D_DESC td = {};
+			td.Width = options.layout == Layout::Separate ? width : 2 * width;
+			td.Height = height;
+			td.MipLevels = 1;
+			td.ArraySize = 1;
+			td.Format = options.textureFormat;
+			td.SampleDesc.Count = 1;
+			td.Usage = D3D11_USAGE_DEFAULT;
+			td.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
+			D3D11_RENDER_TARGET_VIEW_DESC rvd = {};
+			rvd.Format = options.viewFormat;
+			rvd.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
+			for (int i = 0; i < count; ++i) {
+				if (FAILED(device->CreateTexture2D(&td, nullptr, textures[i].GetAddressOf()))
+						|| FAILED(device->CreateRenderTargetView(textures[i].Get(), &rvd, views[i].GetAddressOf()))) {
+					std::fprintf(stderr, "Could not create %ux%u eye texture\n", td.Width, td.Height);
+					return false;
+				}
+			}
+			return true;
+		}
+
+		void Render(int frame) {
+			float shade = (frame % 64) / 64.f;
+			float colour[4] = { shade, .5f, 1.f - shade, 1.f };
+			for (int i = 0; i < 2; ++i) {
+				if (views[i]) {
+					context->ClearRenderTargetView(views[i].Get(), colour);
+				}
+			}
+		}
+
+		void GetSubmitArgs(vr::EVREye eye, vr::Texture_t &texture, vr::VRTextureBounds_t &bounds) const {
+			texture.eType = vr::TextureType_DirectX;
+			texture.eColorSpace = vr::ColorSpace_Auto;
+			if (options.layout == Layout::Separate) {
+				texture.handle = textures[eye].Get();
+				bounds = { 0, 0, 1, 1 };
+			} else {
+				texture.handle = textures[0].Get();
+				bounds = { eye == vr::Eye_Left ? 0.f : .5f, 0, eye == vr::Eye_Left ? .5f : 1.f, 1 };
+			}
+		}
+
+		bool IsOwnTexture(void *handle) const {
+			return handle == textures[0].Get() || handle == textures[1].Get();
+		}
+
+		void EndFrame() {
+			D3D11_QUERY_DESC qd = { D3D11_QUERY_EVENT, 0 };
+			ComPtr<ID3D11Query> query;
+			if (SUCCEEDED(device->CreateQuery(&qd, query.GetAddressOf()))) {
+				context->End(query.Get());
+				context->Flush();
+				framesInFlight.push_back(query);
+			}
+			while ((int)framesInFlight.size() > options.latency) {
+				while (context->GetData(framesInFlight.front().Get(), nullptr, 0, 0) == S_FALSE) {
+					Sleep(0);
+				}
+				framesInFlight.pop_front();
+			}
+		}
+
+		void WaitIdle() {
+			while (!framesInFlight.empty()) {
+				while (context->GetData(framesInFlight.front().Get(), nullptr, 0, 0) == S_FALSE) {
+					Sleep(0);
+				}
+				framesInFlight.pop_front();
+			}
+		}
+
+	private:
+		Options options;
+		ComPtr<ID3D11Device> device;
+		ComPtr<ID3D11DeviceContext> context;
+		ComPtr<ID3D11Texture2D> textures[2];
+		ComPtr<ID3D11RenderTargetView> views[2];
+		std::deque<ComPtr<ID3D11Query>> framesInFlight;
+	};
+
+	void RunFrames(const Options &options, EyeRenderer &renderer, vr::IVRCompositor *compositor, PhaseResult &result) {
+		vr::TrackedDevicePose_t poses[vr::k_unMaxTrackedDeviceCount];
+		result.samples.reserve(2 * options.frames);
+		auto start = Clock::now();
+		for (int frame = -options.warmup; frame < options.frames; ++frame) {
+			if (frame == 0) {
+				start = Clock::now();
+			}
+			compositor->WaitGetPoses(poses, vr::k_unMaxTrackedDeviceCount, nullptr, 0);
+			renderer.Render(frame);
+			for (int eye = 0; eye < 2; ++eye) {
+				vr::Texture_t texture;
+				vr::VRTextureBounds_t bounds;
+				renderer.GetSubmitArgs((vr::EVREye)eye, texture, bounds);
+				auto before = Clock::now();
+				compositor->Submit((vr::EVREye)eye, &texture, &bounds, vr::Submit_Default);
+				auto after = Clock::now();
+				if (frame >= 0) {
+					double us = std::chrono::duration<double, std::micro>(after - before).count();
+					result.samples.push_back({ frame, (vr::EVREye)eye, us });
+				}
+			}
+			renderer.EndFrame();
+		}
+		renderer.WaitIdle();
+		result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	void CheckSubmits(void *runtimeModule, const EyeRenderer &renderer, PhaseResult &result) {
+		auto getStats = (NullRuntime_GetSubmitStatsFn)GetProcAddress((HMODULE)runtimeModule, "NullRuntime_GetSubmitStats");
+		auto resetStats = (NullRuntime_ResetSubmitStatsFn)GetProcAddress((HMODULE)runtimeModule, "NullRuntime_ResetSubmitStats");
+		if (getStats == nullptr || resetStats == nullptr) {
+			return;
+		}
+		nullvr::SubmitStats stats;
+		getStats(&stats);
+		// the post processor swaps in its output texture, so the runtime sees a different handle
+		result.textureReplaced = !renderer.IsOwnTexture(stats.last[0].handle);
+		result.rejectedSubmits = stats.rejectedSubmits;
+		resetStats();
+	}
+
+	double Percentile(std::vector<double> values, double p) {
+		if (values.empty()) {
+			return 0;
+		}
+		size_t index = (std::min)(values.size() - 1, (size_t)(p * (values.size() - 1) + .5));
+		std::nth_element(values.begin(), values.begin() + index, values.end());
+		return values[index];
+	}
+
+	void PrintResult(const PhaseResult &result) {
+		std::vector<double> perEye[2], perFrame;
+		for (size_t i = 0; i < result.samples.size(); ++i) {
+			const Sample &s = result.samples[i];
+			perEye[s.eye].push_back(s.microseconds);
+			if (s.eye == vr::Eye_Right && i > 0) {
+				perFrame.push_back(s.microseconds + result.samples[i - 1].microseconds);
+			}
+		}
+		std::printf("%s (%ux%u per eye)\n", result.name.c_str(), result.width, result.height);
+		std::printf("  %-12s %10s %10s %10s %10s %10s\n", "Submit us", "mean", "p50", "p95", "p99", "max");
+		const char *labels[3] = { "left eye", "right eye", "both eyes" };
+		const std::vector<double> *sets[3] = { &perEye[0], &perEye[1], &perFrame };
+		for (int i = 0; i < 3; ++i) {
+			const std::vector<double> &values = *sets[i];
+			double sum = 0;
+			for (double v : values) sum += v;
+			double mean = values.empty() ? 0 : sum / values.size();
+			std::printf("  %-12s %10.2f %10.2f %10.2f %10.2f %10.2f\n", labels[i], mean,
+				Percentile(values, .5), Percentile(values, .95), Percentile(values, .99), Percentile(values, 1));
+		}
+		size_t frames = perFrame.size();
+		std::printf("  %zu frames in %.2f s (%.1f fps including GPU wait)", frames, result.seconds, frames / result.seconds);
+		if (result.rejectedSubmits > 0) {
+			std::printf(", %llu submits rejected by the runtime", (unsigned long long)result.rejectedSubmits);
+		}
+		std::printf("\n  runtime received %s\n\n", result.textureReplaced ? "the post processor's output" : "the game's textures");
+	}
+
+	double MeanPerFrame(const PhaseResult &result) {
+		double sum = 0;
+		for (const Sample &s : result.samples) sum += s.microseconds;
+		return result.samples.empty() ? 0 : 2 * sum / result.samples.size();
+	}
+
+	void WriteCsv(const std::string &path, const std::vector<PhaseResult> &results) {
+		FILE *csv = std::fopen(path.c_str(), "w");
+		if (csv == nullptr) {
+			std::fprintf(stderr, "Could not open %s for writing\n", path.c_str());
+			return;
+		}
+		std::fprintf(csv, "phase,width,height,frame,eye,submit_us\n");
+		for (const PhaseResult &result : results) {
+			for (const Sample &s : result.samples) {
+				std::fprintf(csv, "%s,%u,%u,%d,%d,%.3f\n", result.name.c_str(), result.width, result.height, s.frame, (int)s.eye, s.microseconds);
+			}
+		}
+		std::fclose(csv);
+	}
+}
+
+int main(int argc, char **argv) {
+	Options options;
+	if (!ParseOptions(argc, argv, options)) {
+		return 1;
+	}
+
+	// all three paths have to be overridden for the loader to skip the SteamVR path registry
+	SetEnvironmentVariableA("VR_OVERRIDE", options.runtimeDir.c_str());
+	SetEnvironmentVariableA("VR_CONFIG_PATH", options.runtimeDir.c_str());
+	SetEnvironmentVariableA("VR_LOG_PATH", options.runtimeDir.c_str());
+
+	EyeRenderer renderer;
+	if (!renderer.Init(options)) {
+		return 1;
+	}
+
+	// Phase 1: talk to the null runtime directly. This has to happen before VR_Init, because the hooks
+	// patch the runtime's Submit implementation itself and affect every caller afterwards.
+#if defined( _WIN64 )
+	std::string runtimePath = options.runtimeDir + "\\bin\\vrclient_x64.dll";
+#else
+	std::string runtimePath = options.runtimeDir + "\\bin\\vrclient.dll";
+#endif
+	HMODULE runtimeModule = LoadLibraryA(runtimePath.c_str());
+	if (runtimeModule == nullptr) {
+		std::fprintf(stderr, "Could not load the null runtime from %s\n", runtimePath.c_str());
+		return 1;
+	}
+	typedef void* (*VRClientCoreFactoryFn)(const char *pInterfaceName, int *pReturnCode);
+	auto factory = (VRClientCoreFactoryFn)GetProcAddress(runtimeModule, "VRClientCoreFactory");
+	auto core = factory ? (vr::IVRClientCore*)factory(vr::IVRClientCore_Version, nullptr) : nullptr;
+	if (core == nullptr || core->Init(vr::VRApplication_Scene, nullptr) != vr::VRInitError_None) {
+		std::fprintf(stderr, "%s is not a usable vrclient\n", runtimePath.c_str());
+		return 1;
+	}
+
+	std::vector<PhaseResult> results (2);
+	results[0].name = "runtime only";
+	auto system = (vr::IVRSystem*)core->GetGenericInterface(vr::IVRSystem_Version, nullptr);
+	auto compositor = (vr::IVRCompositor*)core->GetGenericInterface(vr::IVRCompositor_Version, nullptr);
+	system->GetRecommendedRenderTargetSize(&results[0].width, &results[0].height);
+	if (!renderer.CreateTextures(results[0].width, results[0].height)) {
+		return 1;
+	}
+	RunFrames(options, renderer, compositor, results[0]);
+	CheckSubmits(runtimeModule, renderer, results[0]);
+	PrintResult(results[0]);
+
+	// Phase 2: the regular path through openvr_api, with the hooks and the post processor in place.
+	// The render size is queried again, since the hook applies the configured renderScale.
+	results[1].name = "with mod";
+	vr::EVRInitError error = vr::VRInitError_None;
+	vr::IVRSystem *hookedSystem = vr::VR_Init(&error, vr::VRApplication_Scene);
+	if (hookedSystem == nullptr) {
+		std::fprintf(stderr, "VR_Init failed: %s\n", vr::VR_GetVRInitErrorAsEnglishDescription(error));
+		return 1;
+	}
+	hookedSystem->GetRecommendedRenderTargetSize(&results[1].width, &results[1].height);
+	if (!renderer.CreateTextures(results[1].width, results[1].height)) {
+		return 1;
+	}
+	RunFrames(options, renderer, vr::VRCompositor(), results[1]);
+	CheckSubmits(runtimeModule, renderer, results[1]);
+	PrintResult(results[1]);
+
+	std::printf("Mod overhead per frame (both eyes, mean): %.2f us\n", MeanPerFrame(results[1]) - MeanPerFrame(results[0]));
+	if (!results[1].textureReplaced) {
+		std::printf("Note: the post processor did not replace the submitted textures; check that upscaling is enabled in openvr_mod.cfg\n");
+	}
+
+	if (!options.csvPath.empty()) {
+		WriteCsv(options.csvPath, results);
+	}
+
+	vr::VR_Shutdown();
+	core->Cleanup();
+	FreeLibrary(runtimeModule);
+	return 0;
+}
@@ -0,0 +1,144 @@
+// Prints the live statistics a running game publishes with the mod's telemetry setting enabled (see
+// src/postprocess/Telemetry.h), for watching the mod or feeding dashboards without parsing its log.
+//
+// usage: telemetry_reader [options]
+//   --interval <ms>        time between samples (default 1000)
+//   --count <n>            number of samples to print, 0 for no limit (default 0)
+//   --csv                  print comma separated values with a header line instead of text
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+#include <windows.h>
+
+#include "PostProcessGraph.h"
+#include "Telemetry.h"
+
+using namespace vr;
+
+namespace {
+	struct Options {
+		int intervalMs = 1000;
+		int count = 0;
+		bool csv = false;
+	};
+
+	void PrintUsage() {
+		fprintf(stderr, "usage: telemetry_reader [--interval ms] [--count n] [--csv]\n");
+	}
+
+	bool ParseOptions(int argc, char **argv, Options &options) {
+		for (int i = 1; i < argc; ++i) {
+			std::string arg = argv[i];
+			bool hasValue = i + 1 < argc;
+			if (arg == "--interval" && hasValue) {
+				options.intervalMs = atoi(argv[++i]);
+				if (options.intervalMs < 1) {
+					return false;
+				}
+			} else if (arg == "--count" && hasValue) {
+				options.count = atoi(argv[++i]);
+			} else if (arg == "--csv") {
+				options.csv = true;
+			} else {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// maps the block read-only; returns nullptr if no game publishes telemetry
+	const telemetry::Block * OpenBlock() {
+		std::string name = std::string("Local\\") + telemetry::SHARED_MEMORY_NAME;
+		HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+		if (mapping == nullptr) {
+			return nullptr;
+		}
+		// the view keeps the mapping alive
+		void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, sizeof(telemetry::Block));
+		CloseHandle(mapping);
+		return (const telemetry::Block*)view;
+	}
+
+	std::string StageList(const telemetry::Snapshot &snapshot, const char *separator) {
+		std::string stages;
+		for (uint32_t i = 0; i < snapshot.stageCount && i < telemetry::MAX_STAGES; ++i) {
+			if (i > 0) {
+				stages += separator;
+			}
+			stages += PipelineStageName((PipelineStage)snapshot.stages[i]);
+			if (snapshot.stageFusedGrain[i]) {
+				stages += "+grain";
+			}
+			char time[32];
+			snprintf(time, sizeof(time), " %.3f", snapshot.stageGpuMs[i]);
+			stages += time;
+		}
+		return stages;
+	}
+
+	void PrintSnapshot(const telemetry::Snapshot &snapshot, bool csv) {
+		const char *algorithm = snapshot.algorithm == telemetry::ALGORITHM_NIS ? "nis" : "fsr";
+		double inUseMb = snapshot.vramBytesInUse / (1024.0 * 1024.0);
+		double cachedMb = snapshot.vramBytesCached / (1024.0 * 1024.0);
+		if (csv) {
+			printf("%llu,%s,%ux%u,%ux%u,%.3f,%.3f,%.3f,%.3f,%.3f,%.1f,%.1f,%u,%s\n", (unsigned long long)snapshot.frameIndex, algorithm,
+				snapshot.inputWidth, snapshot.inputHeight, snapshot.outputWidth, snapshot.outputHeight,
+				snapshot.renderScale, snapshot.sharpness, snapshot.radius, snapshot.gpuMs, snapshot.cpuApplyMs,
+				inUseMb, cachedMb, snapshot.samplerCacheSize, StageList(snapshot, ";").c_str());
+		} else {
+			printf("frame %llu: %s %ux%u -> %ux%u, sharpness %.2f, radius %.2f, GPU %.3f ms (%s), CPU %.3f ms, "
+				"VRAM %.1f MB + %.1f MB cached, %u sampler(s)\n", (unsigned long long)snapshot.frameIndex, algorithm,
+				snapshot.inputWidth, snapshot.inputHeight, snapshot.outputWidth, snapshot.outputHeight,
+				snapshot.sharpness, snapshot.radius, snapshot.gpuMs, StageList(snapshot, ", ").c_str(), snapshot.cpuApplyMs,
+				inUseMb, cachedMb, snapshot.samplerCacheSize);
+		}
+		fflush(stdout);
+	}
+}
+
+int main(int argc, char **argv) {
+	Options options;
+	if (!ParseOptions(argc, argv, options)) {
+		PrintUsage();
+		return 2;
+	}
+
+	const telemetry::Block *block = OpenBlock();
+	if (block == nullptr) {
+		fprintf(stderr, "No telemetry found, is a game running with the telemetry setting enabled?\n");
+		return 1;
+	}
+	// newer mods only append fields, which ReadSnapshot leaves out
+	if (block->header.magic != telemetry::MAGIC || block->header.version < telemetry::VERSION
+			|| block->header.snapshotSize < sizeof(telemetry::Snapshot)) {
+		fprintf(stderr, "Unsupported telemetry version %u\n", block->header.version);
+		return 1;
+	}
+
+	if (options.csv) {
+		printf("frame,algorithm,input,output,render_scale,sharpness,radius,gpu_ms,cpu_apply_ms,vram_in_use_mb,vram_cached_mb,samplers,stages_gpu_ms\n");
+	}
+	for (int sample = 0; options.count == 0 || sample < options.count; ++sample) {
+		if (sample > 0) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(options.intervalMs));
+		}
+		telemetry::Snapshot snapshot;
+		bool read = false;
+		for (int attempt = 0; attempt < 100 && !read; ++attempt) {
+			read = telemetry::ReadSnapshot(*block, snapshot);
+			if (!read) {
+				std::this_thread::yield();
+			}
+		}
+		if (!read) {
+			fprintf(stderr, "The telemetry was busy, skipping a sample\n");
+			continue;
+		}
+		PrintSnapshot(snapshot, options.csv);
+	}
+	return 0;
+}